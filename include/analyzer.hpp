@@ -0,0 +1,146 @@
+#ifndef ANALYZER_HPP
+#define ANALYZER_HPP
+
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <cctype>
+#include <cstddef>
+
+namespace notesearch {
+
+/**
+ * Token filters
+ *
+ * A filter is any type with `bool operator()(std::string& token) const`.
+ * It may rewrite the token in place and returns false to drop it.
+ * Filters are combined at compile time by Analyzer, so the per-token path
+ * is a chain of inlined calls without virtual dispatch.
+ */
+
+/**
+ * Drops tokens shorter than MinLength or longer than MaxLength bytes
+ * (long tokens are mostly base64, hashes and other blobs)
+ */
+template <size_t MinLength, size_t MaxLength>
+struct LengthFilter {
+    static_assert(MinLength <= MaxLength, "LengthFilter: MinLength > MaxLength");
+
+    bool operator()(std::string& token) const noexcept {
+        return token.size() >= MinLength && token.size() <= MaxLength;
+    }
+};
+
+/**
+ * Drops all-digit tokens with more than MaxDigits digits (ids, timestamps, phone numbers)
+ * Short numbers like years and version parts stay searchable.
+ */
+template <size_t MaxDigits>
+struct NumberFilter {
+    bool operator()(std::string& token) const noexcept {
+        if (token.size() <= MaxDigits) {
+            return true;
+        }
+        for (char c : token) {
+            if (!std::isdigit(static_cast<unsigned char>(c))) {
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+/**
+ * Check a lowercase token against the built-in English stopword list
+ */
+bool is_stopword(std::string_view token) noexcept;
+
+/**
+ * Drops English stopwords ("the", "and", "is" ...), which otherwise make up the longest posting lists
+ */
+struct StopwordFilter {
+    bool operator()(std::string& token) const noexcept {
+        return !is_stopword(token);
+    }
+};
+
+/**
+ * Reduce English plurals to their singular form in place
+ * ("queries" -> "query", "indexes" -> "index", "files" -> "file")
+ */
+void light_stem(std::string& token) noexcept;
+
+/**
+ * Light (plural only) stemming, so "file" finds "files"
+ * Deliberately weaker than Porter: it never conflates unrelated words.
+ */
+struct LightStemmer {
+    bool operator()(std::string& token) const noexcept {
+        light_stem(token);
+        return true;
+    }
+};
+
+/**
+ * Analyzer splits text into lowercase alphanumeric tokens and runs each token
+ * through Filters in order. A token dropped by one filter is not seen by the next.
+ *
+ * @tparam Filters Token filters, applied left to right
+ */
+template <typename... Filters>
+class Analyzer {
+public:
+    Analyzer() = default;
+    explicit Analyzer(Filters... filters) : filters_(std::move(filters)...) {}
+
+    /**
+     * Tokenize and filter text, calling sink(std::string&&) for every surviving token
+     */
+    template <typename Sink>
+    void analyze(std::string_view text, Sink&& sink) const {
+        std::string token;
+        token.reserve(16);
+
+        for (char c : text) {
+            unsigned char byte = static_cast<unsigned char>(c);
+            if (std::isalnum(byte)) {
+                token += static_cast<char>(std::tolower(byte));
+            } else if (!token.empty()) {
+                emit(token, sink);
+            }
+        }
+        if (!token.empty()) {
+            emit(token, sink);
+        }
+    }
+
+    /**
+     * Run the filter chain on a single, already lowercased token
+     * @return false if a filter dropped it
+     */
+    bool filter(std::string& token) const {
+        return std::apply([&token](const auto&... filter) { return (filter(token) && ...); }, filters_);
+    }
+
+private:
+    std::tuple<Filters...> filters_;
+
+    template <typename Sink>
+    void emit(std::string& token, Sink& sink) const {
+        if (filter(token)) {
+            sink(std::move(token));
+        }
+        token.clear();
+    }
+};
+
+/**
+ * The analyzer used for both indexing and queries
+ * Changing it changes which terms are in the index, so both sides always go through tokenize().
+ */
+using DefaultAnalyzer = Analyzer<LengthFilter<2, 64>, NumberFilter<8>, StopwordFilter, LightStemmer>;
+
+} // namespace notesearch
+
+#endif // ANALYZER_HPP
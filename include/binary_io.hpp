@@ -0,0 +1,113 @@
+#ifndef BINARY_IO_HPP
+#define BINARY_IO_HPP
+
+#include <string>
+#include <string_view>
+#include <fstream>
+#include <filesystem>
+#include <cstdint>
+#include <cstddef>
+
+namespace notesearch {
+
+/**
+ * Append an unsigned LEB128 varint (7 bits per byte, low bits first)
+ */
+void append_varint(std::string& out, uint64_t value);
+
+/**
+ * Read a varint from bytes starting at pos, advances pos
+ * @return false if the bytes end inside the varint or it is longer than 10 bytes
+ */
+bool read_varint(std::string_view bytes, size_t& pos, uint64_t& value) noexcept;
+
+/**
+ * CRC-32 (IEEE, as in zip and PNG) of bytes
+ * @param crc CRC of the bytes before, to checksum data in pieces
+ */
+uint32_t crc32(std::string_view bytes, uint32_t crc = 0) noexcept;
+
+/**
+ * Buffered binary file output for the persistent index files
+ * Errors are sticky: check close() (or ok()) once at the end instead of after every put.
+ */
+class BinaryWriter {
+public:
+    BinaryWriter() = default;
+
+    // Non-copyable
+    BinaryWriter(const BinaryWriter&) = delete;
+    BinaryWriter& operator=(const BinaryWriter&) = delete;
+
+    /**
+     * Create or truncate the file
+     */
+    bool open(const std::filesystem::path& path);
+
+    void put_byte(uint8_t value);
+    void put_varint(uint64_t value);
+    void put_u64(uint64_t value);   // fixed 8 bytes little endian (hashes)
+    void put_bytes(std::string_view bytes);
+    void put_string(std::string_view text) { put_varint(text.size()); put_bytes(text); }
+
+    /**
+     * Flush and close
+     * @return false if any write failed
+     */
+    bool close();
+
+    bool ok() const noexcept { return ok_; }
+    uint64_t bytes_written() const noexcept { return written_ + buffer_.size(); }
+
+private:
+    static constexpr size_t buffer_size = 1 << 20;
+
+    std::ofstream file_;
+    std::string buffer_;
+    uint64_t written_ = 0;
+    bool ok_ = false;
+
+    void flush();
+};
+
+/**
+ * Buffered binary file input, counterpart of BinaryWriter
+ * A failed get leaves ok() false, all later gets fail as well.
+ */
+class BinaryReader {
+public:
+    BinaryReader() = default;
+
+    // Non-copyable
+    BinaryReader(const BinaryReader&) = delete;
+    BinaryReader& operator=(const BinaryReader&) = delete;
+
+    bool open(const std::filesystem::path& path);
+
+    bool get_byte(uint8_t& value);
+    bool get_varint(uint64_t& value);
+    bool get_u64(uint64_t& value);
+    bool get_bytes(size_t size, std::string& out);
+    bool get_string(std::string& out);
+
+    /**
+     * Look at the next byte without consuming it
+     */
+    bool peek_byte(uint8_t& value);
+
+    bool ok() const noexcept { return ok_; }
+
+private:
+    static constexpr size_t buffer_size = 1 << 20;
+
+    std::ifstream file_;
+    std::string buffer_;
+    size_t pos_ = 0;
+    bool ok_ = false;
+
+    bool fill();   // refill once buffer_ is used up, false at end of file
+};
+
+} // namespace notesearch
+
+#endif // BINARY_IO_HPP
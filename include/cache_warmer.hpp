@@ -0,0 +1,97 @@
+#ifndef CACHE_WARMER_HPP
+#define CACHE_WARMER_HPP
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <filesystem>
+#include <cstdint>
+#include "index.hpp"
+#include "document_store.hpp"
+
+namespace notesearch {
+
+/**
+ * HotTerms counts how often each query term is searched for
+ *
+ * The query server records every query (SearchEngine::set_hot_terms()) and saves the counts
+ * next to the index on shutdown (hot_terms.bin), the next start warms the caches with the
+ * hottest terms (see warm_cache()). Counts loaded from an earlier run are halved, so terms
+ * that stop being searched fade out after a few restarts.
+ *
+ * record() is thread safe, every server worker records into the same HotTerms.
+ */
+class HotTerms {
+public:
+    static constexpr size_t max_tracked = 1 << 16;   // more distinct terms: the rarer half is dropped
+    static constexpr size_t max_saved = 4096;        // hottest terms written by save()
+
+    /**
+     * Count one query, terms must be unique within it
+     */
+    void record(const std::vector<std::string>& terms);
+
+    /**
+     * The count hottest terms with their counts, hottest first
+     */
+    std::vector<std::pair<std::string, uint64_t>> hottest(size_t count) const;
+
+    size_t size() const;
+
+    /**
+     * Write the hottest terms (atomically: temporary file, then rename)
+     */
+    bool save(const std::filesystem::path& path, std::string* error = nullptr) const;
+
+    /**
+     * Add the counts saved by an earlier run, halved; a missing file is not an error
+     */
+    bool load(const std::filesystem::path& path, std::string* error = nullptr);
+
+private:
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, uint64_t> counts_;
+
+    void prune();   // mutex must be held
+};
+
+/**
+ * Settings of warm_cache()
+ */
+struct WarmupOptions {
+    size_t max_terms = 256;             // hottest terms to run
+    size_t results_per_term = 20;       // top hits per term whose content is read ahead
+    uint64_t max_bytes = 256ull << 20;  // stop after requesting this much content
+};
+
+/**
+ * What warm_cache() did
+ */
+struct WarmupStats {
+    size_t terms = 0;
+    size_t documents = 0;
+    uint64_t bytes = 0;                 // content pages requested from the operating system
+    double elapsed_ms = 0.0;
+    bool stopped = false;               // interrupted through the stop flag
+};
+
+/**
+ * Warm the caches for the hottest recorded terms, meant for a background thread at startup
+ *
+ * The index itself is read into memory by InvertedIndex::load(), so a cold start pays for the
+ * content blob: the first queries fault in the pages of their top results one by one (the blob is
+ * mapped for random access). warm_cache() runs each hot term as a query, which walks its posting
+ * lists once, and asks the operating system to read the content of the top hits ahead
+ * (DocumentStore::prefetch_content()), so the snippets of the first real queries come from memory.
+ *
+ * @param stop Optional, set it to end the warm-up early (server shutdown)
+ */
+WarmupStats warm_cache(const InvertedIndex& index, const DocumentStore& doc_store, const HotTerms& hot_terms,
+                       const WarmupOptions& options = {}, const std::atomic<bool>* stop = nullptr);
+
+} // namespace notesearch
+
+#endif // CACHE_WARMER_HPP
@@ -0,0 +1,37 @@
+#ifndef COMPRESSION_HPP
+#define COMPRESSION_HPP
+
+#include <string>
+#include <string_view>
+#include <cstddef>
+#include <cstdint>
+
+namespace notesearch {
+
+/**
+ * LZ77 block compression in the LZ4 block format
+ *
+ * Greedy matching with a small hash table: fast to compress, very fast to decompress,
+ * typically 2-3x on source code and prose. Blocks are independent of each other.
+ */
+
+/**
+ * Compress a block
+ * @return Compressed bytes (may be larger than the input for incompressible data)
+ */
+std::string compress_block(std::string_view input);
+
+/**
+ * Decompress a block produced by compress_block()
+ * @param compressed The compressed bytes
+ * @param raw_size Size of the original input
+ * @param out Receives the decompressed bytes
+ * @param limit Stop once at least this many bytes are decoded (out may be a little longer)
+ * @return false if the block is corrupt or does not decompress to raw_size bytes
+ */
+bool decompress_block(std::string_view compressed, size_t raw_size, std::string& out,
+                      size_t limit = SIZE_MAX);
+
+} // namespace notesearch
+
+#endif // COMPRESSION_HPP
@@ -0,0 +1,120 @@
+#ifndef CONTENT_STORE_HPP
+#define CONTENT_STORE_HPP
+
+#include <string>
+#include <string_view>
+#include <memory>
+#include <vector>
+#include <filesystem>
+#include <cstdint>
+
+namespace notesearch {
+
+/**
+ * Location of one document's content in the ContentStore
+ */
+struct ContentRef {
+    uint64_t offset = 0;        // byte offset in the blob
+    uint32_t stored_size = 0;   // bytes in the blob
+    uint32_t raw_size = 0;      // bytes after decompression (== stored_size: stored uncompressed)
+};
+
+/**
+ * ContentStore keeps document content out of the heap
+ *
+ * Content is compressed per document (compress_block) and appended to a blob file,
+ * which is memory mapped for reading. Only documents that are actually read (the
+ * top-k results of a query) are decompressed, so resident memory does not grow with
+ * the size of the corpus. By default the blob is a temporary file that is removed when the
+ * store goes away; if it cannot be created the store falls back to an in-memory blob.
+ * create() / open() use a named file instead, which is kept (persistent index), open_read_only()
+ * reads one without ever writing to it.
+ *
+ * append() and read() are thread safe.
+ */
+class ContentStore {
+public:
+    ContentStore();
+    ~ContentStore();
+
+    // Non-copyable, movable
+    ContentStore(const ContentStore&) = delete;
+    ContentStore& operator=(const ContentStore&) = delete;
+    ContentStore(ContentStore&&) noexcept;
+    ContentStore& operator=(ContentStore&&) noexcept;
+
+    /**
+     * Use a new, named blob file that is kept when the store goes away
+     * Must be called before the first append(), an existing file is truncated
+     * @return false if the file cannot be created
+     */
+    bool create(const std::filesystem::path& blob_path, std::string* error = nullptr);
+
+    /**
+     * Use an existing blob file (written through create()), appends go to its end
+     * @return false if the file cannot be opened
+     */
+    bool open(const std::filesystem::path& blob_path, std::string* error = nullptr);
+
+    /**
+     * Use an existing blob file for reading only, content added later is kept in memory
+     * For processes that only query a persistent index while another one may update it: the
+     * file is never written, cut or grown by this store.
+     * @return false if the file cannot be opened
+     */
+    bool open_read_only(const std::filesystem::path& blob_path, std::string* error = nullptr);
+
+    /**
+     * Compress and append content
+     * @return Where the content was stored
+     */
+    ContentRef append(std::string_view content);
+
+    /**
+     * Compress and store content at a given offset (replaying an update log, see IndexUpdater)
+     * If the blob already holds exactly these bytes there (written before a crash), nothing is
+     * written. Otherwise the blob is cut at offset and the content appended; an offset past the
+     * end (the blob lost its tail) appends at the end. A read-only store never cuts the file, content
+     * that is not in it goes to memory.
+     * @return Where the content is stored
+     */
+    ContentRef append_at(uint64_t offset, std::string_view content);
+
+    /**
+     * Read and decompress content
+     * @param max_bytes Only decompress about this much of the beginning (may return a little more)
+     * @return The content, empty if ref is invalid or the blob is damaged
+     */
+    std::string read(const ContentRef& ref, size_t max_bytes = SIZE_MAX) const;
+
+    /**
+     * Ask the operating system to read the pages of these documents ahead (cache warming)
+     * Returns at once, the reads happen in the background; later read() calls find the pages
+     * resident instead of faulting them in one by one. Does nothing for the in-memory fallback.
+     * @return Bytes requested (whole pages, neighbouring documents merged)
+     */
+    uint64_t prefetch(const std::vector<ContentRef>& refs) const;
+
+    /**
+     * Drop all content (truncates the blob)
+     */
+    void clear();
+
+    /**
+     * Bytes in the blob
+     */
+    uint64_t stored_bytes() const noexcept;
+
+    /**
+     * True if content lives in a mapped file, false if the in-memory fallback is used
+     */
+    bool is_file_backed() const noexcept;
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> impl_;
+};
+
+} // namespace notesearch
+
+#endif // CONTENT_STORE_HPP
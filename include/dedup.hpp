@@ -0,0 +1,102 @@
+#ifndef DEDUP_HPP
+#define DEDUP_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <array>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+#include "doc_id_set.hpp"
+#include "tokenizer.hpp"
+
+namespace notesearch {
+
+/**
+ * 64 bit hash of a byte string (FNV-1a)
+ * Used to find exact duplicate content, matches still have to be compared byte by byte.
+ */
+uint64_t hash_bytes(std::string_view bytes) noexcept;
+
+/**
+ * SimHash fingerprint of a token sequence
+ *
+ * Every distinct token votes on each of the 64 bits with its hash, the fingerprint keeps
+ * the majority. Documents that share most of their vocabulary end up a few bits apart,
+ * so lightly edited copies can be found by Hamming distance.
+ */
+uint64_t simhash(const std::vector<std::string>& tokens);
+
+/**
+ * SimHash fingerprint of a counted document, the same as simhash() of its tokens
+ * (up to hash collisions) without hashing them again
+ */
+uint64_t simhash(const TermCounter& terms);
+
+/**
+ * Number of differing bits between two fingerprints
+ */
+inline unsigned hamming_distance(uint64_t a, uint64_t b) noexcept {
+    return popcount64(a ^ b);
+}
+
+/**
+ * NearDuplicateIndex finds a fingerprint within max_distance bits of a query fingerprint
+ *
+ * The fingerprint is split into max_distance + 1 bands of 16 bits. Two fingerprints
+ * with at most max_distance differing bits agree exactly in at least one band
+ * (pigeonhole), so only documents sharing a band value are compared.
+ */
+class NearDuplicateIndex {
+public:
+    static constexpr unsigned max_distance = 3;
+    static constexpr uint32_t no_match = UINT32_MAX;
+
+    /**
+     * Find a document whose fingerprint is within max_distance bits
+     * @return Its document ID (the closest one), or no_match
+     */
+    uint32_t find(uint64_t fingerprint) const;
+
+    /**
+     * Register the fingerprint of a document
+     */
+    void add(uint32_t doc_id, uint64_t fingerprint);
+
+    /**
+     * Call f(doc_id, fingerprint) for every registered document, in the order they were added
+     */
+    template <typename F>
+    void for_each(F&& f) const {
+        for (const auto& entry : entries_) {
+            f(entry.doc_id, entry.fingerprint);
+        }
+    }
+
+    /**
+     * Heap bytes used by the band tables
+     */
+    size_t memory_bytes() const noexcept;
+
+    void clear() noexcept;
+
+private:
+    static constexpr size_t band_count = max_distance + 1;
+
+    struct Entry {
+        uint32_t doc_id;
+        uint64_t fingerprint;
+    };
+
+    std::vector<Entry> entries_;
+    std::array<std::unordered_map<uint16_t, std::vector<uint32_t>>, band_count> bands_;  // band value -> entries_ index
+
+    static uint16_t band(uint64_t fingerprint, size_t i) noexcept {
+        return static_cast<uint16_t>(fingerprint >> (16 * i));
+    }
+};
+
+} // namespace notesearch
+
+#endif // DEDUP_HPP
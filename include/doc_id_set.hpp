@@ -0,0 +1,241 @@
+#ifndef DOC_ID_SET_HPP
+#define DOC_ID_SET_HPP
+
+#include <vector>
+#include <memory_resource>
+#include <cstdint>
+#include <cstddef>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace notesearch {
+
+// Index of the lowest set bit (bits must not be 0)
+inline unsigned lowest_set_bit(uint64_t bits) noexcept {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, bits);
+    return static_cast<unsigned>(index);
+#else
+    return static_cast<unsigned>(__builtin_ctzll(bits));
+#endif
+}
+
+// Number of set bits
+inline unsigned popcount64(uint64_t bits) noexcept {
+#ifdef _MSC_VER
+    return static_cast<unsigned>(__popcnt64(bits));
+#else
+    return static_cast<unsigned>(__builtin_popcountll(bits));
+#endif
+}
+
+/**
+ * DocIdSet is a compressed set of document IDs (roaring bitmap layout)
+ *
+ * IDs are split into a 16 bit chunk key and a 16 bit low part. Each chunk is
+ * stored in the cheaper of two containers:
+ * - array:  sorted uint16_t values, for chunks with up to 4096 documents (2 bytes per doc)
+ * - bitmap: 65536 bits (8 KB), for denser chunks (fixed cost, O(1) membership)
+ *
+ * Both live in one uint16_t vector, so an array container costs 16 bytes plus its values.
+ *
+ * Used for posting lists, query filters, candidate sets and deletion tombstones.
+ * All set operations work on any combination of containers.
+ *
+ * Memory comes from a std::pmr resource (the default heap unless given), so query evaluation can
+ * keep its temporary sets in a QueryArena. Copies go to the default resource unless another one is
+ * passed, assignment keeps the target's resource.
+ */
+class DocIdSet {
+public:
+    using allocator_type = std::pmr::polymorphic_allocator<std::byte>;
+
+    DocIdSet() = default;
+    explicit DocIdSet(const allocator_type& allocator)
+        : containers_(allocator) {}
+    DocIdSet(const DocIdSet& other, const allocator_type& allocator)
+        : containers_(other.containers_, allocator) {}
+    DocIdSet(DocIdSet&& other, const allocator_type& allocator)
+        : containers_(std::move(other.containers_), allocator) {}
+    DocIdSet(const DocIdSet&) = default;
+    DocIdSet(DocIdSet&&) noexcept = default;
+    DocIdSet& operator=(const DocIdSet&) = default;
+    DocIdSet& operator=(DocIdSet&&) = default;
+
+    allocator_type get_allocator() const noexcept { return containers_.get_allocator(); }
+
+    /**
+     * Add a document (fastest when IDs arrive in ascending order)
+     */
+    void add(uint32_t doc_id);
+
+    /**
+     * Remove a document
+     */
+    void remove(uint32_t doc_id);
+
+    /**
+     * Check whether a document is in the set
+     */
+    bool contains(uint32_t doc_id) const noexcept;
+
+    /**
+     * Number of documents in the set
+     */
+    size_t size() const noexcept;
+
+    bool empty() const noexcept { return containers_.empty(); }
+
+    /**
+     * Largest document ID in the set (set must not be empty)
+     */
+    uint32_t max() const noexcept;
+
+    /**
+     * Number of documents in the set smaller than doc_id
+     */
+    size_t rank(uint32_t doc_id) const noexcept;
+
+    /**
+     * Intersect in place (this = this AND other)
+     */
+    DocIdSet& and_with(const DocIdSet& other);
+
+    /**
+     * Union in place (this = this OR other)
+     */
+    DocIdSet& or_with(const DocIdSet& other);
+
+    /**
+     * Difference in place (this = this AND NOT other)
+     */
+    DocIdSet& and_not(const DocIdSet& other);
+
+    /**
+     * Replace the set by the IDs whose bit is set (ID i = bit i % 64 of words[i / 64])
+     * Dense chunks are copied as bitmaps, so a set from a column scan costs no work per ID.
+     */
+    void assign_bits(const uint64_t* words, size_t word_count);
+
+    /**
+     * Call f(doc_id) for every document in ascending order
+     */
+    template <typename F>
+    void for_each(F&& f) const {
+        for (const auto& container : containers_) {
+            uint32_t high = static_cast<uint32_t>(container.key) << 16;
+            if (container.bitmap) {
+                for (size_t word = 0; word < container.data.size(); ++word) {
+                    uint64_t bits = container.data[word];
+                    while (bits) {
+                        f(high | static_cast<uint32_t>(word * 16 + lowest_set_bit(bits)));
+                        bits &= bits - 1;  // niedrigstes gesetztes Bit löschen
+                    }
+                }
+            } else {
+                for (uint16_t low : container.data) {
+                    f(high | low);
+                }
+            }
+        }
+    }
+
+    /**
+     * Like for_each(), but stops as soon as f returns false
+     * @return false if f stopped the iteration
+     */
+    template <typename F>
+    bool for_each_while(F&& f) const {
+        for (const auto& container : containers_) {
+            uint32_t high = static_cast<uint32_t>(container.key) << 16;
+            if (container.bitmap) {
+                for (size_t word = 0; word < container.data.size(); ++word) {
+                    uint64_t bits = container.data[word];
+                    while (bits) {
+                        if (!f(high | static_cast<uint32_t>(word * 16 + lowest_set_bit(bits)))) {
+                            return false;
+                        }
+                        bits &= bits - 1;
+                    }
+                }
+            } else {
+                for (uint16_t low : container.data) {
+                    if (!f(high | low)) {
+                        return false;
+                    }
+                }
+            }
+        }
+        return true;
+    }
+
+    /**
+     * Heap bytes used by the containers
+     */
+    size_t memory_bytes() const noexcept;
+
+    /**
+     * Heap bytes reserved but unused
+     */
+    size_t slack_bytes() const noexcept;
+
+    /**
+     * Release unused capacity (call after bulk building)
+     */
+    void shrink_to_fit();
+
+    void clear() noexcept;
+
+    bool operator==(const DocIdSet& other) const noexcept;
+    bool operator!=(const DocIdSet& other) const noexcept { return !(*this == other); }
+
+private:
+    static constexpr size_t array_limit = 4096;          // larger chunks become bitmaps
+    static constexpr size_t bitmap_words = 65536 / 16;   // 16 bit words
+
+    struct Container {
+        using allocator_type = std::pmr::polymorphic_allocator<uint16_t>;
+
+        uint16_t key = 0;                // high 16 bits of the IDs in this chunk
+        bool bitmap = false;             // data holds bitmap_words bit words instead of sorted values
+        uint32_t cardinality = 0;
+        std::pmr::vector<uint16_t> data;
+
+        // allocator aware, so the containers of a set take its resource
+        Container() = default;
+        explicit Container(const allocator_type& allocator)
+            : data(allocator) {}
+        Container(const Container& other, const allocator_type& allocator)
+            : key(other.key), bitmap(other.bitmap), cardinality(other.cardinality), data(other.data, allocator) {}
+        Container(Container&& other, const allocator_type& allocator)
+            : key(other.key), bitmap(other.bitmap), cardinality(other.cardinality),
+              data(std::move(other.data), allocator) {}
+        Container(const Container&) = default;
+        Container(Container&&) noexcept = default;
+        Container& operator=(const Container&) = default;
+        Container& operator=(Container&&) = default;
+
+        bool contains(uint16_t low) const noexcept;
+        bool add(uint16_t low);          // true if newly added
+        bool remove(uint16_t low);       // true if it was present
+        void to_bitmap();
+        void to_array();
+        void normalize();                // recount and pick the cheaper container after an operation
+    };
+
+    std::pmr::vector<Container> containers_;  // sorted by key, never holds empty containers
+
+    Container* find_container(uint16_t key) noexcept;
+    const Container* find_container(uint16_t key) const noexcept;
+    Container& get_or_create(uint16_t key);
+
+    static void and_containers(Container& a, const Container& b);
+    static void or_containers(Container& a, const Container& b);
+    static void and_not_containers(Container& a, const Container& b);
+};
+
+} // namespace notesearch
+
+#endif // DOC_ID_SET_HPP
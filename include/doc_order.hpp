@@ -0,0 +1,54 @@
+#ifndef DOC_ORDER_HPP
+#define DOC_ORDER_HPP
+
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include "document_store.hpp"
+#include "index.hpp"
+
+namespace notesearch {
+
+/**
+ * How document IDs are assigned after a build
+ */
+enum class DocOrder : uint8_t {
+    scan,       // as the scanner found the files (no reordering)
+    path,       // sorted by path, files of a directory get neighbouring IDs
+    bisection   // recursive graph bisection over the content terms, starting from path order
+};
+
+/**
+ * Parse "scan", "path" or "bisect"
+ * @return false for an unknown name
+ */
+bool parse_doc_order(std::string_view name, DocOrder& order);
+
+/**
+ * Compute a new document order
+ *
+ * bisection splits the documents in two halves and swaps documents between them while
+ * that lowers the estimated cost of the posting gaps (log2 of the gap per posting), then
+ * recurses into both halves. Documents sharing many terms end up with close IDs, which
+ * shrinks the deltas in posting lists and keeps intersections within fewer containers.
+ * Deleted documents go to the end.
+ *
+ * @return new_ids[old ID] = new ID
+ */
+std::vector<uint32_t> compute_doc_order(const InvertedIndex& index, const DocumentStore& doc_store, DocOrder order);
+
+/**
+ * Reorder the documents of a built index: compute_doc_order() applied to the store and
+ * every posting list and filter
+ */
+void reorder_documents(InvertedIndex& index, DocumentStore& doc_store, DocOrder order);
+
+/**
+ * Average cost of a content posting in bits, log2 of the gap to the previous document
+ * (what a gap-encoded list needs at least, lower is better)
+ */
+double posting_gap_bits(const InvertedIndex& index);
+
+} // namespace notesearch
+
+#endif // DOC_ORDER_HPP
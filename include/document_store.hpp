@@ -2,27 +2,67 @@
 #define DOCUMENT_STORE_HPP
 
 #include <string>
+#include <string_view>
 #include <vector>
+#include <unordered_map>
 #include <cstdint>
+#include <optional>
 #include <filesystem>
+#include "doc_id_set.hpp"
+#include "content_store.hpp"
+#include "dedup.hpp"
+#include "metadata_columns.hpp"
 
 namespace notesearch {
 
 /**
  * Represents a single document in the index
+ * The content itself lives in the store's ContentStore, read it with DocumentStore::get_content()
  */
 struct Document {
     uint32_t id;
     std::string path;
-    std::string content;
+    ContentRef content_ref;
+    uint32_t duplicate_of;   // document with identical content, == id for originals
+    uint32_t cluster;        // near-duplicate cluster (ID of its first document)
     
-    Document(uint32_t doc_id, std::string doc_path, std::string doc_content)
-        : id(doc_id), path(std::move(doc_path)), content(std::move(doc_content)) {}
+    Document(uint32_t doc_id, std::string doc_path, ContentRef doc_content, uint32_t original)
+        : id(doc_id), path(std::move(doc_path)), content_ref(doc_content),
+          duplicate_of(original), cluster(original) {}
+};
+
+/**
+ * Memory breakdown of the document store in bytes
+ */
+struct StoreMemoryStats {
+    size_t document_slots = 0;   // Document objects in the vector
+    size_t vector_slack = 0;     // reserved but unused Document slots
+    size_t path_bytes = 0;       // heap bytes of stored paths
+    size_t tombstones = 0;       // set of deleted document IDs
+    size_t dedup_tables = 0;     // content hashes, copy lists and fingerprint bands
+    size_t metadata_columns = 0; // modified time and size per document
+    
+    // Content is not resident (compressed blob, mapped on demand), so not part of total()
+    uint64_t content_raw_bytes = 0;     // file content before compression
+    uint64_t content_stored_bytes = 0;  // compressed blob size
+    
+    size_t total() const noexcept {
+        return document_slots + vector_slack + path_bytes + tombstones + dedup_tables + metadata_columns;
+    }
 };
 
 /**
  * DocumentStore manages the collection of all indexed documents
- * Maps document IDs to file paths and content
+ * Maps document IDs to file paths and content (compressed in a ContentStore)
+ *
+ * Duplicates are detected while adding:
+ * - exact copies share the content of the first document with that content and should
+ *   not be indexed again (see is_duplicate()), only their paths are
+ * - near-duplicates (SimHash fingerprint within a few bits, see add_fingerprint())
+ *   get the same cluster ID so search() can collapse them into one result
+ *
+ * File size and modified time of every document are kept in MetadataColumns (metadata()),
+ * the size comes from the content, the modified time is set by the scanner (set_modified_time()).
  */
 class DocumentStore {
 public:
@@ -38,23 +78,158 @@ public:
     /**
      * Add a document to the store
      * @param file_path Path to the file
-     * @param content File content
-     * @return The assigned document ID
+     * @param content File content (compressed into the content store, not kept)
+     * @return The assigned document ID, check is_duplicate() before indexing the content
+     */
+    uint32_t add_document(const std::filesystem::path& file_path, std::string_view content);
+
+    /**
+     * Add a document whose content goes to a given offset of the blob (update log replay,
+     * see ContentStore::append_at()), otherwise the same as add_document() above
+     */
+    uint32_t add_document(const std::filesystem::path& file_path, std::string_view content,
+                          uint64_t content_offset);
+    
+    /**
+     * Size of the content blob, where the next added content goes
+     */
+    uint64_t content_bytes() const noexcept { return content_.stored_bytes(); }
+    
+    /**
+     * Keep the content in a named blob file instead of a temporary one (persistent index)
+     * Call on an empty store before adding documents
+     * @return false if the file cannot be created
+     */
+    bool create_content(const std::filesystem::path& blob_path, std::string* error = nullptr);
+    
+    /**
+     * Write documents, tombstones and duplicate detection state (documents.bin)
+     * The content stays in the blob given to create_content()
+     * @return false on a write error
      */
-    uint32_t add_document(const std::filesystem::path& file_path, std::string content);
+    bool save(const std::filesystem::path& documents_file, std::string* error = nullptr) const;
+    
+    /**
+     * Replace the store with one written by save(), reading content from its blob
+     * Adding documents afterwards appends to that blob and still finds duplicates of loaded ones
+     * @param read_only Never write the blob, added content is kept in memory (ContentStore::open_read_only())
+     * @return false if a file is missing or damaged, the store is then empty
+     */
+    bool load(const std::filesystem::path& documents_file, const std::filesystem::path& blob_path,
+              std::string* error = nullptr, bool read_only = false);
+    
+    /**
+     * Assign new document IDs (see reorder_documents())
+     * Documents, tombstones, copies, clusters and fingerprints all move to the new IDs,
+     * the content stays where it is in the blob.
+     * @param new_ids new_ids[old ID] = new ID, a permutation of 0..size()-1
+     */
+    void remap_documents(const std::vector<uint32_t>& new_ids);
     
     /**
      * Get document by ID
      * @param doc_id Document ID
-     * @return Pointer to document, or nullptr if not found
+     * @return Pointer to document, or nullptr if not found or deleted
      */
     const Document* get_document(uint32_t doc_id) const;
     
     /**
-     * Get total number of documents
+     * Read and decompress the content of a document
+     * @param max_bytes Only read about this much of the beginning (see ContentStore::read)
+     * @return The content, empty if the document does not exist or is deleted
+     */
+    std::string get_content(uint32_t doc_id, size_t max_bytes = SIZE_MAX) const;
+    
+    /**
+     * Have the content of these documents read ahead in the background (see ContentStore::prefetch)
+     * @return Bytes requested
+     */
+    uint64_t prefetch_content(const std::vector<uint32_t>& doc_ids) const;
+    
+    /**
+     * Check whether a document is an exact copy of an earlier one
+     * Its content is already in the index under duplicate_of(), index only its path.
+     */
+    bool is_duplicate(uint32_t doc_id) const noexcept {
+        return doc_id < documents_.size() && documents_[doc_id].duplicate_of != doc_id;
+    }
+    
+    /**
+     * Document holding the indexed content (doc_id itself for originals)
+     */
+    uint32_t duplicate_of(uint32_t doc_id) const noexcept {
+        return doc_id < documents_.size() ? documents_[doc_id].duplicate_of : doc_id;
+    }
+    
+    /**
+     * Exact copies of a document (added later with identical content)
+     */
+    const std::vector<uint32_t>& copies_of(uint32_t doc_id) const;
+    
+    /**
+     * Fingerprint an original document from its tokens and assign its cluster
+     * If an earlier document's SimHash is within NearDuplicateIndex::max_distance bits,
+     * the document joins that document's cluster. Very short documents stay alone.
+     */
+    void add_fingerprint(uint32_t doc_id, const std::vector<std::string>& tokens);
+    void add_fingerprint(uint32_t doc_id, const TermCounter& terms);
+    
+    /**
+     * Near-duplicate cluster of a document (exact copies share the cluster of their original)
+     */
+    uint32_t cluster_of(uint32_t doc_id) const noexcept {
+        return doc_id < documents_.size() ? documents_[doc_id].cluster : doc_id;
+    }
+    
+    /**
+     * Documents that share their cluster with at least one other document
+     * (near-duplicates and exact copies), all others are alone in their cluster
+     */
+    const DocIdSet& clustered_documents() const noexcept { return clustered_; }
+    
+    /**
+     * Record the last write time of a document's file (seconds since 1970, FileContent::modified_time())
+     */
+    void set_modified_time(uint32_t doc_id, int64_t modified) noexcept {
+        metadata_.set(MetadataField::modified, doc_id, modified);
+    }
+    
+    /**
+     * Modified time and size of all documents as columns by document ID (mtime: / size: filters)
+     */
+    const MetadataColumns& metadata() const noexcept { return metadata_; }
+    
+    /**
+     * Mark a document as deleted (tombstone)
+     * The ID is not reused and the index keeps its postings, search() masks them out.
+     * If the document is the original of live exact copies, the first of them becomes the
+     * original (the other copies and the content hash move to it). Its content was never
+     * indexed, the caller has to index it now (see remove_file()).
+     * @param promoted Optional, receives the copy that became the original, doc_id if none did
+     * @return false if the document does not exist or is already deleted
+     */
+    bool remove_document(uint32_t doc_id, uint32_t* promoted = nullptr);
+    
+    /**
+     * Check whether a document was deleted
+     */
+    bool is_deleted(uint32_t doc_id) const noexcept { return deleted_.contains(doc_id); }
+    
+    /**
+     * IDs of all deleted documents
+     */
+    const DocIdSet& deleted_documents() const noexcept { return deleted_; }
+    
+    /**
+     * Get total number of documents (including deleted ones, i.e. the ID range)
      */
     size_t size() const noexcept { return documents_.size(); }
     
+    /**
+     * Get number of documents that are not deleted
+     */
+    size_t live_count() const noexcept { return documents_.size() - deleted_.size(); }
+    
     /**
      * Check if store is empty
      */
@@ -66,13 +241,35 @@ public:
     void clear() noexcept;
     
     /**
-     * Get all documents (for iteration)
+     * Get a byte-level memory breakdown of the store
+     */
+    StoreMemoryStats memory_usage() const noexcept;
+    
+    /**
+     * Get all documents (for iteration, includes deleted ones, see is_deleted())
      */
     const std::vector<Document>& get_all_documents() const noexcept { return documents_; }
 
 private:
-    std::vector<Document> documents_;
+    static constexpr size_t min_duplicate_bytes = 64;    // smaller files (stubs, empty files) are never copies
+    static constexpr size_t min_fingerprint_tokens = 16; // SimHash of fewer tokens is too noisy
+    
+    std::vector<Document> documents_;   // documents_[id], never erased
+    DocIdSet deleted_;                  // tombstones
+    ContentStore content_;              // compressed content, append only
+    MetadataColumns metadata_;          // modified time and size by document ID
+    
+    // Duplikat Erkennung
+    std::unordered_map<uint64_t, uint32_t> content_hashes_;            // hash_bytes(content) -> original
+    std::unordered_map<uint32_t, std::vector<uint32_t>> copies_;       // original -> exact copies
+    NearDuplicateIndex near_duplicates_;
+    DocIdSet clustered_;                                               // nicht allein im Cluster
     uint32_t next_id_ = 0;
+    
+    uint32_t insert_document(const std::filesystem::path& file_path, std::string_view content,
+                             std::optional<uint64_t> content_offset);
+    bool wants_fingerprint(uint32_t doc_id, size_t token_count) const noexcept;
+    void join_cluster(uint32_t doc_id, uint64_t fingerprint);
 };
 
 } // namespace notesearch
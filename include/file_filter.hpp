@@ -0,0 +1,77 @@
+#ifndef FILE_FILTER_HPP
+#define FILE_FILTER_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <filesystem>
+
+namespace notesearch {
+
+/**
+ * IgnoreRules holds the .gitignore / .ignore patterns of one directory
+ * and links to the rules of its parent directory.
+ *
+ * Supported syntax: '#' comments, '!' negation, trailing '/' (directories only),
+ * leading or inner '/' (anchored to the directory of the ignore file),
+ * '*', '?', '[...]' and '**'. Within one file the last matching pattern wins,
+ * deeper directories override their parents.
+ */
+class IgnoreRules {
+public:
+    /**
+     * Built-in rules: VCS metadata, node_modules, caches and lockfiles
+     */
+    static std::shared_ptr<const IgnoreRules> defaults();
+
+    /**
+     * Load .gitignore and .ignore from a directory
+     * @return New rules chained to parent, or parent itself if the directory has no ignore file
+     */
+    static std::shared_ptr<const IgnoreRules> load(const std::filesystem::path& dir,
+                                                   std::shared_ptr<const IgnoreRules> parent);
+
+    /**
+     * Check whether a path is excluded
+     * @param path Path of the file or directory
+     * @param is_dir True for directories (patterns ending in '/' only match directories)
+     */
+    bool is_ignored(const std::filesystem::path& path, bool is_dir) const;
+
+private:
+    struct Pattern {
+        std::string glob;
+        bool negated = false;
+        bool dir_only = false;
+        bool anchored = false;   // match against the path relative to base_, not just the name
+    };
+
+    std::string base_;           // directory of the ignore file, generic format with trailing '/'
+    std::vector<Pattern> patterns_;
+    std::shared_ptr<const IgnoreRules> parent_;
+
+    void add_pattern(std::string_view line);
+};
+
+/**
+ * Result of sniffing the first block of a file
+ */
+enum class ContentKind {
+    text,
+    binary,      // NUL bytes or mostly control characters
+    generated,   // "@generated", "DO NOT EDIT", "Code generated by" ...
+    minified     // very long lines (minified JS/JSON, data blobs)
+};
+
+// Bytes looked at by sniff_content()
+constexpr size_t sniff_block_size = 8 * 1024;
+
+/**
+ * Classify content from its first block (at most sniff_block_size bytes are inspected)
+ */
+ContentKind sniff_content(std::string_view first_block) noexcept;
+
+} // namespace notesearch
+
+#endif // FILE_FILTER_HPP
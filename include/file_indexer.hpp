@@ -0,0 +1,76 @@
+#ifndef FILE_INDEXER_HPP
+#define FILE_INDEXER_HPP
+
+#include <string>
+#include <string_view>
+#include <optional>
+#include <filesystem>
+#include <cstdint>
+#include "document_store.hpp"
+#include "tokenizer.hpp"
+
+namespace notesearch {
+
+/**
+ * Index the content of an original document: fingerprint, terms and trigrams
+ * @param sink InvertedIndex or IndexBuilder
+ * @param terms Buffer, reused from document to document
+ */
+template <typename Sink>
+void index_content(DocumentStore& doc_store, Sink& sink, TermCounter& terms, uint32_t doc_id,
+                   std::string_view content) {
+    terms.count(content);
+    doc_store.add_fingerprint(doc_id, terms);
+    sink.index_document(doc_id, terms);
+    sink.index_trigrams(doc_id, content);
+}
+
+/**
+ * Add a file to the store and index it, the one sequence behind every way of indexing
+ * (index, update and its replay, the GUI)
+ *
+ * Exact copies of an earlier document are indexed by path only, their content is already
+ * in the index under the original.
+ * @param sink InvertedIndex or IndexBuilder
+ * @param terms Buffer, reused from file to file
+ * @param root Indexed directory (see InvertedIndex::index_path())
+ * @param modified_time Last write time of the file (FileContent::modified_time())
+ * @param content_offset Where the content goes in the blob (update log replay), default: appended
+ * @return The assigned document ID
+ */
+template <typename Sink>
+uint32_t add_file(DocumentStore& doc_store, Sink& sink, TermCounter& terms, const std::filesystem::path& file_path,
+                  std::string_view content, const std::filesystem::path& root, int64_t modified_time,
+                  std::optional<uint64_t> content_offset = std::nullopt) {
+    uint32_t doc_id = content_offset ? doc_store.add_document(file_path, content, *content_offset)
+                                     : doc_store.add_document(file_path, content);
+    doc_store.set_modified_time(doc_id, modified_time);  // mtime: filters and recent:
+    if (!doc_store.is_duplicate(doc_id)) {
+        index_content(doc_store, sink, terms, doc_id, content);
+    }
+    sink.index_path(doc_id, file_path, root);
+    return doc_id;
+}
+
+/**
+ * Delete a document (tombstone) and keep its exact copies searchable
+ * If the document was the original of live copies, the copy that takes its place gets its
+ * content indexed from the shared blob (see DocumentStore::remove_document()).
+ * @return false if the document does not exist or is already deleted
+ */
+template <typename Sink>
+bool remove_file(DocumentStore& doc_store, Sink& sink, TermCounter& terms, uint32_t doc_id) {
+    uint32_t promoted = doc_id;
+    if (!doc_store.remove_document(doc_id, &promoted)) {
+        return false;
+    }
+    if (promoted != doc_id) {
+        std::string content = doc_store.get_content(promoted);
+        index_content(doc_store, sink, terms, promoted, content);
+    }
+    return true;
+}
+
+} // namespace notesearch
+
+#endif // FILE_INDEXER_HPP
@@ -0,0 +1,149 @@
+#ifndef FILE_READER_HPP
+#define FILE_READER_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <functional>
+#include <filesystem>
+#include <cstddef>
+#include <cstdint>
+
+namespace notesearch {
+
+/**
+ * Why a load returned no content
+ */
+enum class LoadStatus {
+    ok,
+    unreadable,   // could not open / stat / read, or empty
+    too_large,    // larger than LoadOptions::max_size, nothing was read
+    rejected      // first block sniffed as binary, generated or minified, rest not read
+};
+
+// Files at least this large are memory mapped instead of read
+constexpr size_t default_mmap_threshold = 64 * 1024;
+
+struct LoadOptions {
+    size_t mmap_threshold = default_mmap_threshold;
+    size_t max_size = 0;          // 0 = no limit, checked before anything is read
+    bool sniff = false;           // reject binary / generated / minified files after the first block
+};
+
+/**
+ * FileContent owns the bytes of one file
+ * Large files are memory mapped, small files are read with a single read call into an
+ * exactly sized buffer. Either way view() hands out the bytes without another copy.
+ */
+class FileContent {
+public:
+    FileContent() = default;
+    ~FileContent();
+
+    // Non-copyable, movable (owns a mapping)
+    FileContent(const FileContent&) = delete;
+    FileContent& operator=(const FileContent&) = delete;
+    FileContent(FileContent&& other) noexcept;
+    FileContent& operator=(FileContent&& other) noexcept;
+
+    std::string_view view() const noexcept;
+    size_t size() const noexcept { return view().size(); }
+    bool empty() const noexcept { return size() == 0; }
+    bool is_mapped() const noexcept { return map_base_ != nullptr; }
+    LoadStatus status() const noexcept { return status_; }
+
+    /**
+     * Last write time in seconds since 1970 (UTC), taken from the open file, 0 if unknown
+     */
+    int64_t modified_time() const noexcept { return modified_time_; }
+
+    /**
+     * Take the bytes as a string: moves the read buffer, copies only if the file is mapped
+     */
+    std::string release_string();
+
+private:
+    friend FileContent load_file(const std::filesystem::path& file_path, const LoadOptions& options);
+
+    void reset() noexcept;
+
+    std::string buffer_;
+    void* map_base_ = nullptr;
+    size_t map_size_ = 0;
+    LoadStatus status_ = LoadStatus::unreadable;
+    int64_t modified_time_ = 0;
+};
+
+/**
+ * Load a file (mmap for large files, one read for small ones)
+ * @return The file content, empty if the file could not be opened or read (see status())
+ */
+FileContent load_file(const std::filesystem::path& file_path, const LoadOptions& options = LoadOptions{});
+
+/**
+ * FileIngestor keeps many file reads in flight on a small pool of reader threads
+ * and hands the loaded files to one consumer in submit order.
+ *
+ * Producers call submit() (thread safe) and close() when done, the consumer thread calls
+ * consume() which returns after the last file was delivered. At most max_in_flight loaded
+ * files wait for the consumer, so memory stays bounded on large trees.
+ */
+class FileIngestor {
+public:
+    using Consumer = std::function<void(const std::filesystem::path&, FileContent&)>;
+
+    explicit FileIngestor(size_t io_threads = 0, size_t max_in_flight = 64,
+                          LoadOptions load_options = LoadOptions{});
+    ~FileIngestor();
+
+    // Non-copyable, non-movable (reader threads reference this object)
+    FileIngestor(const FileIngestor&) = delete;
+    FileIngestor& operator=(const FileIngestor&) = delete;
+
+    /**
+     * Queue a file for reading
+     */
+    void submit(std::filesystem::path file_path);
+
+    /**
+     * Signal that no more files will be submitted
+     */
+    void close();
+
+    /**
+     * Deliver loaded files to consumer in submit order until close() was called and all files are delivered
+     */
+    void consume(const Consumer& consumer);
+
+private:
+    struct Loaded {
+        std::filesystem::path path;
+        FileContent content;
+    };
+
+    void reader_loop();
+
+    size_t max_in_flight_;
+    LoadOptions load_options_;
+
+    std::mutex mutex_;
+    std::condition_variable work_ready_;   // readers: new path or free slot
+    std::condition_variable file_ready_;   // consumer: next file loaded
+    std::deque<std::filesystem::path> pending_;
+    std::map<size_t, Loaded> loaded_;      // sequence number -> loaded file
+    size_t next_claim_ = 0;                // sequence number of pending_.front()
+    size_t next_consume_ = 0;
+    size_t submitted_ = 0;
+    bool closed_ = false;
+    bool stopping_ = false;
+    std::vector<std::thread> readers_;
+};
+
+} // namespace notesearch
+
+#endif // FILE_READER_HPP
@@ -4,17 +4,40 @@
 #include <string>
 #include <vector>
 #include <filesystem>
+#include <functional>
 #include <utility>
+#include "file_reader.hpp"
+#include "file_filter.hpp"
 
 namespace notesearch {
 
 /**
  * FileScanner recursively scans directories and reads file contents
  * Uses RAII and modern filesystem API
+ *
+ * The walk runs on several threads: each thread keeps its own queue of pending
+ * subdirectories and steals from the others when it runs dry, so slow readdir/stat
+ * calls (NFS, network home directories) overlap instead of running one after another.
+ *
+ * A filter stage keeps bytes we would throw away from being read at all:
+ * extension lookup and .gitignore / .ignore rules before a directory is entered or a
+ * file is opened, a size cap before reading, and a sniff of the first block that
+ * rejects binary, generated and minified files.
  */
 class FileScanner {
 public:
+    struct ScanOptions {
+        size_t walker_threads = 0;              // 0 = one per hardware thread, at least 4
+        size_t max_file_size = 8 * 1024 * 1024; // larger files are skipped, 0 = no limit
+        bool use_ignore_files = true;           // honor .gitignore / .ignore and built-in rules
+        bool sniff_content = true;              // skip binary, generated and minified files
+        size_t shard_count = 1;                 // > 1: only files with shard_of(path) == shard_index
+        size_t shard_index = 0;                 // (path relative to the root, see shard.hpp)
+    };
+    
     FileScanner() = default;
+    explicit FileScanner(ScanOptions options) : options_(options) {}
+    
     ~FileScanner() = default;
     
     // Non-copyable, movable
@@ -23,6 +46,17 @@ public:
     FileScanner(FileScanner&&) noexcept = default;
     FileScanner& operator=(FileScanner&&) noexcept = default;
     
+    using FileCallback = std::function<void(const std::filesystem::path&, FileContent&)>;
+    
+    /**
+     * Scan a directory recursively and stream all indexable files to a callback
+     * Files are read by a FileIngestor while the walk continues, the callback runs
+     * on the calling thread in discovery order. The content is only valid during the callback.
+     * @param root_path Root directory to scan
+     * @param on_file Called once per non-empty indexable file
+     */
+    void scan_directory(const std::filesystem::path& root_path, const FileCallback& on_file) const;
+    
     /**
      * Scan a directory recursively and return all indexable files
      * @param root_path Root directory to scan
@@ -35,7 +69,12 @@ public:
      * Get statistics about the scan
      */
     struct ScanStats {
+        size_t directories_scanned = 0;
+        size_t directories_ignored = 0;   // excluded by ignore rules, not descended into
         size_t files_scanned = 0;
+        size_t files_ignored = 0;         // excluded by ignore rules
+        size_t files_too_large = 0;       // over max_file_size
+        size_t files_rejected = 0;        // binary, generated or minified
         size_t files_indexed = 0;
         size_t total_bytes = 0;
     };
@@ -43,6 +82,7 @@ public:
     ScanStats get_last_scan_stats() const noexcept { return last_stats_; }
 
 private:
+    ScanOptions options_;
     mutable ScanStats last_stats_;
     
     /**
@@ -50,10 +90,6 @@ private:
      */
     bool should_index(const std::filesystem::path& file_path) const;
     
-    /**
-     * Read file content safely
-     */
-    std::string read_file(const std::filesystem::path& file_path) const;
 };
 
 } // namespace notesearch
@@ -0,0 +1,259 @@
+#ifndef FLAT_HASH_MAP_HPP
+#define FLAT_HASH_MAP_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include "dedup.hpp"
+#include "doc_id_set.hpp"
+
+namespace notesearch {
+
+/**
+ * Hash and lookup type of a FlatHashMap key
+ * String keys are looked up by string_view, so a lookup never builds a std::string, and hashed
+ * with hash_bytes(), the hash TermCounter already has for every term of a document.
+ */
+template <typename Key>
+struct FlatHashKey;
+
+template <>
+struct FlatHashKey<std::string> {
+    using lookup_type = std::string_view;
+    static uint64_t hash(std::string_view key) noexcept { return hash_bytes(key); }
+};
+
+template <>
+struct FlatHashKey<uint32_t> {
+    using lookup_type = uint32_t;
+    static uint64_t hash(uint32_t key) noexcept { return key; }  // FlatHashMap mixes the bits itself
+};
+
+/**
+ * FlatHashMap is an open addressing hash map in the layout of a Swiss table
+ *
+ * The table is an array of control bytes plus an array of entry indexes, one of each per slot.
+ * A control byte is either empty or holds 7 bits of its key's hash; a lookup loads the control
+ * bytes of a group of 8 slots as one word, finds the slots whose 7 bits match with a few integer
+ * operations and compares only their keys (almost always one). The entries themselves are kept
+ * densely in insertion order, so iterating is a scan over one vector and growing the table
+ * rebuilds only the two small arrays. Compared to std::unordered_map there is no heap node per
+ * entry and no pointer chain per lookup.
+ *
+ * Entries cannot be erased, the maps of the index only grow until clear(). Pointers to entries
+ * stay valid until the entry vector reallocates: an insertion beyond its capacity (see reserve()),
+ * shrink_to_fit() or clear().
+ */
+template <typename Key, typename Value>
+class FlatHashMap {
+public:
+    using key_type = Key;
+    using mapped_type = Value;
+    using value_type = std::pair<Key, Value>;
+    using lookup_type = typename FlatHashKey<Key>::lookup_type;
+    using iterator = value_type*;
+    using const_iterator = const value_type*;
+
+    iterator begin() noexcept { return entries_.data(); }
+    iterator end() noexcept { return entries_.data() + entries_.size(); }
+    const_iterator begin() const noexcept { return entries_.data(); }
+    const_iterator end() const noexcept { return entries_.data() + entries_.size(); }
+
+    size_t size() const noexcept { return entries_.size(); }
+    bool empty() const noexcept { return entries_.empty(); }
+
+    iterator find(lookup_type key) noexcept { return find(key, FlatHashKey<Key>::hash(key)); }
+    const_iterator find(lookup_type key) const noexcept { return find(key, FlatHashKey<Key>::hash(key)); }
+
+    /**
+     * Look up a key whose hash is already known (FlatHashKey<Key>::hash(key))
+     */
+    iterator find(lookup_type key, uint64_t hash) noexcept {
+        size_t index = lookup(key, hash);
+        return index != npos ? begin() + index : end();
+    }
+    const_iterator find(lookup_type key, uint64_t hash) const noexcept {
+        size_t index = lookup(key, hash);
+        return index != npos ? begin() + index : end();
+    }
+
+    /**
+     * The value of key, inserted default constructed if it is missing
+     */
+    Value& operator[](lookup_type key) { return try_emplace(key, FlatHashKey<Key>::hash(key)).first->second; }
+
+    /**
+     * Insert key with a default constructed value unless it is present, hash as for find()
+     * @return The entry of key, true if it was inserted
+     */
+    std::pair<iterator, bool> try_emplace(lookup_type key, uint64_t hash) {
+        size_t index = lookup(key, hash);
+        if (index != npos) {
+            return {begin() + index, false};
+        }
+        return {insert(hash, Key(key), Value()), true};
+    }
+
+    /**
+     * Insert an entry unless its key is present (then value is dropped)
+     */
+    std::pair<iterator, bool> emplace(Key key, Value value) {
+        uint64_t hash = FlatHashKey<Key>::hash(key);
+        size_t index = lookup(key, hash);
+        if (index != npos) {
+            return {begin() + index, false};
+        }
+        return {insert(hash, std::move(key), std::move(value)), true};
+    }
+
+    /**
+     * Make room for count entries without growing the table or moving entries
+     */
+    void reserve(size_t count) {
+        entries_.reserve(count);
+        if (!fits(count, control_.size())) {
+            rehash(table_size(count));
+        }
+    }
+
+    /**
+     * Release unused entry capacity (moves the entries)
+     */
+    void shrink_to_fit() { entries_.shrink_to_fit(); }
+
+    /**
+     * Remove all entries, the table keeps its size
+     */
+    void clear() noexcept {
+        entries_.clear();
+        std::fill(control_.begin(), control_.end(), empty_slot);
+    }
+
+    /**
+     * Heap bytes of the control bytes and entry indexes
+     */
+    size_t table_bytes() const noexcept { return control_.capacity() + slots_.capacity() * sizeof(uint32_t); }
+
+    /**
+     * Heap bytes of the entry vector (without what keys and values allocate themselves)
+     */
+    size_t entry_bytes() const noexcept { return entries_.capacity() * sizeof(value_type); }
+
+private:
+    static constexpr size_t group_width = 8;
+    static constexpr uint8_t empty_slot = 0x80;   // full slots hold 7 bits of the hash, high bit clear
+    static constexpr size_t npos = SIZE_MAX;
+    static constexpr uint64_t low_bits = 0x0101010101010101ull;
+    static constexpr uint64_t high_bits = 0x8080808080808080ull;
+
+    std::vector<value_type> entries_;
+    std::vector<uint8_t> control_;   // per slot: empty_slot or the 7 bit tag of the entry's hash
+    std::vector<uint32_t> slots_;    // per slot: index of the entry in entries_
+    size_t group_mask_ = 0;          // number of groups - 1
+    unsigned group_shift_ = 63;      // 64 - log2(number of groups)
+
+    // höchstens 7/8 belegt, mindestens ein leerer Slot beendet jede Suche
+    static bool fits(size_t count, size_t slot_count) noexcept { return count * 8 <= slot_count * 7; }
+
+    static size_t table_size(size_t count) noexcept {
+        size_t slot_count = 2 * group_width;
+        while (!fits(count, slot_count)) {
+            slot_count *= 2;
+        }
+        return slot_count;
+    }
+
+    // Fibonacci Hashing: die oberen Bits des Produkts hängen von allen Bits des Hashes ab (die unteren
+    // von FNV-1a und von kleinen Zahlen nicht), sie wählen die Gruppe, 7 Bits darunter sind das Tag
+    struct Probe {
+        size_t group;
+        uint8_t tag;
+    };
+    Probe probe(uint64_t hash) const noexcept {
+        uint64_t mixed = hash * 0x9e3779b97f4a7c15ull;
+        return {static_cast<size_t>(mixed >> group_shift_), static_cast<uint8_t>((mixed >> 32) & 0x7f)};
+    }
+
+    // Steuerbytes einer Gruppe als ein Wort, Byte i in Bits 8i .. 8i+7 (der Compiler macht daraus einen Load)
+    uint64_t load_group(size_t group) const noexcept {
+        const uint8_t* bytes = control_.data() + group * group_width;
+        uint64_t word = 0;
+        for (size_t i = 0; i < group_width; ++i) {
+            word |= static_cast<uint64_t>(bytes[i]) << (8 * i);
+        }
+        return word;
+    }
+
+    // hohes Bit in jedem Byte das gleich tag ist; ein Übertrag kann ein Byte über einem Treffer
+    // fälschlich markieren, aber nie ein leeres (die Schlüssel werden ohnehin verglichen)
+    static uint64_t match_tag(uint64_t word, uint8_t tag) noexcept {
+        uint64_t x = word ^ (low_bits * tag);
+        return (x - low_bits) & ~x & high_bits;
+    }
+
+    static uint64_t match_empty(uint64_t word) noexcept { return word & high_bits; }
+
+    size_t lookup(lookup_type key, uint64_t hash) const noexcept {
+        if (entries_.empty()) {
+            return npos;
+        }
+        Probe position = probe(hash);
+        for (size_t group = position.group;; group = (group + 1) & group_mask_) {
+            uint64_t word = load_group(group);
+            for (uint64_t hits = match_tag(word, position.tag); hits != 0; hits &= hits - 1) {
+                uint32_t index = slots_[group * group_width + lowest_set_bit(hits) / 8];
+                if (entries_[index].first == key) {
+                    return index;
+                }
+            }
+            if (match_empty(word) != 0) {
+                return npos;
+            }
+        }
+    }
+
+    iterator insert(uint64_t hash, Key key, Value value) {
+        if (!fits(entries_.size() + 1, control_.size())) {
+            rehash(control_.empty() ? table_size(entries_.size() + 1) : control_.size() * 2);
+        }
+        entries_.emplace_back(std::move(key), std::move(value));
+        place(hash, static_cast<uint32_t>(entries_.size() - 1));
+        return end() - 1;
+    }
+
+    // trägt einen Eintrag in den ersten freien Slot ab seiner Gruppe ein
+    void place(uint64_t hash, uint32_t index) noexcept {
+        Probe position = probe(hash);
+        for (size_t group = position.group;; group = (group + 1) & group_mask_) {
+            uint64_t empty = match_empty(load_group(group));
+            if (empty != 0) {
+                size_t slot = group * group_width + lowest_set_bit(empty) / 8;
+                control_[slot] = position.tag;
+                slots_[slot] = index;
+                return;
+            }
+        }
+    }
+
+    // neue Tabelle, die Einträge selbst bleiben wo sie sind
+    void rehash(size_t slot_count) {
+        control_.assign(slot_count, empty_slot);
+        slots_.assign(slot_count, 0);
+        group_mask_ = slot_count / group_width - 1;
+        group_shift_ = 64;
+        for (size_t groups = group_mask_ + 1; groups > 1; groups /= 2) {
+            --group_shift_;
+        }
+        for (size_t index = 0; index < entries_.size(); ++index) {
+            place(FlatHashKey<Key>::hash(entries_[index].first), static_cast<uint32_t>(index));
+        }
+    }
+};
+
+} // namespace notesearch
+
+#endif // FLAT_HASH_MAP_HPP
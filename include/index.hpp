@@ -2,26 +2,150 @@
 #define INDEX_HPP
 
 #include <string>
+#include <string_view>
 #include <vector>
-#include <unordered_map>
+#include <array>
+#include <filesystem>
 #include <cstdint>
 #include "document_store.hpp"
+#include "doc_id_set.hpp"
+#include "flat_hash_map.hpp"
+#include "tokenizer.hpp"
 
 namespace notesearch {
 
 /**
- * Posting represents a single occurrence of a term in a document
+ * PostingList holds the documents containing a term and how often the term occurs in each
+ *
+ * Document IDs live in a DocIdSet (compressed array for rare terms, bitmap for frequent ones),
+ * so lists can be combined with AND / OR / ANDNOT directly. Frequencies are stored in
+ * ascending document order next to it, saturating at 65535.
  */
-struct Posting {
-    uint32_t doc_id;       // Document ID
-    uint32_t term_freq;    // Frequency of term in this document
+class PostingList {
+public:
+    /**
+     * Add a document (or raise its frequency if already present)
+     * Appending in ascending document order is the fast path
+     */
+    void add(uint32_t doc_id, uint32_t term_freq);
+    
+    /**
+     * Number of documents containing the term
+     */
+    size_t size() const noexcept { return docs_.size(); }
+    
+    /**
+     * Documents containing the term
+     */
+    const DocIdSet& docs() const noexcept { return docs_; }
+    
+    /**
+     * Term frequency in a document, 0 if the document does not contain the term
+     */
+    uint32_t frequency(uint32_t doc_id) const noexcept;
+    
+    /**
+     * Call f(doc_id, term_freq) for every posting in ascending document order
+     */
+    template <typename F>
+    void for_each(F&& f) const {
+        size_t i = 0;
+        docs_.for_each([&](uint32_t doc_id) { f(doc_id, static_cast<uint32_t>(freqs_[i++])); });
+    }
+    
+    /**
+     * Like for_each(), but stops as soon as f returns false
+     * @return false if f stopped the iteration
+     */
+    template <typename F>
+    bool for_each_while(F&& f) const {
+        size_t i = 0;
+        return docs_.for_each_while([&](uint32_t doc_id) { return f(doc_id, static_cast<uint32_t>(freqs_[i++])); });
+    }
+    
+    size_t memory_bytes() const noexcept { return docs_.memory_bytes() + freqs_.capacity() * sizeof(uint16_t); }
+    size_t slack_bytes() const noexcept {
+        return docs_.slack_bytes() + (freqs_.capacity() - freqs_.size()) * sizeof(uint16_t);
+    }
+    
+    /**
+     * Release unused capacity (call after bulk indexing)
+     */
+    void shrink_to_fit();
+
+private:
+    DocIdSet docs_;
+    std::vector<uint16_t> freqs_;   // freqs_[rank of doc_id in docs_]
+};
+
+/**
+ * Indexed fields of a document, each with its own term dictionary
+ */
+enum class Field : uint8_t {
+    content,    // file content
+    filename,   // file name without extension
+    path        // names of the parent directories
+};
+
+constexpr size_t field_count = 3;
+
+/**
+ * Precomputed document filters (ext:, dir:)
+ */
+enum class FilterKind : uint8_t {
+    extension,  // lowercase extension without the dot, e.g. "md"
+    directory   // lowercase name of any parent directory, e.g. "notes"
+};
+
+/**
+ * What index_path() indexes for a file
+ */
+struct PathTerms {
+    std::vector<std::string> filename;      // tokens of the file name without extension (Field::filename)
+    std::vector<std::string> directories;   // tokens of the directory names below the root (Field::path)
+    std::string extension;                  // lowercase, without the dot, empty if none (ext: filter)
+    std::vector<std::string> directory_names;  // lowercase directory names (dir: filter)
+};
+
+/**
+ * Split a path into the terms and filter values of index_path()
+ * @param root Indexed directory, directories above it are left out (empty = keep all)
+ */
+PathTerms analyze_path(const std::filesystem::path& file_path, const std::filesystem::path& root = {});
+
+/**
+ * A term of the sorted lexicon with its posting list
+ * Points into the index, valid until a term is added or the index is cleared
+ */
+struct LexiconEntry {
+    const std::string* term;
+    const PostingList* postings;
+};
+
+/**
+ * Memory breakdown of the inverted index in bytes
+ */
+struct IndexMemoryStats {
+    size_t dictionary_keys = 0;   // heap bytes of term strings (short terms live inline)
+    size_t hash_table = 0;        // control bytes and entry indexes of the term tables (FlatHashMap)
+    size_t hash_entries = 0;      // one entry per term (key and posting list headers), incl. spare capacity
+    size_t posting_payload = 0;   // doc ID containers and frequencies of all posting lists
+    size_t posting_slack = 0;     // reserved but unused posting capacity
+    size_t filter_bitsets = 0;    // ext: / dir: filter sets including their keys
+    size_t lexicon = 0;           // sorted term pointers for prefix lookups
+    size_t trigram_sets = 0;      // doc sets of the trigram index (re: / lit:) including their table
     
-    Posting(uint32_t id, uint32_t freq) : doc_id(id), term_freq(freq) {}
+    size_t total() const noexcept {
+        return dictionary_keys + hash_table + hash_entries + posting_payload + posting_slack + filter_bitsets
+             + lexicon + trigram_sets;
+    }
 };
 
 /**
  * InvertedIndex is the core data structure for fast full-text search
- * Maps terms -> list of postings (documents containing the term)
+ * Maps terms -> list of postings (documents containing the term), one map per field,
+ * plus doc-ID sets for the ext: and dir: filters and for every trigram of the content
+ * (see trigram.hpp), which narrow re: / lit: queries to the documents worth checking
  */
 class InvertedIndex {
 public:
@@ -38,32 +162,122 @@ public:
      * Index a document: add all its terms to the inverted index
      * @param doc_id Document ID
      * @param tokens Vector of normalized tokens from the document
+     * @param field Field the tokens belong to
+     */
+    void index_document(uint32_t doc_id, const std::vector<std::string>& tokens, Field field = Field::content);
+    
+    /**
+     * Index a document from its counted terms (no intermediate token vector)
+     */
+    void index_document(uint32_t doc_id, const TermCounter& terms, Field field = Field::content);
+    
+    /**
+     * Index the path of a document: file name and directory names as fields,
+     * extension and directories as filters
+     * @param doc_id Document ID
+     * @param file_path Path of the document
+     * @param root Indexed directory, directories above it are not indexed (empty = keep all)
+     */
+    void index_path(uint32_t doc_id, const std::filesystem::path& file_path,
+                    const std::filesystem::path& root = {});
+    
+    /**
+     * Index the trigrams of a document's content (see document_trigrams())
+     */
+    void index_trigrams(uint32_t doc_id, std::string_view content);
+    
+    /**
+     * Set the complete posting list of a term (replaces an existing one)
+     * Used to fill the index from a build (IndexBuilder) or from disk
+     */
+    void set_postings(const std::string& term, Field field, PostingList postings);
+    
+    /**
+     * Set the documents of a filter value (replaces an existing set)
+     */
+    void set_filter(FilterKind kind, const std::string& value, DocIdSet docs);
+    
+    /**
+     * Set the documents containing a trigram (replaces an existing set)
+     */
+    void set_trigram(uint32_t trigram, DocIdSet docs);
+    
+    /**
+     * Replace the index with one written by IndexBuilder::write() (index.bin)
+     * @return false if the file is missing or damaged, the index is then empty
+     */
+    bool load(const std::filesystem::path& index_file, std::string* error = nullptr);
+    
+    /**
+     * Write the index in the format of IndexBuilder::write() (index.bin)
+     * @return false on a write error
+     */
+    bool save(const std::filesystem::path& index_file, std::string* error = nullptr) const;
+    
+    /**
+     * Assign new document IDs (see reorder_documents())
+     * @param new_ids new_ids[old ID] = new ID, a permutation covering every indexed ID
      */
-    void index_document(uint32_t doc_id, const std::vector<std::string>& tokens);
+    void remap_documents(const std::vector<uint32_t>& new_ids);
     
     /**
      * Get postings list for a term
-     * @param term The search term
+     * @param term The search term (no std::string needed, see FlatHashMap)
+     * @param field Field to look in
      * @return Pointer to postings list, or nullptr if term not found
      */
-    const std::vector<Posting>* get_postings(const std::string& term) const;
+    const PostingList* get_postings(std::string_view term, Field field = Field::content) const;
     
     /**
      * Get document frequency (number of documents containing the term)
      * @param term The search term
+     * @param field Field to look in
      * @return Document frequency, or 0 if term not found
      */
-    size_t get_document_frequency(const std::string& term) const;
+    size_t get_document_frequency(std::string_view term, Field field = Field::content) const;
     
     /**
-     * Get total number of unique terms in the index
+     * Get the documents matching a filter value
+     * @param kind ext: or dir:
+     * @param value Lowercase extension without dot, or lowercase directory name
+     * @return Pointer to the document set, or nullptr if no document matches
      */
-    size_t vocabulary_size() const noexcept { return index_.size(); }
+    const DocIdSet* get_filter(FilterKind kind, std::string_view value) const;
+    
+    /**
+     * Get the documents whose content contains a trigram (see trigram_key())
+     * @return Pointer to the document set, or nullptr if no document contains it
+     */
+    const DocIdSet* get_trigram(uint32_t trigram) const;
+    
+    /**
+     * Number of distinct trigrams in the index
+     */
+    size_t trigram_count() const noexcept { return trigrams_.size(); }
+    
+    /**
+     * Get the terms of a field that start with a prefix, in lexicographic order
+     * Binary search in the sorted lexicon built by shrink_to_fit(), a full scan of the
+     * field while the lexicon is missing terms added since.
+     * @return Terms with their postings, valid until the index is cleared
+     */
+    std::vector<LexiconEntry> terms_with_prefix(std::string_view prefix, Field field) const;
+    
+    /**
+     * Get total number of unique terms in the index (summed over all fields)
+     */
+    size_t vocabulary_size() const noexcept;
     
     /**
      * Check if index is empty
      */
-    bool empty() const noexcept { return index_.empty(); }
+    bool empty() const noexcept { return vocabulary_size() == 0; }
+    
+    /**
+     * Release unused capacity of all posting lists and filters and sort the vocabulary
+     * for prefix lookups (call after bulk indexing)
+     */
+    void shrink_to_fit();
     
     /**
      * Clear the entire index
@@ -71,13 +285,35 @@ public:
     void clear() noexcept;
     
     /**
-     * Get all terms (for iteration/debugging)
+     * Get all content terms (for iteration/debugging)
      */
     std::vector<std::string> get_all_terms() const;
+    
+    /**
+     * Get a byte-level memory breakdown of the index
+     */
+    IndexMemoryStats memory_usage() const noexcept;
+    
+    /**
+     * Histogram of posting list lengths in the content field
+     * @return Bucket i counts the terms with a posting list length in [2^i, 2^(i+1))
+     */
+    std::vector<size_t> posting_length_histogram() const;
 
 private:
     // term -> vector of postings
-    std::unordered_map<std::string, std::vector<Posting>> index_;
+    using TermMap = FlatHashMap<std::string, PostingList>;
+    using FilterMap = FlatHashMap<std::string, DocIdSet>;
+    
+    std::array<TermMap, field_count> fields_;   // indexed by Field
+    FilterMap extension_filters_;
+    FilterMap directory_filters_;
+    FlatHashMap<uint32_t, DocIdSet> trigrams_;
+    std::array<std::vector<LexiconEntry>, field_count> lexicon_;  // sorted by term, points into fields_ (stale once a term is added)
+    TermCounter token_terms_;                   // buffer of index_document(tokens)
+    
+    TermMap& terms(Field field) noexcept { return fields_[static_cast<size_t>(field)]; }
+    const TermMap& terms(Field field) const noexcept { return fields_[static_cast<size_t>(field)]; }
 };
 
 } // namespace notesearch
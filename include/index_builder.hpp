@@ -0,0 +1,144 @@
+#ifndef INDEX_BUILDER_HPP
+#define INDEX_BUILDER_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <array>
+#include <unordered_map>
+#include <filesystem>
+#include <functional>
+#include <cstdint>
+#include "index.hpp"
+#include "index_file.hpp"
+#include "tokenizer.hpp"
+
+namespace notesearch {
+
+/**
+ * Statistics of an index build
+ */
+struct BuildStats {
+    size_t runs_written = 0;         // sorted runs flushed to disk
+    uint64_t run_bytes = 0;          // bytes written to runs
+    size_t peak_memory_bytes = 0;    // largest in-memory block before a flush
+    size_t terms = 0;                // distinct terms (all fields) in the final index
+};
+
+/**
+ * IndexBuilder builds an inverted index in bounded memory (single-pass in-memory indexing, SPIMI)
+ *
+ * Postings are collected per term in an in-memory block, already delta and varint encoded.
+ * When the block reaches the memory budget its terms are sorted and written to disk as a
+ * run, and the block starts over. finish() / write() merge all runs term by term (k-way
+ * merge over the sorted runs), so only one record per run is in memory at a time and the
+ * size of the index is limited by the disk, not by the build host's RAM.
+ *
+ * Documents must be added in ascending ID order (as DocumentStore assigns them).
+ * Trigrams (index_trigrams()) go through the same blocks and runs as terms.
+ * Filters (ext:, dir:) are small bitsets and stay in memory.
+ */
+class IndexBuilder {
+public:
+    static constexpr size_t default_memory_budget = size_t{256} << 20;
+
+    /**
+     * @param memory_budget Bytes the in-memory block may use before it is flushed
+     * @param work_dir Directory for the runs, empty = a new directory in the temp directory
+     */
+    explicit IndexBuilder(size_t memory_budget = default_memory_budget, std::filesystem::path work_dir = {});
+    ~IndexBuilder();
+
+    // Non-copyable (owns run files)
+    IndexBuilder(const IndexBuilder&) = delete;
+    IndexBuilder& operator=(const IndexBuilder&) = delete;
+
+    /**
+     * Add the tokens of one field of a document (see InvertedIndex::index_document)
+     */
+    void index_document(uint32_t doc_id, const std::vector<std::string>& tokens, Field field = Field::content);
+
+    /**
+     * Add the counted terms of one field of a document
+     * The block is keyed by the hashes TermCounter already computed, so no term is hashed
+     * or copied into a string again; postings are appended by the block's term ID.
+     */
+    void index_document(uint32_t doc_id, const TermCounter& terms, Field field = Field::content);
+
+    /**
+     * Add file name, directories and filters of a document (see InvertedIndex::index_path)
+     */
+    void index_path(uint32_t doc_id, const std::filesystem::path& file_path,
+                    const std::filesystem::path& root = {});
+    
+    /**
+     * Add the trigrams of a document's content (see InvertedIndex::index_trigrams)
+     */
+    void index_trigrams(uint32_t doc_id, std::string_view content);
+
+    /**
+     * Merge everything into an in-memory index (replaces its content)
+     * @return false if a run could not be written or read back
+     */
+    bool finish(InvertedIndex& index, std::string* error = nullptr);
+
+    /**
+     * Merge everything into an index file (index.bin, see InvertedIndex::load)
+     * @return false on a write error
+     */
+    bool write(const std::filesystem::path& index_file, std::string* error = nullptr);
+
+    const BuildStats& stats() const noexcept { return stats_; }
+
+private:
+    // Postings eines Worts im aktuellen Block
+    struct BlockPostings {
+        uint32_t count = 0;
+        uint32_t last_doc = 0;
+        std::string bytes;   // Lücke + Frequenz als Varints
+    };
+    struct BlockTerm {
+        uint64_t hash;          // hash_bytes of the term (from TermCounter)
+        size_t offset;          // bytes in Block::pool
+        uint32_t length;
+        BlockPostings postings;
+    };
+    // Wörter eines Felds im Block: Term ID = Index in terms, offene Hash Tabelle über die Hashes
+    struct Block {
+        std::vector<uint32_t> slots;   // Term ID + 1, 0 = leer (linear probing)
+        std::vector<BlockTerm> terms;
+        std::string pool;              // Bytes aller Wörter hintereinander
+
+        std::string_view text(const BlockTerm& term) const noexcept {
+            return std::string_view(pool).substr(term.offset, term.length);
+        }
+        bool empty() const noexcept { return terms.empty(); }
+    };
+
+    size_t memory_budget_;
+    std::filesystem::path work_dir_;
+    bool owns_work_dir_ = false;
+    std::vector<std::filesystem::path> runs_;
+    std::array<Block, field_count> block_;
+    std::unordered_map<uint32_t, BlockPostings> trigram_block_;   // nur Lücken, keine Frequenzen
+    std::vector<uint32_t> trigram_keys_;                           // Puffer für index_trigrams()
+    TermCounter token_terms_;                                      // Puffer für index_document(tokens)
+    size_t block_bytes_ = 0;
+    std::array<std::unordered_map<std::string, DocIdSet>, 2> filters_;  // indexed by FilterKind
+    BuildStats stats_;
+    std::string error_;   // first flush error, reported by finish() / write()
+
+    size_t bucket_bytes() const noexcept;
+    BlockTerm& block_term(Block& block, const TermCounter::Term& term);
+    static void grow(Block& block);
+    static std::vector<uint32_t> sorted_terms(const Block& block);
+    void flush();
+    bool merge(const std::function<bool(TermRecord&)>& sink);
+    bool write_filters(const std::function<bool(TermRecord&)>& sink);
+    bool write_trigrams(const std::function<bool(TermRecord&)>& sink);
+    void remove_runs() noexcept;
+};
+
+} // namespace notesearch
+
+#endif // INDEX_BUILDER_HPP
@@ -0,0 +1,78 @@
+#ifndef INDEX_FILE_HPP
+#define INDEX_FILE_HPP
+
+#include <string>
+#include <cstdint>
+#include "binary_io.hpp"
+#include "index.hpp"
+
+namespace notesearch {
+
+/**
+ * Files of a persistent index directory
+ */
+constexpr const char* index_file_name = "index.bin";          // posting lists and filters (InvertedIndex)
+constexpr const char* documents_file_name = "documents.bin";  // paths, content refs, dedup state (DocumentStore)
+constexpr const char* content_file_name = "content.blob";     // compressed content (ContentStore)
+constexpr const char* update_log_file_name = "updates.wal";    // changes since the snapshot (IndexUpdater)
+constexpr const char* hot_terms_file_name = "hot_terms.bin";   // query term counts for cache warming (HotTerms)
+constexpr const char* lock_file_name = "index.lock";          // updater against readers (IndexLock)
+
+/**
+ * One term (or filter value) with its postings, the unit of index.bin and of the
+ * sorted runs written by IndexBuilder
+ *
+ * On disk: tag, term, count, last_doc, postings size, postings
+ * Postings are varints: per document the gap to the previous one (the first counts from 0),
+ * for terms followed by the term frequency. Records are sorted by (tag, term).
+ */
+struct TermRecord {
+    uint8_t tag = 0;           // Field value for terms, filter_tag + FilterKind for filters, trigram_tag
+    std::string term;
+    uint64_t count = 0;        // documents in postings
+    uint64_t last_doc = 0;     // largest document ID (lets runs be concatenated without decoding)
+    std::string postings;
+
+    static constexpr uint8_t filter_tag = 0x10;
+    static constexpr uint8_t trigram_tag = 0x20;  // term is the 3 bytes of the trigram, no frequencies
+    static constexpr uint8_t end_tag = 0xff;   // ends the record list
+
+    bool is_filter() const noexcept { return tag >= filter_tag && tag < trigram_tag; }
+    bool is_trigram() const noexcept { return tag == trigram_tag; }
+};
+
+/**
+ * index.bin starts with this magic and a version varint, followed by records and end_tag
+ */
+constexpr uint32_t index_file_magic = 0x5849534e;   // "NSIX"
+constexpr uint64_t index_file_version = 2;   // 2: trigram records
+
+void write_record(BinaryWriter& out, const TermRecord& record);
+
+/**
+ * Read the next record
+ * @return false at end_tag or on a damaged file (then reader.ok() is false)
+ */
+bool read_record(BinaryReader& in, TermRecord& record);
+
+/**
+ * Append the postings of other (documents all after record's) to record
+ */
+bool append_record(TermRecord& record, const TermRecord& other);
+
+/**
+ * Encode term postings / filter documents into record (count, last_doc, postings)
+ */
+void encode_postings(const PostingList& postings, TermRecord& record);
+void encode_documents(const DocIdSet& docs, TermRecord& record);
+
+/**
+ * Decode term postings / filter documents
+ * @return false if the postings are damaged
+ */
+bool decode_postings(const TermRecord& record, PostingList& postings);
+bool decode_documents(const TermRecord& record, DocIdSet& docs);
+
+} // namespace notesearch
+
+#endif // INDEX_FILE_HPP
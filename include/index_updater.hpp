@@ -0,0 +1,153 @@
+#ifndef INDEX_UPDATER_HPP
+#define INDEX_UPDATER_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <filesystem>
+#include <cstdint>
+#include "document_store.hpp"
+#include "index.hpp"
+#include "tokenizer.hpp"
+#include "update_log.hpp"
+
+namespace notesearch {
+
+/**
+ * IndexUpdater changes a saved index (index --out) in place: documents are added, replaced
+ * or removed without a rebuild, and the changes survive a crash
+ *
+ * Write-ahead: every change is appended to the update log (updates.wal) before it is applied
+ * to the DocumentStore and InvertedIndex in memory, commit() makes the log durable. open() loads
+ * the last snapshot (index.bin, documents.bin) and replays only the log written since, so
+ * startup costs the snapshot load plus the recent changes, not a rescan. checkpoint() writes
+ * a new snapshot and starts an empty log, which keeps replay short.
+ *
+ * A checkpoint saves index.bin.tmp and documents.bin.tmp, syncs them and the content blob, then
+ * logs a checkpoint record (the commit point) before renaming them over the snapshot. Crashing
+ * before the record leaves the old snapshot and the whole log, crashing after it leaves the
+ * renames to the next open(). New content is appended to content.blob as usual; the log records
+ * the offset, so replay keeps content that reached the blob and rewrites only what is missing.
+ *
+ * Replaced and removed documents become tombstones (see DocumentStore::remove_document()).
+ * open() locks the index directory for as long as the updater lives (see IndexLock), a second
+ * update waits for the first. Processes that only query the index use load() instead, which
+ * changes no file and only waits while an update runs.
+ */
+class IndexUpdater {
+public:
+    static constexpr uint64_t default_checkpoint_bytes = 64ull << 20;
+
+    IndexUpdater(DocumentStore& doc_store, InvertedIndex& index)
+        : doc_store_(doc_store), index_(index) {}
+
+    /**
+     * Load the index saved in index_dir and replay its update log
+     * Finishes a checkpoint that was interrupted after its commit point.
+     * @return false if the snapshot or the log cannot be read, error describes why
+     */
+    bool open(const std::filesystem::path& index_dir, std::string* error = nullptr);
+
+    /**
+     * Load the index saved in index_dir and its update log for querying only
+     * Nothing in the directory is written: the log is replayed in memory with the content of its
+     * records, an interrupted checkpoint is read from its .tmp files and left for the next open().
+     * The updater cannot change the index afterwards.
+     * @return false if the snapshot or the log cannot be read, error describes why
+     */
+    bool load(const std::filesystem::path& index_dir, std::string* error = nullptr);
+
+    /**
+     * Add a document, replacing the live document with the same path
+     * @param root Directory the index was built from (dir: filters stop there, see index_path())
+     * @param modified_time Last write time of the file (FileContent::modified_time())
+     * @return false if the change cannot be logged (then it is not applied)
+     */
+    bool add_document(const std::filesystem::path& file_path, std::string_view content,
+                      const std::filesystem::path& root, int64_t modified_time, std::string* error = nullptr);
+
+    /**
+     * Delete the live document with this path
+     * @return false if there is none or the change cannot be logged
+     */
+    bool remove_document(const std::filesystem::path& file_path, std::string* error = nullptr);
+
+    /**
+     * Check whether a live document has this path
+     */
+    bool contains(const std::filesystem::path& file_path);
+
+    /**
+     * Check whether the live document with this path was indexed with this modified time and
+     * size, i.e. the file did not change since (an unknown modified time counts as changed)
+     */
+    bool unchanged(const std::filesystem::path& file_path, int64_t modified_time, uint64_t size);
+
+    /**
+     * Paths of the live documents in directory and its subdirectories (update: files deleted
+     * since are the ones a rescan does not see)
+     */
+    std::vector<std::string> paths_under(const std::filesystem::path& directory);
+
+    /**
+     * The form a path is compared in, "./notes/a.md" and "notes/a.md" are the same document
+     */
+    static std::string path_key(const std::filesystem::path& file_path);
+
+    /**
+     * Make the changes so far durable (one fsync for all of them)
+     */
+    bool commit(std::string* error = nullptr);
+
+    /**
+     * Write the index as the new snapshot and empty the log (includes commit())
+     */
+    bool checkpoint(std::string* error = nullptr);
+
+    /**
+     * True once the log has grown past the checkpoint threshold
+     */
+    bool wants_checkpoint() const noexcept { return log_.size_bytes() >= checkpoint_bytes_; }
+    void set_checkpoint_bytes(uint64_t bytes) noexcept { checkpoint_bytes_ = bytes; }
+
+    /**
+     * Changes replayed from the log by open()
+     */
+    size_t replayed_changes() const noexcept { return replayed_; }
+
+    /**
+     * Changes in the log, i.e. since the last snapshot
+     */
+    size_t logged_changes() const noexcept { return logged_; }
+
+    uint64_t log_bytes() const noexcept { return log_.size_bytes(); }
+
+private:
+    DocumentStore& doc_store_;
+    InvertedIndex& index_;
+    std::filesystem::path dir_;
+    UpdateLog log_;
+    IndexLock lock_;
+    bool read_only_ = false;
+    TermCounter terms_;
+    uint64_t checkpoint_bytes_ = default_checkpoint_bytes;
+    size_t replayed_ = 0;
+    size_t logged_ = 0;
+
+    // Pfad -> lebendes Dokument, erst bei der ersten Änderung aufgebaut
+    std::unordered_map<std::string, uint32_t> live_paths_;
+    bool paths_loaded_ = false;
+
+    bool log(const LogRecord& record, std::string* error);
+    bool read_log(const std::filesystem::path& index_dir, std::vector<LogRecord>& records, size_t& first,
+                  bool& checkpointed, std::string* error);
+    void replay(const std::vector<LogRecord>& records, size_t first);
+    void apply(const LogRecord& record);
+    void remove_path(const std::string& key);
+    void load_paths();
+};
+
+} // namespace notesearch
+
+#endif // INDEX_UPDATER_HPP
@@ -0,0 +1,75 @@
+#ifndef JSON_HPP
+#define JSON_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <optional>
+
+namespace notesearch {
+
+/**
+ * Minimal JSON value used by the query server protocol
+ * (one JSON object per line)
+ */
+class JsonValue {
+public:
+    enum class Type { Null, Bool, Number, String, Array, Object };
+
+    using Array = std::vector<JsonValue>;
+    using Object = std::map<std::string, JsonValue>;
+
+    JsonValue() = default;
+    JsonValue(bool value) : type_(Type::Bool), bool_(value) {}
+    JsonValue(double value) : type_(Type::Number), number_(value) {}
+    JsonValue(std::string value) : type_(Type::String), string_(std::move(value)) {}
+    JsonValue(Array value) : type_(Type::Array), array_(std::move(value)) {}
+    JsonValue(Object value) : type_(Type::Object), object_(std::move(value)) {}
+
+    Type type() const noexcept { return type_; }
+    bool is_null() const noexcept { return type_ == Type::Null; }
+    bool is_bool() const noexcept { return type_ == Type::Bool; }
+    bool is_number() const noexcept { return type_ == Type::Number; }
+    bool is_string() const noexcept { return type_ == Type::String; }
+    bool is_array() const noexcept { return type_ == Type::Array; }
+    bool is_object() const noexcept { return type_ == Type::Object; }
+
+    bool as_bool() const noexcept { return bool_; }
+    double as_number() const noexcept { return number_; }
+    const std::string& as_string() const noexcept { return string_; }
+    const Array& as_array() const noexcept { return array_; }
+    const Object& as_object() const noexcept { return object_; }
+
+    /**
+     * Get an object member
+     * @return Pointer to the member, or nullptr if this is not an object or the key is missing
+     */
+    const JsonValue* find(const std::string& key) const;
+
+    /**
+     * Serialize to compact JSON text
+     */
+    std::string dump() const;
+
+    /**
+     * Parse JSON text
+     * @return The parsed value, or std::nullopt on a syntax error
+     */
+    static std::optional<JsonValue> parse(std::string_view text);
+
+private:
+    Type type_ = Type::Null;
+    bool bool_ = false;
+    double number_ = 0.0;
+    std::string string_;
+    Array array_;
+    Object object_;
+};
+
+// Append a quoted, escaped JSON string to out
+void json_append_string(std::string& out, std::string_view value);
+
+} // namespace notesearch
+
+#endif // JSON_HPP
@@ -0,0 +1,94 @@
+#ifndef LOAD_TEST_HPP
+#define LOAD_TEST_HPP
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <filesystem>
+#include <cstdint>
+#include "index.hpp"
+#include "search.hpp"
+#include "shard.hpp"
+
+namespace notesearch {
+
+/**
+ * Sends one request line of the query server protocol and receives the response line
+ * @return false if the request could not be delivered (connection lost)
+ */
+using LoadClient = std::function<bool(const std::string& request, std::string& response)>;
+
+/**
+ * Client that answers in-process with handle_query_request(), the server's request path
+ * without the network (JSON parsing and serialization included)
+ */
+LoadClient engine_load_client(const SearchEngine& engine);
+
+/**
+ * Client with its own blocking connection to a query server or coordinator,
+ * opened on first use and reopened after an error
+ */
+LoadClient server_load_client(const ShardAddress& address);
+
+/**
+ * Load test settings, the same for every concurrency level
+ *
+ * Closed loop (arrival_rate 0): every client sends its next query as soon as the previous one
+ * was answered, throughput is whatever the engine manages at that concurrency.
+ * Open loop (arrival_rate > 0): queries are due at fixed intervals no matter how fast answers come,
+ * the clients are the pool that sends them. Latency counts from the time a query was due, so
+ * queueing behind a saturated engine shows up in the percentiles instead of lowering the rate.
+ */
+struct LoadTestConfig {
+    double arrival_rate = 0.0;   // queries per second, 0 = closed loop
+    double duration_s = 10.0;    // measured time per level
+    double warmup_s = 1.0;       // queries due before this are sent but not measured
+    size_t max_results = 10;     // "k" of every request
+    double budget_ms = 0.0;      // "budget_ms" of every request, 0 = the server's default
+};
+
+/**
+ * Result of one concurrency level, latencies in milliseconds
+ */
+struct LoadTestResult {
+    size_t concurrency = 0;
+    size_t queries = 0;          // answered queries after the warmup
+    size_t errors = 0;           // error responses and lost connections
+    size_t incomplete = 0;       // answered with partial results (budget exceeded)
+    double qps = 0.0;
+    double mean_ms = 0.0;
+    double p50_ms = 0.0;
+    double p95_ms = 0.0;
+    double p99_ms = 0.0;
+    double p999_ms = 0.0;
+    double max_ms = 0.0;
+};
+
+/**
+ * Read a query log: one query per line, empty lines skipped
+ * A line that is a JSON request of the server protocol counts with its "q", so a captured
+ * request stream can be replayed as is.
+ * @return false if the file cannot be read, error describes why
+ */
+bool load_query_log(const std::filesystem::path& path, std::vector<std::string>& queries,
+                    std::string* error = nullptr);
+
+/**
+ * Synthetic queries of 1-3 content terms, drawn from the most frequent terms with Zipfian
+ * probabilities (rank r has weight 1 / r^exponent), like a real query log where a few queries
+ * repeat a lot. The same seed gives the same queries.
+ */
+std::vector<std::string> zipf_queries(const InvertedIndex& index, size_t count, double exponent = 1.0,
+                                      uint64_t seed = 42);
+
+/**
+ * Replay queries (in order, wrapping around) with concurrency clients
+ * @param make_client Called once per client thread, e.g. to open its own connection
+ */
+LoadTestResult run_load_test(const std::vector<std::string>& queries,
+                             const std::function<LoadClient()>& make_client, size_t concurrency,
+                             const LoadTestConfig& config);
+
+} // namespace notesearch
+
+#endif // LOAD_TEST_HPP
@@ -0,0 +1,79 @@
+#ifndef METADATA_COLUMNS_HPP
+#define METADATA_COLUMNS_HPP
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "doc_id_set.hpp"
+
+namespace notesearch {
+
+/**
+ * File metadata a query can filter on (mtime:, size:)
+ */
+enum class MetadataField : uint8_t {
+    modified,   // last write time, seconds since 1970 (UTC)
+    size,       // file size in bytes
+};
+
+/**
+ * MetadataColumns keeps the file metadata of every document in dense columns indexed by document ID
+ *
+ * One contiguous array per field instead of a member of Document: a range filter reads a single
+ * array front to back and turns every 64 comparisons into one bitmap word without branches, which
+ * the compiler vectorizes, and the words become a DocIdSet as they are (see DocIdSet::assign_bits()).
+ * Scoring reads the modified column by doc ID for the recency boost.
+ */
+class MetadataColumns {
+public:
+    /**
+     * Add the metadata of the next document ID
+     */
+    void append(int64_t modified, int64_t size);
+
+    void set(MetadataField field, uint32_t doc_id, int64_t value) noexcept {
+        if (doc_id < documents()) {
+            column(field)[doc_id] = value;
+        }
+    }
+
+    int64_t get(MetadataField field, uint32_t doc_id) const noexcept {
+        return doc_id < documents() ? column(field)[doc_id] : 0;
+    }
+
+    size_t documents() const noexcept { return modified_.size(); }
+
+    /**
+     * Documents with min <= value <= max (deleted ones included, like the ext: / dir: filters)
+     * @param allocator Resource of the result, e.g. the query arena
+     */
+    DocIdSet match_range(MetadataField field, int64_t min, int64_t max,
+                         const DocIdSet::allocator_type& allocator = {}) const;
+
+    /**
+     * Move every value to its new document ID (see DocumentStore::remap_documents())
+     */
+    void remap(const std::vector<uint32_t>& new_ids);
+
+    void clear() noexcept;
+
+    /**
+     * Heap bytes of the columns
+     */
+    size_t memory_bytes() const noexcept;
+
+private:
+    std::vector<int64_t> modified_;
+    std::vector<int64_t> sizes_;
+
+    std::vector<int64_t>& column(MetadataField field) noexcept {
+        return field == MetadataField::modified ? modified_ : sizes_;
+    }
+    const std::vector<int64_t>& column(MetadataField field) const noexcept {
+        return field == MetadataField::modified ? modified_ : sizes_;
+    }
+};
+
+} // namespace notesearch
+
+#endif // METADATA_COLUMNS_HPP
@@ -0,0 +1,70 @@
+#ifndef NET_HPP
+#define NET_HPP
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+namespace notesearch {
+
+/**
+ * Thin portable wrappers around BSD sockets / Winsock
+ * Only what the query server and its clients need
+ */
+
+#ifdef _WIN32
+using socket_t = std::uintptr_t;  // SOCKET
+constexpr socket_t invalid_socket = ~static_cast<socket_t>(0);
+#else
+using socket_t = int;
+constexpr socket_t invalid_socket = -1;
+#endif
+
+// Initialize the socket library (WSAStartup on Windows), safe to call repeatedly
+bool net_init();
+
+// Close a socket, ignores invalid_socket
+void close_socket(socket_t sock) noexcept;
+
+// Switch a socket to non-blocking mode
+bool set_nonblocking(socket_t sock);
+
+// Listen on 127.0.0.1:port
+socket_t listen_tcp(uint16_t port, std::string* error = nullptr);
+
+// Listen on a Unix domain socket (removes a stale socket file first)
+socket_t listen_unix(const std::string& path, std::string* error = nullptr);
+
+// Accept a pending connection, returns invalid_socket if none is pending
+socket_t accept_connection(socket_t listener);
+
+// Connect (blocking) to 127.0.0.1:port or to a Unix domain socket
+socket_t connect_tcp(uint16_t port, std::string* error = nullptr);
+socket_t connect_unix(const std::string& path, std::string* error = nullptr);
+
+/**
+ * Send / receive some bytes
+ * @return Bytes transferred, 0 on orderly close (recv only), -1 on error or would-block
+ */
+long send_some(socket_t sock, const char* data, size_t size) noexcept;
+long recv_some(socket_t sock, char* buffer, size_t size) noexcept;
+
+// True if the last failed send/recv/accept was a would-block (EAGAIN / WSAEWOULDBLOCK)
+bool last_error_would_block() noexcept;
+
+// Create a connected pair of stream sockets (socketpair, or a loopback TCP pair on Windows)
+bool make_socket_pair(socket_t pair[2]);
+
+// Send the whole buffer on a blocking socket
+bool send_all(socket_t sock, const std::string& data);
+
+/**
+ * Read one '\n' terminated line from a blocking socket
+ * buffer keeps bytes received past the line for the next call
+ * @return false on close or error
+ */
+bool recv_line(socket_t sock, std::string& buffer, std::string& line);
+
+} // namespace notesearch
+
+#endif // NET_HPP
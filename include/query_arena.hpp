@@ -0,0 +1,95 @@
+#ifndef QUERY_ARENA_HPP
+#define QUERY_ARENA_HPP
+
+#include <memory_resource>
+#include <vector>
+#include <cstddef>
+
+namespace notesearch {
+
+/**
+ * QueryArena is a bump allocator for the temporary data of a query
+ *
+ * Allocating moves a pointer, deallocating does nothing, reset() makes all memory reusable
+ * at once. Memory comes from the heap in blocks that are kept across resets. If a query needed
+ * more than one block, reset() replaces them with a single block of the combined size, so a thread
+ * that keeps answering similar queries stops touching the global heap (and its locks) after the
+ * first few. Blocks beyond max_retained_bytes are given back instead of kept.
+ *
+ * Every thread has its own arena (for_this_thread()), an arena is not thread safe.
+ * Use it through std::pmr containers; nothing allocated from it may outlive the Scope.
+ */
+class QueryArena : public std::pmr::memory_resource {
+public:
+    static constexpr size_t initial_block_bytes = 64 * 1024;
+    static constexpr size_t max_retained_bytes = 16 * 1024 * 1024;
+
+    QueryArena() = default;
+    ~QueryArena() override;
+
+    QueryArena(const QueryArena&) = delete;
+    QueryArena& operator=(const QueryArena&) = delete;
+
+    /**
+     * The arena of the calling thread
+     */
+    static QueryArena& for_this_thread();
+
+    /**
+     * Marks the lifetime of one query's data on this thread's arena
+     * The arena is reset when the outermost Scope ends, so nested queries share it.
+     */
+    class Scope {
+    public:
+        Scope();
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+        QueryArena& arena() noexcept { return arena_; }
+
+    private:
+        QueryArena& arena_;
+    };
+
+    /**
+     * Release everything allocated so far (the memory is kept for the next query)
+     */
+    void reset() noexcept;
+
+    /**
+     * Bytes handed out since the last reset
+     */
+    size_t used_bytes() const noexcept { return used_bytes_; }
+
+    /**
+     * Heap blocks allocated over the arena's lifetime (stays constant in steady state)
+     */
+    size_t heap_allocations() const noexcept { return heap_allocations_; }
+
+protected:
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void*, size_t, size_t) override {}
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+private:
+    struct Block {
+        std::byte* data;
+        size_t size;
+    };
+
+    std::vector<Block> blocks_;
+    size_t current_ = 0;          // block allocations come from
+    size_t offset_ = 0;           // first free byte in blocks_[current_]
+    size_t used_bytes_ = 0;
+    size_t heap_allocations_ = 0;
+    size_t depth_ = 0;            // open Scopes
+
+    void add_block(size_t min_bytes);
+    void release_blocks() noexcept;
+};
+
+} // namespace notesearch
+
+#endif // QUERY_ARENA_HPP
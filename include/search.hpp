@@ -3,26 +3,240 @@
 
 #include <string>
 #include <vector>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <regex>
+#include <unordered_map>
+#include <utility>
 #include <cstdint>
 #include "index.hpp"
 #include "document_store.hpp"
+#include "trigram.hpp"
 
 namespace notesearch {
 
+class HotTerms;
+
 // search result structure
 struct SearchResult {
     std::string path;
     double score;
     std::string snippet;
+    std::vector<std::string> copies;   // other paths with identical content
+    size_t collapsed = 0;              // near-duplicates folded into this result
     
     SearchResult(std::string result_path, double result_score, std::string result_snippet)
         : path(std::move(result_path)), score(result_score), snippet(std::move(result_snippet)) {}
 };
 
+// one ranked document without path or snippet, SearchEngine::results() turns hits into SearchResults
+struct SearchHit {
+    uint32_t doc_id;
+    double score;
+    size_t collapsed = 0;              // near-duplicates folded into this hit
+};
+
+// per-field score weights, a match in the file name counts more than one in the text
+struct FieldBoosts {
+    double content = 1.0;
+    double filename = 2.5;
+    double path = 1.5;
+    
+    double operator[](Field field) const noexcept {
+        switch (field) {
+            case Field::filename: return filename;
+            case Field::path: return path;
+            default: return content;
+        }
+    }
+};
+
+// re:<regex> or lit:<text> part of a query, matched against the raw content line by line
+// (case-sensitive, re: uses ECMAScript syntax, a leading (?i) ignores case)
+// the value ends at the next whitespace, use \s or \x20 for spaces
+struct QueryPattern {
+    std::string source;                        // value after re: / lit:
+    bool literal = false;                      // lit: plain substring
+    bool ignore_case = false;
+    std::shared_ptr<const std::regex> regex;   // compiled re: pattern
+    TrigramQuery trigrams;                     // trigrams every matching document contains
+};
+
+// mtime: or size: filter on the document metadata, bounds inclusive
+// "size:<100k" -> size in [min, 102399], "mtime:>7d" -> modified in [now - 7 days, max],
+// "mtime:2024-03-01" -> modified on that day (local time)
+struct RangeFilter {
+    MetadataField field = MetadataField::modified;
+    int64_t min = INT64_MIN;
+    int64_t max = INT64_MAX;
+    
+    bool operator==(const RangeFilter& other) const noexcept {
+        return field == other.field && min == other.min && max == other.max;
+    }
+};
+
+// query split into search terms, filters and patterns
+// "ext:md dir:notes inverted index" -> terms {inverted, index}, extensions {md}, directories {{notes}}
+// "re:std::move\( ext:cpp" -> patterns {std::move\(}, extensions {cpp}
+// "mtime:>7d size:<1m recent:3d todo" -> terms {todo}, two ranges, recency half-life of 3 days
+struct ParsedQuery {
+    std::vector<std::string> terms;                      // analyzed terms (see tokenize)
+    std::vector<std::string> extensions;                 // ext: values, lowercase without dot (OR)
+    std::vector<std::vector<std::string>> directories;   // dir: values split into names (OR)
+    std::vector<RangeFilter> ranges;                     // mtime: / size: filters (AND)
+    std::vector<QueryPattern> patterns;                  // re: / lit: patterns (AND)
+    int64_t recency_half_life = 0;                       // recent: value in seconds, 0 = no recency boost
+    std::string error;                                   // first invalid re: pattern or filter, query matches nothing
+    
+    bool has_filters() const noexcept { return !extensions.empty() || !directories.empty() || !ranges.empty(); }
+    bool has_patterns() const noexcept { return !patterns.empty(); }
+};
+
+// split a raw query into terms, ext: / dir: / mtime: / size: filters, re: / lit: patterns and recent:
+ParsedQuery parse_query(const std::string& query);
+
+// cancellation flag of a running query, copies share the flag
+// cancel() may be called from any thread, e.g. when the user has typed on or the client went away
+class CancellationToken {
+public:
+    CancellationToken() : flag_(std::make_shared<std::atomic<bool>>(false)) {}
+    
+    void cancel() const noexcept { flag_->store(true, std::memory_order_relaxed); }
+    bool cancelled() const noexcept { return flag_->load(std::memory_order_relaxed); }
+
+private:
+    std::shared_ptr<std::atomic<bool>> flag_;
+};
+
+// time budget of one query, counted from construction, optionally ended early by a CancellationToken
+// execute() checks it between phases and inside the posting traversal, verify and scoring loops;
+// once it is reached the query stops and ranks the documents it has completely scored, the cursor
+// is then flagged as incomplete (SearchCursor::complete())
+class QueryDeadline {
+public:
+    QueryDeadline() = default;  // never expires
+    explicit QueryDeadline(double budget_ms, std::optional<CancellationToken> cancel = std::nullopt);
+    
+    // true once the budget is used up or the query was cancelled, stays true
+    bool expired() noexcept;
+    
+    // same as expired(), but only looks at the clock every poll_interval calls (per-posting loops)
+    bool poll() noexcept {
+        if (expired_) {
+            return true;
+        }
+        if (--countdown_ > 0) {
+            return false;
+        }
+        countdown_ = poll_interval;
+        return expired();
+    }
+    
+    bool reached() const noexcept { return expired_; }
+
+private:
+    static constexpr unsigned poll_interval = 1024;
+    
+    std::optional<std::chrono::steady_clock::time_point> end_;
+    std::optional<CancellationToken> cancel_;
+    unsigned countdown_ = poll_interval;
+    bool expired_ = false;
+};
+
+// per-query execution stats - filled by search() when a pointer is passed
+// used by --explain to show why a query is slow
+struct SearchStats {
+    struct TermStats {
+        std::string term;
+        size_t document_frequency;  // documents with the term in any field, 0 if not in the index
+    };
+    
+    struct PatternStats {
+        std::string pattern;             // re: / lit: value
+        std::string trigram_query;       // e.g. "mov" "ove", "*" = no usable trigram
+        size_t trigram_matches;          // documents passing the trigram query
+    };
+    
+    std::vector<TermStats> terms;        // resolved query terms (after dedup)
+    bool filtered = false;               // query had ext: / dir: / mtime: / size: filters
+    size_t filter_matches = 0;           // documents passing the filters
+    std::vector<PatternStats> patterns;
+    size_t docs_verified = 0;            // candidates whose content was checked against the patterns
+    size_t postings_scanned = 0;         // postings read while building candidate sets
+    std::vector<size_t> candidate_sizes; // candidate set size after each intersection step
+    size_t docs_scored = 0;
+    size_t collapsed = 0;                // near-duplicate results folded into a better one
+    bool incremental = false;            // SearchSession narrowed the previous candidates
+    bool incomplete = false;             // the deadline ran out, results are the best of what was scored
+    size_t arena_bytes = 0;              // query temporaries allocated from the thread's QueryArena
+    size_t arena_blocks = 0;             // heap blocks the arena needed for this query (0 in steady state)
+    
+    // time per phase in milliseconds
+    double tokenize_ms = 0.0;
+    double intersect_ms = 0.0;
+    double verify_ms = 0.0;
+    double score_ms = 0.0;
+    double sort_ms = 0.0;
+    double snippet_ms = 0.0;
+    
+    double total_ms() const noexcept {
+        return tokenize_ms + intersect_ms + verify_ms + score_ms + sort_ms + snippet_ms;
+    }
+};
+
+// corpus statistics used for IDF
+// a sharded coordinator sums them over all shards and passes them back, so every shard scores
+// with the global document frequencies instead of its own and the merged top-k stays comparable
+struct CollectionStats {
+    size_t total_docs = 0;
+    std::unordered_map<std::string, std::array<size_t, field_count>> document_frequencies;  // term -> df per field
+    
+    // add the statistics of another shard
+    void merge(const CollectionStats& other);
+};
+
+// ranked candidates of one query, handed out page by page
+// next() only sorts as far as the page needs and continues where the previous page stopped,
+// so page 2 costs neither a new query nor snippets for page 1
+// valid while the index and document store are unchanged
+class SearchCursor {
+public:
+    // the next count hits (fewer at the end, 0 = all remaining), near-duplicates collapsed
+    std::vector<SearchHit> next(size_t count, SearchStats* stats = nullptr);
+    
+    bool done() const noexcept { return next_ == doc_scores_.size(); }
+    bool complete() const noexcept { return complete_; }      // false: the query ran out of time (QueryDeadline)
+    size_t returned() const noexcept { return returned_; }    // hits handed out so far
+    size_t candidates() const noexcept { return doc_scores_.size(); }
+
+private:
+    friend class SearchEngine;
+    friend class SearchSession;
+    
+    struct Cluster {
+        uint32_t best;                 // the member that is shown
+        double score;
+        size_t members;
+    };
+    
+    const DocumentStore* doc_store_ = nullptr;
+    std::vector<std::pair<uint32_t, double>> doc_scores_;  // [0, sorted_) in rank order
+    size_t sorted_ = 0;
+    size_t next_ = 0;
+    size_t returned_ = 0;
+    bool complete_ = true;
+    std::vector<std::pair<uint32_t, Cluster>> clusters_;   // sorted by cluster, best member, only clusters with hits
+    std::vector<std::string> snippet_terms_;
+    std::unordered_map<uint32_t, size_t> match_positions_; // re: / lit: match per document
+};
+
 // search engine - handles queries and scoring
 class SearchEngine {
 public:
-    SearchEngine(const InvertedIndex& index, const DocumentStore& doc_store);
+    SearchEngine(const InvertedIndex& index, const DocumentStore& doc_store, FieldBoosts boosts = FieldBoosts{});
     ~SearchEngine() = default;
     
     // Non-copyable, movable
@@ -32,18 +246,129 @@ public:
     SearchEngine& operator=(SearchEngine&&) noexcept = default;
     
     // search with max results limit
-    std::vector<SearchResult> search(const std::string& query, size_t max_results = 10) const;
+    // query may contain ext:<extension> and dir:<name>[/<name>...] filters, they are applied before scoring,
+    // and re:<regex> / lit:<text> patterns: the trigram index narrows the candidates, then their content
+    // is checked; each pattern adds 1 + log(matching lines) to the score
+    // mtime:<op><date or age> and size:<op><bytes> filter on file metadata (op one of < <= > >=),
+    // recent:<half-life> multiplies the score by 1 + 2^(-age / half-life), so new files rank higher
+    // stats is optional, if set it gets filled with execution stats for this query
+    // collection is optional, if set IDF uses its document counts instead of this index (sharding)
+    // same as execute(), then the first page of hits turned into results
+    // deadline is optional, if it runs out the results are a partial top-k (see QueryDeadline)
+    std::vector<SearchResult> search(const std::string& query, size_t max_results = 10,
+                                     SearchStats* stats = nullptr,
+                                     const CollectionStats* collection = nullptr,
+                                     QueryDeadline* deadline = nullptr) const;
+    
+    // run the query up to scoring, the cursor hands out the ranked hits page by page
+    SearchCursor execute(const std::string& query, SearchStats* stats = nullptr,
+                         const CollectionStats* collection = nullptr,
+                         QueryDeadline* deadline = nullptr) const;
+    
+    // path, snippet and copies of hits from cursor, snippets are only built here
+    // parallel: one thread per hit up to the core count (the content is decompressed per snippet)
+    std::vector<SearchResult> results(const std::vector<SearchHit>& hits, const SearchCursor& cursor,
+                                      bool parallel = false, SearchStats* stats = nullptr) const;
+    SearchResult result(const SearchHit& hit, const SearchCursor& cursor) const;
+    
+    // local document count and per-field document frequencies of the query's terms
+    CollectionStats collection_stats(const std::string& query) const;
+    
+    // count the terms of every executed query in hot_terms (cache warming, see warm_cache()), nullptr = off
+    void set_hot_terms(HotTerms* hot_terms) noexcept { hot_terms_ = hot_terms; }
+    
+    // false with a message if the query cannot run (an invalid re: pattern), search() would find nothing
+    static bool check_query(const std::string& query, std::string* error);
     
     // calculate TF-IDF score
-    double calculate_tf_idf(const std::string& term, uint32_t doc_id, size_t total_docs) const;
+    double calculate_tf_idf(const std::string& term, uint32_t doc_id, size_t total_docs,
+                            Field field = Field::content) const;
 
 private:
     const InvertedIndex& index_;
     const DocumentStore& doc_store_;
+    FieldBoosts boosts_;
+    HotTerms* hot_terms_ = nullptr;
+    
+    friend class SearchSession;
+    
+    using FieldPostings = std::array<const PostingList*, field_count>;
+    
+    // postings of a term in every field, docs (optional) receives the documents with the term in any field
+    FieldPostings lookup_term(const std::string& term, DocIdSet* docs, SearchStats* stats) const;
+    // add the score of one term to doc_scores (ascending by doc_id)
+    // returns how many entries from the front got it, fewer than all if the deadline ran out
+    size_t score_term(const std::string& term, const FieldPostings& postings, size_t total_docs,
+                      const CollectionStats* collection,
+                      std::vector<std::pair<uint32_t, double>>& doc_scores,
+                      QueryDeadline* deadline = nullptr) const;
+    // cursor over the scored candidates, groups near-duplicates by cluster
+    // match_positions: where a pattern matched, the snippet is taken from there
+    SearchCursor make_cursor(std::vector<std::pair<uint32_t, double>> doc_scores,
+                             std::vector<std::string> snippet_terms,
+                             std::unordered_map<uint32_t, size_t> match_positions = {}) const;
+    // documents satisfying a trigram query, false if it does not restrict them (all)
+    bool match_trigrams(const TrigramQuery& query, DocIdSet& docs) const;
+    double calculate_tf(const std::string& term, uint32_t doc_id, Field field) const;
+    double calculate_idf(const std::string& term, size_t total_docs, Field field) const;
+    bool build_filter(const ParsedQuery& query, DocIdSet& filter) const;
+    // recent: boost, scores *= 1 + 2^(-age / half_life) with the age from the modified column
+    void apply_recency(int64_t half_life, std::vector<std::pair<uint32_t, double>>& doc_scores) const;
+    // position of the first occurrence of any of the terms (case-insensitive), npos if none
+    static size_t first_match(const std::string& content, const std::vector<std::string>& query_terms);
+};
+
+// incremental search for search-as-you-type
+// keeps the candidate set of the previous query, a query that only adds terms or extends the last
+// word narrows that set instead of intersecting the posting lists from scratch
+// the last word is matched as a prefix (its most frequent completions) unless the query ends in a space
+// one session per input box, not thread safe; call reset() after the index was rebuilt
+class SearchSession {
+public:
+    static constexpr size_t max_completions = 16;  // completions of the last word that are searched
+    static constexpr size_t min_prefix_length = 2; // a shorter last word is ignored until it grows
+    
+    explicit SearchSession(const SearchEngine& engine);
+    
+    // search the current input, same results as SearchEngine::search() for complete words
+    // a deadline that runs out while candidates are narrowed drops the cache (the next update starts over)
+    std::vector<SearchResult> update(const std::string& query, size_t max_results = 10,
+                                     SearchStats* stats = nullptr, QueryDeadline* deadline = nullptr);
+    
+    // ranking of the last update(), its first page was returned by update()
+    SearchCursor& cursor() noexcept { return cursor_; }
+    
+    // forget the cached candidates
+    void reset() noexcept;
+
+private:
+    using FieldPostings = SearchEngine::FieldPostings;
+    
+    const SearchEngine& engine_;
+    bool valid_ = false;
+    
+    // context of the cache, a change invalidates it
+    std::vector<std::string> extensions_;
+    std::vector<std::vector<std::string>> directories_;
+    std::vector<RangeFilter> ranges_;
+    size_t document_count_ = 0;
+    size_t deleted_count_ = 0;
+    size_t filter_matches_ = 0;
+    
+    std::vector<std::string> terms_;             // complete words in query order
+    std::vector<FieldPostings> term_postings_;
+    bool unrestricted_ = true;                   // no filter and no words yet: base_ would be every document
+    DocIdSet base_;                              // filters AND all terms_, without tombstones
+    
+    std::string prefix_;                         // last word while it is typed, empty if none
+    std::vector<std::string> completions_;
+    std::vector<FieldPostings> completion_postings_;
+    DocIdSet prefix_docs_;                       // base_ AND any completion
+    
+    SearchCursor cursor_;
     
-    double calculate_tf(const std::string& term, uint32_t doc_id) const;
-    double calculate_idf(const std::string& term, size_t total_docs) const;
-    std::string extract_snippet(const std::string& content, const std::vector<std::string>& query_terms) const;
+    void find_completions(const std::string& prefix, SearchStats* stats);
+    void narrow(DocIdSet& candidates, const std::vector<const FieldPostings*>& any_of) const;
 };
 
 } // namespace notesearch
@@ -0,0 +1,128 @@
+#ifndef SERVER_HPP
+#define SERVER_HPP
+
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include "index.hpp"
+#include "document_store.hpp"
+#include "search.hpp"
+#include "json.hpp"
+
+namespace notesearch {
+
+/**
+ * Query server configuration
+ * Listens on a Unix domain socket if unix_socket_path is set, otherwise on 127.0.0.1:tcp_port
+ */
+struct ServerConfig {
+    std::string unix_socket_path;
+    uint16_t tcp_port = 7700;
+    size_t worker_threads = 0;                 // 0 = one per hardware thread
+    size_t max_line_bytes = 1 << 20;           // longer requests close the connection
+    size_t max_inflight_per_connection = 256;  // pipelined requests before reading pauses
+    double query_budget_ms = 0.0;              // time budget per query, 0 = none ("budget_ms" overrides it)
+    HotTerms* hot_terms = nullptr;             // counts the query terms of every worker, optional (cache warming)
+};
+
+/**
+ * Handle one request line of the newline-delimited JSON protocol
+ *
+ * Request:  {"id": 1, "q": "inverted index", "k": 10, "explain": false, "budget_ms": 50}
+ * Response: {"id": 1, "results": [{"path": ..., "score": ..., "snippet": ...}], "took_ms": ...}
+ * Errors:   {"id": 1, "error": "..."}
+ *
+ * "budget_ms" (optional, default default_budget_ms, 0 = none) bounds the query time: when it runs out
+ * the response holds the best of what was scored so far and "incomplete": true (see QueryDeadline).
+ *
+ * Two more forms are used by a sharded coordinator (see shard.hpp):
+ * {"id": 1, "q": ..., "df": true}  answers {"id": 1, "docs": N, "df": {"term": [content, filename, path]}}
+ * {"id": 1, "q": ..., "global": {"docs": N, "df": {...}}}  scores with these statistics instead of the local ones
+ *
+ * @return The response line without the trailing newline
+ */
+std::string handle_query_request(const SearchEngine& engine, std::string_view request_line,
+                                 double default_budget_ms = 0.0);
+
+/**
+ * Read the optional "budget_ms" of a request into budget_ms
+ * @return false if it is present but not a non-negative number
+ */
+bool parse_query_budget(const JsonValue& request, double& budget_ms);
+
+/**
+ * Read the optional "k" of a request into max_results (0 = all results)
+ * A k beyond the number of possible documents (UINT32_MAX) is clamped to it.
+ * @return false if it is present but not a finite, non-negative number
+ */
+bool parse_result_count(const JsonValue& request, size_t& max_results);
+
+/**
+ * Serialize CollectionStats as {"docs": N, "df": {"term": [content, filename, path]}}
+ */
+void append_collection_stats(std::string& out, const CollectionStats& collection);
+
+/**
+ * Read CollectionStats in the format written by append_collection_stats
+ * @return false if the value is malformed
+ */
+bool parse_collection_stats(const JsonValue& value, CollectionStats& collection);
+
+/**
+ * Answers one request line, returns the response line without the trailing newline
+ */
+using RequestHandler = std::function<std::string(std::string_view)>;
+
+/**
+ * QueryServer keeps the index resident and answers queries over a socket
+ * One event loop thread (epoll on Linux, poll/WSAPoll elsewhere) owns all connections,
+ * queries run on a worker pool that shares the read-only index.
+ * Many requests can be pipelined on one connection, responses come back in request order.
+ */
+class QueryServer {
+public:
+    QueryServer(const InvertedIndex& index, const DocumentStore& doc_store, ServerConfig config);
+
+    /**
+     * Serve requests with a custom handler (e.g. the shard coordinator)
+     * @param make_handler Called once per worker thread, so handlers can keep per-thread state
+     */
+    QueryServer(std::function<RequestHandler()> make_handler, ServerConfig config);
+
+    ~QueryServer();
+
+    // Non-copyable, non-movable (worker threads reference this object)
+    QueryServer(const QueryServer&) = delete;
+    QueryServer& operator=(const QueryServer&) = delete;
+
+    /**
+     * Bind the listening socket
+     * @return false if binding failed, error describes why
+     */
+    bool start(std::string* error = nullptr);
+
+    /**
+     * Run the event loop until stop() is called
+     */
+    void run();
+
+    /**
+     * Ask the event loop to exit (safe from other threads and signal handlers)
+     */
+    void stop() noexcept { stop_requested_.store(true); }
+
+private:
+    struct Impl;
+
+    std::function<RequestHandler()> make_handler_;
+    ServerConfig config_;
+    std::atomic<bool> stop_requested_{false};
+    std::unique_ptr<Impl> impl_;
+};
+
+} // namespace notesearch
+
+#endif // SERVER_HPP
@@ -0,0 +1,88 @@
+#ifndef SHARD_HPP
+#define SHARD_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <filesystem>
+#include <cstdint>
+#include "json.hpp"
+#include "net.hpp"
+
+namespace notesearch {
+
+/**
+ * Which of shard_count shards a file belongs to
+ * Hashes the path relative to the indexed root, so every worker decides on its own
+ * which files are its share and nothing is read twice.
+ */
+size_t shard_of(const std::filesystem::path& relative_path, size_t shard_count);
+
+/**
+ * Address of a shard worker: a port on 127.0.0.1 or a Unix domain socket
+ */
+struct ShardAddress {
+    std::string unix_socket_path;
+    uint16_t tcp_port = 0;
+
+    /**
+     * Parse "7701" (port) or anything else as a socket path
+     * @return false if the text is empty or the port is out of range
+     */
+    static bool parse(const std::string& text, ShardAddress& address);
+
+    std::string to_string() const;
+};
+
+/**
+ * ShardCoordinator fans queries out to shard workers (serve --shard i/N) and merges their top-k
+ *
+ * Every query takes two rounds, both sent to all shards before any answer is read:
+ * 1. each shard reports its document count and the document frequencies of the query terms,
+ *    the coordinator sums them
+ * 2. each shard searches with the global statistics, so its scores are the ones a single
+ *    index over the whole corpus would give, and returns its top k
+ * The merged list is the global top k. Requests and responses use the query server protocol,
+ * clients cannot tell a coordinator from a single server.
+ *
+ * One blocking connection per shard, opened on first use and reopened once after an error.
+ * Not thread safe, the coordinator server gives each worker thread its own instance.
+ */
+class ShardCoordinator {
+public:
+    explicit ShardCoordinator(std::vector<ShardAddress> shards);
+    ~ShardCoordinator();
+
+    // Non-copyable, non-movable (owns sockets)
+    ShardCoordinator(const ShardCoordinator&) = delete;
+    ShardCoordinator& operator=(const ShardCoordinator&) = delete;
+
+    /**
+     * Answer one request line, same format as handle_query_request()
+     * The time budget covers both rounds, the shards get what is left after the first
+     */
+    std::string handle_request(std::string_view request_line, double default_budget_ms = 0.0);
+
+private:
+    struct Shard {
+        ShardAddress address;
+        socket_t sock = invalid_socket;
+        std::string buffer;  // bytes received past the last response
+    };
+
+    std::vector<Shard> shards_;
+
+    /**
+     * Send one request to every shard, then collect the responses (in shard order)
+     * @return false if a shard could not be reached or answered with an error, error describes it
+     */
+    bool exchange(const std::vector<std::string>& requests, std::vector<JsonValue>& responses,
+                  std::string& error);
+
+    bool connect(Shard& shard);
+    void disconnect(Shard& shard) noexcept;
+};
+
+} // namespace notesearch
+
+#endif // SHARD_HPP
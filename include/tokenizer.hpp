@@ -2,7 +2,10 @@
 #define TOKENIZER_HPP
 
 #include <string> 
+#include <string_view>
 #include <vector>
+#include <cstdint>
+#include <cstddef>
 
 
 namespace notesearch {
@@ -10,16 +13,85 @@ namespace notesearch {
     /**
     tokenizes the text into normalized search term, 
 
-    rules
+    rules (see DefaultAnalyzer in analyzer.hpp)
     - Split on whitespace or non alphanumeric characters
     - Convert to lowercase
-    - Remove tokens shorter than 2 chars
+    - Remove tokens shorter than 2 or longer than 64 chars
+    - Remove numbers with more than 8 digits
+    - Remove English stopwords
+    - Reduce plurals to the singular
 
-     @param text The text to tokenize.
+    Used for documents and queries alike, so both always produce the same terms.
+
+     @param text The text to tokenize (a view, so mapped file content is not copied).
      @return A vector of strings.
      */
-     std::vector<std::string> tokenize(const std::string& text);
+     std::vector<std::string> tokenize(std::string_view text);
+
+    /**
+     * TermCounter tokenizes a document and counts its terms in one pass
+     *
+     * Same rules as tokenize(), but no token string is materialized: each token is hashed
+     * once (hash_bytes) and interned into an open addressing table that gives it a term ID
+     * (0, 1, 2 ... in order of first occurrence) and counts its occurrences. The bytes of a
+     * term are stored once per document in a shared pool. Table and pool are reused from
+     * document to document, so counting a document allocates nothing once they are large enough.
+     *
+     * IndexBuilder and InvertedIndex append postings by term ID and reuse the hash,
+     * DocumentStore fingerprints the document from the same hashes.
+     */
+    class TermCounter {
+    public:
+        struct Term {
+            std::string_view text;   // valid until the next count()
+            uint64_t hash;           // hash_bytes(text)
+            uint32_t frequency;
+        };
+
+        /**
+         * Tokenize and count a document, replacing the previous one
+         */
+        void count(std::string_view text);
+
+        /**
+         * Count already analyzed tokens (e.g. from analyze_path), replacing the previous document
+         */
+        void count(const std::vector<std::string>& tokens);
+
+        /**
+         * Tokens in the document, repeats included
+         */
+        size_t token_count() const noexcept { return token_count_; }
+
+        /**
+         * Distinct terms, term IDs are 0 .. size() - 1
+         */
+        size_t size() const noexcept { return terms_.size(); }
+
+        Term term(uint32_t id) const noexcept {
+            const Entry& entry = terms_[id];
+            return {std::string_view(pool_).substr(entry.offset, entry.length), entry.hash, entry.frequency};
+        }
+
+    private:
+        struct Entry {
+            uint64_t hash;
+            uint32_t offset;      // in pool_
+            uint32_t length;
+            uint32_t frequency;
+            uint32_t slot;        // position in slots_, so clear() only touches used slots
+        };
+
+        std::vector<uint32_t> slots_;   // term ID + 1, 0 = empty (linear probing)
+        std::vector<Entry> terms_;
+        std::string pool_;
+        size_t token_count_ = 0;
+
+        void clear() noexcept;
+        void add(std::string_view token);
+        void grow();
+    };
 
 }
 
-#endif
\ No newline at end of file
+#endif
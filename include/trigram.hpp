@@ -0,0 +1,73 @@
+#ifndef TRIGRAM_HPP
+#define TRIGRAM_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+namespace notesearch {
+
+/**
+ * A trigram: three consecutive bytes of the content, ASCII letters folded to lowercase,
+ * packed into the low 24 bits (first byte highest, so keys sort like the byte strings)
+ */
+inline uint32_t trigram_key(char a, char b, char c) noexcept {
+    auto fold = [](char ch) {
+        unsigned char byte = static_cast<unsigned char>(ch);
+        return static_cast<uint32_t>(byte >= 'A' && byte <= 'Z' ? byte + ('a' - 'A') : byte);
+    };
+    return (fold(a) << 16) | (fold(b) << 8) | fold(c);
+}
+
+/**
+ * The three bytes of a trigram key as a string (for index records and --explain)
+ */
+std::string trigram_string(uint32_t trigram);
+
+/**
+ * Distinct trigrams of a document, in order of first occurrence
+ */
+void document_trigrams(std::string_view content, std::vector<uint32_t>& trigrams);
+
+/**
+ * Boolean query over trigrams that every match of a pattern satisfies
+ *
+ * all: no restriction (the pattern has no usable literal), none: nothing can match,
+ * and_ / or_: all / any of trigrams and of the sub queries.
+ */
+struct TrigramQuery {
+    enum class Op : uint8_t { all, none, and_, or_ };
+
+    Op op = Op::all;
+    std::vector<uint32_t> trigrams;
+    std::vector<TrigramQuery> children;
+
+    static TrigramQuery all() { return TrigramQuery{}; }
+
+    // combine, simplifying all / none and flattening nested queries of the same kind
+    static TrigramQuery and_of(TrigramQuery a, TrigramQuery b);
+    static TrigramQuery or_of(TrigramQuery a, TrigramQuery b);
+
+    // e.g. ("foo" "oob") | "bar"
+    std::string to_string() const;
+};
+
+/**
+ * Trigram query of a regular expression (ECMAScript syntax as in std::regex)
+ *
+ * The pattern is analyzed the way Code Search does it: for each part the set of exact
+ * strings it can match (while small), otherwise the possible prefixes and suffixes plus the
+ * trigrams it requires. Alternations become ORs, concatenations ANDs including the trigrams
+ * spanning both parts. Unknown syntax degrades to all, so the result never excludes a match.
+ */
+TrigramQuery regex_trigram_query(std::string_view pattern);
+
+/**
+ * Trigram query of a literal substring (all its trigrams, all if shorter than 3 bytes)
+ */
+TrigramQuery literal_trigram_query(std::string_view text);
+
+} // namespace notesearch
+
+#endif // TRIGRAM_HPP
@@ -0,0 +1,134 @@
+#ifndef UPDATE_LOG_HPP
+#define UPDATE_LOG_HPP
+
+#include <string>
+#include <vector>
+#include <filesystem>
+#include <cstdio>
+#include <cstdint>
+
+namespace notesearch {
+
+/**
+ * One entry of the update log
+ */
+struct LogRecord {
+    enum class Type : uint8_t {
+        start = 1,        // first record, blob_size of the snapshot the log applies to
+        add = 2,          // add (or replace) the document at path
+        remove = 3,       // delete the document at path
+        checkpoint = 4,   // snapshot .tmp files are complete, see IndexUpdater::checkpoint()
+    };
+
+    Type type = Type::start;
+    std::string root;             // add: directory the index was built from (dir: filters)
+    std::string path;             // add, remove: document path
+    std::string content;          // add: file content
+    uint64_t blob_offset = 0;     // add: where the content goes in the blob; start, checkpoint: blob size
+    int64_t modified_time = 0;    // add: last write time of the file
+};
+
+/**
+ * UpdateLog is the write-ahead log of a persistent index (updates.wal)
+ *
+ * On disk every record is framed as payload length (4 bytes), CRC-32 of the payload (4 bytes)
+ * and the payload, so a record that was only partly written when the process died is detected
+ * and dropped instead of being replayed as garbage. Records are appended and flushed to the OS
+ * one by one; sync() makes them durable, so a batch of changes costs one fsync.
+ */
+class UpdateLog {
+public:
+    UpdateLog() = default;
+    ~UpdateLog();
+
+    // Non-copyable
+    UpdateLog(const UpdateLog&) = delete;
+    UpdateLog& operator=(const UpdateLog&) = delete;
+
+    /**
+     * Read the log up to the first incomplete or damaged record, later appends overwrite that tail
+     * A missing file is an empty log.
+     * @return false if the file cannot be read or is not an update log
+     */
+    bool open(const std::filesystem::path& log_path, std::vector<LogRecord>& records,
+              std::string* error = nullptr);
+
+    /**
+     * Append a record (flushed to the OS, durable after sync())
+     * @return false on a write error
+     */
+    bool append(const LogRecord& record, std::string* error = nullptr);
+
+    /**
+     * Make all appended records durable (fsync)
+     */
+    bool sync(std::string* error = nullptr);
+
+    /**
+     * Atomically replace the log by one holding only a start record (written to a temporary
+     * file, synced and renamed over the log)
+     */
+    bool reset(uint64_t blob_size, std::string* error = nullptr);
+
+    /**
+     * Bytes of intact records in the log
+     */
+    uint64_t size_bytes() const noexcept { return size_; }
+
+    bool empty() const noexcept { return size_ == 0; }
+
+private:
+    static constexpr size_t header_bytes = 8;   // length, CRC-32
+
+    std::filesystem::path path_;
+    std::FILE* file_ = nullptr;   // opened for appending on first use
+    uint64_t size_ = 0;
+    bool damaged_tail_ = false;   // bytes after size_ to cut off before appending
+
+    void close() noexcept;
+};
+
+/**
+ * IndexLock is a lock on a persistent index directory (its lock file), released when it goes away
+ *
+ * IndexUpdater holds it exclusively from open() on, processes that only query an index hold it
+ * shared while they load the snapshot and replay the log (IndexUpdater::load()), so they never see
+ * a checkpoint half done. Both wait for the lock; a shared lock on an index the process may not
+ * write to (no lock file, none can be created) is granted without one.
+ */
+class IndexLock {
+public:
+    IndexLock() = default;
+    ~IndexLock();
+
+    // Non-copyable
+    IndexLock(const IndexLock&) = delete;
+    IndexLock& operator=(const IndexLock&) = delete;
+
+    /**
+     * Wait for and take the lock, the lock file is created if missing
+     * @param exclusive true: updating the index, false: loading it
+     * @return false if the lock file cannot be opened or locked
+     */
+    bool lock(const std::filesystem::path& lock_path, bool exclusive, std::string* error = nullptr);
+
+    void unlock() noexcept;
+
+private:
+#ifdef _WIN32
+    void* file_ = nullptr;   // HANDLE
+#else
+    int fd_ = -1;
+#endif
+};
+
+/**
+ * Flush a file / a directory entry (after a rename) to disk
+ * @return false if the file cannot be opened or synced
+ */
+bool sync_file(const std::filesystem::path& path);
+bool sync_directory(const std::filesystem::path& dir);
+
+} // namespace notesearch
+
+#endif // UPDATE_LOG_HPP
@@ -20,6 +20,12 @@ std::string read_file_content(const std::filesystem::path& file_path);
 // Extract snippet from text around a match position
 std::string extract_snippet(const std::string& text, size_t position, size_t context_size = 50);
 
+// Heap bytes owned by a string (0 if it fits in the small string buffer)
+size_t string_heap_bytes(const std::string& str) noexcept;
+
+// Format a byte count for display, e.g. "1.5 MB"
+std::string format_bytes(size_t bytes);
+
 } // namespace notesearch
 
 #endif // UTIL_HPP
@@ -0,0 +1,61 @@
+#include "analyzer.hpp"
+#include <algorithm>
+#include <iterator>
+
+namespace notesearch {
+
+namespace {
+
+bool ends_with(const std::string& token, std::string_view suffix) noexcept {
+    return token.size() >= suffix.size() &&
+           std::string_view(token).substr(token.size() - suffix.size()) == suffix;
+}
+
+} // namespace
+
+bool is_stopword(std::string_view token) noexcept {
+    // sortiert (binary_search), Wörter unter 2 Zeichen fängt schon der LengthFilter ab
+    static constexpr std::string_view stopwords[] = {
+        "about", "above", "after", "again", "against", "all", "am", "an", "and", "any", "are", "as",
+        "at", "be", "because", "been", "before", "being", "below", "between", "both", "but", "by",
+        "can", "could", "did", "do", "does", "doing", "down", "during", "each", "few", "for",
+        "from", "further", "had", "has", "have", "having", "he", "her", "here", "hers", "herself",
+        "him", "himself", "his", "how", "if", "in", "into", "is", "it", "its", "itself", "just",
+        "me", "more", "most", "my", "myself", "no", "nor", "not", "now", "of", "off", "on", "once",
+        "only", "or", "other", "our", "ours", "ourselves", "out", "over", "own", "same", "she",
+        "should", "so", "some", "such", "than", "that", "the", "their", "theirs", "them",
+        "themselves", "then", "there", "these", "they", "this", "those", "through", "to", "too",
+        "under", "until", "up", "very", "was", "we", "were", "what", "when", "where", "which",
+        "while", "who", "whom", "why", "will", "with", "would", "you", "your", "yours", "yourself",
+        "yourselves",
+    };
+    return std::binary_search(std::begin(stopwords), std::end(stopwords), token);
+}
+
+// Nur Plural Endungen, geprüft von der längsten zur kürzesten
+// Kurze Wörter (bis 3 Zeichen) bleiben unverändert: "has", "bus", "gas"
+void light_stem(std::string& token) noexcept {
+    if (token.size() <= 3) {
+        return;
+    }
+
+    // queries -> query (eies, aies bleiben)
+    if (token.size() > 4 && ends_with(token, "ies") && !ends_with(token, "eies") && !ends_with(token, "aies")) {
+        token.resize(token.size() - 3);
+        token += 'y';
+        return;
+    }
+
+    // classes -> class, indexes -> index, matches -> match, wishes -> wish
+    if (ends_with(token, "sses") || ends_with(token, "xes") || ends_with(token, "ches") || ends_with(token, "shes")) {
+        token.resize(token.size() - 2);
+        return;
+    }
+
+    // files -> file, aber status, class, analysis bleiben
+    if (ends_with(token, "s") && !ends_with(token, "ss") && !ends_with(token, "us") && !ends_with(token, "is")) {
+        token.pop_back();
+    }
+}
+
+} // namespace notesearch
@@ -0,0 +1,191 @@
+#include "binary_io.hpp"
+#include <algorithm>
+#include <array>
+
+namespace notesearch {
+
+void append_varint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out += static_cast<char>((value & 0x7f) | 0x80);
+        value >>= 7;
+    }
+    out += static_cast<char>(value);
+}
+
+bool read_varint(std::string_view bytes, size_t& pos, uint64_t& value) noexcept {
+    value = 0;
+    for (unsigned shift = 0; shift < 64 && pos < bytes.size(); shift += 7) {
+        uint8_t byte = static_cast<uint8_t>(bytes[pos++]);
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Tabelle für ein Byte pro Schritt, einmal beim ersten Aufruf berechnet
+uint32_t crc32(std::string_view bytes, uint32_t crc) noexcept {
+    static const std::array<uint32_t, 256> table = [] {
+        std::array<uint32_t, 256> result{};
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t value = i;
+            for (int bit = 0; bit < 8; ++bit) {
+                value = (value & 1) ? 0xedb88320u ^ (value >> 1) : value >> 1;
+            }
+            result[i] = value;
+        }
+        return result;
+    }();
+    crc = ~crc;
+    for (char c : bytes) {
+        crc = table[(crc ^ static_cast<uint8_t>(c)) & 0xff] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+bool BinaryWriter::open(const std::filesystem::path& path) {
+    file_.open(path, std::ios::binary | std::ios::trunc);
+    buffer_.clear();
+    buffer_.reserve(buffer_size);
+    written_ = 0;
+    ok_ = file_.is_open();
+    return ok_;
+}
+
+void BinaryWriter::flush() {
+    if (ok_ && !buffer_.empty()) {
+        file_.write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+        ok_ = static_cast<bool>(file_);
+    }
+    written_ += buffer_.size();
+    buffer_.clear();
+}
+
+void BinaryWriter::put_byte(uint8_t value) {
+    buffer_ += static_cast<char>(value);
+    if (buffer_.size() >= buffer_size) {
+        flush();
+    }
+}
+
+void BinaryWriter::put_varint(uint64_t value) {
+    append_varint(buffer_, value);
+    if (buffer_.size() >= buffer_size) {
+        flush();
+    }
+}
+
+void BinaryWriter::put_u64(uint64_t value) {
+    for (int i = 0; i < 8; ++i) {
+        buffer_ += static_cast<char>(value >> (8 * i));
+    }
+    if (buffer_.size() >= buffer_size) {
+        flush();
+    }
+}
+
+void BinaryWriter::put_bytes(std::string_view bytes) {
+    if (buffer_.size() + bytes.size() > buffer_size) {
+        flush();
+    }
+    if (bytes.size() >= buffer_size) {
+        // große Blöcke direkt schreiben statt über den Puffer
+        if (ok_) {
+            file_.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+            ok_ = static_cast<bool>(file_);
+        }
+        written_ += bytes.size();
+        return;
+    }
+    buffer_ += bytes;
+}
+
+bool BinaryWriter::close() {
+    flush();
+    if (file_.is_open()) {
+        file_.close();
+        ok_ = ok_ && !file_.fail();
+    }
+    return ok_;
+}
+
+bool BinaryReader::open(const std::filesystem::path& path) {
+    file_.open(path, std::ios::binary);
+    buffer_.clear();
+    pos_ = 0;
+    ok_ = file_.is_open();
+    return ok_;
+}
+
+bool BinaryReader::fill() {
+    if (!ok_) {
+        return false;
+    }
+    // ungelesenen Rest behalten (ein Varint kann über die Puffergrenze gehen)
+    buffer_.erase(0, pos_);
+    pos_ = 0;
+    size_t kept = buffer_.size();
+    buffer_.resize(kept + buffer_size);
+    file_.read(&buffer_[kept], static_cast<std::streamsize>(buffer_size));
+    buffer_.resize(kept + static_cast<size_t>(file_.gcount()));
+    return buffer_.size() > kept;
+}
+
+bool BinaryReader::peek_byte(uint8_t& value) {
+    if (pos_ >= buffer_.size() && !fill()) {
+        ok_ = false;
+        return false;
+    }
+    value = static_cast<uint8_t>(buffer_[pos_]);
+    return true;
+}
+
+bool BinaryReader::get_byte(uint8_t& value) {
+    if (!peek_byte(value)) {
+        return false;
+    }
+    ++pos_;
+    return true;
+}
+
+bool BinaryReader::get_varint(uint64_t& value) {
+    if (buffer_.size() - pos_ < 10) {
+        fill();  // Ende der Datei: es bleibt weniger, read_varint merkt ein abgeschnittenes Varint
+    }
+    ok_ = ok_ && read_varint(buffer_, pos_, value);
+    return ok_;
+}
+
+bool BinaryReader::get_u64(uint64_t& value) {
+    std::string bytes;
+    if (!get_bytes(8, bytes)) {
+        return false;
+    }
+    value = 0;
+    for (int i = 0; i < 8; ++i) {
+        value |= static_cast<uint64_t>(static_cast<uint8_t>(bytes[static_cast<size_t>(i)])) << (8 * i);
+    }
+    return true;
+}
+
+bool BinaryReader::get_bytes(size_t size, std::string& out) {
+    out.clear();
+    while (ok_ && out.size() < size) {
+        if (pos_ >= buffer_.size() && !fill()) {
+            ok_ = false;
+            break;
+        }
+        size_t chunk = std::min(size - out.size(), buffer_.size() - pos_);
+        out.append(buffer_, pos_, chunk);
+        pos_ += chunk;
+    }
+    return ok_;
+}
+
+bool BinaryReader::get_string(std::string& out) {
+    uint64_t size = 0;
+    return get_varint(size) && get_bytes(static_cast<size_t>(size), out);
+}
+
+} // namespace notesearch
@@ -0,0 +1,172 @@
+#include "cache_warmer.hpp"
+#include "binary_io.hpp"
+#include "search.hpp"
+#include <algorithm>
+#include <chrono>
+#include <unordered_set>
+
+namespace notesearch {
+
+namespace {
+
+constexpr uint32_t hot_terms_magic = 0x5448534e;   // "NSHT"
+constexpr uint64_t hot_terms_version = 1;
+
+// absteigend nach Anzahl, bei Gleichstand alphabetisch (damit save() deterministisch ist)
+bool hotter(const std::pair<std::string, uint64_t>& a, const std::pair<std::string, uint64_t>& b) {
+    return a.second != b.second ? a.second > b.second : a.first < b.first;
+}
+
+} // namespace
+
+void HotTerms::record(const std::vector<std::string>& terms) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& term : terms) {
+        ++counts_[term];
+    }
+    if (counts_.size() > max_tracked) {
+        prune();
+    }
+}
+
+// Beliebige Wörter von Clients sollen den Speicher nicht füllen: die seltenere Hälfte fliegt raus
+void HotTerms::prune() {
+    std::vector<uint64_t> counts;
+    counts.reserve(counts_.size());
+    for (const auto& entry : counts_) {
+        counts.push_back(entry.second);
+    }
+    auto middle = counts.begin() + static_cast<std::ptrdiff_t>(counts.size() / 2);
+    std::nth_element(counts.begin(), middle, counts.end());
+    uint64_t threshold = *middle;
+    for (auto it = counts_.begin(); it != counts_.end();) {
+        // <= damit auch lauter Einsen schrumpfen
+        it = it->second <= threshold ? counts_.erase(it) : std::next(it);
+    }
+}
+
+std::vector<std::pair<std::string, uint64_t>> HotTerms::hottest(size_t count) const {
+    std::vector<std::pair<std::string, uint64_t>> terms;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        terms.assign(counts_.begin(), counts_.end());
+    }
+    if (terms.size() > count) {
+        std::partial_sort(terms.begin(), terms.begin() + static_cast<std::ptrdiff_t>(count), terms.end(), hotter);
+        terms.resize(count);
+    } else {
+        std::sort(terms.begin(), terms.end(), hotter);
+    }
+    return terms;
+}
+
+size_t HotTerms::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return counts_.size();
+}
+
+// hot_terms.bin: Header, Anzahl, dann Wort + Zähler, heißestes zuerst
+bool HotTerms::save(const std::filesystem::path& path, std::string* error) const {
+    std::vector<std::pair<std::string, uint64_t>> terms = hottest(max_saved);
+    std::filesystem::path temp_path = path;
+    temp_path += ".tmp";
+
+    BinaryWriter out;
+    if (!out.open(temp_path)) {
+        if (error) *error = "cannot create " + temp_path.string();
+        return false;
+    }
+    out.put_varint(hot_terms_magic);
+    out.put_varint(hot_terms_version);
+    out.put_varint(terms.size());
+    for (const auto& [term, count] : terms) {
+        out.put_string(term);
+        out.put_varint(count);
+    }
+    if (!out.close()) {
+        if (error) *error = "cannot write " + temp_path.string() + " (disk full?)";
+        return false;
+    }
+    // ein Absturz beim Schreiben lässt die alte Datei stehen
+    std::error_code ec;
+    std::filesystem::rename(temp_path, path, ec);
+    if (ec) {
+        if (error) *error = "cannot replace " + path.string() + ": " + ec.message();
+        return false;
+    }
+    return true;
+}
+
+bool HotTerms::load(const std::filesystem::path& path, std::string* error) {
+    std::error_code ec;
+    if (!std::filesystem::exists(path, ec)) {
+        return true;  // noch nie gespeichert (neuer Index)
+    }
+    BinaryReader in;
+    if (!in.open(path)) {
+        if (error) *error = "cannot open " + path.string();
+        return false;
+    }
+    uint64_t magic = 0;
+    uint64_t version = 0;
+    uint64_t count = 0;
+    if (!in.get_varint(magic) || magic != hot_terms_magic || !in.get_varint(version) ||
+        version != hot_terms_version) {
+        if (error) *error = path.string() + " is not a hot terms file of this version";
+        return false;
+    }
+    if (!in.get_varint(count)) {
+        if (error) *error = path.string() + " is damaged";
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (uint64_t i = 0; i < count; ++i) {
+        std::string term;
+        uint64_t term_count = 0;
+        if (!in.get_string(term) || !in.get_varint(term_count)) {
+            if (error) *error = path.string() + " is damaged";
+            return false;
+        }
+        // halbiert: was im letzten Lauf gesucht wurde zählt mehr als was davor gesucht wurde
+        if (term_count / 2 > 0) {
+            counts_[term] += term_count / 2;
+        }
+    }
+    return true;
+}
+
+WarmupStats warm_cache(const InvertedIndex& index, const DocumentStore& doc_store, const HotTerms& hot_terms,
+                       const WarmupOptions& options, const std::atomic<bool>* stop) {
+    auto start = std::chrono::steady_clock::now();
+    WarmupStats stats;
+    // eigene Engine ohne HotTerms: die Warm-up Queries sollen nicht mitgezählt werden
+    SearchEngine engine(index, doc_store);
+    std::unordered_set<uint32_t> seen;
+
+    for (const auto& [term, count] : hot_terms.hottest(options.max_terms)) {
+        if (stats.bytes >= options.max_bytes) {
+            break;
+        }
+        if (stop && stop->load(std::memory_order_relaxed)) {
+            stats.stopped = true;
+            break;
+        }
+        // die Query läuft einmal über die Postings, der Cursor liefert die Top-Treffer ohne Snippets
+        SearchCursor cursor = engine.execute(term);
+        std::vector<uint32_t> doc_ids;
+        for (const auto& hit : cursor.next(options.results_per_term)) {
+            if (seen.insert(hit.doc_id).second) {
+                doc_ids.push_back(hit.doc_id);
+            }
+        }
+        ++stats.terms;
+        stats.documents += doc_ids.size();
+        stats.bytes += doc_store.prefetch_content(doc_ids);
+    }
+
+    stats.elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return stats;
+}
+
+} // namespace notesearch
@@ -0,0 +1,177 @@
+#include "compression.hpp"
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace notesearch {
+
+namespace {
+
+// Formatregeln von LZ4: ein Match ist mindestens 4 Bytes lang, die letzten 5 Bytes
+// sind immer Literale und ein Match darf nicht in den letzten 12 Bytes beginnen
+constexpr size_t min_match = 4;
+constexpr size_t last_literals = 5;
+constexpr size_t match_start_limit = 12;
+constexpr size_t max_offset = 65535;
+constexpr unsigned hash_bits = 12;
+
+uint32_t read32(const char* p) noexcept {
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+uint32_t hash_sequence(uint32_t sequence) noexcept {
+    return (sequence * 2654435761u) >> (32 - hash_bits);  // Fibonacci Hashing
+}
+
+// Länge >= 15 wird als 255, 255, ..., Rest hinten angehängt
+void write_length(std::string& out, size_t length) {
+    while (length >= 255) {
+        out += static_cast<char>(255);
+        length -= 255;
+    }
+    out += static_cast<char>(length);
+}
+
+void emit_sequence(std::string& out, const char* literals, size_t literal_length,
+                   size_t offset, size_t match_length) {
+    size_t match_code = match_length >= min_match ? match_length - min_match : 0;
+    unsigned token = static_cast<unsigned>((literal_length < 15 ? literal_length : 15) << 4);
+    if (match_length > 0) {
+        token |= static_cast<unsigned>(match_code < 15 ? match_code : 15);
+    }
+    out += static_cast<char>(token);
+    if (literal_length >= 15) {
+        write_length(out, literal_length - 15);
+    }
+    out.append(literals, literal_length);
+
+    if (match_length == 0) {
+        return;  // letzte Sequenz: nur Literale
+    }
+    out += static_cast<char>(offset & 0xFF);
+    out += static_cast<char>((offset >> 8) & 0xFF);
+    if (match_code >= 15) {
+        write_length(out, match_code - 15);
+    }
+}
+
+// liest eine Länge Erweiterung (255, 255, ..., Rest), false bei Ende der Daten
+bool read_length(std::string_view in, size_t& pos, size_t& length) {
+    unsigned char byte;
+    do {
+        if (pos >= in.size()) {
+            return false;
+        }
+        byte = static_cast<unsigned char>(in[pos++]);
+        length += byte;
+    } while (byte == 255);
+    return true;
+}
+
+} // namespace
+
+std::string compress_block(std::string_view input) {
+    std::string out;
+    const size_t size = input.size();
+    out.reserve(size + size / 255 + 16);
+    const char* data = input.data();
+
+    size_t anchor = 0;  // Beginn der noch nicht geschriebenen Literale
+    if (size > match_start_limit) {
+        std::vector<uint32_t> table(size_t{1} << hash_bits, UINT32_MAX);  // Hash -> letzte Position
+        const size_t limit = size - match_start_limit;
+        const size_t match_end_limit = size - last_literals;
+
+        size_t pos = 0;
+        while (pos < limit) {
+            uint32_t sequence = read32(data + pos);
+            uint32_t& slot = table[hash_sequence(sequence)];
+            size_t candidate = slot;
+            slot = static_cast<uint32_t>(pos);
+
+            if (candidate == UINT32_MAX || pos - candidate > max_offset || read32(data + candidate) != sequence) {
+                // kein Match: bei langen Literal Strecken schneller weiterspringen (inkompressible Daten)
+                pos += 1 + ((pos - anchor) >> 6);
+                continue;
+            }
+
+            size_t length = min_match;
+            while (pos + length < match_end_limit && data[candidate + length] == data[pos + length]) {
+                ++length;
+            }
+
+            emit_sequence(out, data + anchor, pos - anchor, pos - candidate, length);
+            pos += length;
+            anchor = pos;
+        }
+    }
+
+    emit_sequence(out, data + anchor, size - anchor, 0, 0);
+    return out;
+}
+
+bool decompress_block(std::string_view compressed, size_t raw_size, std::string& out, size_t limit) {
+    // Ziel einmal in voller Größe anlegen und über einen Zeiger schreiben, statt pro Byte anzuhängen
+    out.assign(raw_size, '\0');
+    char* dest = &out[0];
+    size_t written = 0;
+
+    size_t pos = 0;
+    while (pos < compressed.size()) {
+        if (written >= limit) {
+            out.resize(written);  // nur der Anfang war gefragt (z.B. für ein Snippet)
+            return true;
+        }
+        unsigned token = static_cast<unsigned char>(compressed[pos++]);
+
+        size_t literal_length = token >> 4;
+        if (literal_length == 15 && !read_length(compressed, pos, literal_length)) {
+            return false;
+        }
+        if (literal_length > compressed.size() - pos || literal_length > raw_size - written) {
+            return false;
+        }
+        std::memcpy(dest + written, compressed.data() + pos, literal_length);
+        written += literal_length;
+        pos += literal_length;
+
+        if (pos == compressed.size()) {
+            break;  // letzte Sequenz hat keinen Match
+        }
+
+        if (compressed.size() - pos < 2) {
+            return false;
+        }
+        size_t offset = static_cast<unsigned char>(compressed[pos]) |
+                        (static_cast<size_t>(static_cast<unsigned char>(compressed[pos + 1])) << 8);
+        pos += 2;
+        size_t match_length = token & 0x0F;
+        if (match_length == 15 && !read_length(compressed, pos, match_length)) {
+            return false;
+        }
+        match_length += min_match;
+
+        if (offset == 0 || offset > written || match_length > raw_size - written) {
+            return false;
+        }
+        const char* from = dest + written - offset;
+        if (offset >= match_length) {
+            std::memcpy(dest + written, from, match_length);  // Quelle und Ziel getrennt
+        } else {
+            // überlappend (Wiederholung eines kurzen Musters): Byte für Byte
+            for (size_t i = 0; i < match_length; ++i) {
+                dest[written + i] = from[i];
+            }
+        }
+        written += match_length;
+    }
+
+    if (written != raw_size) {
+        return false;
+    }
+    return true;
+}
+
+} // namespace notesearch
@@ -0,0 +1,468 @@
+#include "content_store.hpp"
+#include "compression.hpp"
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <string>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace notesearch {
+
+namespace {
+
+// Ein Mapping des Blobs bis zu einer bestimmten Größe
+// Leser halten es per shared_ptr fest, ein neueres Mapping (Blob ist gewachsen) ersetzt es
+// also ohne dass ein laufender read() ins Leere greift
+struct Mapping {
+    const char* base = nullptr;
+    size_t size = 0;
+
+    Mapping() = default;
+    Mapping(const Mapping&) = delete;
+    Mapping& operator=(const Mapping&) = delete;
+
+    ~Mapping() {
+        if (base) {
+#ifdef _WIN32
+            UnmapViewOfFile(base);
+#else
+            munmap(const_cast<char*>(base), size);
+#endif
+        }
+    }
+};
+
+size_t page_size() {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwPageSize;
+#else
+    long size = sysconf(_SC_PAGESIZE);
+    return size > 0 ? static_cast<size_t>(size) : 4096;
+#endif
+}
+
+std::filesystem::path temp_blob_path() {
+    static std::atomic<unsigned> counter{0};
+#ifdef _WIN32
+    unsigned long pid = GetCurrentProcessId();
+#else
+    long pid = static_cast<long>(getpid());
+#endif
+    std::error_code ec;
+    std::filesystem::path dir = std::filesystem::temp_directory_path(ec);
+    if (ec) {
+        dir = ".";
+    }
+    return dir / ("notesearch-" + std::to_string(pid) + "-" + std::to_string(counter++) + ".blob");
+}
+
+} // namespace
+
+struct ContentStore::Impl {
+    mutable std::mutex mutex;
+    bool opened = false;           // Blob Datei wird erst beim ersten append() angelegt
+    bool file_backed = false;
+    bool read_only = false;        // open_read_only(): die Datei wird nie geschrieben
+    uint64_t size = 0;             // geschriebene Bytes
+    mutable std::shared_ptr<const Mapping> mapping;
+    std::string memory;            // Fallback wenn keine Datei angelegt werden kann, read-only: was nach der Datei kommt
+    uint64_t memory_offset = 0;    // Offset des ersten Bytes von memory (read-only: Größe der Datei, sonst 0)
+
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+#else
+    int fd = -1;
+#endif
+
+    ~Impl() {
+        mapping.reset();
+#ifdef _WIN32
+        if (file != INVALID_HANDLE_VALUE) {
+            CloseHandle(file);  // FILE_FLAG_DELETE_ON_CLOSE löscht die Datei
+        }
+#else
+        if (fd >= 0) {
+            close(fd);
+        }
+#endif
+    }
+
+    // temporary: Datei verschwindet mit dem Store, keep_content: vorhandenen Inhalt weiter benutzen,
+    // only_read: nur lesen (keep_content), neuer Inhalt bleibt im Speicher
+    bool open_file(const std::filesystem::path& path, bool temporary, bool keep_content, bool only_read = false) {
+        opened = true;
+        read_only = only_read;
+#ifdef _WIN32
+        DWORD flags = temporary ? FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE : FILE_ATTRIBUTE_NORMAL;
+        file = CreateFileW(path.c_str(), only_read ? GENERIC_READ : GENERIC_READ | GENERIC_WRITE,
+                           FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+                           keep_content ? OPEN_EXISTING : CREATE_ALWAYS, flags, nullptr);
+        file_backed = file != INVALID_HANDLE_VALUE;
+        if (file_backed && keep_content) {
+            LARGE_INTEGER file_size;
+            GetFileSizeEx(file, &file_size);
+            size = static_cast<uint64_t>(file_size.QuadPart);
+            SetFilePointerEx(file, file_size, nullptr, FILE_BEGIN);  // WriteFile hängt am Dateizeiger an
+        }
+#else
+        int mode = only_read ? O_RDONLY | O_CLOEXEC
+                 : keep_content ? O_RDWR | O_CLOEXEC : O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC;
+        fd = ::open(path.c_str(), mode, 0600);
+        if (fd >= 0 && temporary) {
+            unlink(path.c_str());  // Datei verschwindet mit dem letzten Handle, auch bei Absturz
+        }
+        file_backed = fd >= 0;
+        if (file_backed && keep_content) {
+            off_t end = lseek(fd, 0, SEEK_END);
+            size = end > 0 ? static_cast<uint64_t>(end) : 0;
+        }
+#endif
+        memory_offset = read_only ? size : 0;
+        return file_backed;
+    }
+
+    // liegt [offset, ...) in memory statt in der Datei
+    bool in_memory(uint64_t offset) const noexcept { return !file_backed || (read_only && offset >= memory_offset); }
+
+    // so weit reicht die Datei (das Mapping)
+    uint64_t file_size() const noexcept { return read_only ? memory_offset : size; }
+
+    // hängt Bytes an den Blob an, false bei Schreibfehler
+    bool write(std::string_view bytes) {
+        if (in_memory(size)) {
+            memory += bytes;
+            return true;
+        }
+        size_t written = 0;
+        while (written < bytes.size()) {
+#ifdef _WIN32
+            DWORD chunk = 0;
+            DWORD want = static_cast<DWORD>(std::min<size_t>(bytes.size() - written, 1u << 30));
+            if (!WriteFile(file, bytes.data() + written, want, &chunk, nullptr) || chunk == 0) {
+                return false;
+            }
+#else
+            ssize_t chunk = pwrite(fd, bytes.data() + written, bytes.size() - written,
+                                   static_cast<off_t>(size + written));
+            if (chunk < 0 && errno == EINTR) {
+                continue;
+            }
+            if (chunk <= 0) {
+                return false;
+            }
+#endif
+            written += static_cast<size_t>(chunk);
+        }
+        return true;
+    }
+
+    // kürzt den Blob auf new_size Bytes, weitere write() hängen dort an
+    void truncate(uint64_t new_size) {
+        mapping.reset();  // laufende read() halten ihr Mapping selbst fest
+        if (read_only && new_size < memory_offset) {
+            memory_offset = new_size;  // die Datei selbst bleibt wie sie ist, gelesen wird nur bis hier
+        }
+        memory.resize(static_cast<size_t>(std::min<uint64_t>(memory.size(), new_size - memory_offset)));
+        size = new_size;
+        if (file_backed && !read_only) {
+#ifdef _WIN32
+            LARGE_INTEGER position;
+            position.QuadPart = static_cast<LONGLONG>(new_size);
+            SetFilePointerEx(file, position, nullptr, FILE_BEGIN);
+            SetEndOfFile(file);
+#else
+            if (ftruncate(fd, static_cast<off_t>(new_size)) != 0) {
+                // Truncate fehlgeschlagen: alte Bytes bleiben liegen, werden aber überschrieben
+            }
+#endif
+        }
+    }
+
+    // die gespeicherten Bytes [offset, offset + length), leer wenn der Blob kürzer ist (mutex muss gehalten werden)
+    std::string_view stored(uint64_t offset, size_t length) {
+        if (offset + length > size) {
+            return {};
+        }
+        if (in_memory(offset)) {
+            return std::string_view(memory).substr(static_cast<size_t>(offset - memory_offset), length);
+        }
+        if (offset + length > file_size()) {
+            return {};  // read-only: reicht über die Datei hinaus in memory
+        }
+        if (!mapping || mapping->size < offset + length) {
+            remap();
+        }
+        return mapping ? std::string_view(mapping->base + offset, length) : std::string_view();
+    }
+
+    // neues Mapping über den ganzen bisher geschriebenen Blob (mutex muss gehalten werden)
+    std::shared_ptr<const Mapping> remap() const {
+        auto fresh = std::make_shared<Mapping>();
+        uint64_t length = file_size();
+        if (length == 0) {
+            return fresh;
+        }
+#ifdef _WIN32
+        HANDLE handle = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!handle) {
+            return nullptr;
+        }
+        void* base = MapViewOfFile(handle, FILE_MAP_READ, 0, 0, static_cast<SIZE_T>(length));
+        CloseHandle(handle);  // die View hält das Mapping offen
+        if (!base) {
+            return nullptr;
+        }
+#else
+        void* base = mmap(nullptr, static_cast<size_t>(length), PROT_READ, MAP_SHARED, fd, 0);
+        if (base == MAP_FAILED) {
+            return nullptr;
+        }
+        madvise(base, static_cast<size_t>(length), MADV_RANDOM);  // gelesen werden nur einzelne Dokumente
+#endif
+        fresh->base = static_cast<const char*>(base);
+        fresh->size = static_cast<size_t>(length);
+        mapping = fresh;
+        return fresh;
+    }
+};
+
+ContentStore::ContentStore() : impl_(std::make_unique<Impl>()) {}
+
+ContentStore::~ContentStore() = default;
+
+ContentStore::ContentStore(ContentStore&&) noexcept = default;
+
+ContentStore& ContentStore::operator=(ContentStore&&) noexcept = default;
+
+bool ContentStore::create(const std::filesystem::path& blob_path, std::string* error) {
+    std::lock_guard<std::mutex> lock(impl_->mutex);
+    if (impl_->opened) {
+        if (error) *error = "content store is already in use";
+        return false;
+    }
+    if (!impl_->open_file(blob_path, false, false)) {
+        impl_->opened = false;
+        if (error) *error = "cannot create " + blob_path.string();
+        return false;
+    }
+    return true;
+}
+
+bool ContentStore::open(const std::filesystem::path& blob_path, std::string* error) {
+    std::lock_guard<std::mutex> lock(impl_->mutex);
+    if (impl_->opened) {
+        if (error) *error = "content store is already in use";
+        return false;
+    }
+    if (!impl_->open_file(blob_path, false, true)) {
+        impl_->opened = false;
+        if (error) *error = "cannot open " + blob_path.string();
+        return false;
+    }
+    return true;
+}
+
+bool ContentStore::open_read_only(const std::filesystem::path& blob_path, std::string* error) {
+    std::lock_guard<std::mutex> lock(impl_->mutex);
+    if (impl_->opened) {
+        if (error) *error = "content store is already in use";
+        return false;
+    }
+    if (!impl_->open_file(blob_path, false, true, true)) {
+        impl_->opened = false;
+        impl_->read_only = false;
+        if (error) *error = "cannot open " + blob_path.string();
+        return false;
+    }
+    return true;
+}
+
+ContentRef ContentStore::append(std::string_view content) {
+    // Kompression außerhalb des Locks, nur das Anhängen ist serialisiert
+    std::string compressed = compress_block(content);
+    bool store_raw = compressed.size() >= content.size();  // inkompressibel: roh speichern
+
+    std::lock_guard<std::mutex> lock(impl_->mutex);
+    if (!impl_->opened) {
+        impl_->open_file(temp_blob_path(), true, false);
+    }
+
+    ContentRef ref;
+    ref.offset = impl_->size;
+    ref.raw_size = static_cast<uint32_t>(content.size());
+    ref.stored_size = static_cast<uint32_t>(store_raw ? content.size() : compressed.size());
+
+    std::string_view bytes = store_raw ? content : std::string_view(compressed);
+    if (!impl_->write(bytes)) {
+        // Schreibfehler (Platte voll): Inhalt geht verloren, das Dokument bleibt aber durchsuchbar
+        return ContentRef{};
+    }
+    impl_->size += ref.stored_size;
+    return ref;
+}
+
+ContentRef ContentStore::append_at(uint64_t offset, std::string_view content) {
+    std::string compressed = compress_block(content);
+    bool store_raw = compressed.size() >= content.size();
+    std::string_view bytes = store_raw ? content : std::string_view(compressed);
+
+    std::lock_guard<std::mutex> lock(impl_->mutex);
+    if (!impl_->opened) {
+        impl_->open_file(temp_blob_path(), true, false);
+    }
+
+    ContentRef ref;
+    ref.offset = std::min(offset, impl_->size);
+    ref.raw_size = static_cast<uint32_t>(content.size());
+    ref.stored_size = static_cast<uint32_t>(bytes.size());
+    if (bytes.empty() || (ref.offset == offset && impl_->stored(offset, bytes.size()) == bytes)) {
+        return ref;  // schon vor dem Absturz geschrieben (Kompression ist deterministisch)
+    }
+
+    // read-only: die Datei bleibt wie sie ist, der Inhalt kommt in den Speicher dahinter
+    if (impl_->read_only) {
+        ref.offset = impl_->size;
+    }
+    // dahinter liegt nur ein abgebrochener Schreibvorgang
+    if (ref.offset < impl_->size) {
+        impl_->truncate(ref.offset);
+    }
+    if (!impl_->write(bytes)) {
+        return ContentRef{};
+    }
+    impl_->size += ref.stored_size;
+    return ref;
+}
+
+std::string ContentStore::read(const ContentRef& ref, size_t max_bytes) const {
+    if (ref.raw_size == 0) {
+        return "";
+    }
+
+    std::string stored;
+    std::string_view bytes;
+    std::shared_ptr<const Mapping> mapping;
+    {
+        std::lock_guard<std::mutex> lock(impl_->mutex);
+        if (ref.offset + ref.stored_size > impl_->size) {
+            return "";
+        }
+        if (impl_->in_memory(ref.offset)) {
+            size_t length = (ref.stored_size == ref.raw_size) ? std::min<size_t>(ref.stored_size, max_bytes)
+                                                              : ref.stored_size;
+            stored = impl_->memory.substr(static_cast<size_t>(ref.offset - impl_->memory_offset), length);
+            bytes = stored;
+        } else if (ref.offset + ref.stored_size > impl_->file_size()) {
+            return "";
+        } else {
+            mapping = impl_->mapping;
+            if (!mapping || mapping->size < ref.offset + ref.stored_size) {
+                mapping = impl_->remap();  // Blob ist seit dem letzten Mapping gewachsen
+            }
+            if (!mapping) {
+                return "";
+            }
+            bytes = std::string_view(mapping->base + ref.offset, ref.stored_size);
+        }
+    }
+
+    // Dekompression ohne Lock, das Mapping bleibt über den shared_ptr gültig
+    if (ref.stored_size == ref.raw_size) {
+        return std::string(bytes.substr(0, max_bytes));
+    }
+    std::string content;
+    if (!decompress_block(bytes, ref.raw_size, content, max_bytes)) {
+        return "";
+    }
+    return content;
+}
+
+// Nur ein Hinweis ans Betriebssystem: MADV_RANDOM schaltet das Vorauslesen beim Seitenfehler ab,
+// MADV_WILLNEED / PrefetchVirtualMemory holen die Seiten trotzdem asynchron in den Page Cache
+uint64_t ContentStore::prefetch(const std::vector<ContentRef>& refs) const {
+    std::shared_ptr<const Mapping> mapping;
+    {
+        std::lock_guard<std::mutex> lock(impl_->mutex);
+        if (!impl_->file_backed || impl_->file_size() == 0) {
+            return 0;
+        }
+        mapping = impl_->mapping;
+        if (!mapping || mapping->size < impl_->file_size()) {
+            mapping = impl_->remap();
+        }
+        if (!mapping) {
+            return 0;
+        }
+    }
+
+    // auf Seitengrenzen erweitert und sortiert, benachbarte Bereiche werden zu einem
+    const size_t page = page_size();
+    std::vector<std::pair<size_t, size_t>> ranges;  // [begin, end) im Mapping
+    ranges.reserve(refs.size());
+    for (const auto& ref : refs) {
+        if (ref.stored_size == 0 || ref.offset + ref.stored_size > mapping->size) {
+            continue;
+        }
+        size_t begin = static_cast<size_t>(ref.offset) / page * page;
+        size_t end = (static_cast<size_t>(ref.offset) + ref.stored_size + page - 1) / page * page;
+        ranges.emplace_back(begin, std::min(end, mapping->size));
+    }
+    std::sort(ranges.begin(), ranges.end());
+    size_t merged = 0;
+    for (size_t i = 0; i < ranges.size(); ++i) {
+        if (merged > 0 && ranges[i].first <= ranges[merged - 1].second) {
+            ranges[merged - 1].second = std::max(ranges[merged - 1].second, ranges[i].second);
+        } else {
+            ranges[merged++] = ranges[i];
+        }
+    }
+    ranges.resize(merged);
+
+    uint64_t requested = 0;
+#ifdef _WIN32
+    std::vector<WIN32_MEMORY_RANGE_ENTRY> entries;
+    entries.reserve(ranges.size());
+    for (const auto& [begin, end] : ranges) {
+        entries.push_back({const_cast<char*>(mapping->base) + begin, end - begin});
+        requested += end - begin;
+    }
+    if (!entries.empty()) {
+        PrefetchVirtualMemory(GetCurrentProcess(), entries.size(), entries.data(), 0);
+    }
+#else
+    for (const auto& [begin, end] : ranges) {
+        if (madvise(const_cast<char*>(mapping->base) + begin, end - begin, MADV_WILLNEED) == 0) {
+            requested += end - begin;
+        }
+    }
+#endif
+    return requested;
+}
+
+void ContentStore::clear() {
+    std::lock_guard<std::mutex> lock(impl_->mutex);
+    impl_->truncate(0);
+}
+
+uint64_t ContentStore::stored_bytes() const noexcept {
+    std::lock_guard<std::mutex> lock(impl_->mutex);
+    return impl_->size;
+}
+
+bool ContentStore::is_file_backed() const noexcept {
+    std::lock_guard<std::mutex> lock(impl_->mutex);
+    return impl_->file_backed;
+}
+
+} // namespace notesearch
@@ -0,0 +1,180 @@
+#include "dedup.hpp"
+
+namespace notesearch {
+
+namespace {
+
+constexpr uint64_t fnv_offset = 14695981039346656037ull;
+constexpr uint64_t fnv_prime = 1099511628211ull;
+
+// FNV-1a streut kurze Tokens schlecht über die oberen Bits, deshalb noch ein Finalizer (aus splitmix64)
+uint64_t mix(uint64_t x) noexcept {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebull;
+    x ^= x >> 31;
+    return x;
+}
+
+// spread_bits[b]: Bit i von b landet als 1 in Byte i des Ergebnisses
+constexpr std::array<uint64_t, 256> make_spread_table() {
+    std::array<uint64_t, 256> table{};
+    for (size_t value = 0; value < 256; ++value) {
+        for (size_t bit = 0; bit < 8; ++bit) {
+            if (value & (size_t{1} << bit)) {
+                table[value] |= uint64_t{1} << (bit * 8);
+            }
+        }
+    }
+    return table;
+}
+
+constexpr std::array<uint64_t, 256> spread_bits = make_spread_table();
+
+// Jedes Token stimmt für jedes Bit ab: dafür wenn sein Hash das Bit gesetzt hat, sonst dagegen
+//
+// Gezählt werden nur die Ja Stimmen, bit sliced: spread_bits verteilt ein Hash Byte auf die
+// 8 Bytes eines Worts, so zählt eine Addition 8 Bits gleichzeitig (8 statt 64 Additionen pro Token)
+// Die Byte Zähler laufen nach 255 Tokens über, deshalb werden sie vorher in ones_ geleert
+class BitVotes {
+public:
+    void add(uint64_t hash) noexcept {
+        for (size_t byte = 0; byte < 8; ++byte) {
+            lanes_[byte] += spread_bits[(hash >> (byte * 8)) & 0xff];
+        }
+        ++voters_;
+        if (++pending_ == 255) {
+            flush();
+        }
+    }
+
+    // Mehrheit: mehr Ja als Nein Stimmen
+    uint64_t majority() noexcept {
+        flush();
+        uint64_t fingerprint = 0;
+        for (size_t bit = 0; bit < 64; ++bit) {
+            if (uint64_t{ones_[bit]} * 2 > voters_) {
+                fingerprint |= uint64_t{1} << bit;
+            }
+        }
+        return fingerprint;
+    }
+
+private:
+    std::array<uint32_t, 64> ones_{};
+    std::array<uint64_t, 8> lanes_{};
+    size_t pending_ = 0;
+    size_t voters_ = 0;
+
+    void flush() noexcept {
+        for (size_t byte = 0; byte < 8; ++byte) {
+            for (size_t bit = 0; bit < 8; ++bit) {
+                ones_[byte * 8 + bit] += static_cast<uint32_t>((lanes_[byte] >> (bit * 8)) & 0xff);
+            }
+            lanes_[byte] = 0;
+        }
+        pending_ = 0;
+    }
+};
+
+} // namespace
+
+uint64_t hash_bytes(std::string_view bytes) noexcept {
+    uint64_t hash = fnv_offset;
+    for (char c : bytes) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= fnv_prime;
+    }
+    return hash;
+}
+
+uint64_t simhash(const std::vector<std::string>& tokens) {
+    // jedes verschiedene Token zählt einmal, sonst überstimmen die häufigsten Wörter (in jedem
+    // Dokument gleich) den Rest und verschiedene Dokumente bekommen ähnliche Fingerprints
+    // Schon gesehene Hashes merkt sich eine offene Hash Tabelle (0 = leer, linear probing)
+    size_t capacity = 16;
+    while (capacity < tokens.size() * 2) {
+        capacity *= 2;
+    }
+    std::vector<uint64_t> seen(capacity, 0);
+    BitVotes votes;
+
+    for (const auto& token : tokens) {
+        uint64_t hash = mix(hash_bytes(token));
+        uint64_t key = hash | 1;  // nie 0 (leer)
+        size_t slot = static_cast<size_t>(hash >> 32) & (capacity - 1);
+        while (seen[slot] != 0 && seen[slot] != key) {
+            slot = (slot + 1) & (capacity - 1);
+        }
+        if (seen[slot] == key) {
+            continue;
+        }
+        seen[slot] = key;
+        votes.add(hash);
+    }
+    return votes.majority();
+}
+
+uint64_t simhash(const TermCounter& terms) {
+    // die Wörter sind schon verschieden und gehasht
+    BitVotes votes;
+    for (uint32_t id = 0; id < terms.size(); ++id) {
+        votes.add(mix(terms.term(id).hash));
+    }
+    return votes.majority();
+}
+
+uint32_t NearDuplicateIndex::find(uint64_t fingerprint) const {
+    uint32_t best = no_match;
+    unsigned best_distance = max_distance + 1;
+
+    for (size_t i = 0; i < band_count; ++i) {
+        auto it = bands_[i].find(band(fingerprint, i));
+        if (it == bands_[i].end()) {
+            continue;
+        }
+        for (uint32_t entry : it->second) {
+            unsigned distance = hamming_distance(fingerprint, entries_[entry].fingerprint);
+            // bei gleichem Abstand gewinnt das ältere Dokument (kleinere ID), egal in welchem Band gefunden
+            if (distance < best_distance || (distance == best_distance && entries_[entry].doc_id < best)) {
+                best = entries_[entry].doc_id;
+                best_distance = distance;
+            }
+        }
+        if (best_distance == 0) {
+            break;
+        }
+    }
+    return best;
+}
+
+void NearDuplicateIndex::add(uint32_t doc_id, uint64_t fingerprint) {
+    uint32_t entry = static_cast<uint32_t>(entries_.size());
+    entries_.push_back({doc_id, fingerprint});
+    for (size_t i = 0; i < band_count; ++i) {
+        bands_[i][band(fingerprint, i)].push_back(entry);
+    }
+}
+
+size_t NearDuplicateIndex::memory_bytes() const noexcept {
+    size_t bytes = entries_.capacity() * sizeof(Entry);
+    for (const auto& table : bands_) {
+        bytes += table.bucket_count() * sizeof(void*);
+        // Knoten: Key + vector + next Pointer + gecachter Hash
+        bytes += table.size() * (sizeof(uint16_t) + sizeof(std::vector<uint32_t>) + 2 * sizeof(void*));
+        for (const auto& pair : table) {
+            bytes += pair.second.capacity() * sizeof(uint32_t);
+        }
+    }
+    return bytes;
+}
+
+void NearDuplicateIndex::clear() noexcept {
+    entries_.clear();
+    for (auto& table : bands_) {
+        table.clear();
+    }
+}
+
+} // namespace notesearch
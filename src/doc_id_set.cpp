@@ -0,0 +1,462 @@
+#include "doc_id_set.hpp"
+#include <algorithm>
+#include <iterator>
+
+namespace notesearch {
+
+// ---------------------------------------------------------------------------
+// Container: ein Block von 65536 IDs, als sortiertes Array oder als Bitmap
+// Bitmap Wörter sind 16 Bit breit, damit beide Formen in denselben Vektor passen
+// Hilfsvektoren nehmen die Ressource von data, sonst kopiert das move am Ende statt zu tauschen
+// ---------------------------------------------------------------------------
+
+namespace {
+
+inline uint16_t bit_mask(uint16_t low) noexcept {
+    return static_cast<uint16_t>(1u << (low % 16));
+}
+
+} // namespace
+
+bool DocIdSet::Container::contains(uint16_t low) const noexcept {
+    if (bitmap) {
+        return (data[low / 16] & bit_mask(low)) != 0;
+    }
+    return std::binary_search(data.begin(), data.end(), low);
+}
+
+bool DocIdSet::Container::add(uint16_t low) {
+    if (bitmap) {
+        if (data[low / 16] & bit_mask(low)) {
+            return false;
+        }
+        data[low / 16] |= bit_mask(low);
+        ++cardinality;
+        return true;
+    }
+
+    // häufigster Fall beim Indexieren: aufsteigende IDs, also anhängen
+    if (data.empty() || data.back() < low) {
+        data.push_back(low);
+    } else {
+        auto it = std::lower_bound(data.begin(), data.end(), low);
+        if (*it == low) {
+            return false;
+        }
+        data.insert(it, low);
+    }
+    ++cardinality;
+    if (cardinality > array_limit) {
+        to_bitmap();
+    }
+    return true;
+}
+
+bool DocIdSet::Container::remove(uint16_t low) {
+    if (bitmap) {
+        if (!(data[low / 16] & bit_mask(low))) {
+            return false;
+        }
+        data[low / 16] &= static_cast<uint16_t>(~bit_mask(low));
+        --cardinality;
+        if (cardinality <= array_limit) {
+            to_array();
+        }
+        return true;
+    }
+
+    auto it = std::lower_bound(data.begin(), data.end(), low);
+    if (it == data.end() || *it != low) {
+        return false;
+    }
+    data.erase(it);
+    --cardinality;
+    return true;
+}
+
+void DocIdSet::Container::to_bitmap() {
+    std::pmr::vector<uint16_t> words(bitmap_words, 0, data.get_allocator());
+    for (uint16_t low : data) {
+        words[low / 16] |= bit_mask(low);
+    }
+    data = std::move(words);
+    bitmap = true;
+}
+
+void DocIdSet::Container::to_array() {
+    std::pmr::vector<uint16_t> values(data.get_allocator());
+    values.reserve(cardinality);
+    for (size_t word = 0; word < data.size(); ++word) {
+        uint64_t bits = data[word];
+        while (bits) {
+            values.push_back(static_cast<uint16_t>(word * 16 + lowest_set_bit(bits)));
+            bits &= bits - 1;
+        }
+    }
+    data = std::move(values);
+    bitmap = false;
+}
+
+void DocIdSet::Container::normalize() {
+    if (bitmap) {
+        cardinality = 0;
+        for (uint16_t bits : data) {
+            cardinality += popcount64(bits);
+        }
+        if (cardinality <= array_limit) {
+            to_array();
+        }
+    } else {
+        cardinality = static_cast<uint32_t>(data.size());
+        if (cardinality > array_limit) {
+            to_bitmap();
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Operationen zwischen zwei Containern mit gleichem Key
+// Ergebnis steht immer in a, danach wird der günstigere Container gewählt
+// ---------------------------------------------------------------------------
+
+void DocIdSet::and_containers(Container& a, const Container& b) {
+    if (a.bitmap && b.bitmap) {
+        for (size_t i = 0; i < bitmap_words; ++i) {
+            a.data[i] &= b.data[i];
+        }
+    } else if (a.bitmap) {
+        // Ergebnis hat höchstens so viele Elemente wie das Array
+        std::pmr::vector<uint16_t> values(a.data.get_allocator());
+        values.reserve(b.data.size());
+        for (uint16_t low : b.data) {
+            if (a.contains(low)) {
+                values.push_back(low);
+            }
+        }
+        a.data = std::move(values);
+        a.bitmap = false;
+    } else if (b.bitmap) {
+        a.data.erase(std::remove_if(a.data.begin(), a.data.end(),
+                                    [&b](uint16_t low) { return !b.contains(low); }),
+                     a.data.end());
+    } else {
+        std::pmr::vector<uint16_t> values(a.data.get_allocator());
+        values.reserve(std::min(a.data.size(), b.data.size()));
+        std::set_intersection(a.data.begin(), a.data.end(), b.data.begin(), b.data.end(),
+                              std::back_inserter(values));
+        a.data = std::move(values);
+    }
+    a.normalize();
+}
+
+void DocIdSet::or_containers(Container& a, const Container& b) {
+    if (!a.bitmap && !b.bitmap && a.data.size() + b.data.size() <= array_limit) {
+        std::pmr::vector<uint16_t> values(a.data.get_allocator());
+        values.reserve(a.data.size() + b.data.size());
+        std::set_union(a.data.begin(), a.data.end(), b.data.begin(), b.data.end(),
+                       std::back_inserter(values));
+        a.data = std::move(values);
+        a.normalize();
+        return;
+    }
+
+    if (!a.bitmap) {
+        a.to_bitmap();
+    }
+    if (b.bitmap) {
+        for (size_t i = 0; i < bitmap_words; ++i) {
+            a.data[i] |= b.data[i];
+        }
+    } else {
+        for (uint16_t low : b.data) {
+            a.data[low / 16] |= bit_mask(low);
+        }
+    }
+    a.normalize();
+}
+
+void DocIdSet::and_not_containers(Container& a, const Container& b) {
+    if (a.bitmap && b.bitmap) {
+        for (size_t i = 0; i < bitmap_words; ++i) {
+            a.data[i] &= static_cast<uint16_t>(~b.data[i]);
+        }
+    } else if (a.bitmap) {
+        for (uint16_t low : b.data) {
+            a.data[low / 16] &= static_cast<uint16_t>(~bit_mask(low));
+        }
+    } else if (b.bitmap) {
+        a.data.erase(std::remove_if(a.data.begin(), a.data.end(),
+                                    [&b](uint16_t low) { return b.contains(low); }),
+                     a.data.end());
+    } else {
+        std::pmr::vector<uint16_t> values(a.data.get_allocator());
+        values.reserve(a.data.size());
+        std::set_difference(a.data.begin(), a.data.end(), b.data.begin(), b.data.end(),
+                            std::back_inserter(values));
+        a.data = std::move(values);
+    }
+    a.normalize();
+}
+
+// ---------------------------------------------------------------------------
+// DocIdSet
+// ---------------------------------------------------------------------------
+
+DocIdSet::Container* DocIdSet::find_container(uint16_t key) noexcept {
+    auto it = std::lower_bound(containers_.begin(), containers_.end(), key,
+                               [](const Container& c, uint16_t k) { return c.key < k; });
+    return (it != containers_.end() && it->key == key) ? &*it : nullptr;
+}
+
+const DocIdSet::Container* DocIdSet::find_container(uint16_t key) const noexcept {
+    auto it = std::lower_bound(containers_.begin(), containers_.end(), key,
+                               [](const Container& c, uint16_t k) { return c.key < k; });
+    return (it != containers_.end() && it->key == key) ? &*it : nullptr;
+}
+
+DocIdSet::Container& DocIdSet::get_or_create(uint16_t key) {
+    // aufsteigende IDs: der passende Container ist fast immer der letzte
+    if (!containers_.empty() && containers_.back().key == key) {
+        return containers_.back();
+    }
+    if (containers_.empty() || containers_.back().key < key) {
+        containers_.emplace_back();
+        containers_.back().key = key;
+        return containers_.back();
+    }
+    auto it = std::lower_bound(containers_.begin(), containers_.end(), key,
+                               [](const Container& c, uint16_t k) { return c.key < k; });
+    if (it == containers_.end() || it->key != key) {
+        it = containers_.emplace(it);
+        it->key = key;
+    }
+    return *it;
+}
+
+void DocIdSet::add(uint32_t doc_id) {
+    get_or_create(static_cast<uint16_t>(doc_id >> 16)).add(static_cast<uint16_t>(doc_id & 0xFFFF));
+}
+
+void DocIdSet::remove(uint32_t doc_id) {
+    Container* container = find_container(static_cast<uint16_t>(doc_id >> 16));
+    if (container && container->remove(static_cast<uint16_t>(doc_id & 0xFFFF)) && container->cardinality == 0) {
+        containers_.erase(containers_.begin() + (container - containers_.data()));
+    }
+}
+
+bool DocIdSet::contains(uint32_t doc_id) const noexcept {
+    const Container* container = find_container(static_cast<uint16_t>(doc_id >> 16));
+    return container && container->contains(static_cast<uint16_t>(doc_id & 0xFFFF));
+}
+
+size_t DocIdSet::size() const noexcept {
+    size_t total = 0;
+    for (const auto& container : containers_) {
+        total += container.cardinality;
+    }
+    return total;
+}
+
+uint32_t DocIdSet::max() const noexcept {
+    const Container& last = containers_.back();
+    uint32_t high = static_cast<uint32_t>(last.key) << 16;
+    if (!last.bitmap) {
+        return high | last.data.back();
+    }
+    for (size_t word = bitmap_words; word-- > 0;) {
+        uint16_t bits = last.data[word];
+        if (bits) {
+            unsigned bit = 15;
+            while (!((bits >> bit) & 1u)) {
+                --bit;
+            }
+            return high | static_cast<uint32_t>(word * 16 + bit);
+        }
+    }
+    return high;
+}
+
+size_t DocIdSet::rank(uint32_t doc_id) const noexcept {
+    uint16_t key = static_cast<uint16_t>(doc_id >> 16);
+    uint16_t low = static_cast<uint16_t>(doc_id & 0xFFFF);
+
+    size_t result = 0;
+    for (const auto& container : containers_) {
+        if (container.key < key) {
+            result += container.cardinality;
+            continue;
+        }
+        if (container.key == key) {
+            if (container.bitmap) {
+                for (size_t word = 0; word < low / 16u; ++word) {
+                    result += popcount64(container.data[word]);
+                }
+                result += popcount64(container.data[low / 16] & (bit_mask(low) - 1u));
+            } else {
+                result += static_cast<size_t>(
+                    std::lower_bound(container.data.begin(), container.data.end(), low) - container.data.begin());
+            }
+        }
+        break;
+    }
+    return result;
+}
+
+DocIdSet& DocIdSet::and_with(const DocIdSet& other) {
+    // Merge über die sortierten Keys, Container ohne Partner fallen weg
+    size_t out = 0;
+    size_t j = 0;
+    for (size_t i = 0; i < containers_.size(); ++i) {
+        Container& a = containers_[i];
+        while (j < other.containers_.size() && other.containers_[j].key < a.key) {
+            ++j;
+        }
+        if (j == other.containers_.size()) {
+            break;
+        }
+        if (other.containers_[j].key != a.key) {
+            continue;
+        }
+        and_containers(a, other.containers_[j]);
+        if (a.cardinality > 0) {
+            if (out != i) {
+                containers_[out] = std::move(a);
+            }
+            ++out;
+        }
+    }
+    containers_.resize(out);
+    return *this;
+}
+
+DocIdSet& DocIdSet::or_with(const DocIdSet& other) {
+    if (containers_.empty()) {
+        containers_ = other.containers_;
+        return *this;
+    }
+
+    std::pmr::vector<Container> merged(containers_.get_allocator());
+    merged.reserve(containers_.size() + other.containers_.size());
+
+    size_t i = 0;
+    size_t j = 0;
+    while (i < containers_.size() || j < other.containers_.size()) {
+        if (j == other.containers_.size() ||
+            (i < containers_.size() && containers_[i].key < other.containers_[j].key)) {
+            merged.push_back(std::move(containers_[i++]));
+        } else if (i == containers_.size() || other.containers_[j].key < containers_[i].key) {
+            merged.push_back(other.containers_[j++]);
+        } else {
+            or_containers(containers_[i], other.containers_[j]);
+            merged.push_back(std::move(containers_[i]));
+            ++i;
+            ++j;
+        }
+    }
+
+    containers_ = std::move(merged);
+    return *this;
+}
+
+DocIdSet& DocIdSet::and_not(const DocIdSet& other) {
+    size_t out = 0;
+    size_t j = 0;
+    for (size_t i = 0; i < containers_.size(); ++i) {
+        Container& a = containers_[i];
+        while (j < other.containers_.size() && other.containers_[j].key < a.key) {
+            ++j;
+        }
+        if (j < other.containers_.size() && other.containers_[j].key == a.key) {
+            and_not_containers(a, other.containers_[j]);
+        }
+        if (a.cardinality > 0) {
+            if (out != i) {
+                containers_[out] = std::move(a);
+            }
+            ++out;
+        }
+    }
+    containers_.resize(out);
+    return *this;
+}
+
+size_t DocIdSet::memory_bytes() const noexcept {
+    size_t bytes = containers_.capacity() * sizeof(Container);
+    for (const auto& container : containers_) {
+        bytes += container.data.capacity() * sizeof(uint16_t);
+    }
+    return bytes;
+}
+
+size_t DocIdSet::slack_bytes() const noexcept {
+    size_t bytes = (containers_.capacity() - containers_.size()) * sizeof(Container);
+    for (const auto& container : containers_) {
+        bytes += (container.data.capacity() - container.data.size()) * sizeof(uint16_t);
+    }
+    return bytes;
+}
+
+void DocIdSet::shrink_to_fit() {
+    containers_.shrink_to_fit();
+    for (auto& container : containers_) {
+        container.data.shrink_to_fit();
+    }
+}
+
+// Pro Chunk 1024 Wörter à 64 Bit: dichte werden als Bitmap übernommen, dünne als Array aufgezählt
+void DocIdSet::assign_bits(const uint64_t* words, size_t word_count) {
+    constexpr size_t chunk_words = 65536 / 64;
+    containers_.clear();
+    for (size_t first = 0; first < word_count; first += chunk_words) {
+        size_t count = std::min(chunk_words, word_count - first);
+        uint32_t cardinality = 0;
+        for (size_t i = 0; i < count; ++i) {
+            cardinality += popcount64(words[first + i]);
+        }
+        if (cardinality == 0) {
+            continue;
+        }
+        Container& container = containers_.emplace_back();
+        container.key = static_cast<uint16_t>(first / chunk_words);
+        container.cardinality = cardinality;
+        if (cardinality > array_limit) {
+            container.bitmap = true;
+            container.data.assign(bitmap_words, 0);
+            for (size_t i = 0; i < count; ++i) {
+                for (size_t part = 0; part < 4; ++part) {
+                    container.data[i * 4 + part] = static_cast<uint16_t>(words[first + i] >> (16 * part));
+                }
+            }
+        } else {
+            container.data.reserve(cardinality);
+            for (size_t i = 0; i < count; ++i) {
+                uint64_t bits = words[first + i];
+                while (bits) {
+                    container.data.push_back(static_cast<uint16_t>(i * 64 + lowest_set_bit(bits)));
+                    bits &= bits - 1;
+                }
+            }
+        }
+    }
+}
+
+void DocIdSet::clear() noexcept {
+    containers_.clear();
+}
+
+bool DocIdSet::operator==(const DocIdSet& other) const noexcept {
+    if (containers_.size() != other.containers_.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < containers_.size(); ++i) {
+        const Container& a = containers_[i];
+        const Container& b = other.containers_[i];
+        // normalize() sorgt dafür, dass gleiche Inhalte immer dieselbe Container Form haben
+        if (a.key != b.key || a.bitmap != b.bitmap || a.data != b.data) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace notesearch
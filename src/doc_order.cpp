@@ -0,0 +1,241 @@
+#include "doc_order.hpp"
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <numeric>
+#include <utility>
+
+namespace notesearch {
+
+namespace {
+
+constexpr size_t leaf_size = 16;          // kleinere Teile bleiben in Pfad Reihenfolge
+constexpr int max_iterations = 20;        // Tausch Runden pro Teilung
+constexpr unsigned max_depth = 24;
+
+// Dokumente nach Pfad (komponentenweise, ein Verzeichnis bleibt zusammen), gelöschte ans Ende
+std::vector<uint32_t> documents_by_path(const DocumentStore& doc_store) {
+    const auto& documents = doc_store.get_all_documents();
+    std::vector<std::filesystem::path> paths;
+    paths.reserve(documents.size());
+    for (const auto& doc : documents) {
+        paths.emplace_back(doc.path);
+    }
+    std::vector<uint32_t> order(documents.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        bool deleted_a = doc_store.is_deleted(a);
+        bool deleted_b = doc_store.is_deleted(b);
+        if (deleted_a != deleted_b) return deleted_b;
+        return paths[a] < paths[b];
+    });
+    return order;
+}
+
+// Recursive Graph Bisection: Dokumente und ihre Wörter als bipartiter Graph
+// Kosten eines Worts in einer Hälfte mit n Dokumenten, d davon mit dem Wort: d * log2(n / (d + 1)),
+// die geschätzten Bits seiner Lücken. Getauscht wird, wo die Summe sinkt.
+class Bisection {
+public:
+    Bisection(const InvertedIndex& index, size_t doc_count) : offsets_(doc_count + 1, 0) {
+        // Vorwärts Index (Dokument -> Wörter) als CSR, nur Wörter die Dokumente verbinden
+        // Sehr häufige Wörter tragen kaum etwas bei und kosten am meisten Zeit
+        std::vector<LexiconEntry> entries = index.terms_with_prefix("", Field::content);
+        size_t max_df = std::max<size_t>(2, doc_count / 2);
+        std::vector<const PostingList*> postings;
+        for (const auto& entry : entries) {
+            size_t df = entry.postings->size();
+            if (df >= 2 && df <= max_df) {
+                postings.push_back(entry.postings);
+                entry.postings->docs().for_each([this](uint32_t doc_id) { ++offsets_[doc_id + 1]; });
+            }
+        }
+        std::partial_sum(offsets_.begin(), offsets_.end(), offsets_.begin());
+        terms_.resize(offsets_.back());
+        std::vector<size_t> fill(offsets_.begin(), offsets_.end() - 1);
+        for (uint32_t term = 0; term < postings.size(); ++term) {
+            postings[term]->docs().for_each([&](uint32_t doc_id) { terms_[fill[doc_id]++] = term; });
+        }
+        left_degree_.assign(postings.size(), 0);
+        right_degree_.assign(postings.size(), 0);
+        left_gain_.assign(postings.size(), 0.0f);
+        right_gain_.assign(postings.size(), 0.0f);
+    }
+
+    bool has_terms(uint32_t doc_id) const noexcept { return offsets_[doc_id + 1] > offsets_[doc_id]; }
+
+    // ordnet [begin, end) um, die Ausgangs Reihenfolge bleibt innerhalb der Teile erhalten
+    void order(uint32_t* begin, uint32_t* end) {
+        rank_.assign(offsets_.size() - 1, 0);
+        for (uint32_t* doc = begin; doc != end; ++doc) {
+            rank_[*doc] = static_cast<uint32_t>(doc - begin);
+        }
+        run(begin, end, 0);
+    }
+
+private:
+    std::vector<size_t> offsets_;
+    std::vector<uint32_t> terms_;
+    std::vector<uint32_t> rank_;      // Position in der Ausgangs Reihenfolge
+    std::vector<uint32_t> left_degree_;
+    std::vector<uint32_t> right_degree_;
+    std::vector<float> left_gain_;    // Gewinn wenn ein Dokument mit dem Wort von links nach rechts geht
+    std::vector<float> right_gain_;
+
+    void run(uint32_t* begin, uint32_t* end, unsigned depth) {
+        size_t size = static_cast<size_t>(end - begin);
+        if (size <= leaf_size || depth >= max_depth) {
+            return;
+        }
+        uint32_t* middle = begin + size / 2;
+        partition(begin, middle, end);
+        run(begin, middle, depth + 1);
+        run(middle, end, depth + 1);
+    }
+
+    static float cost(uint32_t degree, float log_size) noexcept {
+        return degree == 0 ? 0.0f : static_cast<float>(degree) * (log_size - std::log2(static_cast<float>(degree) + 1));
+    }
+
+    template <typename F>
+    void for_each_term(uint32_t doc_id, F&& f) const {
+        for (size_t i = offsets_[doc_id]; i < offsets_[doc_id + 1]; ++i) {
+            f(terms_[i]);
+        }
+    }
+
+    void partition(uint32_t* begin, uint32_t* middle, uint32_t* end) {
+        std::vector<uint32_t> touched;
+        for (uint32_t* doc = begin; doc != end; ++doc) {
+            bool left = doc < middle;
+            for_each_term(*doc, [&](uint32_t term) {
+                if (left_degree_[term] == 0 && right_degree_[term] == 0) {
+                    touched.push_back(term);
+                }
+                ++(left ? left_degree_ : right_degree_)[term];
+            });
+        }
+        float log_left = std::log2(static_cast<float>(middle - begin));
+        float log_right = std::log2(static_cast<float>(end - middle));
+
+        std::vector<std::pair<float, uint32_t>> left_moves(static_cast<size_t>(middle - begin));
+        std::vector<std::pair<float, uint32_t>> right_moves(static_cast<size_t>(end - middle));
+        for (int iteration = 0; iteration < max_iterations; ++iteration) {
+            for (uint32_t term : touched) {
+                uint32_t l = left_degree_[term];
+                uint32_t r = right_degree_[term];
+                float current = cost(l, log_left) + cost(r, log_right);
+                left_gain_[term] = l ? current - cost(l - 1, log_left) - cost(r + 1, log_right) : 0.0f;
+                right_gain_[term] = r ? current - cost(l + 1, log_left) - cost(r - 1, log_right) : 0.0f;
+            }
+            for (size_t i = 0; i < left_moves.size(); ++i) {
+                float gain = 0.0f;
+                for_each_term(begin[i], [&](uint32_t term) { gain += left_gain_[term]; });
+                left_moves[i] = {gain, begin[i]};
+            }
+            for (size_t i = 0; i < right_moves.size(); ++i) {
+                float gain = 0.0f;
+                for_each_term(middle[i], [&](uint32_t term) { gain += right_gain_[term]; });
+                right_moves[i] = {gain, middle[i]};
+            }
+            std::sort(left_moves.begin(), left_moves.end(), std::greater<>());
+            std::sort(right_moves.begin(), right_moves.end(), std::greater<>());
+
+            // die besten Paare tauschen, solange der Tausch zusammen etwas bringt
+            size_t swaps = 0;
+            size_t pairs = std::min(left_moves.size(), right_moves.size());
+            while (swaps < pairs && left_moves[swaps].first + right_moves[swaps].first > 0.0f) {
+                for_each_term(left_moves[swaps].second, [this](uint32_t term) {
+                    --left_degree_[term];
+                    ++right_degree_[term];
+                });
+                for_each_term(right_moves[swaps].second, [this](uint32_t term) {
+                    --right_degree_[term];
+                    ++left_degree_[term];
+                });
+                std::swap(left_moves[swaps].second, right_moves[swaps].second);
+                ++swaps;
+            }
+            if (swaps == 0) {
+                break;
+            }
+            // Hälften übernehmen, innerhalb bleibt die Ausgangs Reihenfolge (Pfad) für die nächste Ebene
+            auto by_rank = [this](const auto& a, const auto& b) { return rank_[a.second] < rank_[b.second]; };
+            std::sort(left_moves.begin(), left_moves.end(), by_rank);
+            std::sort(right_moves.begin(), right_moves.end(), by_rank);
+            for (size_t i = 0; i < left_moves.size(); ++i) begin[i] = left_moves[i].second;
+            for (size_t i = 0; i < right_moves.size(); ++i) middle[i] = right_moves[i].second;
+        }
+
+        for (uint32_t term : touched) {
+            left_degree_[term] = 0;
+            right_degree_[term] = 0;
+        }
+    }
+};
+
+} // namespace
+
+bool parse_doc_order(std::string_view name, DocOrder& order) {
+    if (name == "scan") {
+        order = DocOrder::scan;
+    } else if (name == "path") {
+        order = DocOrder::path;
+    } else if (name == "bisect" || name == "bisection") {
+        order = DocOrder::bisection;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+std::vector<uint32_t> compute_doc_order(const InvertedIndex& index, const DocumentStore& doc_store, DocOrder order) {
+    size_t doc_count = doc_store.size();
+    std::vector<uint32_t> old_ids;
+    if (order == DocOrder::scan) {
+        old_ids.resize(doc_count);
+        std::iota(old_ids.begin(), old_ids.end(), 0);
+    } else {
+        old_ids = documents_by_path(doc_store);
+    }
+
+    if (order == DocOrder::bisection) {
+        // nur Dokumente mit Wörtern werden geteilt, Kopien, leere und gelöschte folgen in Pfad Reihenfolge
+        Bisection bisection(index, doc_count);
+        auto featureless = std::stable_partition(old_ids.begin(), old_ids.end(), [&](uint32_t doc_id) {
+            return !doc_store.is_deleted(doc_id) && bisection.has_terms(doc_id);
+        });
+        bisection.order(old_ids.data(), old_ids.data() + (featureless - old_ids.begin()));
+    }
+
+    std::vector<uint32_t> new_ids(doc_count);
+    for (uint32_t new_id = 0; new_id < doc_count; ++new_id) {
+        new_ids[old_ids[new_id]] = new_id;
+    }
+    return new_ids;
+}
+
+void reorder_documents(InvertedIndex& index, DocumentStore& doc_store, DocOrder order) {
+    if (order == DocOrder::scan || doc_store.empty()) {
+        return;
+    }
+    std::vector<uint32_t> new_ids = compute_doc_order(index, doc_store, order);
+    index.remap_documents(new_ids);
+    doc_store.remap_documents(new_ids);
+}
+
+double posting_gap_bits(const InvertedIndex& index) {
+    double bits = 0.0;
+    uint64_t postings = 0;
+    for (const auto& entry : index.terms_with_prefix("", Field::content)) {
+        int64_t previous = -1;
+        entry.postings->docs().for_each([&](uint32_t doc_id) {
+            bits += std::log2(static_cast<double>(doc_id - previous));
+            previous = doc_id;
+        });
+        postings += entry.postings->size();
+    }
+    return postings ? bits / static_cast<double>(postings) : 0.0;
+}
+
+} // namespace notesearch
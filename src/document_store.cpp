@@ -1,12 +1,30 @@
 #include "document_store.hpp"
+#include "binary_io.hpp"
+#include "util.hpp"
 #include <algorithm>
 
 namespace notesearch {
 
+namespace {
 
-uint32_t DocumentStore::add_document(const std::filesystem::path& file_path, std::string content) {
-    
-    
+constexpr uint32_t documents_file_magic = 0x5344534e;  // "NSDS"
+constexpr uint64_t documents_file_version = 2;  // 2: modified times
+
+} // namespace
+
+
+uint32_t DocumentStore::add_document(const std::filesystem::path& file_path, std::string_view content) {
+    return insert_document(file_path, content, std::nullopt);
+}
+
+uint32_t DocumentStore::add_document(const std::filesystem::path& file_path, std::string_view content,
+                                     uint64_t content_offset) {
+    return insert_document(file_path, content, content_offset);
+}
+
+// content_offset: Inhalt an diese Stelle des Blobs statt ans Ende (Replay des Update Logs)
+uint32_t DocumentStore::insert_document(const std::filesystem::path& file_path, std::string_view content,
+                                        std::optional<uint64_t> content_offset) {
     uint32_t doc_id = next_id_++;
     // next_id_++ ... post increment, gibt aktuellen Wert zurück, dann erhöht
     // doc_id bekommt zb 0, dann wird next_id_ zu 1
@@ -14,9 +32,38 @@ uint32_t DocumentStore::add_document(const std::filesystem::path& file_path, std
     //   doc_id = ++next_id_   --- > next_id_ wird zuerst erhöht, dann zugewiesen
     //   Beispiel: next_id_ = 0
     //   doc_id = ++next_id_  ---- > next_id_ = 1, doc_id = 1 (beide 1)
-    documents_.emplace_back(doc_id, file_path.string(), std::move(content));
+    // Exakte Kopie eines früheren Dokuments? Gleicher Hash reicht nicht (Kollision), der Inhalt wird verglichen
+    // Kopien teilen sich den Inhalt im Blob und werden nicht nochmal indexiert
+    uint64_t hash = 0;
+    if (content.size() >= min_duplicate_bytes) {
+        hash = hash_bytes(content);
+        auto it = content_hashes_.find(hash);
+        if (it != content_hashes_.end() && !deleted_.contains(it->second)) {
+            const Document& original = documents_[it->second];
+            if (original.content_ref.raw_size == content.size() && content_.read(original.content_ref) == content) {
+                uint32_t original_id = original.id;
+                uint32_t cluster = original.cluster;
+                ContentRef ref = original.content_ref;
+                documents_.emplace_back(doc_id, file_path.string(), ref, original_id);
+                documents_.back().cluster = cluster;
+                metadata_.append(0, static_cast<int64_t>(content.size()));
+                copies_[original_id].push_back(doc_id);
+                clustered_.add(original_id);
+                clustered_.add(doc_id);
+                return doc_id;
+            }
+        }
+    }
+
+    // Inhalt wird komprimiert in den Blob geschrieben, im Document bleibt nur die Position
+    ContentRef ref = content_offset ? content_.append_at(*content_offset, content) : content_.append(content);
+    documents_.emplace_back(doc_id, file_path.string(), ref, doc_id);
+    metadata_.append(0, static_cast<int64_t>(content.size()));  // Änderungszeit setzt der Aufrufer
+    if (content.size() >= min_duplicate_bytes) {
+        content_hashes_[hash] = doc_id;  // ersetzt ein gelöschtes Original
+    }
 
-    // konstruiert Document mit .. (doc_id, path_string, moved_content)
+    // konstruiert Document mit .. (doc_id, path_string, content_ref, original = sich selbst)
     
     return doc_id;
     // gibt die zugewiesene document id zurück
@@ -26,29 +73,112 @@ const Document* DocumentStore::get_document(uint32_t doc_id) const {
    
     // das return ist const Document* .. also Pointer auf konstantes Document (oder nullptr), wenn nicht gefunden
     
-    auto it = std::find_if(documents_.begin(), documents_.end(),
-        [doc_id](const Document& doc) { return doc.id == doc_id; });
-    // std::find_if() = sucht erstes Element das Bedingung erfüllt
-    // documents_.begin() = Start-Iterator (Anfang des Vektors)
-    // documents_.end() = End-Iterator (nach letztem Element)
-    // [doc_id] ... erfasst doc_id aus äußerem Scope .. ist eine lambda function 
-    // (const Document& doc) ist Lambda param --> jedes Document im Vektor
+    // IDs werden fortlaufend vergeben und Dokumente nie aus dem Vektor entfernt (nur Tombstones),
+    // also ist die ID direkt der Index.. O(1) statt find_if über alle Dokumente
+    if (doc_id >= documents_.size() || deleted_.contains(doc_id)) {
+        return nullptr;
+        // Dokument nicht gefunden oder gelöscht also nullptr zurückgeben
+    }
+    return &documents_[doc_id];
+}
+
+// Liest den Inhalt aus dem Blob und dekomprimiert ihn, nur für die Dokumente die wirklich gebraucht werden
+std::string DocumentStore::get_content(uint32_t doc_id, size_t max_bytes) const {
+    const Document* doc = get_document(doc_id);
+    if (!doc) {
+        return "";
+    }
+    return content_.read(doc->content_ref, max_bytes);
+}
+
+uint64_t DocumentStore::prefetch_content(const std::vector<uint32_t>& doc_ids) const {
+    std::vector<ContentRef> refs;
+    refs.reserve(doc_ids.size());
+    for (uint32_t doc_id : doc_ids) {
+        if (const Document* doc = get_document(doc_id)) {
+            refs.push_back(doc->content_ref);
+        }
+    }
+    return content_.prefetch(refs);
+}
+
+const std::vector<uint32_t>& DocumentStore::copies_of(uint32_t doc_id) const {
+    static const std::vector<uint32_t> none;
+    auto it = copies_.find(doc_id);
+    return it != copies_.end() ? it->second : none;
+}
+
+// SimHash über die Tokens, Dokumente mit fast gleichen Tokens landen im selben Cluster
+void DocumentStore::add_fingerprint(uint32_t doc_id, const std::vector<std::string>& tokens) {
+    if (wants_fingerprint(doc_id, tokens.size())) {
+        join_cluster(doc_id, simhash(tokens));
+    }
+}
+
+// Dasselbe aus den Hashes des TermCounter (Indexieren über den kombinierten Pfad)
+void DocumentStore::add_fingerprint(uint32_t doc_id, const TermCounter& terms) {
+    if (wants_fingerprint(doc_id, terms.token_count())) {
+        join_cluster(doc_id, simhash(terms));
+    }
+}
+
+bool DocumentStore::wants_fingerprint(uint32_t doc_id, size_t token_count) const noexcept {
+    return doc_id < documents_.size() && !is_duplicate(doc_id) && token_count >= min_fingerprint_tokens;
+}
 
+void DocumentStore::join_cluster(uint32_t doc_id, uint64_t fingerprint) {
+    uint32_t match = near_duplicates_.find(fingerprint);
+    if (match != NearDuplicateIndex::no_match && !deleted_.contains(match)) {
+        documents_[doc_id].cluster = documents_[match].cluster;
+        clustered_.add(match);
+        clustered_.add(doc_id);
+        // exakte Kopien (nur bei einem beförderten Original schon vorhanden) teilen den Cluster
+        for (uint32_t copy : copies_of(doc_id)) {
+            documents_[copy].cluster = documents_[doc_id].cluster;
+        }
+    }
+    near_duplicates_.add(doc_id, fingerprint);
+}
+
+// Markiert ein Dokument als gelöscht (Tombstone)
+// Der Index bleibt unverändert, die Suche zieht die Tombstones von den Kandidaten ab
+bool DocumentStore::remove_document(uint32_t doc_id, uint32_t* promoted) {
+    if (promoted) *promoted = doc_id;
+    if (doc_id >= documents_.size() || deleted_.contains(doc_id)) {
+        return false;
+    }
+    deleted_.add(doc_id);
+    // der Blob ist append only, der Inhalt bleibt dort liegen bis clear()
+    
+    // Kopien waren nur über ihren Pfad indexiert: die erste lebende wird das neue Original
+    auto copies_it = copies_.find(doc_id);
+    if (copies_it == copies_.end()) {
+        return true;
+    }
+    std::vector<uint32_t>& copies = copies_it->second;
+    auto heir = std::find_if(copies.begin(), copies.end(), [this](uint32_t copy) { return !deleted_.contains(copy); });
+    if (heir == copies.end()) {
+        return true;  // nur gelöschte Kopien, die bleiben beim alten Original
+    }
+    uint32_t original = *heir;
+    copies.erase(heir);
+    documents_[original].duplicate_of = original;
+    for (uint32_t copy : copies) {
+        documents_[copy].duplicate_of = original;
+    }
+    std::vector<uint32_t> moved = std::move(copies);
+    copies_.erase(copies_it);
+    if (!moved.empty()) {
+        copies_[original] = std::move(moved);
+    }
     
-    if (it != documents_.end()) {
-        // iterator vergleich 
-        // it != documents_.end() bedeutet.. Element wurde gefunden
-        // it == documents_.end() bedeutet.. Nicht gefunden
-        
-        // Warum nicht it == nullptr?
-        // weil iteratoren sind keine Pointer..
-        //  end() ist spezieller Iterator Wert für nicht gefunden
-        return &(*it); // dereferenziert iterator und gibt pointer auf document zurück
-        // Ein pointer speichert die Adresse eines Wertes im Speicher. 
-        // Wenn mann einen pointer dereferenzierst, erhält mann den Wert an dieser Adresse.
+    // neue Dateien mit demselben Inhalt werden Kopien des neuen Originals
+    auto hash_it = content_hashes_.find(hash_bytes(content_.read(documents_[original].content_ref)));
+    if (hash_it != content_hashes_.end() && hash_it->second == doc_id) {
+        hash_it->second = original;
     }
-    return nullptr;
-    // Dokument nicht gefunden also nullptr zurückgeben
+    if (promoted) *promoted = original;
+    return true;
 }
 
 void DocumentStore::clear() noexcept {
@@ -58,8 +188,269 @@ void DocumentStore::clear() noexcept {
     
     documents_.clear();
     // - clear() = entfernt alle Elemente aus dem Vektor    
+    deleted_.clear();
+    content_.clear();
+    content_hashes_.clear();
+    copies_.clear();
+    near_duplicates_.clear();
+    clustered_.clear();
+    metadata_.clear();
     next_id_ = 0;
 
 }
 
-} 
+bool DocumentStore::create_content(const std::filesystem::path& blob_path, std::string* error) {
+    if (!documents_.empty()) {
+        if (error) *error = "document store is not empty";
+        return false;
+    }
+    return content_.create(blob_path, error);
+}
+
+// documents.bin: Header, Dokumente, Änderungszeiten, Tombstones, Content Hashes, Fingerprints
+// Kopien Listen, Cluster Mitglieder und die Größen Spalte werden beim Laden aus den Dokumenten rekonstruiert
+bool DocumentStore::save(const std::filesystem::path& documents_file, std::string* error) const {
+    BinaryWriter out;
+    if (!out.open(documents_file)) {
+        if (error) *error = "cannot create " + documents_file.string();
+        return false;
+    }
+    out.put_varint(documents_file_magic);
+    out.put_varint(documents_file_version);
+    
+    out.put_varint(documents_.size());
+    for (const auto& doc : documents_) {
+        out.put_string(doc.path);
+        out.put_varint(doc.content_ref.offset);
+        out.put_varint(doc.content_ref.stored_size);
+        out.put_varint(doc.content_ref.raw_size);
+        out.put_varint(doc.duplicate_of);
+        out.put_varint(doc.cluster);
+    }
+    for (const auto& doc : documents_) {
+        out.put_u64(static_cast<uint64_t>(metadata_.get(MetadataField::modified, doc.id)));
+    }
+    
+    out.put_varint(deleted_.size());
+    uint32_t previous = 0;
+    deleted_.for_each([&out, &previous](uint32_t doc_id) {
+        out.put_varint(doc_id - previous);
+        previous = doc_id;
+    });
+    
+    out.put_varint(content_hashes_.size());
+    for (const auto& [hash, doc_id] : content_hashes_) {
+        out.put_u64(hash);
+        out.put_varint(doc_id);
+    }
+    
+    std::vector<std::pair<uint32_t, uint64_t>> fingerprints;
+    near_duplicates_.for_each([&fingerprints](uint32_t doc_id, uint64_t fingerprint) {
+        fingerprints.emplace_back(doc_id, fingerprint);
+    });
+    out.put_varint(fingerprints.size());
+    for (const auto& [doc_id, fingerprint] : fingerprints) {
+        out.put_varint(doc_id);
+        out.put_u64(fingerprint);
+    }
+    
+    if (!out.close()) {
+        if (error) *error = "cannot write " + documents_file.string() + " (disk full?)";
+        return false;
+    }
+    return true;
+}
+
+bool DocumentStore::load(const std::filesystem::path& documents_file, const std::filesystem::path& blob_path,
+                         std::string* error, bool read_only) {
+    content_ = ContentStore();  // altes Blob nur loslassen, clear() würde eine benannte Datei leeren
+    clear();
+    auto fail = [this, error](const std::string& message) {
+        clear();
+        if (error) *error = message;
+        return false;
+    };
+    
+    BinaryReader in;
+    if (!in.open(documents_file)) {
+        return fail("cannot open " + documents_file.string());
+    }
+    uint64_t magic = 0;
+    uint64_t version = 0;
+    if (!in.get_varint(magic) || magic != documents_file_magic || !in.get_varint(version) ||
+        version != documents_file_version) {
+        return fail(documents_file.string() + " is not a document file of this version");
+    }
+    
+    uint64_t count = 0;
+    if (!in.get_varint(count) || count > UINT32_MAX) {
+        return fail(documents_file.string() + " is damaged");
+    }
+    documents_.reserve(static_cast<size_t>(count));
+    for (uint64_t id = 0; id < count; ++id) {
+        std::string path;
+        uint64_t offset = 0, stored_size = 0, raw_size = 0, original = 0, cluster = 0;
+        if (!in.get_string(path) || !in.get_varint(offset) || !in.get_varint(stored_size) ||
+            !in.get_varint(raw_size) || !in.get_varint(original) || !in.get_varint(cluster) ||
+            stored_size > UINT32_MAX || raw_size > UINT32_MAX || original >= count || cluster >= count) {
+            return fail(documents_file.string() + " is damaged");
+        }
+        ContentRef ref;
+        ref.offset = offset;
+        ref.stored_size = static_cast<uint32_t>(stored_size);
+        ref.raw_size = static_cast<uint32_t>(raw_size);
+        documents_.emplace_back(static_cast<uint32_t>(id), std::move(path), ref, static_cast<uint32_t>(original));
+        documents_.back().cluster = static_cast<uint32_t>(cluster);
+        if (original != id) {
+            copies_[static_cast<uint32_t>(original)].push_back(static_cast<uint32_t>(id));
+        }
+    }
+    next_id_ = static_cast<uint32_t>(count);
+    for (const auto& doc : documents_) {
+        uint64_t modified = 0;
+        in.get_u64(modified);
+        metadata_.append(static_cast<int64_t>(modified), doc.content_ref.raw_size);
+    }
+    // nach reorder_documents() kann das Original eine größere ID haben als seine Kopie
+    for (const auto& [original, copies] : copies_) {
+        if (documents_[original].duplicate_of != original) {
+            return fail(documents_file.string() + " is damaged");
+        }
+    }
+    
+    uint64_t deleted_count = 0;
+    uint64_t doc_id = 0;
+    in.get_varint(deleted_count);
+    for (uint64_t i = 0; i < deleted_count && in.ok(); ++i) {
+        uint64_t gap = 0;
+        in.get_varint(gap);
+        doc_id += gap;
+        if (doc_id >= count) {
+            return fail(documents_file.string() + " is damaged");
+        }
+        deleted_.add(static_cast<uint32_t>(doc_id));
+    }
+    
+    uint64_t hash_count = 0;
+    in.get_varint(hash_count);
+    for (uint64_t i = 0; i < hash_count && in.ok(); ++i) {
+        uint64_t hash = 0;
+        uint64_t original = 0;
+        if (in.get_u64(hash) && in.get_varint(original) && original < count) {
+            content_hashes_[hash] = static_cast<uint32_t>(original);
+        }
+    }
+    
+    uint64_t fingerprint_count = 0;
+    in.get_varint(fingerprint_count);
+    for (uint64_t i = 0; i < fingerprint_count && in.ok(); ++i) {
+        uint64_t fingerprint_doc = 0;
+        uint64_t fingerprint = 0;
+        if (in.get_varint(fingerprint_doc) && in.get_u64(fingerprint) && fingerprint_doc < count) {
+            near_duplicates_.add(static_cast<uint32_t>(fingerprint_doc), fingerprint);
+        }
+    }
+    if (!in.ok()) {
+        return fail(documents_file.string() + " is truncated");
+    }
+    
+    // Dokumente die ihren Cluster teilen (exakte Kopien und Near-Duplicates)
+    std::unordered_map<uint32_t, uint32_t> cluster_sizes;
+    for (const auto& doc : documents_) {
+        ++cluster_sizes[doc.cluster];
+    }
+    for (const auto& doc : documents_) {
+        if (cluster_sizes[doc.cluster] > 1) {
+            clustered_.add(doc.id);
+        }
+    }
+    
+    if (!(read_only ? content_.open_read_only(blob_path, error) : content_.open(blob_path, error))) {
+        clear();
+        return false;
+    }
+    return true;
+}
+
+// Vergibt alle IDs neu: der Vektor wird umsortiert und jede gespeicherte ID übersetzt
+void DocumentStore::remap_documents(const std::vector<uint32_t>& new_ids) {
+    std::vector<Document> old_documents;
+    old_documents.swap(documents_);
+    std::vector<uint32_t> old_ids(old_documents.size());
+    for (uint32_t old_id = 0; old_id < old_ids.size(); ++old_id) {
+        old_ids[new_ids[old_id]] = old_id;
+    }
+    
+    documents_.reserve(old_documents.size());
+    copies_.clear();
+    for (uint32_t old_id : old_ids) {
+        Document& doc = old_documents[old_id];
+        doc.id = new_ids[old_id];
+        doc.duplicate_of = new_ids[doc.duplicate_of];
+        doc.cluster = new_ids[doc.cluster];
+        if (doc.duplicate_of != doc.id) {
+            copies_[doc.duplicate_of].push_back(doc.id);  // aufsteigend, wie beim Hinzufügen
+        }
+        documents_.push_back(std::move(doc));
+    }
+    
+    for (auto& pair : content_hashes_) {
+        pair.second = new_ids[pair.second];
+    }
+    
+    auto remap_set = [&new_ids](DocIdSet& set) {
+        std::vector<uint32_t> docs;
+        set.for_each([&](uint32_t doc_id) { docs.push_back(new_ids[doc_id]); });
+        std::sort(docs.begin(), docs.end());
+        set.clear();
+        for (uint32_t doc_id : docs) {
+            set.add(doc_id);
+        }
+        set.shrink_to_fit();
+    };
+    remap_set(deleted_);
+    remap_set(clustered_);
+    metadata_.remap(new_ids);
+    
+    std::vector<std::pair<uint32_t, uint64_t>> fingerprints;
+    near_duplicates_.for_each([&](uint32_t doc_id, uint64_t fingerprint) {
+        fingerprints.emplace_back(new_ids[doc_id], fingerprint);
+    });
+    near_duplicates_.clear();
+    for (const auto& [doc_id, fingerprint] : fingerprints) {
+        near_duplicates_.add(doc_id, fingerprint);
+    }
+}
+
+// Berechnet wie viel Speicher der Store belegt (in Bytes)
+StoreMemoryStats DocumentStore::memory_usage() const noexcept {
+    StoreMemoryStats stats;
+    stats.document_slots = documents_.size() * sizeof(Document);
+    stats.vector_slack = (documents_.capacity() - documents_.size()) * sizeof(Document);
+    
+    for (const auto& doc : documents_) {
+        stats.path_bytes += string_heap_bytes(doc.path);
+    }
+    stats.tombstones = deleted_.memory_bytes();
+    stats.metadata_columns = metadata_.memory_bytes();
+    
+    // Hash Tabellen grob geschätzt: ein Pointer pro Bucket, Knoten = Wert + next Pointer + gecachter Hash
+    stats.dedup_tables = content_hashes_.bucket_count() * sizeof(void*)
+                       + content_hashes_.size() * (sizeof(std::pair<const uint64_t, uint32_t>) + 2 * sizeof(void*))
+                       + copies_.bucket_count() * sizeof(void*)
+                       + near_duplicates_.memory_bytes()
+                       + clustered_.memory_bytes();
+    for (const auto& pair : copies_) {
+        stats.dedup_tables += sizeof(pair) + 2 * sizeof(void*) + pair.second.capacity() * sizeof(uint32_t);
+    }
+    for (const auto& doc : documents_) {
+        if (doc.duplicate_of == doc.id) {
+            stats.content_raw_bytes += doc.content_ref.raw_size;  // Kopien teilen den Inhalt des Originals
+        }
+    }
+    stats.content_stored_bytes = content_.stored_bytes();
+    
+    return stats;
+}
+
+}
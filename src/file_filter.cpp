@@ -0,0 +1,262 @@
+#include "file_filter.hpp"
+#include "file_reader.hpp"
+#include <algorithm>
+
+namespace notesearch {
+
+namespace {
+
+// Glob Matching wie in .gitignore
+// *  = beliebig viele Zeichen außer '/'
+// ** = beliebig viele Zeichen inkl. '/', "**/" passt auch auf null Verzeichnisse
+// ?  = ein Zeichen außer '/'
+// [abc], [a-z], [!abc] = Zeichenklassen
+bool glob_match(std::string_view pattern, std::string_view text) {
+    while (!pattern.empty()) {
+        char p = pattern[0];
+
+        if (p == '*') {
+            bool double_star = pattern.size() > 1 && pattern[1] == '*';
+            if (double_star) {
+                std::string_view rest = pattern.substr(2);
+                if (!rest.empty() && rest[0] == '/') {
+                    // "**/" darf auch null Verzeichnisse überspringen
+                    if (glob_match(rest.substr(1), text)) {
+                        return true;
+                    }
+                }
+                for (size_t i = 0; i <= text.size(); ++i) {
+                    if (glob_match(rest, text.substr(i))) {
+                        return true;
+                    }
+                }
+                return false;
+            }
+
+            std::string_view rest = pattern.substr(1);
+            for (size_t i = 0; i <= text.size(); ++i) {
+                if (glob_match(rest, text.substr(i))) {
+                    return true;
+                }
+                if (i < text.size() && text[i] == '/') {
+                    break;  // einfacher Stern geht nicht über Verzeichnisgrenzen
+                }
+            }
+            return false;
+        }
+
+        if (text.empty()) {
+            return false;
+        }
+
+        if (p == '?') {
+            if (text[0] == '/') {
+                return false;
+            }
+        } else if (p == '[') {
+            size_t close = pattern.find(']', 2);
+            if (close == std::string_view::npos) {
+                if (text[0] != '[') {  // keine gültige Klasse: '[' wörtlich nehmen
+                    return false;
+                }
+            } else {
+                std::string_view set = pattern.substr(1, close - 1);
+                bool negate = !set.empty() && (set[0] == '!' || set[0] == '^');
+                if (negate) {
+                    set.remove_prefix(1);
+                }
+                bool found = false;
+                for (size_t i = 0; i < set.size(); ++i) {
+                    if (i + 2 < set.size() && set[i + 1] == '-') {
+                        found = found || (text[0] >= set[i] && text[0] <= set[i + 2]);
+                        i += 2;
+                    } else {
+                        found = found || text[0] == set[i];
+                    }
+                }
+                if (found == negate || text[0] == '/') {
+                    return false;
+                }
+                pattern.remove_prefix(close);  // unten wird noch 1 entfernt
+            }
+        } else {
+            if (p == '\\' && pattern.size() > 1) {
+                pattern.remove_prefix(1);  // escaptes Zeichen wörtlich
+                p = pattern[0];
+            }
+            if (text[0] != p) {
+                return false;
+            }
+        }
+
+        pattern.remove_prefix(1);
+        text.remove_prefix(1);
+    }
+    return text.empty();
+}
+
+bool contains(std::string_view haystack, std::string_view needle) {
+    return haystack.find(needle) != std::string_view::npos;
+}
+
+} // namespace
+
+std::shared_ptr<const IgnoreRules> IgnoreRules::defaults() {
+    static const std::shared_ptr<const IgnoreRules> rules = [] {
+        auto built_in = std::make_shared<IgnoreRules>();
+        const char* patterns[] = {
+            // Versionskontrolle und Tool Caches
+            ".git/", ".hg/", ".svn/", ".vs/", ".idea/",
+            "node_modules/", "__pycache__/", ".venv/",
+            // Lockfiles: groß, generiert, für die Suche nutzlos
+            "package-lock.json", "yarn.lock", "pnpm-lock.yaml", "Cargo.lock",
+            "composer.lock", "Gemfile.lock", "poetry.lock", "go.sum",
+            // minifizierte Dateien
+            "*.min.js", "*.min.json",
+        };
+        for (const char* pattern : patterns) {
+            built_in->add_pattern(pattern);
+        }
+        return built_in;
+    }();
+    return rules;
+}
+
+std::shared_ptr<const IgnoreRules> IgnoreRules::load(const std::filesystem::path& dir,
+                                                     std::shared_ptr<const IgnoreRules> parent) {
+    std::shared_ptr<IgnoreRules> rules;
+
+    for (const char* name : {".gitignore", ".ignore"}) {
+        FileContent content = load_file(dir / name);
+        if (content.empty()) {
+            continue;
+        }
+        if (!rules) {
+            rules = std::make_shared<IgnoreRules>();
+            rules->base_ = dir.generic_string();
+            if (!rules->base_.empty() && rules->base_.back() != '/') {
+                rules->base_ += '/';
+            }
+            rules->parent_ = parent;
+        }
+
+        std::string_view text = content.view();
+        while (!text.empty()) {
+            size_t newline = text.find('\n');
+            rules->add_pattern(text.substr(0, newline));
+            text.remove_prefix(newline == std::string_view::npos ? text.size() : newline + 1);
+        }
+    }
+
+    if (!rules) {
+        return parent;
+    }
+    return rules;
+}
+
+void IgnoreRules::add_pattern(std::string_view line) {
+    if (!line.empty() && line.back() == '\r') {
+        line.remove_suffix(1);
+    }
+    // Leerzeichen am Ende ignorieren (außer escaped)
+    while (!line.empty() && line.back() == ' ' && !(line.size() > 1 && line[line.size() - 2] == '\\')) {
+        line.remove_suffix(1);
+    }
+    if (line.empty() || line[0] == '#') {
+        return;
+    }
+
+    Pattern pattern;
+    if (line[0] == '!') {
+        pattern.negated = true;
+        line.remove_prefix(1);
+    } else if (line[0] == '\\') {
+        line.remove_prefix(1);  // "\#" oder "\!" am Anfang
+    }
+    if (!line.empty() && line.back() == '/') {
+        pattern.dir_only = true;
+        line.remove_suffix(1);
+    }
+    if (!line.empty() && line[0] == '/') {
+        pattern.anchored = true;
+        line.remove_prefix(1);
+    }
+    if (line.empty()) {
+        return;
+    }
+    // ein '/' in der Mitte verankert das Muster ebenfalls
+    if (line.find('/') != std::string_view::npos) {
+        pattern.anchored = true;
+    }
+    pattern.glob = std::string(line);
+    patterns_.push_back(std::move(pattern));
+}
+
+bool IgnoreRules::is_ignored(const std::filesystem::path& path, bool is_dir) const {
+    const std::string generic = path.generic_string();
+    size_t slash = generic.find_last_of('/');
+    std::string_view name = std::string_view(generic).substr(slash == std::string::npos ? 0 : slash + 1);
+
+    // vom tiefsten Verzeichnis zur Wurzel, die erste Ebene mit einem Treffer entscheidet
+    for (const IgnoreRules* level = this; level; level = level->parent_.get()) {
+        std::string_view relative = generic;
+        if (!level->base_.empty()) {
+            if (generic.compare(0, level->base_.size(), level->base_) != 0) {
+                continue;  // Pfad liegt nicht unter diesem Verzeichnis
+            }
+            relative.remove_prefix(level->base_.size());
+        }
+
+        // innerhalb einer Datei gewinnt das letzte passende Muster
+        for (auto it = level->patterns_.rbegin(); it != level->patterns_.rend(); ++it) {
+            if (it->dir_only && !is_dir) {
+                continue;
+            }
+            if (glob_match(it->glob, it->anchored ? relative : name)) {
+                return !it->negated;
+            }
+        }
+    }
+    return false;
+}
+
+ContentKind sniff_content(std::string_view first_block) noexcept {
+    std::string_view block = first_block.substr(0, sniff_block_size);
+    if (block.empty()) {
+        return ContentKind::text;
+    }
+
+    size_t control_chars = 0;
+    size_t newlines = 0;
+    for (char c : block) {
+        unsigned char byte = static_cast<unsigned char>(c);
+        if (byte == 0) {
+            return ContentKind::binary;  // Textdateien enthalten keine NUL Bytes
+        }
+        if (byte == '\n') {
+            ++newlines;
+        } else if ((byte < 0x20 && byte != '\t' && byte != '\r' && byte != '\f') || byte == 0x7f) {
+            ++control_chars;
+        }
+    }
+    if (control_chars * 10 > block.size()) {
+        return ContentKind::binary;
+    }
+
+    // Generator Hinweise stehen am Dateianfang
+    std::string_view header = block.substr(0, 1024);
+    if (contains(header, "@generated") || contains(header, "DO NOT EDIT") ||
+        contains(header, "Code generated by") || contains(header, "auto-generated") ||
+        contains(header, "Auto-generated") || contains(header, "autogenerated")) {
+        return ContentKind::generated;
+    }
+
+    // minifiziert: im Schnitt mehr als 2000 Zeichen pro Zeile
+    if (block.size() >= 4096 && newlines * 2000 < block.size()) {
+        return ContentKind::minified;
+    }
+
+    return ContentKind::text;
+}
+
+} // namespace notesearch
@@ -0,0 +1,297 @@
+#include "file_reader.hpp"
+#include "file_filter.hpp"
+#include <algorithm>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace notesearch {
+
+FileContent::~FileContent() {
+    reset();
+}
+
+FileContent::FileContent(FileContent&& other) noexcept
+    : buffer_(std::move(other.buffer_)), map_base_(other.map_base_), map_size_(other.map_size_),
+      status_(other.status_), modified_time_(other.modified_time_) {
+    other.map_base_ = nullptr;
+    other.map_size_ = 0;
+}
+
+FileContent& FileContent::operator=(FileContent&& other) noexcept {
+    if (this != &other) {
+        reset();
+        buffer_ = std::move(other.buffer_);
+        map_base_ = other.map_base_;
+        map_size_ = other.map_size_;
+        status_ = other.status_;
+        modified_time_ = other.modified_time_;
+        other.map_base_ = nullptr;
+        other.map_size_ = 0;
+    }
+    return *this;
+}
+
+std::string_view FileContent::view() const noexcept {
+    if (map_base_) {
+        return std::string_view(static_cast<const char*>(map_base_), map_size_);
+    }
+    return buffer_;
+}
+
+std::string FileContent::release_string() {
+    std::string result = map_base_ ? std::string(view()) : std::move(buffer_);
+    reset();
+    return result;
+}
+
+void FileContent::reset() noexcept {
+    status_ = LoadStatus::unreadable;
+    if (map_base_) {
+#ifdef _WIN32
+        UnmapViewOfFile(map_base_);
+#else
+        munmap(map_base_, map_size_);
+#endif
+        map_base_ = nullptr;
+        map_size_ = 0;
+    }
+    buffer_.clear();
+}
+
+// load_file: große Dateien mappen, kleine mit einem einzigen Read in einen passenden Puffer
+// Im Gegensatz zu ifstream + ostringstream wird der Inhalt dabei nicht mehrfach kopiert
+// max_size wird vor dem Lesen geprüft, sniff schaut nur den ersten Block an,
+// abgelehnte Dateien kosten also höchstens einen Block I/O
+// Die Änderungszeit kommt vom offenen Handle (unter POSIX aus demselben fstat wie die Größe)
+FileContent load_file(const std::filesystem::path& file_path, const LoadOptions& options) {
+    FileContent content;
+
+    // true wenn der erste Block in Ordnung ist (oder nicht geprüft wird)
+    auto first_block_ok = [&options, &content](std::string_view first_block) {
+        if (options.sniff && sniff_content(first_block) != ContentKind::text) {
+            content.reset();
+            content.status_ = LoadStatus::rejected;
+            return false;
+        }
+        return true;
+    };
+
+#ifdef _WIN32
+    HANDLE file = CreateFileW(file_path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                              nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return content;
+    }
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+        CloseHandle(file);
+        return content;
+    }
+    size_t size = static_cast<size_t>(file_size.QuadPart);
+    FILETIME write_time;
+    if (GetFileTime(file, nullptr, nullptr, &write_time)) {
+        // 100 ns Schritte seit 1601 -> Sekunden seit 1970
+        uint64_t ticks = (static_cast<uint64_t>(write_time.dwHighDateTime) << 32) | write_time.dwLowDateTime;
+        content.modified_time_ = static_cast<int64_t>(ticks / 10000000) - 11644473600;
+    }
+    if (options.max_size != 0 && size > options.max_size) {
+        CloseHandle(file);
+        content.status_ = LoadStatus::too_large;
+        return content;
+    }
+
+    if (size >= options.mmap_threshold) {
+        HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping) {
+            void* base = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            CloseHandle(mapping);  // die View hält das Mapping offen
+            if (base) {
+                CloseHandle(file);
+                content.map_base_ = base;
+                content.map_size_ = size;
+                content.status_ = LoadStatus::ok;
+                first_block_ok(content.view());  // berührt nur die ersten Seiten
+                return content;
+            }
+        }
+        // Mapping fehlgeschlagen: normal lesen
+    }
+
+    content.buffer_.resize(size);
+    size_t offset = 0;
+    while (offset < size) {
+        // erster Read nur ein Block, damit abgelehnte Dateien nicht ganz gelesen werden
+        size_t want = (offset == 0 && options.sniff) ? std::min(size, sniff_block_size) : size - offset;
+        DWORD chunk = static_cast<DWORD>(std::min<size_t>(want, 1u << 30));
+        DWORD read = 0;
+        if (!ReadFile(file, &content.buffer_[offset], chunk, &read, nullptr) || read == 0) {
+            break;
+        }
+        offset += read;
+        if (offset == read && !first_block_ok(std::string_view(content.buffer_.data(), offset))) {
+            CloseHandle(file);
+            return content;
+        }
+    }
+    content.buffer_.resize(offset);  // Datei kann beim Lesen kürzer geworden sein
+    CloseHandle(file);
+#else
+    int fd = open(file_path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return content;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode) || info.st_size == 0) {
+        close(fd);
+        return content;
+    }
+    size_t size = static_cast<size_t>(info.st_size);
+    content.modified_time_ = static_cast<int64_t>(info.st_mtime);
+    if (options.max_size != 0 && size > options.max_size) {
+        close(fd);
+        content.status_ = LoadStatus::too_large;
+        return content;
+    }
+
+    if (size >= options.mmap_threshold) {
+        void* base = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (base != MAP_FAILED) {
+            madvise(base, size, MADV_SEQUENTIAL);  // Tokenizer liest einmal von vorne nach hinten
+            close(fd);
+            content.map_base_ = base;
+            content.map_size_ = size;
+            content.status_ = LoadStatus::ok;
+            first_block_ok(content.view());  // berührt nur die ersten Seiten
+            return content;
+        }
+        // Mapping fehlgeschlagen: normal lesen
+    }
+
+    content.buffer_.resize(size);
+    size_t offset = 0;
+    while (offset < size) {
+        // erster Read nur ein Block, damit abgelehnte Dateien nicht ganz gelesen werden
+        size_t want = (offset == 0 && options.sniff) ? std::min(size, sniff_block_size) : size - offset;
+        ssize_t read_bytes = pread(fd, &content.buffer_[offset], want, static_cast<off_t>(offset));
+        if (read_bytes < 0 && errno == EINTR) {
+            continue;
+        }
+        if (read_bytes <= 0) {
+            break;
+        }
+        bool first_read = offset == 0;
+        offset += static_cast<size_t>(read_bytes);
+        if (first_read && !first_block_ok(std::string_view(content.buffer_.data(), offset))) {
+            close(fd);
+            return content;
+        }
+    }
+    content.buffer_.resize(offset);  // Datei kann beim Lesen kürzer geworden sein
+    close(fd);
+#endif
+
+    content.status_ = content.buffer_.empty() ? LoadStatus::unreadable : LoadStatus::ok;
+    return content;
+}
+
+FileIngestor::FileIngestor(size_t io_threads, size_t max_in_flight, LoadOptions load_options)
+    : max_in_flight_(std::max<size_t>(1, max_in_flight)), load_options_(load_options) {
+    if (io_threads == 0) {
+        // I/O gebunden: mehr Reads gleichzeitig als CPU Kerne lohnt sich (Queue Depth der Platte)
+        io_threads = std::clamp<size_t>(std::thread::hardware_concurrency() * 2, 4, 16);
+    }
+    for (size_t i = 0; i < io_threads; ++i) {
+        readers_.emplace_back([this] { reader_loop(); });
+    }
+}
+
+FileIngestor::~FileIngestor() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    work_ready_.notify_all();
+    for (auto& reader : readers_) {
+        reader.join();
+    }
+}
+
+void FileIngestor::submit(std::filesystem::path file_path) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_.push_back(std::move(file_path));
+        ++submitted_;
+    }
+    work_ready_.notify_one();
+}
+
+void FileIngestor::close() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+    }
+    file_ready_.notify_all();
+}
+
+void FileIngestor::reader_loop() {
+    while (true) {
+        std::filesystem::path file_path;
+        size_t seq;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            // nur lesen wenn im Fenster Platz ist, sonst wartet zu viel Inhalt im Speicher
+            work_ready_.wait(lock, [this] {
+                return stopping_ || (!pending_.empty() && next_claim_ < next_consume_ + max_in_flight_);
+            });
+            if (stopping_) {
+                return;
+            }
+            file_path = std::move(pending_.front());
+            pending_.pop_front();
+            seq = next_claim_++;
+        }
+
+        FileContent content = load_file(file_path, load_options_);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            loaded_.emplace(seq, Loaded{std::move(file_path), std::move(content)});
+        }
+        file_ready_.notify_all();
+    }
+}
+
+void FileIngestor::consume(const Consumer& consumer) {
+    while (true) {
+        Loaded next;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            file_ready_.wait(lock, [this] {
+                return loaded_.count(next_consume_) > 0 || (closed_ && next_consume_ == submitted_);
+            });
+            auto it = loaded_.find(next_consume_);
+            if (it == loaded_.end()) {
+                return;  // geschlossen und alles ausgeliefert
+            }
+            next = std::move(it->second);
+            loaded_.erase(it);
+            ++next_consume_;
+        }
+        work_ready_.notify_all();  // ein Platz im Fenster ist frei geworden
+
+        consumer(next.path, next.content);
+    }
+}
+
+} // namespace notesearch
@@ -1,15 +1,225 @@
 #include "file_scanner.hpp"
+#include "shard.hpp"
 #include "util.hpp"
-#include <fstream>
-#include <sstream>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <thread>
 
 namespace notesearch {
 
+namespace {
+
+// ParallelWalker: durchläuft einen Verzeichnisbaum mit mehreren Threads (Work Stealing)
+//
+// Jeder Thread hat eine eigene Queue mit Unterverzeichnissen. Er nimmt vom Ende seiner
+// eigenen Queue (depth first, gute Locality) und klaut vom Anfang fremder Queues
+// (dort liegen die Verzeichnisse nahe der Wurzel, also die großen Teilbäume).
+// Gefundene Dateien gehen direkt an den FileIngestor.
+class ParallelWalker {
+public:
+  using Filter = std::function<bool(const std::filesystem::path &)>;
+  using RulesPtr = std::shared_ptr<const IgnoreRules>;
+
+  // rules = nullptr schaltet Ignore Regeln ab
+  ParallelWalker(size_t thread_count, FileIngestor &ingestor, Filter filter, RulesPtr rules)
+      : ingestor_(ingestor), filter_(std::move(filter)), root_rules_(std::move(rules)),
+        queues_(thread_count), stats_(thread_count) {}
+
+  ~ParallelWalker() { join(); }
+
+  ParallelWalker(const ParallelWalker &) = delete;
+  ParallelWalker &operator=(const ParallelWalker &) = delete;
+
+  void start(const std::filesystem::path &root) {
+    outstanding_ = 1;  // das Wurzelverzeichnis
+    queues_[0].dirs.push_back({root, root_rules_});
+    running_ = queues_.size();
+    for (size_t i = 0; i < queues_.size(); ++i) {
+      threads_.emplace_back([this, i] { run(i); });
+    }
+  }
+
+  // Wartet auf alle Threads und gibt die zusammengeführten Zähler zurück
+  FileScanner::ScanStats join() {
+    for (auto &thread : threads_) {
+      thread.join();
+    }
+    threads_.clear();
+
+    FileScanner::ScanStats total;
+    for (const auto &local : stats_) {
+      total.directories_scanned += local.directories_scanned;
+      total.directories_ignored += local.directories_ignored;
+      total.files_scanned += local.files_scanned;
+      total.files_ignored += local.files_ignored;
+    }
+    return total;
+  }
+
+private:
+  // ein offenes Verzeichnis mit den Ignore Regeln die für seinen Inhalt gelten
+  struct PendingDir {
+    std::filesystem::path path;
+    RulesPtr rules;
+  };
+
+  // eigene Cache Line pro Queue, damit sich die Threads nicht gegenseitig ausbremsen
+  struct alignas(64) WorkQueue {
+    std::mutex mutex;
+    std::deque<PendingDir> dirs;
+  };
+
+  struct alignas(64) LocalStats {
+    size_t directories_scanned = 0;
+    size_t directories_ignored = 0;
+    size_t files_scanned = 0;
+    size_t files_ignored = 0;
+  };
+
+  FileIngestor &ingestor_;
+  Filter filter_;
+  RulesPtr root_rules_;
+  std::vector<WorkQueue> queues_;
+  std::vector<LocalStats> stats_;
+  std::vector<std::thread> threads_;
+  std::atomic<size_t> outstanding_{0};  // Verzeichnisse in Queues + gerade in Arbeit
+  std::atomic<size_t> running_{0};
+
+  bool pop_local(size_t self, PendingDir &dir) {
+    WorkQueue &queue = queues_[self];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.dirs.empty()) {
+      return false;
+    }
+    dir = std::move(queue.dirs.back());
+    queue.dirs.pop_back();
+    return true;
+  }
+
+  bool steal(size_t self, PendingDir &dir) {
+    for (size_t offset = 1; offset < queues_.size(); ++offset) {
+      WorkQueue &victim = queues_[(self + offset) % queues_.size()];
+      std::lock_guard<std::mutex> lock(victim.mutex);
+      if (!victim.dirs.empty()) {
+        dir = std::move(victim.dirs.front());
+        victim.dirs.pop_front();
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void run(size_t self) {
+    PendingDir dir;
+    size_t idle_rounds = 0;
+
+    while (true) {
+      if (pop_local(self, dir) || steal(self, dir)) {
+        idle_rounds = 0;
+        scan_one(self, dir);
+        outstanding_.fetch_sub(1);
+        continue;
+      }
+
+      // nichts zu tun: fertig wenn kein Verzeichnis mehr offen ist
+      // sonst kurz warten, ein anderer Thread findet gerade neue Unterverzeichnisse
+      if (outstanding_.load() == 0) {
+        break;
+      }
+      if (++idle_rounds < 64) {
+        std::this_thread::yield();
+      } else {
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+      }
+    }
+
+    // der letzte Thread meldet dem Ingestor dass keine Dateien mehr kommen
+    if (running_.fetch_sub(1) == 1) {
+      ingestor_.close();
+    }
+  }
+
+  void scan_one(size_t self, const PendingDir &dir) {
+    LocalStats &local = stats_[self];
+    ++local.directories_scanned;
+
+    // erst alle Einträge sammeln: falls das Verzeichnis eine .gitignore hat,
+    // muss sie geladen sein bevor die Geschwister geprüft werden
+    struct Entry {
+      std::filesystem::path path;
+      bool is_dir;
+    };
+    std::vector<Entry> entries;
+    bool has_ignore_file = false;
+
+    // error_code Varianten: ein nicht lesbares Verzeichnis bricht nicht den ganzen Walk ab
+    std::error_code ec;
+    std::filesystem::directory_iterator it(
+        dir.path, std::filesystem::directory_options::skip_permission_denied, ec);
+
+    for (; !ec && it != std::filesystem::directory_iterator(); it.increment(ec)) {
+      const auto &entry = *it;
+      std::error_code status_ec;
+
+      // wie recursive_directory_iterator: Symlinks auf Verzeichnisse nicht verfolgen (keine Zyklen)
+      if (entry.is_directory(status_ec) && !entry.is_symlink(status_ec)) {
+        entries.push_back({entry.path(), true});
+      } else if (entry.is_regular_file(status_ec)) {
+        ++local.files_scanned;
+        const auto name = entry.path().filename();
+        has_ignore_file = has_ignore_file || name == ".gitignore" || name == ".ignore";
+        entries.push_back({entry.path(), false});
+      }
+    }
+
+    RulesPtr rules = dir.rules;
+    if (rules && has_ignore_file) {
+      rules = IgnoreRules::load(dir.path, rules);
+    }
+
+    std::vector<PendingDir> subdirs;
+    for (auto &entry : entries) {
+      if (rules && rules->is_ignored(entry.path, entry.is_dir)) {
+        ++(entry.is_dir ? local.directories_ignored : local.files_ignored);
+        continue;  // ignorierte Verzeichnisse werden gar nicht erst betreten
+      }
+      if (entry.is_dir) {
+        subdirs.push_back({std::move(entry.path), rules});
+      } else if (filter_(entry.path)) {
+        ingestor_.submit(std::move(entry.path));
+      }
+    }
+
+    if (!subdirs.empty()) {
+      outstanding_.fetch_add(subdirs.size());
+      WorkQueue &queue = queues_[self];
+      std::lock_guard<std::mutex> lock(queue.mutex);
+      for (auto &subdir : subdirs) {
+        queue.dirs.push_back(std::move(subdir));
+      }
+    }
+  }
+};
+
+} // namespace
+
 std::vector<std::pair<std::filesystem::path, std::string>>
 FileScanner::scan_directory(const std::filesystem::path &root_path) const {
 
-  
   std::vector<std::pair<std::filesystem::path, std::string>> files;
+  scan_directory(root_path, [&files](const std::filesystem::path &path, FileContent &content) {
+    // release_string() übernimmt den Lese Puffer ohne Kopie
+    files.emplace_back(path, content.release_string());
+  });
+  return files;
+}
+
+void FileScanner::scan_directory(const std::filesystem::path &root_path,
+                                 const FileCallback &on_file) const {
+
   last_stats_ = ScanStats{};
   
   // std::filesystem API 
@@ -18,63 +228,61 @@ FileScanner::scan_directory(const std::filesystem::path &root_path) const {
     // exists() = prüft ob Pfad existiert (Datei oder Ordner)
     // is_directory() = prüft ob Pfad ein Verzeichnis ist (nicht Datei)
   
-    return files;
+    return;
   }
   
-
+  // Reader Threads lesen die Dateien schon während das Verzeichnis noch durchlaufen wird
+  // die Walker Threads laufen parallel, dieser Thread übergibt die Dateien an on_file
+  LoadOptions load_options;
+  load_options.max_size = options_.max_file_size;
+  load_options.sniff = options_.sniff_content;
+  FileIngestor ingestor(0, 64, load_options);
+  
+  size_t thread_count = options_.walker_threads;
+  if (thread_count == 0) {
+    // Walk wartet meist auf readdir/stat, nicht auf die CPU
+    thread_count = std::max<size_t>(4, std::thread::hardware_concurrency());
+  }
+  
+  // Sharding: fremde Dateien werden gar nicht erst gelesen
+  auto filter = [this, &root_path](const std::filesystem::path &path) {
+    if (!should_index(path)) {
+      return false;
+    }
+    return options_.shard_count <= 1 ||
+           shard_of(path.lexically_relative(root_path), options_.shard_count) == options_.shard_index;
+  };
+  ParallelWalker walker(thread_count, ingestor, filter,
+                        options_.use_ignore_files ? IgnoreRules::defaults() : nullptr);
+  walker.start(root_path);
+  
   try {
-    // try catch .. fängt Exceptions ab
-    // Verhindert Programm crash bei Dateisystem Fehlern
-    // Code in try Block wird ausgeführt
-    // Bei Fehler Sprung zu catchBlock
-    
-    // recursive_directory_iterator 
-    for (const auto &entry : std::filesystem::recursive_directory_iterator(
-             root_path,
-             std::filesystem::directory_options::skip_permission_denied)) {
-
-      // Durchsucht Verzeichnis und alle Unterverzeichnisse
-
-      
-      // directory_options::skip_permission_denied
-      // Überspringt Dateien oder Ordner ohne Berechtigung
-      // Verhindert Crash bei fehlenden Berechtigungen
-    
-      
-      // entry.is_regular_file() - NEUES KONZEPT!
-      if (entry.is_regular_file()) {
-        // is_regular_file()  .. prüft ob Eintrag normale Datei ist
-        // wenn true .. normale Datei (z.B. .txt, .cpp)
-        // false .. Verzeichnis, Symlink, etc.
-        // es filtert Verzeichnisse aus
-        
-        ++last_stats_.files_scanned;
-
-        if (should_index(entry.path())) {
-          std::string content = read_file(entry.path());
-          if (!content.empty()) {
-            files.emplace_back(entry.path(), std::move(content));
-            ++last_stats_.files_indexed;
-            last_stats_.total_bytes += content.size();
-          }
-        }
+    ingestor.consume([this, &on_file](const std::filesystem::path &path, FileContent &content) {
+      if (content.status() == LoadStatus::too_large) {
+        ++last_stats_.files_too_large;
+      } else if (content.status() == LoadStatus::rejected) {
+        ++last_stats_.files_rejected;
+      } else if (!content.empty()) {
+        ++last_stats_.files_indexed;
+        last_stats_.total_bytes += content.size();
+        on_file(path, content);
       }
-    }
-  } catch (const std::filesystem::filesystem_error &e) {
-    // Silently handle filesystem errors - return empty vector
-    // GUI will show appropriate status message
+    });
+  } catch (...) {
+    walker.join();  // Threads dürfen nicht joinable zerstört werden
+    throw;
   }
   
-  return files;
+  // Zähler der Walker Threads zusammenführen
+  ScanStats walk_stats = walker.join();
+  last_stats_.directories_scanned = walk_stats.directories_scanned;
+  last_stats_.directories_ignored = walk_stats.directories_ignored;
+  last_stats_.files_scanned = walk_stats.files_scanned;
+  last_stats_.files_ignored = walk_stats.files_ignored;
 }
 
 bool FileScanner::should_index(const std::filesystem::path &file_path) const { // kommt ausutil.cpp
   return notesearch::should_index_file(file_path);
 }
 
-std::string
-FileScanner::read_file(const std::filesystem::path &file_path) const {
-  return notesearch::read_file_content(file_path);
-}
-
 }
\ No newline at end of file
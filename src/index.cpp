@@ -1,33 +1,319 @@
 #include "index.hpp"
+#include "index_file.hpp"
+#include "trigram.hpp"
+#include "tokenizer.hpp"
+#include "util.hpp"
 #include <algorithm>
-#include <unordered_map>
+#include <cctype>
+#include <cstddef>
 
 namespace notesearch {
 
+// Fügt ein Posting hinzu, Frequenzen stehen in derselben Reihenfolge wie die IDs im DocIdSet
+void PostingList::add(uint32_t doc_id, uint32_t term_freq) {
+    uint16_t freq = static_cast<uint16_t>(std::min<uint32_t>(term_freq, UINT16_MAX));  // sättigend
+    
+    // Normalfall beim Indexieren: IDs kommen aufsteigend, also anhängen
+    if (docs_.empty() || doc_id > docs_.max()) {
+        docs_.add(doc_id);
+        freqs_.push_back(freq);
+        return;
+    }
+    
+    size_t position = docs_.rank(doc_id);
+    if (docs_.contains(doc_id)) {
+        freqs_[position] = static_cast<uint16_t>(std::min<uint32_t>(freqs_[position] + term_freq, UINT16_MAX));
+        return;
+    }
+    docs_.add(doc_id);
+    freqs_.insert(freqs_.begin() + static_cast<std::ptrdiff_t>(position), freq);
+}
+
+uint32_t PostingList::frequency(uint32_t doc_id) const noexcept {
+    if (!docs_.contains(doc_id)) {
+        return 0;
+    }
+    return freqs_[docs_.rank(doc_id)];
+}
+
+void PostingList::shrink_to_fit() {
+    docs_.shrink_to_fit();
+    freqs_.shrink_to_fit();
+}
+
 // Fügt ein Dokument zum Index hinzu
 // doc_id = ID des Dokuments
 // tokens = Liste aller Wörter aus dem Dokument
-void InvertedIndex::index_document(uint32_t doc_id, const std::vector<std::string>& tokens) {
-    //  Zähle wie oft jedes Wort vorkommt
-    std::unordered_map<std::string, uint32_t> term_counts;
-    for (const auto& token : tokens) {
-        ++term_counts[token];  // Erhöht Zähler für jedes Wort
+// field = Feld in das die Wörter kommen (Inhalt, Dateiname, Pfad)
+void InvertedIndex::index_document(uint32_t doc_id, const std::vector<std::string>& tokens, Field field) {
+    //  Zähle wie oft jedes Wort vorkommt (offene Hash Tabelle, wiederverwendet von Dokument zu Dokument)
+    token_terms_.count(tokens);
+    
+    // Schritt 2: Füge jedes Wort zum Index hinzu: Wort -> (Dokument-ID, Häufigkeit)
+    index_document(doc_id, token_terms_, field);
+}
+
+// Dasselbe mit schon gezählten Wörtern (TermCounter), der Zähl Schritt oben fällt weg
+// Der Hash des TermCounters wird weiterbenutzt, ein std::string entsteht nur für neue Wörter
+void InvertedIndex::index_document(uint32_t doc_id, const TermCounter& terms, Field field) {
+    TermMap& index = this->terms(field);
+    for (uint32_t id = 0; id < terms.size(); ++id) {
+        TermCounter::Term term = terms.term(id);
+        index.try_emplace(term.text, term.hash).first->second.add(doc_id, term.frequency);
+    }
+}
+
+// Zerlegt einen Pfad in Dateiname, Verzeichnisnamen, Endung und Verzeichnis Filter
+// Verzeichnisse oberhalb von root zählen nicht (sonst hätte jedes Dokument "home", "users" ...)
+PathTerms analyze_path(const std::filesystem::path& file_path, const std::filesystem::path& root) {
+    auto lowercase = [](std::string text) {
+        for (char& c : text) {
+            c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        }
+        return text;
+    };
+    
+    std::filesystem::path directories = file_path.parent_path().relative_path();
+    if (!root.empty()) {
+        std::filesystem::path relative = file_path.parent_path().lexically_relative(root);
+        if (!relative.empty() && *relative.begin() != "..") {
+            directories = relative;
+        }
+    }
+    
+    PathTerms terms;
+    terms.filename = tokenize(file_path.stem().string());
+    terms.directories = tokenize(directories.string());
+    
+    std::string extension = file_path.extension().string();
+    if (extension.size() > 1) {
+        terms.extension = lowercase(extension.substr(1));  // ohne Punkt
+    }
+    
+    // jedes Verzeichnis auf dem Weg zur Datei
+    for (const auto& component : directories) {
+        std::string name = lowercase(component.string());
+        if (!name.empty() && name != ".") {
+            terms.directory_names.push_back(std::move(name));
+        }
+    }
+    return terms;
+}
+
+// Indexiert den Pfad eines Dokuments
+// Dateiname und Verzeichnisnamen werden eigene Felder (eigene Gewichtung bei der Suche),
+// Endung und Verzeichnisse werden als Bitsets für ext: / dir: Filter vorberechnet
+void InvertedIndex::index_path(uint32_t doc_id, const std::filesystem::path& file_path,
+                               const std::filesystem::path& root) {
+    PathTerms path_terms = analyze_path(file_path, root);
+    index_document(doc_id, path_terms.filename, Field::filename);
+    index_document(doc_id, path_terms.directories, Field::path);
+    
+    if (!path_terms.extension.empty()) {
+        extension_filters_[path_terms.extension].add(doc_id);
+    }
+    for (const auto& name : path_terms.directory_names) {
+        directory_filters_[name].add(doc_id);
+    }
+}
+
+void InvertedIndex::set_postings(const std::string& term, Field field, PostingList postings) {
+    terms(field)[term] = std::move(postings);
+}
+
+void InvertedIndex::set_filter(FilterKind kind, const std::string& value, DocIdSet docs) {
+    auto& filters = (kind == FilterKind::extension) ? extension_filters_ : directory_filters_;
+    filters[value] = std::move(docs);
+}
+
+// Jedes Trigramm des Inhalts einmal, für re: / lit: Queries
+void InvertedIndex::index_trigrams(uint32_t doc_id, std::string_view content) {
+    std::vector<uint32_t> keys;
+    document_trigrams(content, keys);
+    for (uint32_t trigram : keys) {
+        trigrams_[trigram].add(doc_id);
+    }
+}
+
+void InvertedIndex::set_trigram(uint32_t trigram, DocIdSet docs) {
+    trigrams_[trigram] = std::move(docs);
+}
+
+const DocIdSet* InvertedIndex::get_trigram(uint32_t trigram) const {
+    auto it = trigrams_.find(trigram);
+    return it != trigrams_.end() ? &it->second : nullptr;
+}
+
+// Lädt einen gebauten Index (index.bin): Header, dann Records sortiert nach (Feld, Wort)
+// Die Postings kommen aufsteigend, PostingList::add hängt also nur an
+bool InvertedIndex::load(const std::filesystem::path& index_file, std::string* error) {
+    clear();
+    auto fail = [this, error](const std::string& message) {
+        clear();
+        if (error) *error = message;
+        return false;
+    };
+    
+    BinaryReader in;
+    if (!in.open(index_file)) {
+        return fail("cannot open " + index_file.string());
+    }
+    uint64_t magic = 0;
+    uint64_t version = 0;
+    if (!in.get_varint(magic) || magic != index_file_magic || !in.get_varint(version) ||
+        version != index_file_version) {
+        return fail(index_file.string() + " is not an index file of this version");
+    }
+    
+    TermRecord record;
+    while (read_record(in, record)) {
+        if (record.is_trigram()) {
+            DocIdSet docs;
+            if (record.term.size() != 3 || !decode_documents(record, docs)) {
+                return fail("damaged trigram in " + index_file.string());
+            }
+            docs.shrink_to_fit();
+            const std::string& bytes = record.term;
+            set_trigram(trigram_key(bytes[0], bytes[1], bytes[2]), std::move(docs));
+        } else if (record.is_filter()) {
+            uint8_t kind = record.tag - TermRecord::filter_tag;
+            DocIdSet docs;
+            if (kind > static_cast<uint8_t>(FilterKind::directory) || !decode_documents(record, docs)) {
+                return fail("damaged filter '" + record.term + "' in " + index_file.string());
+            }
+            docs.shrink_to_fit();
+            set_filter(static_cast<FilterKind>(kind), record.term, std::move(docs));
+        } else {
+            PostingList postings;
+            if (record.tag >= field_count || !decode_postings(record, postings)) {
+                return fail("damaged postings of '" + record.term + "' in " + index_file.string());
+            }
+            postings.shrink_to_fit();
+            terms(static_cast<Field>(record.tag)).emplace(std::move(record.term), std::move(postings));
+        }
+    }
+    if (!in.ok()) {
+        return fail(index_file.string() + " is truncated");
+    }
+    
+    shrink_to_fit();  // Lexikon für die Prefix Suche
+    return true;
+}
+
+// Schreibt den Index im Format von IndexBuilder::write(), sortiert nach (Feld, Wort)
+bool InvertedIndex::save(const std::filesystem::path& index_file, std::string* error) const {
+    BinaryWriter out;
+    if (!out.open(index_file)) {
+        if (error) *error = "cannot create " + index_file.string();
+        return false;
+    }
+    out.put_varint(index_file_magic);
+    out.put_varint(index_file_version);
+    
+    TermRecord record;
+    for (size_t f = 0; f < field_count; ++f) {
+        std::vector<const TermMap::value_type*> entries;
+        entries.reserve(fields_[f].size());
+        for (const auto& pair : fields_[f]) {
+            entries.push_back(&pair);
+        }
+        std::sort(entries.begin(), entries.end(),
+                  [](const TermMap::value_type* a, const TermMap::value_type* b) { return a->first < b->first; });
+        record.tag = static_cast<uint8_t>(f);
+        for (const auto* entry : entries) {
+            record.term = entry->first;
+            encode_postings(entry->second, record);
+            write_record(out, record);
+        }
     }
     
-    // Schritt 2: Füge jedes Wort zum Index hinzu
-    for (const auto& pair : term_counts) {
-        const std::string& term = pair.first;      // Das Wort
-        uint32_t freq = pair.second;                // Wie oft es vorkommt
-        index_[term].emplace_back(doc_id, freq);   // Speichere: Wort -> (Dokument-ID, Häufigkeit)
+    const FilterMap* filters[] = {&extension_filters_, &directory_filters_};
+    for (size_t kind = 0; kind < 2; ++kind) {
+        std::vector<const FilterMap::value_type*> values;
+        for (const auto& pair : *filters[kind]) {
+            values.push_back(&pair);
+        }
+        std::sort(values.begin(), values.end(),
+                  [](const FilterMap::value_type* a, const FilterMap::value_type* b) { return a->first < b->first; });
+        record.tag = static_cast<uint8_t>(TermRecord::filter_tag + kind);
+        for (const auto* value : values) {
+            record.term = value->first;
+            encode_documents(value->second, record);
+            write_record(out, record);
+        }
+    }
+    
+    std::vector<const std::pair<uint32_t, DocIdSet>*> trigrams;
+    trigrams.reserve(trigrams_.size());
+    for (const auto& pair : trigrams_) {
+        trigrams.push_back(&pair);
+    }
+    std::sort(trigrams.begin(), trigrams.end(),
+              [](const auto* a, const auto* b) { return a->first < b->first; });
+    record.tag = TermRecord::trigram_tag;
+    for (const auto* trigram : trigrams) {
+        record.term = trigram_string(trigram->first);
+        encode_documents(trigram->second, record);
+        write_record(out, record);
+    }
+    out.put_byte(TermRecord::end_tag);
+    
+    if (!out.close()) {
+        if (error) *error = "cannot write " + index_file.string() + " (disk full?)";
+        return false;
+    }
+    return true;
+}
+
+// Vergibt alle Dokument IDs neu: new_ids[alte ID] = neue ID
+// Jede Posting Liste wird nach den neuen IDs sortiert neu aufgebaut, die Einträge bleiben (Lexikon gültig)
+void InvertedIndex::remap_documents(const std::vector<uint32_t>& new_ids) {
+    std::vector<std::pair<uint32_t, uint32_t>> postings;
+    for (auto& index : fields_) {
+        for (auto& pair : index) {
+            postings.clear();
+            pair.second.for_each([&](uint32_t doc_id, uint32_t term_freq) {
+                postings.emplace_back(new_ids[doc_id], term_freq);
+            });
+            std::sort(postings.begin(), postings.end());
+            PostingList remapped;
+            for (const auto& [doc_id, term_freq] : postings) {
+                remapped.add(doc_id, term_freq);
+            }
+            remapped.shrink_to_fit();
+            pair.second = std::move(remapped);
+        }
+    }
+    
+    std::vector<uint32_t> docs;
+    auto remap_set = [&docs, &new_ids](DocIdSet& set) {
+        docs.clear();
+        set.for_each([&](uint32_t doc_id) { docs.push_back(new_ids[doc_id]); });
+        std::sort(docs.begin(), docs.end());
+        DocIdSet remapped;
+        for (uint32_t doc_id : docs) {
+            remapped.add(doc_id);
+        }
+        remapped.shrink_to_fit();
+        set = std::move(remapped);
+    };
+    for (auto* filters : {&extension_filters_, &directory_filters_}) {
+        for (auto& pair : *filters) {
+            remap_set(pair.second);
+        }
+    }
+    for (auto& pair : trigrams_) {
+        remap_set(pair.second);
     }
 }
 
 // Sucht ein Wort im Index und gibt alle Dokumente zurück, die es enthalten
 // term = das gesuchte Wort
 // Rückgabe: Pointer auf Liste von Postings (oder nullptr wenn nicht gefunden)
-const std::vector<Posting>* InvertedIndex::get_postings(const std::string& term) const {
-    auto it = index_.find(term);  // Suche das Wort
-    if (it != index_.end()) {
+const PostingList* InvertedIndex::get_postings(std::string_view term, Field field) const {
+    const TermMap& index = terms(field);
+    auto it = index.find(term);   // Suche das Wort
+    if (it != index.end()) {
         return &(it->second);      // Gefunden: gib Liste zurück
     }
     return nullptr;                // Nicht gefunden
@@ -36,31 +322,171 @@ const std::vector<Posting>* InvertedIndex::get_postings(const std::string& term)
 // Gibt zurück: In wie vielen Dokumenten kommt das Wort vor?
 // term = das gesuchte Wort
 // Rückgabe: Anzahl der Dokumente (0 wenn nicht gefunden)
-size_t InvertedIndex::get_document_frequency(const std::string& term) const {
-    auto it = index_.find(term);
-    if (it != index_.end()) {
+size_t InvertedIndex::get_document_frequency(std::string_view term, Field field) const {
+    const TermMap& index = terms(field);
+    auto it = index.find(term);
+    if (it != index.end()) {
         return it->second.size();  // Größe der Liste = Anzahl Dokumente
     }
     return 0;
 }
 
+// Gibt die Dokumente zurück die zu einem Filter Wert passen (nullptr = keine)
+const DocIdSet* InvertedIndex::get_filter(FilterKind kind, std::string_view value) const {
+    const auto& filters = (kind == FilterKind::extension) ? extension_filters_ : directory_filters_;
+    auto it = filters.find(value);
+    return it != filters.end() ? &it->second : nullptr;
+}
+
+// Anzahl Wörter über alle Felder
+size_t InvertedIndex::vocabulary_size() const noexcept {
+    size_t total = 0;
+    for (const auto& index : fields_) {
+        total += index.size();
+    }
+    return total;
+}
+
+// Gibt nach dem Aufbau ungenutzte Kapazität frei (Vektoren wachsen beim Anhängen auf Vorrat)
+void InvertedIndex::shrink_to_fit() {
+    for (auto& index : fields_) {
+        for (auto& pair : index) {
+            pair.second.shrink_to_fit();
+        }
+    }
+    for (auto* filters : {&extension_filters_, &directory_filters_}) {
+        filters->shrink_to_fit();
+        for (auto& pair : *filters) {
+            pair.second.shrink_to_fit();
+        }
+    }
+    trigrams_.shrink_to_fit();
+    for (auto& pair : trigrams_) {
+        pair.second.shrink_to_fit();
+    }
+    
+    // sortiertes Wörterbuch für Prefix Suche (Search-as-you-type), die Hash Maps haben keine Ordnung
+    // Erst die Reserve der Einträge freigeben, das verschiebt sie, danach zeigt das Lexikon hinein
+    for (size_t f = 0; f < field_count; ++f) {
+        fields_[f].shrink_to_fit();
+        std::vector<LexiconEntry>& lexicon = lexicon_[f];
+        lexicon.clear();
+        lexicon.reserve(fields_[f].size());
+        for (const auto& pair : fields_[f]) {
+            lexicon.push_back({&pair.first, &pair.second});
+        }
+        std::sort(lexicon.begin(), lexicon.end(),
+                  [](const LexiconEntry& a, const LexiconEntry& b) { return *a.term < *b.term; });
+        lexicon.shrink_to_fit();
+    }
+}
+
+// Alle Wörter eines Felds die mit prefix anfangen, sortiert
+// Normalfall: binäre Suche im Lexikon, ist es veraltet (neue Wörter seit shrink_to_fit) wird gescannt
+std::vector<LexiconEntry> InvertedIndex::terms_with_prefix(std::string_view prefix, Field field) const {
+    std::vector<LexiconEntry> matches;
+    const auto& lexicon = lexicon_[static_cast<size_t>(field)];
+    const TermMap& index = terms(field);
+    
+    if (lexicon.size() == index.size()) {
+        auto it = std::lower_bound(lexicon.begin(), lexicon.end(), prefix,
+                                   [](const LexiconEntry& entry, std::string_view value) { return *entry.term < value; });
+        auto end = it;
+        while (end != lexicon.end() && std::string_view(*end->term).substr(0, prefix.size()) == prefix) {
+            ++end;
+        }
+        matches.assign(it, end);
+        return matches;
+    }
+    
+    for (const auto& pair : index) {
+        if (std::string_view(pair.first).substr(0, prefix.size()) == prefix) {
+            matches.push_back({&pair.first, &pair.second});
+        }
+    }
+    std::sort(matches.begin(), matches.end(),
+              [](const LexiconEntry& a, const LexiconEntry& b) { return *a.term < *b.term; });
+    return matches;
+}
+
 // Löscht den kompletten Index
 void InvertedIndex::clear() noexcept {
-    index_.clear();
+    for (auto& index : fields_) {
+        index.clear();
+    }
+    extension_filters_.clear();
+    directory_filters_.clear();
+    trigrams_.clear();
+    for (auto& lexicon : lexicon_) {
+        lexicon.clear();
+    }
 }
 
 // Gibt alle Wörter zurück, die im Index sind
 // Nützlich für Debugging oder Auto-Complete
 std::vector<std::string> InvertedIndex::get_all_terms() const {
-    std::vector<std::string> terms;
-    terms.reserve(index_.size());  // Reserviere Speicher für bessere Performance
+    const TermMap& index = terms(Field::content);
+    std::vector<std::string> all_terms;
+    all_terms.reserve(index.size());  // Reserviere Speicher für bessere Performance
     
     // Gehe durch alle Einträge im Index
-    for (const auto& pair : index_) {
-        terms.push_back(pair.first);  // Füge das Wort hinzu
+    for (const auto& pair : index) {
+        all_terms.push_back(pair.first);  // Füge das Wort hinzu
     }
     
-    return terms;
+    return all_terms;
 }
 
-} 
\ No newline at end of file
+// Berechnet wie viel Speicher der Index belegt (in Bytes)
+IndexMemoryStats InvertedIndex::memory_usage() const noexcept {
+    IndexMemoryStats stats;
+    for (const auto& index : fields_) {
+        stats.hash_table += index.table_bytes();
+        stats.hash_entries += index.entry_bytes();
+        
+        for (const auto& pair : index) {
+            stats.dictionary_keys += string_heap_bytes(pair.first);
+            stats.posting_payload += pair.second.memory_bytes() - pair.second.slack_bytes();
+            stats.posting_slack += pair.second.slack_bytes();
+        }
+    }
+    
+    for (const auto* filters : {&extension_filters_, &directory_filters_}) {
+        stats.filter_bitsets += filters->table_bytes() + filters->entry_bytes();
+        for (const auto& pair : *filters) {
+            stats.filter_bitsets += string_heap_bytes(pair.first) + pair.second.memory_bytes();
+        }
+    }
+    for (const auto& lexicon : lexicon_) {
+        stats.lexicon += lexicon.capacity() * sizeof(LexiconEntry);
+    }
+    stats.trigram_sets = trigrams_.table_bytes() + trigrams_.entry_bytes();
+    for (const auto& pair : trigrams_) {
+        stats.trigram_sets += pair.second.memory_bytes();
+    }
+    
+    return stats;
+}
+
+// Zählt wie viele Wörter wie lange Posting Listen haben
+// Bucket i = Länge zwischen 2^i und 2^(i+1)-1
+std::vector<size_t> InvertedIndex::posting_length_histogram() const {
+    std::vector<size_t> histogram;
+    
+    for (const auto& pair : terms(Field::content)) {
+        size_t length = pair.second.size();
+        size_t bucket = 0;
+        while (length > 1) {  // log2 abrunden
+            length >>= 1;
+            ++bucket;
+        }
+        if (bucket >= histogram.size()) {
+            histogram.resize(bucket + 1, 0);
+        }
+        ++histogram[bucket];
+    }
+    
+    return histogram;
+}
+
+}
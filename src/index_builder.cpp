@@ -0,0 +1,454 @@
+#include "index_builder.hpp"
+#include "trigram.hpp"
+#include "util.hpp"
+#include <algorithm>
+#include <atomic>
+#include <queue>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace notesearch {
+
+namespace {
+
+std::filesystem::path temp_work_dir() {
+    static std::atomic<unsigned> counter{0};
+#ifdef _WIN32
+    unsigned long pid = GetCurrentProcessId();
+#else
+    long pid = static_cast<long>(getpid());
+#endif
+    std::error_code ec;
+    std::filesystem::path dir = std::filesystem::temp_directory_path(ec);
+    if (ec) {
+        dir = ".";
+    }
+    return dir / ("notesearch-" + std::to_string(pid) + "-build-" + std::to_string(counter++));
+}
+
+// Ein Run beim Mergen: der aktuelle Record und woher er kommt
+struct RunCursor {
+    TermRecord record;
+    size_t run;
+};
+
+// Min-Heap nach (Feld, Wort), bei Gleichstand der ältere Run zuerst (seine Dokumente sind kleiner)
+struct LaterCursor {
+    bool operator()(const RunCursor* a, const RunCursor* b) const {
+        if (a->record.tag != b->record.tag) return a->record.tag > b->record.tag;
+        if (a->record.term != b->record.term) return a->record.term > b->record.term;
+        return a->run > b->run;
+    }
+};
+
+} // namespace
+
+IndexBuilder::IndexBuilder(size_t memory_budget, std::filesystem::path work_dir)
+    : memory_budget_(memory_budget), work_dir_(std::move(work_dir)) {}
+
+IndexBuilder::~IndexBuilder() {
+    remove_runs();
+}
+
+// Fertige Tokens (Pfad Felder): erst zählen, dann wie unten
+void IndexBuilder::index_document(uint32_t doc_id, const std::vector<std::string>& tokens, Field field) {
+    token_terms_.count(tokens);
+    index_document(doc_id, token_terms_, field);
+}
+
+// Wie InvertedIndex::index_document, aber in den Block: Postings werden gleich kodiert angehängt
+void IndexBuilder::index_document(uint32_t doc_id, const TermCounter& terms, Field field) {
+    Block& block = block_[static_cast<size_t>(field)];
+    for (uint32_t id = 0; id < terms.size(); ++id) {
+        TermCounter::Term term = terms.term(id);
+        BlockPostings& postings = block_term(block, term).postings;
+        if (postings.count > 0 && doc_id <= postings.last_doc) {
+            continue;  // IDs müssen aufsteigen, ein Dokument pro Feld nur einmal
+        }
+        size_t capacity = postings.bytes.capacity();
+        append_varint(postings.bytes, postings.count == 0 ? doc_id : doc_id - postings.last_doc);
+        append_varint(postings.bytes, term.frequency);
+        block_bytes_ += postings.bytes.capacity() - capacity;
+        ++postings.count;
+        postings.last_doc = doc_id;
+    }
+
+    if (block_bytes_ + bucket_bytes() >= memory_budget_) {
+        flush();
+    }
+}
+
+// Sucht ein Wort im Block über seinen Hash, neue Wörter bekommen die nächste Term ID
+IndexBuilder::BlockTerm& IndexBuilder::block_term(Block& block, const TermCounter::Term& term) {
+    if ((block.terms.size() + 1) * 2 > block.slots.size()) {
+        grow(block);
+    }
+    size_t mask = block.slots.size() - 1;
+    size_t slot = static_cast<size_t>(term.hash ^ (term.hash >> 32)) & mask;
+    while (uint32_t id = block.slots[slot]) {
+        BlockTerm& entry = block.terms[id - 1];
+        if (entry.hash == term.hash && block.text(entry) == term.text) {
+            return entry;
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    // Speicher: Eintrag und Bytes im Pool, gezählt wird was die Vektoren wirklich reservieren
+    size_t before = block.terms.capacity() * sizeof(BlockTerm) + block.pool.capacity();
+    block.slots[slot] = static_cast<uint32_t>(block.terms.size() + 1);
+    block.terms.push_back({term.hash, block.pool.size(), static_cast<uint32_t>(term.text.size()), BlockPostings{}});
+    block.pool.append(term.text);
+    block_bytes_ += block.terms.capacity() * sizeof(BlockTerm) + block.pool.capacity() - before;
+    return block.terms.back();
+}
+
+void IndexBuilder::grow(Block& block) {
+    block.slots.assign(block.slots.empty() ? 1024 : block.slots.size() * 2, 0);
+    size_t mask = block.slots.size() - 1;
+    for (size_t id = 0; id < block.terms.size(); ++id) {
+        uint64_t hash = block.terms[id].hash;
+        size_t slot = static_cast<size_t>(hash ^ (hash >> 32)) & mask;
+        while (block.slots[slot] != 0) {
+            slot = (slot + 1) & mask;
+        }
+        block.slots[slot] = static_cast<uint32_t>(id + 1);
+    }
+}
+
+// Term IDs eines Blocks nach Wort sortiert, so stehen sie in den Runs und im Index
+std::vector<uint32_t> IndexBuilder::sorted_terms(const Block& block) {
+    std::vector<uint32_t> ids(block.terms.size());
+    for (size_t id = 0; id < ids.size(); ++id) {
+        ids[id] = static_cast<uint32_t>(id);
+    }
+    std::sort(ids.begin(), ids.end(), [&block](uint32_t a, uint32_t b) {
+        return block.text(block.terms[a]) < block.text(block.terms[b]);
+    });
+    return ids;
+}
+
+// Trigramme wie Wörter, aber nur die Lücken (ein Trigramm zählt pro Dokument einmal)
+void IndexBuilder::index_trigrams(uint32_t doc_id, std::string_view content) {
+    document_trigrams(content, trigram_keys_);
+    for (uint32_t trigram : trigram_keys_) {
+        auto [it, inserted] = trigram_block_.try_emplace(trigram);
+        BlockPostings& postings = it->second;
+        if (inserted) {
+            block_bytes_ += sizeof(decltype(trigram_block_)::value_type) + 2 * sizeof(void*);
+        } else if (doc_id <= postings.last_doc) {
+            continue;
+        }
+        size_t capacity = postings.bytes.capacity();
+        append_varint(postings.bytes, postings.count == 0 ? doc_id : doc_id - postings.last_doc);
+        block_bytes_ += postings.bytes.capacity() - capacity;
+        ++postings.count;
+        postings.last_doc = doc_id;
+    }
+    if (block_bytes_ + bucket_bytes() >= memory_budget_) {
+        flush();
+    }
+}
+
+size_t IndexBuilder::bucket_bytes() const noexcept {
+    size_t bytes = trigram_block_.bucket_count() * sizeof(void*);
+    for (const auto& block : block_) {
+        bytes += block.slots.capacity() * sizeof(uint32_t);
+    }
+    return bytes;
+}
+
+void IndexBuilder::index_path(uint32_t doc_id, const std::filesystem::path& file_path,
+                              const std::filesystem::path& root) {
+    PathTerms path_terms = analyze_path(file_path, root);
+    index_document(doc_id, path_terms.filename, Field::filename);
+    index_document(doc_id, path_terms.directories, Field::path);
+
+    if (!path_terms.extension.empty()) {
+        filters_[static_cast<size_t>(FilterKind::extension)][path_terms.extension].add(doc_id);
+    }
+    for (const auto& name : path_terms.directory_names) {
+        filters_[static_cast<size_t>(FilterKind::directory)][name].add(doc_id);
+    }
+}
+
+// Schreibt den Block sortiert als Run auf die Platte und fängt einen neuen an
+void IndexBuilder::flush() {
+    bool empty = trigram_block_.empty() &&
+                 std::all_of(block_.begin(), block_.end(), [](const Block& terms) { return terms.empty(); });
+    if (empty || !error_.empty()) {
+        return;
+    }
+    stats_.peak_memory_bytes = std::max(stats_.peak_memory_bytes, block_bytes_);
+
+    if (work_dir_.empty()) {
+        work_dir_ = temp_work_dir();
+        owns_work_dir_ = true;
+    }
+    std::error_code ec;
+    std::filesystem::create_directories(work_dir_, ec);
+
+    std::filesystem::path run_path = work_dir_ / ("run-" + std::to_string(runs_.size()) + ".bin");
+    BinaryWriter out;
+    if (!out.open(run_path)) {
+        error_ = "cannot create " + run_path.string();
+        return;
+    }
+    runs_.push_back(run_path);
+
+    TermRecord record;
+    for (size_t f = 0; f < field_count; ++f) {
+        Block& block = block_[f];
+        record.tag = static_cast<uint8_t>(f);
+        for (uint32_t id : sorted_terms(block)) {
+            BlockTerm& term = block.terms[id];
+            record.term.assign(block.text(term));
+            record.count = term.postings.count;
+            record.last_doc = term.postings.last_doc;
+            record.postings.swap(term.postings.bytes);
+            write_record(out, record);
+        }
+        block = Block();  // auch Tabelle und Pool freigeben
+    }
+    write_trigrams([&out](TermRecord& record) {
+        write_record(out, record);
+        return true;
+    });
+    out.put_byte(TermRecord::end_tag);
+
+    stats_.run_bytes += out.bytes_written();
+    ++stats_.runs_written;
+    block_bytes_ = 0;
+    if (!out.close()) {
+        error_ = "cannot write " + run_path.string() + " (disk full?)";
+    }
+}
+
+// Trigramm Block sortiert als Records, danach ist er leer
+bool IndexBuilder::write_trigrams(const std::function<bool(TermRecord&)>& sink) {
+    std::vector<uint32_t> keys;
+    keys.reserve(trigram_block_.size());
+    for (const auto& entry : trigram_block_) {
+        keys.push_back(entry.first);
+    }
+    std::sort(keys.begin(), keys.end());
+    
+    TermRecord record;
+    record.tag = TermRecord::trigram_tag;
+    for (uint32_t trigram : keys) {
+        BlockPostings& postings = trigram_block_.at(trigram);
+        record.term = trigram_string(trigram);
+        record.count = postings.count;
+        record.last_doc = postings.last_doc;
+        record.postings.swap(postings.bytes);
+        if (!sink(record)) {
+            return false;
+        }
+    }
+    decltype(trigram_block_)().swap(trigram_block_);
+    return true;
+}
+
+// Filter: kleine Bitsets, sortiert nach Art und Wert zwischen den Wörtern und den Trigrammen
+bool IndexBuilder::write_filters(const std::function<bool(TermRecord&)>& sink) {
+    for (size_t kind = 0; kind < filters_.size(); ++kind) {
+        std::vector<const std::string*> values;
+        for (const auto& entry : filters_[kind]) {
+            values.push_back(&entry.first);
+        }
+        std::sort(values.begin(), values.end(), [](const std::string* a, const std::string* b) { return *a < *b; });
+
+        TermRecord record;
+        record.tag = static_cast<uint8_t>(TermRecord::filter_tag + kind);
+        for (const std::string* value : values) {
+            record.term = *value;
+            encode_documents(filters_[kind].at(*value), record);
+            if (!sink(record)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// k-way Merge: aus jedem Run liegt nur der aktuelle Record im Speicher
+// Ohne Runs (alles passte ins Budget) kommen die Records direkt aus dem Block
+bool IndexBuilder::merge(const std::function<bool(TermRecord&)>& sink) {
+    stats_.peak_memory_bytes = std::max(stats_.peak_memory_bytes, block_bytes_);
+    stats_.terms = 0;
+
+    if (!runs_.empty()) {
+        flush();
+    }
+    if (!error_.empty()) {
+        return false;
+    }
+
+    if (runs_.empty()) {
+        TermRecord record;
+        for (size_t f = 0; f < field_count; ++f) {
+            Block& block = block_[f];
+            record.tag = static_cast<uint8_t>(f);
+            for (uint32_t id : sorted_terms(block)) {
+                BlockTerm& term = block.terms[id];
+                record.term.assign(block.text(term));
+                record.count = term.postings.count;
+                record.last_doc = term.postings.last_doc;
+                record.postings.swap(term.postings.bytes);
+                ++stats_.terms;
+                if (!sink(record)) {
+                    return false;
+                }
+            }
+            block = Block();
+        }
+        if (!write_filters(sink) || !write_trigrams(sink)) {
+            return false;
+        }
+        block_bytes_ = 0;
+    } else {
+        std::vector<BinaryReader> readers(runs_.size());
+        std::vector<RunCursor> cursors(runs_.size());
+        std::priority_queue<RunCursor*, std::vector<RunCursor*>, LaterCursor> heap;
+        for (size_t i = 0; i < runs_.size(); ++i) {
+            cursors[i].run = i;
+            if (!readers[i].open(runs_[i])) {
+                error_ = "cannot open " + runs_[i].string();
+                return false;
+            }
+            if (read_record(readers[i], cursors[i].record)) {
+                heap.push(&cursors[i]);
+            }
+        }
+
+        TermRecord merged;
+        bool filters_written = false;
+        while (!heap.empty()) {
+            // alle Records mit demselben Wort einsammeln, in Run Reihenfolge = aufsteigende Dokumente
+            RunCursor* top = heap.top();
+            heap.pop();
+            merged = std::move(top->record);
+            if (read_record(readers[top->run], top->record)) {
+                heap.push(top);
+            }
+            while (!heap.empty() && heap.top()->record.tag == merged.tag && heap.top()->record.term == merged.term) {
+                RunCursor* next = heap.top();
+                heap.pop();
+                if (!append_record(merged, next->record)) {
+                    error_ = "runs overlap for term '" + merged.term + "'";
+                    return false;
+                }
+                if (read_record(readers[next->run], next->record)) {
+                    heap.push(next);
+                }
+            }
+            if (merged.is_trigram() && !filters_written) {
+                filters_written = true;
+                if (!write_filters(sink)) {
+                    return false;
+                }
+            }
+            if (!merged.is_trigram()) {
+                ++stats_.terms;
+            }
+            if (!sink(merged)) {
+                return false;
+            }
+        }
+        if (!filters_written && !write_filters(sink)) {
+            return false;
+        }
+        for (size_t i = 0; i < readers.size(); ++i) {
+            if (!readers[i].ok()) {
+                error_ = runs_[i].string() + " is damaged";
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+bool IndexBuilder::finish(InvertedIndex& index, std::string* error) {
+    index.clear();
+    bool ok = merge([this, &index](TermRecord& record) {
+        if (record.is_filter()) {
+            DocIdSet docs;
+            if (!decode_documents(record, docs)) {
+                error_ = "damaged filter '" + record.term + "'";
+                return false;
+            }
+            index.set_filter(static_cast<FilterKind>(record.tag - TermRecord::filter_tag), record.term, std::move(docs));
+            return true;
+        }
+        if (record.is_trigram()) {
+            DocIdSet docs;
+            if (!decode_documents(record, docs)) {
+                error_ = "damaged trigram postings";
+                return false;
+            }
+            docs.shrink_to_fit();
+            const std::string& bytes = record.term;
+            index.set_trigram(trigram_key(bytes[0], bytes[1], bytes[2]), std::move(docs));
+            return true;
+        }
+        PostingList postings;
+        if (!decode_postings(record, postings)) {
+            error_ = "damaged postings of '" + record.term + "'";
+            return false;
+        }
+        postings.shrink_to_fit();
+        index.set_postings(record.term, static_cast<Field>(record.tag), std::move(postings));
+        return true;
+    });
+    remove_runs();
+    if (!ok) {
+        if (error) *error = error_;
+        index.clear();
+        return false;
+    }
+    index.shrink_to_fit();
+    return true;
+}
+
+bool IndexBuilder::write(const std::filesystem::path& index_file, std::string* error) {
+    BinaryWriter out;
+    if (!out.open(index_file)) {
+        if (error) *error = "cannot create " + index_file.string();
+        remove_runs();
+        return false;
+    }
+    out.put_varint(index_file_magic);
+    out.put_varint(index_file_version);
+    bool ok = merge([&out](TermRecord& record) {
+        write_record(out, record);
+        return out.ok();
+    });
+    out.put_byte(TermRecord::end_tag);
+    remove_runs();
+    if (!out.close() && ok) {
+        error_ = "cannot write " + index_file.string() + " (disk full?)";
+        ok = false;
+    }
+    if (!ok && error) {
+        *error = error_.empty() ? "cannot write " + index_file.string() : error_;
+    }
+    return ok;
+}
+
+void IndexBuilder::remove_runs() noexcept {
+    std::error_code ec;
+    for (const auto& run : runs_) {
+        std::filesystem::remove(run, ec);
+    }
+    runs_.clear();
+    if (owns_work_dir_) {
+        std::filesystem::remove(work_dir_, ec);  // nur wenn leer
+    }
+}
+
+} // namespace notesearch
@@ -0,0 +1,96 @@
+#include "index_file.hpp"
+
+namespace notesearch {
+
+void write_record(BinaryWriter& out, const TermRecord& record) {
+    out.put_byte(record.tag);
+    out.put_string(record.term);
+    out.put_varint(record.count);
+    out.put_varint(record.last_doc);
+    out.put_string(record.postings);
+}
+
+bool read_record(BinaryReader& in, TermRecord& record) {
+    if (!in.get_byte(record.tag) || record.tag == TermRecord::end_tag) {
+        return false;
+    }
+    return in.get_string(record.term) && in.get_varint(record.count) && in.get_varint(record.last_doc) &&
+           in.get_string(record.postings);
+}
+
+// Hängt die Postings eines späteren Runs an: nur die erste Lücke (dort noch ab 0 gezählt)
+// muss neu kodiert werden, der Rest wird unverändert kopiert
+bool append_record(TermRecord& record, const TermRecord& other) {
+    if (record.count == 0) {
+        record = other;
+        return true;
+    }
+    if (other.count == 0) {
+        return true;
+    }
+    size_t pos = 0;
+    uint64_t first_doc = 0;
+    if (!read_varint(other.postings, pos, first_doc) || first_doc <= record.last_doc) {
+        return false;  // Runs müssen aufsteigende, disjunkte Dokumente haben
+    }
+    append_varint(record.postings, first_doc - record.last_doc);
+    record.postings.append(other.postings, pos, std::string::npos);
+    record.count += other.count;
+    record.last_doc = other.last_doc;
+    return true;
+}
+
+void encode_postings(const PostingList& postings, TermRecord& record) {
+    record.count = postings.size();
+    record.last_doc = postings.size() ? postings.docs().max() : 0;
+    record.postings.clear();
+    uint32_t previous = 0;
+    postings.for_each([&record, &previous](uint32_t doc_id, uint32_t term_freq) {
+        append_varint(record.postings, doc_id - previous);
+        append_varint(record.postings, term_freq);
+        previous = doc_id;
+    });
+}
+
+void encode_documents(const DocIdSet& docs, TermRecord& record) {
+    record.count = docs.size();
+    record.last_doc = docs.empty() ? 0 : docs.max();
+    record.postings.clear();
+    uint32_t previous = 0;
+    docs.for_each([&record, &previous](uint32_t doc_id) {
+        append_varint(record.postings, doc_id - previous);
+        previous = doc_id;
+    });
+}
+
+bool decode_postings(const TermRecord& record, PostingList& postings) {
+    size_t pos = 0;
+    uint64_t doc = 0;
+    for (uint64_t i = 0; i < record.count; ++i) {
+        uint64_t gap = 0;
+        uint64_t term_freq = 0;
+        if (!read_varint(record.postings, pos, gap) || !read_varint(record.postings, pos, term_freq) ||
+            (i > 0 && gap == 0) || doc + gap > UINT32_MAX) {
+            return false;
+        }
+        doc += gap;
+        postings.add(static_cast<uint32_t>(doc), static_cast<uint32_t>(term_freq));
+    }
+    return pos == record.postings.size();
+}
+
+bool decode_documents(const TermRecord& record, DocIdSet& docs) {
+    size_t pos = 0;
+    uint64_t doc = 0;
+    for (uint64_t i = 0; i < record.count; ++i) {
+        uint64_t gap = 0;
+        if (!read_varint(record.postings, pos, gap) || (i > 0 && gap == 0) || doc + gap > UINT32_MAX) {
+            return false;
+        }
+        doc += gap;
+        docs.add(static_cast<uint32_t>(doc));
+    }
+    return pos == record.postings.size();
+}
+
+} // namespace notesearch
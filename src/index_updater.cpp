@@ -0,0 +1,294 @@
+#include "index_updater.hpp"
+#include "index_file.hpp"
+#include "file_indexer.hpp"
+#include <algorithm>
+
+namespace notesearch {
+
+namespace {
+
+std::filesystem::path temp_path(const std::filesystem::path& path) {
+    std::filesystem::path temp = path;
+    temp += ".tmp";
+    return temp;
+}
+
+} // namespace
+
+bool IndexUpdater::open(const std::filesystem::path& index_dir, std::string* error) {
+    // bis das Objekt verschwindet: kein zweites Update, kein Leser mitten im Laden
+    if (!lock_.lock(index_dir / lock_file_name, true, error)) {
+        return false;
+    }
+    read_only_ = false;
+    std::vector<LogRecord> records;
+    size_t first = 0;
+    bool checkpointed = false;
+    if (!read_log(index_dir, records, first, checkpointed, error)) {
+        return false;
+    }
+
+    // Ohne Checkpoint sind übrig gebliebene .tmp Dateien ein abgebrochener Versuch
+    for (const char* name : {index_file_name, documents_file_name}) {
+        std::filesystem::path file = dir_ / name;
+        std::error_code ec;
+        if (!std::filesystem::exists(temp_path(file), ec)) {
+            continue;
+        }
+        if (checkpointed) {
+            std::filesystem::rename(temp_path(file), file, ec);
+        } else {
+            std::filesystem::remove(temp_path(file), ec);
+        }
+        if (ec || (checkpointed && !sync_directory(dir_))) {
+            if (error) *error = "cannot recover " + file.string() + (ec ? ": " + ec.message() : "");
+            return false;
+        }
+    }
+
+    if (!doc_store_.load(dir_ / documents_file_name, dir_ / content_file_name, error) ||
+        !index_.load(dir_ / index_file_name, error)) {
+        return false;
+    }
+
+    replay(records, first);
+    if (replayed_ == 0 && checkpointed) {
+        return log_.reset(records.back().blob_offset, error);  // Checkpoint fertig, der Log fängt neu an
+    }
+    return true;
+}
+
+bool IndexUpdater::load(const std::filesystem::path& index_dir, std::string* error) {
+    // nur solange geladen wird: ein Update dazwischen könnte den Snapshot unter uns austauschen
+    IndexLock lock;
+    if (!lock.lock(index_dir / lock_file_name, false, error)) {
+        return false;
+    }
+    read_only_ = true;
+    std::vector<LogRecord> records;
+    size_t first = 0;
+    bool checkpointed = false;
+    if (!read_log(index_dir, records, first, checkpointed, error)) {
+        return false;
+    }
+
+    // Checkpoint geloggt, aber nicht umbenannt: der neue Snapshot steht noch in den .tmp Dateien
+    auto snapshot = [&](const char* name) {
+        std::filesystem::path file = dir_ / name;
+        std::error_code ec;
+        return checkpointed && std::filesystem::exists(temp_path(file), ec) ? temp_path(file) : file;
+    };
+    if (!doc_store_.load(snapshot(documents_file_name), dir_ / content_file_name, error, true) ||
+        !index_.load(snapshot(index_file_name), error)) {
+        return false;
+    }
+    replay(records, first);
+    return true;
+}
+
+// Vor dem letzten Checkpoint Record steht alles im neuen Snapshot, vielleicht fehlt nur noch das
+// Umbenennen der .tmp Dateien
+bool IndexUpdater::read_log(const std::filesystem::path& index_dir, std::vector<LogRecord>& records, size_t& first,
+                            bool& checkpointed, std::string* error) {
+    dir_ = index_dir;
+    replayed_ = 0;
+    logged_ = 0;
+    live_paths_.clear();
+    paths_loaded_ = false;
+    if (!log_.open(dir_ / update_log_file_name, records, error)) {
+        return false;
+    }
+    first = records.empty() ? 0 : 1;  // records[0] ist der Start Record
+    checkpointed = false;
+    for (size_t i = 0; i < records.size(); ++i) {
+        if (records[i].type == LogRecord::Type::checkpoint) {
+            first = i + 1;
+            checkpointed = true;
+        }
+    }
+    return true;
+}
+
+// nur die Änderungen seit dem Snapshot
+void IndexUpdater::replay(const std::vector<LogRecord>& records, size_t first) {
+    for (size_t i = first; i < records.size(); ++i) {
+        apply(records[i]);
+    }
+    replayed_ = logged_ = records.size() - first;
+    if (replayed_ > 0) {
+        index_.shrink_to_fit();  // Lexikon für Präfix Suchen neu sortieren
+    }
+}
+
+bool IndexUpdater::add_document(const std::filesystem::path& file_path, std::string_view content,
+                                const std::filesystem::path& root, int64_t modified_time, std::string* error) {
+    LogRecord record;
+    record.type = LogRecord::Type::add;
+    record.root = root.string();
+    record.path = file_path.string();
+    record.content = std::string(content);
+    record.modified_time = modified_time;
+    record.blob_offset = doc_store_.content_bytes();  // dort landet der Inhalt gleich
+    if (!log(record, error)) {
+        return false;
+    }
+    apply(record);
+    return true;
+}
+
+bool IndexUpdater::remove_document(const std::filesystem::path& file_path, std::string* error) {
+    if (!contains(file_path)) {
+        if (error) *error = file_path.string() + " is not in the index";
+        return false;
+    }
+    LogRecord record;
+    record.type = LogRecord::Type::remove;
+    record.path = file_path.string();
+    if (!log(record, error)) {
+        return false;
+    }
+    apply(record);
+    return true;
+}
+
+bool IndexUpdater::contains(const std::filesystem::path& file_path) {
+    load_paths();
+    return live_paths_.count(path_key(file_path)) > 0;
+}
+
+bool IndexUpdater::unchanged(const std::filesystem::path& file_path, int64_t modified_time, uint64_t size) {
+    load_paths();
+    auto it = live_paths_.find(path_key(file_path));
+    if (it == live_paths_.end() || modified_time == 0) {
+        return false;
+    }
+    const MetadataColumns& metadata = doc_store_.metadata();
+    return metadata.get(MetadataField::modified, it->second) == modified_time &&
+           static_cast<uint64_t>(metadata.get(MetadataField::size, it->second)) == size;
+}
+
+std::vector<std::string> IndexUpdater::paths_under(const std::filesystem::path& directory) {
+    load_paths();
+    // mit abschließendem "/", sonst gehörte "notes2/a.md" zu "notes"; "." ist alles
+    std::string prefix = path_key(directory);
+    if (prefix == ".") {
+        prefix.clear();
+    } else if (!prefix.empty() && prefix.back() != '/') {
+        prefix += '/';
+    }
+    std::vector<std::string> paths;
+    for (const auto& [key, doc_id] : live_paths_) {
+        if (key.compare(0, prefix.size(), prefix) == 0) {
+            paths.push_back(key);
+        }
+    }
+    std::sort(paths.begin(), paths.end());  // Log und Ausgabe in fester Reihenfolge
+    return paths;
+}
+
+bool IndexUpdater::commit(std::string* error) {
+    return log_.sync(error);
+}
+
+bool IndexUpdater::checkpoint(std::string* error) {
+    if (read_only_) {
+        if (error) *error = dir_.string() + " was loaded read-only";
+        return false;
+    }
+    if (logged_ == 0) {
+        return true;  // Snapshot ist aktuell
+    }
+    std::filesystem::path index_file = dir_ / index_file_name;
+    std::filesystem::path documents_file = dir_ / documents_file_name;
+    if (!index_.save(temp_path(index_file), error) || !doc_store_.save(temp_path(documents_file), error)) {
+        return false;
+    }
+    // der neue Snapshot muss auf der Platte sein, bevor der Log ihn für gültig erklärt
+    if (!sync_file(temp_path(index_file)) || !sync_file(temp_path(documents_file)) ||
+        !sync_file(dir_ / content_file_name)) {
+        if (error) *error = "cannot sync the snapshot in " + dir_.string();
+        return false;
+    }
+
+    LogRecord record;
+    record.type = LogRecord::Type::checkpoint;
+    record.blob_offset = doc_store_.content_bytes();
+    if (!log_.append(record, error) || !log_.sync(error)) {
+        return false;
+    }
+
+    // ab hier beendet ein Absturz den Checkpoint beim nächsten open()
+    std::error_code ec;
+    std::filesystem::rename(temp_path(index_file), index_file, ec);
+    if (!ec) {
+        std::filesystem::rename(temp_path(documents_file), documents_file, ec);
+    }
+    if (ec || !sync_directory(dir_)) {
+        if (error) *error = "cannot replace the snapshot in " + dir_.string();
+        return false;
+    }
+    if (!log_.reset(record.blob_offset, error)) {
+        return false;
+    }
+    logged_ = 0;
+    return true;
+}
+
+bool IndexUpdater::log(const LogRecord& record, std::string* error) {
+    if (read_only_) {
+        if (error) *error = dir_.string() + " was loaded read-only";
+        return false;
+    }
+    // erste Änderung seit dem Snapshot: der Log beginnt mit der Blob Größe des Snapshots
+    if (log_.empty() && !log_.reset(doc_store_.content_bytes(), error)) {
+        return false;
+    }
+    if (!log_.append(record, error)) {
+        return false;
+    }
+    ++logged_;
+    return true;
+}
+
+// Genau wie beim Indexieren (add_file), Replay geht denselben Weg und kommt zum selben Ergebnis
+void IndexUpdater::apply(const LogRecord& record) {
+    if (record.type != LogRecord::Type::add && record.type != LogRecord::Type::remove) {
+        return;
+    }
+    load_paths();
+    std::string key = path_key(record.path);
+    remove_path(key);
+    if (record.type != LogRecord::Type::add) {
+        return;
+    }
+
+    live_paths_[key] = add_file(doc_store_, index_, terms_, record.path, record.content, record.root,
+                                record.modified_time, record.blob_offset);
+}
+
+void IndexUpdater::remove_path(const std::string& key) {
+    auto it = live_paths_.find(key);
+    if (it != live_paths_.end()) {
+        remove_file(doc_store_, index_, terms_, it->second);
+        live_paths_.erase(it);
+    }
+}
+
+void IndexUpdater::load_paths() {
+    if (paths_loaded_) {
+        return;
+    }
+    for (const auto& doc : doc_store_.get_all_documents()) {
+        if (!doc_store_.is_deleted(doc.id)) {
+            live_paths_[path_key(doc.path)] = doc.id;  // bei gleichem Pfad gewinnt das spätere
+        }
+    }
+    paths_loaded_ = true;
+}
+
+// "./notes/a.md" und "notes/a.md" sind dasselbe Dokument
+std::string IndexUpdater::path_key(const std::filesystem::path& file_path) {
+    return file_path.lexically_normal().generic_string();
+}
+
+} // namespace notesearch
@@ -0,0 +1,376 @@
+#include "json.hpp"
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+
+namespace notesearch {
+
+namespace {
+
+// Rekursiver Parser für JSON (RFC 8259)
+// pos_ zeigt immer auf das nächste ungelesene Zeichen
+class JsonParser {
+public:
+    explicit JsonParser(std::string_view text) : text_(text) {}
+
+    bool parse_document(JsonValue& out) {
+        skip_whitespace();
+        if (!parse_value(out, 0)) {
+            return false;
+        }
+        skip_whitespace();
+        return pos_ == text_.size();  // nach dem Wert darf nichts mehr kommen
+    }
+
+private:
+    static constexpr int max_depth = 64;  // schützt vor Stack Overflow bei bösartigem Input
+
+    std::string_view text_;
+    size_t pos_ = 0;
+
+    void skip_whitespace() {
+        while (pos_ < text_.size() &&
+               (text_[pos_] == ' ' || text_[pos_] == '\t' || text_[pos_] == '\n' || text_[pos_] == '\r')) {
+            ++pos_;
+        }
+    }
+
+    bool consume(char expected) {
+        if (pos_ < text_.size() && text_[pos_] == expected) {
+            ++pos_;
+            return true;
+        }
+        return false;
+    }
+
+    bool consume_literal(std::string_view literal) {
+        if (text_.substr(pos_, literal.size()) == literal) {
+            pos_ += literal.size();
+            return true;
+        }
+        return false;
+    }
+
+    bool parse_value(JsonValue& out, int depth) {
+        if (depth > max_depth || pos_ >= text_.size()) {
+            return false;
+        }
+
+        char c = text_[pos_];
+        if (c == '{') {
+            return parse_object(out, depth);
+        }
+        if (c == '[') {
+            return parse_array(out, depth);
+        }
+        if (c == '"') {
+            std::string value;
+            if (!parse_string(value)) {
+                return false;
+            }
+            out = JsonValue(std::move(value));
+            return true;
+        }
+        if (consume_literal("true")) {
+            out = JsonValue(true);
+            return true;
+        }
+        if (consume_literal("false")) {
+            out = JsonValue(false);
+            return true;
+        }
+        if (consume_literal("null")) {
+            out = JsonValue();
+            return true;
+        }
+        return parse_number(out);
+    }
+
+    bool parse_object(JsonValue& out, int depth) {
+        ++pos_;  // '{'
+        JsonValue::Object object;
+        skip_whitespace();
+        if (consume('}')) {
+            out = JsonValue(std::move(object));
+            return true;
+        }
+
+        while (true) {
+            skip_whitespace();
+            std::string key;
+            if (!parse_string(key)) {
+                return false;
+            }
+            skip_whitespace();
+            if (!consume(':')) {
+                return false;
+            }
+            skip_whitespace();
+            JsonValue value;
+            if (!parse_value(value, depth + 1)) {
+                return false;
+            }
+            object[std::move(key)] = std::move(value);
+            skip_whitespace();
+            if (consume('}')) {
+                break;
+            }
+            if (!consume(',')) {
+                return false;
+            }
+        }
+
+        out = JsonValue(std::move(object));
+        return true;
+    }
+
+    bool parse_array(JsonValue& out, int depth) {
+        ++pos_;  // '['
+        JsonValue::Array array;
+        skip_whitespace();
+        if (consume(']')) {
+            out = JsonValue(std::move(array));
+            return true;
+        }
+
+        while (true) {
+            skip_whitespace();
+            JsonValue value;
+            if (!parse_value(value, depth + 1)) {
+                return false;
+            }
+            array.push_back(std::move(value));
+            skip_whitespace();
+            if (consume(']')) {
+                break;
+            }
+            if (!consume(',')) {
+                return false;
+            }
+        }
+
+        out = JsonValue(std::move(array));
+        return true;
+    }
+
+    bool parse_hex4(uint32_t& code) {
+        if (pos_ + 4 > text_.size()) {
+            return false;
+        }
+        code = 0;
+        for (int i = 0; i < 4; ++i) {
+            char c = text_[pos_++];
+            code <<= 4;
+            if (c >= '0' && c <= '9') code |= static_cast<uint32_t>(c - '0');
+            else if (c >= 'a' && c <= 'f') code |= static_cast<uint32_t>(c - 'a' + 10);
+            else if (c >= 'A' && c <= 'F') code |= static_cast<uint32_t>(c - 'A' + 10);
+            else return false;
+        }
+        return true;
+    }
+
+    static void append_utf8(std::string& out, uint32_t code) {
+        if (code < 0x80) {
+            out += static_cast<char>(code);
+        } else if (code < 0x800) {
+            out += static_cast<char>(0xC0 | (code >> 6));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        } else if (code < 0x10000) {
+            out += static_cast<char>(0xE0 | (code >> 12));
+            out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        } else {
+            out += static_cast<char>(0xF0 | (code >> 18));
+            out += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        }
+    }
+
+    bool parse_string(std::string& out) {
+        if (!consume('"')) {
+            return false;
+        }
+
+        while (pos_ < text_.size()) {
+            char c = text_[pos_++];
+            if (c == '"') {
+                return true;
+            }
+            if (static_cast<unsigned char>(c) < 0x20) {
+                return false;  // Steuerzeichen müssen escaped sein
+            }
+            if (c != '\\') {
+                out += c;
+                continue;
+            }
+
+            if (pos_ >= text_.size()) {
+                return false;
+            }
+            char escape = text_[pos_++];
+            switch (escape) {
+                case '"': out += '"'; break;
+                case '\\': out += '\\'; break;
+                case '/': out += '/'; break;
+                case 'b': out += '\b'; break;
+                case 'f': out += '\f'; break;
+                case 'n': out += '\n'; break;
+                case 'r': out += '\r'; break;
+                case 't': out += '\t'; break;
+                case 'u': {
+                    uint32_t code = 0;
+                    if (!parse_hex4(code)) {
+                        return false;
+                    }
+                    // Surrogate Paar (Zeichen außerhalb der BMP)
+                    if (code >= 0xD800 && code <= 0xDBFF) {
+                        uint32_t low = 0;
+                        if (!consume('\\') || !consume('u') || !parse_hex4(low) ||
+                            low < 0xDC00 || low > 0xDFFF) {
+                            return false;
+                        }
+                        code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                    }
+                    append_utf8(out, code);
+                    break;
+                }
+                default:
+                    return false;
+            }
+        }
+        return false;  // String nicht geschlossen
+    }
+
+    bool parse_number(JsonValue& out) {
+        size_t start = pos_;
+        consume('-');
+        if (pos_ >= text_.size() || !std::isdigit(static_cast<unsigned char>(text_[pos_]))) {
+            return false;
+        }
+        while (pos_ < text_.size()) {
+            char c = text_[pos_];
+            if (std::isdigit(static_cast<unsigned char>(c)) || c == '.' || c == 'e' || c == 'E' ||
+                c == '+' || c == '-') {
+                ++pos_;
+            } else {
+                break;
+            }
+        }
+
+        // strtod braucht einen nullterminierten String
+        std::string number(text_.substr(start, pos_ - start));
+        char* end = nullptr;
+        double value = std::strtod(number.c_str(), &end);
+        if (end != number.c_str() + number.size()) {
+            return false;
+        }
+        out = JsonValue(value);
+        return true;
+    }
+};
+
+void dump_value(const JsonValue& value, std::string& out) {
+    switch (value.type()) {
+        case JsonValue::Type::Null:
+            out += "null";
+            break;
+        case JsonValue::Type::Bool:
+            out += value.as_bool() ? "true" : "false";
+            break;
+        case JsonValue::Type::Number: {
+            double number = value.as_number();
+            if (!std::isfinite(number)) {
+                out += "null";  // JSON kennt kein NaN / Infinity
+                break;
+            }
+            // kürzeste Darstellung die beim Zurücklesen denselben Wert ergibt
+            char buffer[32];
+            std::snprintf(buffer, sizeof(buffer), "%.15g", number);
+            if (std::strtod(buffer, nullptr) != number) {
+                std::snprintf(buffer, sizeof(buffer), "%.17g", number);
+            }
+            out += buffer;
+            break;
+        }
+        case JsonValue::Type::String:
+            json_append_string(out, value.as_string());
+            break;
+        case JsonValue::Type::Array: {
+            out += '[';
+            bool first = true;
+            for (const auto& element : value.as_array()) {
+                if (!first) out += ',';
+                first = false;
+                dump_value(element, out);
+            }
+            out += ']';
+            break;
+        }
+        case JsonValue::Type::Object: {
+            out += '{';
+            bool first = true;
+            for (const auto& member : value.as_object()) {
+                if (!first) out += ',';
+                first = false;
+                json_append_string(out, member.first);
+                out += ':';
+                dump_value(member.second, out);
+            }
+            out += '}';
+            break;
+        }
+    }
+}
+
+} // namespace
+
+const JsonValue* JsonValue::find(const std::string& key) const {
+    if (type_ != Type::Object) {
+        return nullptr;
+    }
+    auto it = object_.find(key);
+    return it != object_.end() ? &it->second : nullptr;
+}
+
+std::string JsonValue::dump() const {
+    std::string out;
+    dump_value(*this, out);
+    return out;
+}
+
+std::optional<JsonValue> JsonValue::parse(std::string_view text) {
+    JsonValue value;
+    JsonParser parser(text);
+    if (!parser.parse_document(value)) {
+        return std::nullopt;
+    }
+    return value;
+}
+
+void json_append_string(std::string& out, std::string_view value) {
+    static const char hex[] = "0123456789abcdef";
+    out += '"';
+    for (char c : value) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    out += "\\u00";
+                    out += hex[(c >> 4) & 0xF];
+                    out += hex[c & 0xF];
+                } else {
+                    out += c;
+                }
+        }
+    }
+    out += '"';
+}
+
+} // namespace notesearch
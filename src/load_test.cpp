@@ -0,0 +1,247 @@
+#include "load_test.hpp"
+#include "json.hpp"
+#include "net.hpp"
+#include "server.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <thread>
+
+namespace notesearch {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr size_t zipf_vocabulary = 10000;  // so viele der häufigsten Wörter kommen in Frage
+
+// eine Verbindung pro Client, wird vom LoadClient (kopierbar) geteilt
+struct ServerConnection {
+    ShardAddress address;
+    socket_t sock = invalid_socket;
+    std::string buffer;  // Bytes nach der letzten Antwort
+
+    ~ServerConnection() { close_socket(sock); }
+
+    bool exchange(const std::string& request, std::string& response) {
+        if (sock == invalid_socket) {
+            sock = address.unix_socket_path.empty() ? connect_tcp(address.tcp_port)
+                                                    : connect_unix(address.unix_socket_path);
+            buffer.clear();
+        }
+        if (sock != invalid_socket && send_all(sock, request + "\n") && recv_line(sock, buffer, response)) {
+            return true;
+        }
+        close_socket(sock);  // beim nächsten Request neu verbinden
+        sock = invalid_socket;
+        return false;
+    }
+};
+
+// Latenz beim Anteil q (0..1) der aufsteigend sortierten Werte
+double percentile(const std::vector<double>& sorted, double q) {
+    if (sorted.empty()) {
+        return 0.0;
+    }
+    size_t rank = static_cast<size_t>(std::ceil(q * static_cast<double>(sorted.size())));
+    return sorted[std::min(sorted.size(), std::max<size_t>(rank, 1)) - 1];
+}
+
+} // namespace
+
+LoadClient engine_load_client(const SearchEngine& engine) {
+    return [&engine](const std::string& request, std::string& response) {
+        response = handle_query_request(engine, request);
+        return true;
+    };
+}
+
+LoadClient server_load_client(const ShardAddress& address) {
+    auto connection = std::make_shared<ServerConnection>();
+    connection->address = address;
+    return [connection](const std::string& request, std::string& response) {
+        return connection->exchange(request, response);
+    };
+}
+
+bool load_query_log(const std::filesystem::path& path, std::vector<std::string>& queries, std::string* error) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        if (error) *error = "cannot open " + path.string();
+        return false;
+    }
+    std::string line;
+    while (std::getline(in, line)) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (line.find_first_not_of(" \t") == std::string::npos) {
+            continue;
+        }
+        // mitgeschnittene Server Requests: nur die Query zählt
+        if (line[0] == '{') {
+            auto request = JsonValue::parse(line);
+            const JsonValue* query = request && request->is_object() ? request->find("q") : nullptr;
+            if (query && query->is_string()) {
+                queries.push_back(query->as_string());
+                continue;
+            }
+        }
+        queries.push_back(line);
+    }
+    return true;
+}
+
+std::vector<std::string> zipf_queries(const InvertedIndex& index, size_t count, double exponent, uint64_t seed) {
+    // Wörter nach Document Frequency, die häufigsten vorne
+    std::vector<LexiconEntry> entries = index.terms_with_prefix("", Field::content);
+    size_t vocabulary = std::min(entries.size(), zipf_vocabulary);
+    std::partial_sort(entries.begin(), entries.begin() + vocabulary, entries.end(),
+                      [](const LexiconEntry& a, const LexiconEntry& b) {
+                          return a.postings->size() != b.postings->size() ? a.postings->size() > b.postings->size()
+                                                                          : *a.term < *b.term;
+                      });
+    if (vocabulary == 0) {
+        return {};
+    }
+
+    // Rang r hat Gewicht 1 / r^exponent, gezogen über die kumulierten Gewichte
+    std::vector<double> cumulative(vocabulary);
+    double sum = 0.0;
+    for (size_t r = 0; r < vocabulary; ++r) {
+        sum += 1.0 / std::pow(static_cast<double>(r + 1), exponent);
+        cumulative[r] = sum;
+    }
+    std::mt19937_64 random(seed);
+    std::uniform_real_distribution<double> uniform(0.0, sum);
+    std::discrete_distribution<int> term_count({50, 35, 15});  // 1, 2 oder 3 Wörter pro Query
+
+    std::vector<std::string> queries;
+    queries.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        std::string query;
+        int terms = term_count(random) + 1;
+        for (int t = 0; t < terms; ++t) {
+            size_t rank = static_cast<size_t>(std::lower_bound(cumulative.begin(), cumulative.end(), uniform(random)) -
+                                              cumulative.begin());
+            if (!query.empty()) {
+                query += ' ';
+            }
+            query += *entries[std::min(rank, vocabulary - 1)].term;
+        }
+        queries.push_back(std::move(query));
+    }
+    return queries;
+}
+
+LoadTestResult run_load_test(const std::vector<std::string>& queries,
+                             const std::function<LoadClient()>& make_client, size_t concurrency,
+                             const LoadTestConfig& config) {
+    LoadTestResult result;
+    result.concurrency = concurrency;
+    if (queries.empty() || concurrency == 0) {
+        return result;
+    }
+
+    // Requests vorbereiten, pro Query nur noch die id davor
+    std::vector<std::string> request_tails;
+    request_tails.reserve(queries.size());
+    for (const auto& query : queries) {
+        std::string tail = ",\"q\":";
+        json_append_string(tail, query);
+        tail += ",\"k\":" + std::to_string(config.max_results);
+        if (config.budget_ms > 0.0) {
+            tail += ",\"budget_ms\":" + JsonValue(config.budget_ms).dump();
+        }
+        tail += "}";
+        request_tails.push_back(std::move(tail));
+    }
+
+    auto to_duration = [](double seconds) {
+        return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+    };
+    // Clients verbinden sich erst, dann geht es für alle gleichzeitig los
+    Clock::time_point start = Clock::now() + std::chrono::milliseconds(50);
+    Clock::time_point measure_from = start + to_duration(config.warmup_s);
+    Clock::time_point end = measure_from + to_duration(config.duration_s);
+
+    std::atomic<size_t> next{0};
+    std::vector<std::vector<double>> latencies(concurrency);
+    std::vector<size_t> errors(concurrency, 0);
+    std::vector<size_t> incomplete(concurrency, 0);
+    std::vector<std::thread> threads;
+    threads.reserve(concurrency);
+    for (size_t c = 0; c < concurrency; ++c) {
+        threads.emplace_back([&, c]() {
+            LoadClient client = make_client();
+            std::this_thread::sleep_until(start);
+            std::string request;
+            std::string response;
+            while (true) {
+                size_t n = next++;
+                Clock::time_point due;
+                if (config.arrival_rate > 0.0) {
+                    // offene Schleife: fester Takt, Latenz zählt ab dem Zeitpunkt an dem die Query fällig war
+                    due = start + to_duration(static_cast<double>(n) / config.arrival_rate);
+                    if (due >= end) {
+                        break;
+                    }
+                    std::this_thread::sleep_until(due);
+                } else {
+                    due = Clock::now();
+                    if (due >= end) {
+                        break;
+                    }
+                }
+
+                request = "{\"id\":" + std::to_string(n) + request_tails[n % request_tails.size()];
+                bool ok = client(request, response);
+                // Fehler Antworten beginnen mit id und "error" (handle_query_request)
+                std::string error_prefix = "{\"id\":" + std::to_string(n) + ",\"error\":";
+                ok = ok && response.compare(0, error_prefix.size(), error_prefix) != 0;
+                Clock::time_point done = Clock::now();
+                if (due < measure_from) {
+                    continue;
+                }
+                if (ok) {
+                    latencies[c].push_back(std::chrono::duration<double, std::milli>(done - due).count());
+                    incomplete[c] += response.find(",\"incomplete\":true") != std::string::npos;
+                } else {
+                    ++errors[c];
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    std::vector<double> all;
+    for (size_t c = 0; c < concurrency; ++c) {
+        all.insert(all.end(), latencies[c].begin(), latencies[c].end());
+        result.errors += errors[c];
+        result.incomplete += incomplete[c];
+    }
+    std::sort(all.begin(), all.end());
+    result.queries = all.size();
+    result.qps = config.duration_s > 0.0 ? static_cast<double>(all.size()) / config.duration_s : 0.0;
+    if (!all.empty()) {
+        double sum = 0.0;
+        for (double latency : all) {
+            sum += latency;
+        }
+        result.mean_ms = sum / static_cast<double>(all.size());
+        result.p50_ms = percentile(all, 0.50);
+        result.p95_ms = percentile(all, 0.95);
+        result.p99_ms = percentile(all, 0.99);
+        result.p999_ms = percentile(all, 0.999);
+        result.max_ms = all.back();
+    }
+    return result;
+}
+
+} // namespace notesearch
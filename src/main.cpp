@@ -1,36 +1,349 @@
+#include <algorithm>
+#include <csignal>
+#include <cstdlib>
+#include <functional>
 #include <iostream>
 #include <string>
 #include <vector>
 #include <chrono>
 #include <iomanip>
 #include <filesystem>
+#include <map>
+#include <unordered_set>
+#include <atomic>
+#include <thread>
+#include "cache_warmer.hpp"
 #include "tokenizer.hpp"
 #include "file_scanner.hpp"
+#include "file_reader.hpp"
 #include "document_store.hpp"
+#include "file_indexer.hpp"
 #include "index.hpp"
+#include "doc_order.hpp"
+#include "index_builder.hpp"
+#include "index_file.hpp"
+#include "index_updater.hpp"
+#include "load_test.hpp"
 #include "search.hpp"
+#include "server.hpp"
+#include "shard.hpp"
+#include "util.hpp"
 
 // command line interface logik
 namespace notesearch {
 
+// für den Signal Handler im serve mode
+QueryServer* g_server = nullptr;
+
+void handle_stop_signal(int) {
+    if (g_server) {
+        g_server->stop();
+    }
+}
+
 void print_usage(const char* program_name) { // das stern hier ist asterisk pointer (const char* program_name)
     std::cout << "NoteSearch - Local Full-Text Search Engine\n\n";
     std::cout << "Usage:\n";  // akzeptiert 3 commands.. index, search, interactive
-    std::cout << "  " << program_name << " index <directory>    Index a directory\n";
-    std::cout << "  " << program_name << " search <query>       Search the index\n";
-    std::cout << "  " << program_name << " interactive          Interactive search mode\n";
+    std::cout << "  " << program_name << " index <directory> [--out <dir>]  Index a directory (and save the index)\n";
+    std::cout << "  " << program_name << " update <directory> <path>... --index <dir>  Re-index changed files, drop deleted ones\n";
+    std::cout << "  " << program_name << " search <query> [directory]       Search the index\n";
+    std::cout << "  " << program_name << " interactive [directory]          Interactive search mode\n";
+    std::cout << "  " << program_name << " stats <directory>                Index a directory and print a memory report\n";
+    std::cout << "  " << program_name << " serve <directory>                Keep the index resident and answer JSON queries\n";
+    std::cout << "  " << program_name << " coordinate --shards <a,b,...>    Answer JSON queries by fanning out to shard servers\n";
+    std::cout << "  " << program_name << " loadtest [directory]             Replay queries at rising concurrency, report QPS and latency\n";
     std::cout << "\n";
+    std::cout << "Options:\n";
+    std::cout << "  --explain          Print per-query execution stats (terms, candidates, timings)\n";
+    std::cout << "  --page <n>         search: show result page n (10 per page)\n";
+    std::cout << "  --out <dir>        index: save the index to a directory\n";
+    std::cout << "  --index <dir>      search, interactive, stats, serve: load a saved index instead of a directory\n";
+    std::cout << "  --checkpoint <MB>  update: write a new snapshot once the update log is this large (default 64)\n";
+    std::cout << "  --memory-budget <MB>  index: memory for postings before they are flushed to disk (default 256)\n";
+    std::cout << "  --order <order>    scan (default), path or bisect: reassign document IDs after indexing\n";
+    std::cout << "  --socket <path>    serve: listen on a Unix domain socket\n";
+    std::cout << "  --port <port>      serve: listen on 127.0.0.1:<port> (default 7700)\n";
+    std::cout << "  --threads <n>      serve: number of query worker threads\n";
+    std::cout << "  --budget <ms>      search, serve, coordinate, loadtest: time per query, then return partial results\n";
+    std::cout << "  --warmup <MB>      serve, interactive with --index: read ahead content of hot terms at start (default 256, 0 = off)\n";
+    std::cout << "  --shard <i>/<n>    index, serve: index only shard i of n (0-based) of the directory\n";
+    std::cout << "  --shards <list>    coordinate: shard ports or socket paths, comma separated\n";
+    std::cout << "  --server <addr>    loadtest: send queries to a server (port or socket path) instead of in-process\n";
+    std::cout << "  --queries <file>   loadtest: query log, one query per line (default: synthetic Zipfian queries)\n";
+    std::cout << "  --concurrency <list>  loadtest: client counts, comma separated (default 1,2,4,8)\n";
+    std::cout << "  --rate <qps>       loadtest: fixed arrival rate instead of closed-loop clients\n";
+    std::cout << "  --duration <s>     loadtest: measured seconds per concurrency level (default 10)\n";
+    std::cout << "\n";
+    std::cout << "Query syntax:\n";
+    std::cout << "  ext:<ext> dir:<name>   Only files with this extension / under this directory\n";
+    std::cout << "  mtime:>7d size:<100k   Only files modified in the last 7 days / smaller than 100 KB (< <= > >=)\n";
+    std::cout << "  mtime:2024-03-01       Only files modified on that day\n";
+    std::cout << "  recent:<half-life>     Rank newer files higher, e.g. recent:7d\n";
+    std::cout << "  re:<regex>             Lines matching an ECMAScript regex, (?i) ignores case\n";
+    std::cout << "  lit:<text>             Lines containing the exact text\n";
+    std::cout << "\n";
+}
+
+// Optionen für den Aufbau eines Index (--shard, --memory-budget, --order)
+struct BuildOptions {
+    FileScanner::ScanOptions scan;
+    size_t memory_budget = IndexBuilder::default_memory_budget;
+    DocOrder order = DocOrder::scan;
+};
+
+// liest --shard i/n, --memory-budget <MB> und --order, false bei ungültigen Werten (Meldung schon ausgegeben)
+bool parse_build_options(std::map<std::string, std::string>& options, BuildOptions& build) {
+    if (!options["shard"].empty()) {
+        const std::string& shard = options["shard"];
+        // genau ein "/", jede seite höchstens 4 ziffern (sonst wirft stoul)
+        size_t slash = shard.find('/');
+        bool valid = slash != std::string::npos && slash > 0 && slash <= 4 && slash + 1 < shard.size() &&
+                     shard.size() - slash - 1 <= 4 && shard.find('/', slash + 1) == std::string::npos &&
+                     shard.find_first_not_of("0123456789/") == std::string::npos;
+        if (valid) {
+            build.scan.shard_index = std::stoul(shard.substr(0, slash));
+            build.scan.shard_count = std::stoul(shard.substr(slash + 1));
+        }
+        if (!valid || build.scan.shard_count == 0 || build.scan.shard_index >= build.scan.shard_count) {
+            std::cerr << "Falsch: --shard erwartet <i>/<n> mit i < n, zb. 0/4\n";
+            return false;
+        }
+    }
+    if (!options["memory-budget"].empty()) {
+        const std::string& budget = options["memory-budget"];
+        if (budget.empty() || budget.size() > 7 || budget.find_first_not_of("0123456789") != std::string::npos ||
+            std::stoul(budget) == 0) {
+            std::cerr << "Falsch: --memory-budget erwartet eine Zahl in MB\n";
+            return false;
+        }
+        build.memory_budget = std::stoul(budget) << 20;
+    }
+    if (!options["order"].empty() && !parse_doc_order(options["order"], build.order)) {
+        std::cerr << "Falsch: --order erwartet scan, path oder bisect\n";
+        return false;
+    }
+    return true;
+}
+
+// liest --port und --threads für serve und coordinate, false bei ungültigen werten (meldung schon ausgegeben)
+bool parse_server_options(std::map<std::string, std::string>& options, ServerConfig& config) {
+    if (!options["port"].empty()) {
+        const std::string& port = options["port"];
+        ShardAddress address;  // prüft den bereich 1..65535, nicht-ziffern wären dort ein socket pfad
+        if (port.find_first_not_of("0123456789") != std::string::npos || !ShardAddress::parse(port, address)) {
+            std::cerr << "Falsch: --port erwartet eine Zahl von 1 bis 65535\n";
+            return false;
+        }
+        config.tcp_port = address.tcp_port;
+    }
+    if (!options["threads"].empty()) {
+        const std::string& threads = options["threads"];
+        if (threads.size() > 4 || threads.find_first_not_of("0123456789") != std::string::npos ||
+            std::stoul(threads) == 0) {
+            std::cerr << "Falsch: --threads erwartet eine Zahl ab 1\n";
+            return false;
+        }
+        config.worker_threads = std::stoul(threads);
+    }
+    return true;
+}
+
+// liest --budget <ms> (zeit pro query, 0 = ohne grenze), false bei ungültigem wert (meldung schon ausgegeben)
+bool parse_budget(std::map<std::string, std::string>& options, double& budget_ms) {
+    budget_ms = 0.0;
+    if (options["budget"].empty()) {
+        return true;
+    }
+    char* end = nullptr;
+    budget_ms = std::strtod(options["budget"].c_str(), &end);
+    if (*end != '\0' || !(budget_ms > 0.0)) {
+        std::cerr << "Falsch: --budget erwartet eine positive Zahl in ms\n";
+        return false;
+    }
+    return true;
+}
+
+// scannt ein Verzeichnis und baut Index + DocumentStore neu auf
+// build.scan.shard_count > 1: nur der Anteil eines Shards
+// Postings gehen durch den IndexBuilder: über dem Budget werden sie als sortierte Runs ausgelagert
+bool build_index(const std::filesystem::path& dir_path, DocumentStore& doc_store, InvertedIndex& index,
+                 const BuildOptions& build = BuildOptions{}) {
+    doc_store.clear();
+    index.clear();
+    
+    // Dateien werden gestreamt: Store und Tokenizer lesen direkt aus dem Lese Puffer bzw. Mapping
+    // Exakte Kopien werden nur über ihren Pfad indexiert, der Inhalt steckt schon im Index
+    // Wörter werden in einem Durchgang gezählt (TermCounter, wiederverwendet), ohne Token Strings
+    IndexBuilder builder(build.memory_budget);
+    TermCounter terms;
+    FileScanner scanner(build.scan);
+    scanner.scan_directory(dir_path, [&](const std::filesystem::path& file_path, FileContent& content) {
+        add_file(doc_store, builder, terms, file_path, content.view(), dir_path, content.modified_time());
+    });
+    
+    std::string error;
+    if (!builder.finish(index, &error)) {
+        std::cerr << "Falsch: Index konnte nicht gebaut werden: " << error << "\n";
+        return false;
+    }
+    reorder_documents(index, doc_store, build.order);
+    return true;
+}
+
+// lädt einen mit "index --out" gespeicherten Index, dazu die Änderungen seit dem letzten Snapshot ("update"),
+// nur lesend: ein update das gleichzeitig läuft wird nicht gestört
+bool load_index(const std::filesystem::path& index_dir, DocumentStore& doc_store, InvertedIndex& index) {
+    std::string error;
+    IndexUpdater updater(doc_store, index);
+    if (!updater.load(index_dir, &error)) {
+        std::cerr << "Falsch: Index konnte nicht geladen werden: " << error << "\n";
+        return false;
+    }
+    if (updater.replayed_changes() > 0) {
+        std::cout << "Replayed " << updater.replayed_changes() << " changes from the update log\n";
+    }
+    return true;
 }
 
-void print_results(const std::vector<SearchResult>& results) {
+// --index <dir> lädt einen gespeicherten Index, sonst wird directory (falls angegeben) indexiert
+bool prepare_index(std::map<std::string, std::string>& options, const std::string* directory,
+                   DocumentStore& doc_store, InvertedIndex& index, const BuildOptions& build = BuildOptions{}) {
+    if (!options["index"].empty()) {
+        return load_index(options["index"], doc_store, index);
+    }
+    if (directory) {
+        return build_index(*directory, doc_store, index, build);
+    }
+    return true;
+}
+
+// cache warming für einen gespeicherten index: die queries zählen ihre wörter (HotTerms), beim nächsten start
+// wird der inhalt der top treffer der heißesten wörter im hintergrund vorgelesen, beim beenden gespeichert
+struct CacheWarming {
+    HotTerms hot_terms;
+    std::filesystem::path file;   // leer: kein --index, nichts zu tun
+    std::atomic<bool> stop{false};
+    std::thread thread;
+    
+    ~CacheWarming() {
+        stop = true;
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+    
+    // lädt hot_terms.bin und startet den warm-up thread, false bei ungültigem --warmup
+    bool start(std::map<std::string, std::string>& options, const InvertedIndex& index,
+               const DocumentStore& doc_store, bool report) {
+        if (options["index"].empty()) {
+            return true;
+        }
+        WarmupOptions warmup;
+        if (!options["warmup"].empty()) {
+            const std::string& megabytes = options["warmup"];
+            if (megabytes.size() > 7 || megabytes.find_first_not_of("0123456789") != std::string::npos) {
+                std::cerr << "Falsch: --warmup erwartet eine Zahl in MB\n";
+                return false;
+            }
+            warmup.max_bytes = static_cast<uint64_t>(std::stoul(megabytes)) << 20;
+        }
+        file = std::filesystem::path(options["index"]) / hot_terms_file_name;
+        std::string error;
+        if (!hot_terms.load(file, &error)) {
+            std::cerr << "Hot terms ignored: " << error << "\n";
+        }
+        if (warmup.max_bytes == 0 || hot_terms.size() == 0) {
+            return true;
+        }
+        if (report) {
+            std::cout << "Warming caches for the " << std::min(warmup.max_terms, hot_terms.size())
+                      << " hottest terms in the background\n";
+        }
+        thread = std::thread([this, &index, &doc_store, warmup, report]() {
+            WarmupStats stats = warm_cache(index, doc_store, hot_terms, warmup, &stop);
+            if (report && !stats.stopped) {
+                std::cout << "Cache warm-up: " << stats.terms << " terms, " << stats.documents << " documents, "
+                          << (stats.bytes >> 10) << " KB read ahead in " << static_cast<long>(stats.elapsed_ms)
+                          << " ms\n" << std::flush;
+            }
+        });
+        return true;
+    }
+    
+    // warm-up abbrechen und die zähler für den nächsten start speichern
+    void finish() {
+        stop = true;
+        if (thread.joinable()) {
+            thread.join();
+        }
+        std::string error;
+        if (!file.empty() && !hot_terms.save(file, &error)) {
+            std::cerr << "Hot terms not saved: " << error << "\n";
+        }
+    }
+};
+
+// gibt die SearchStats einer Query aus (--explain)
+void print_stats(const SearchStats& stats) {
+    std::cout << "Query plan:\n";
+    for (const auto& term : stats.terms) {
+        std::cout << "  term '" << term.term << "'  df=" << term.document_frequency << "\n";
+    }
+    
+    if (stats.filtered) {
+        std::cout << "  filter matches: " << stats.filter_matches << "\n";
+    }
+    for (const auto& pattern : stats.patterns) {
+        std::cout << "  pattern '" << pattern.pattern << "'  trigrams " << pattern.trigram_query
+                  << "  matches=" << pattern.trigram_matches << "\n";
+    }
+    std::cout << "  postings scanned: " << stats.postings_scanned << "\n";
+    std::cout << "  candidates:";
+    for (size_t i = 0; i < stats.candidate_sizes.size(); ++i) {
+        std::cout << (i == 0 ? " " : " -> ") << stats.candidate_sizes[i];
+    }
+    std::cout << "\n";
+    if (!stats.patterns.empty()) {
+        std::cout << "  docs verified: " << stats.docs_verified << "\n";
+    }
+    std::cout << "  docs scored: " << stats.docs_scored << "\n";
+    if (stats.incomplete) {
+        std::cout << "  incomplete: time budget exceeded\n";
+    }
+    if (stats.collapsed > 0) {
+        std::cout << "  near-duplicates collapsed: " << stats.collapsed << "\n";
+    }
+    // arena blocks > 0 nur bei den ersten (oder ungewöhnlich großen) queries eines threads
+    std::cout << "  query arena: " << stats.arena_bytes << " bytes, " << stats.arena_blocks << " new blocks\n";
+    
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "  tokenize:  " << stats.tokenize_ms << " ms\n";
+    std::cout << "  intersect: " << stats.intersect_ms << " ms\n";
+    if (!stats.patterns.empty()) {
+        std::cout << "  verify:    " << stats.verify_ms << " ms\n";
+    }
+    std::cout << "  score:     " << stats.score_ms << " ms\n";
+    std::cout << "  sort:      " << stats.sort_ms << " ms\n";
+    std::cout << "  snippet:   " << stats.snippet_ms << " ms\n";
+    std::cout << "  total:     " << stats.total_ms() << " ms\n\n";
+}
+
+constexpr size_t page_size = 10;  // ergebnisse pro seite (search, interactive)
+
+// first = wie viele ergebnisse auf früheren seiten schon gezeigt wurden
+void print_results(const std::vector<SearchResult>& results, size_t first = 0) {
     // print_results ist eine freie Funktion (keine member funktion), member funktionen sind funktionen die zu einer klasse gehören und auf objekte der klasse zugreifen können
 
     if (results.empty()) {
-        std::cout << "No results found.\n";
+        std::cout << (first == 0 ? "No results found.\n" : "No more results.\n");
         return;
     }
     
-    std::cout << "\nFound " << results.size() << " result(s):\n\n";
+    if (first == 0) {
+        std::cout << "\nFound " << results.size() << " result(s):\n\n";
+    } else {
+        std::cout << "\nResults " << (first + 1) << "-" << (first + results.size()) << ":\n\n";
+    }
     
     // iteriert über alle Suchergebnisse
     for (size_t i = 0; i < results.size(); ++i) { 
@@ -39,7 +352,7 @@ void print_results(const std::vector<SearchResult>& results) {
         const auto& result = results[i]; 
         // const auto& = konstante Referenz auf SearchResult Objekt (wichtig ->> keine Kopie)
         
-        std::cout << "[" << (i + 1) << "] " << result.path << "\n";
+        std::cout << "[" << (first + i + 1) << "] " << result.path << "\n";
         
         // Score = TF-IDF Relevanz-Wert (nicht nur Häufigkeit!)
         // TF IDF = (Term Frequency) × (Inverse Document Frequency)
@@ -50,13 +363,76 @@ void print_results(const std::vector<SearchResult>& results) {
         if (!result.snippet.empty()) {
             std::cout << "    " << result.snippet << "\n";
         }
+        
+        // gleiche Datei an anderen Orten, und wie viele fast gleiche Treffer zusammengefasst wurden
+        for (const auto& copy : result.copies) {
+            std::cout << "    also at: " << copy << "\n";
+        }
+        if (result.collapsed > 0) {
+            std::cout << "    (+" << result.collapsed << " similar)\n";
+        }
         std::cout << "\n";
     }
 }
 
-void interactive_mode(DocumentStore& doc_store, InvertedIndex& index) { // diese parameter sind referenzen auf die document store und index, weil wir sie verändern wollen
-    std::cout << "Entering interactive mode. Type 'quit' or 'exit' to exit.\n\n";
+// gibt den Speicherverbrauch von Index und Store aus (stats command)
+void print_memory_report(const DocumentStore& doc_store, const InvertedIndex& index) {
+    IndexMemoryStats index_mem = index.memory_usage();
+    StoreMemoryStats store_mem = doc_store.memory_usage();
+    
+    auto row = [](const char* label, size_t bytes) {
+        std::cout << "  " << std::left << std::setw(20) << label << std::right 
+                  << std::setw(12) << bytes << "  (" << format_bytes(bytes) << ")\n";
+    };
+    
+    std::cout << "\nInverted index (" << index.vocabulary_size() << " terms):\n";
+    row("dictionary keys", index_mem.dictionary_keys);
+    row("hash table", index_mem.hash_table);
+    row("hash entries", index_mem.hash_entries);
+    row("posting payload", index_mem.posting_payload);
+    row("posting slack", index_mem.posting_slack);
+    row("filter bitsets", index_mem.filter_bitsets);
+    row("lexicon", index_mem.lexicon);
+    row("trigram sets", index_mem.trigram_sets);
+    row("total", index_mem.total());
+    
+    std::cout << "\nDocument store (" << doc_store.size() << " documents):\n";
+    row("document slots", store_mem.document_slots);
+    row("vector slack", store_mem.vector_slack);
+    row("paths", store_mem.path_bytes);
+    row("tombstones", store_mem.tombstones);
+    row("dedup tables", store_mem.dedup_tables);
+    row("metadata columns", store_mem.metadata_columns);
+    row("total", store_mem.total());
+    row("content (raw)", store_mem.content_raw_bytes);
+    row("content (blob)", store_mem.content_stored_bytes);
     
+    // Histogramm der Posting Listen Längen (Zweierpotenz Buckets)
+    std::vector<size_t> histogram = index.posting_length_histogram();
+    size_t max_count = 0;
+    for (size_t count : histogram) {
+        max_count = std::max(max_count, count);
+    }
+    
+    std::cout << "\nPosting list lengths:\n";
+    for (size_t i = 0; i < histogram.size(); ++i) {
+        size_t low = size_t{1} << i;
+        size_t high = (size_t{1} << (i + 1)) - 1;
+        std::string range = (low == high) ? std::to_string(low) 
+                                          : std::to_string(low) + "-" + std::to_string(high);
+        size_t bar = max_count ? (histogram[i] * 40 + max_count - 1) / max_count : 0;
+        std::cout << "  " << std::setw(15) << range << " " << std::setw(9) << histogram[i] 
+                  << " " << std::string(bar, '#') << "\n";
+    }
+    std::cout << "\n";
+}
+
+void interactive_mode(DocumentStore& doc_store, InvertedIndex& index, bool explain, HotTerms* hot_terms = nullptr) { // diese parameter sind referenzen auf die document store und index, weil wir sie verändern wollen
+    std::cout << "Entering interactive mode. Type 'more' for the next page, 'quit' or 'exit' to exit.\n\n";
+    
+    SearchEngine engine(index, doc_store);
+    engine.set_hot_terms(hot_terms);
+    SearchCursor cursor;  // rangliste der letzten query, 'more' holt daraus die nächste seite ohne neue suche
     std::string query;
     while (true) {
         std::cout << "search> ";
@@ -75,14 +451,32 @@ void interactive_mode(DocumentStore& doc_store, InvertedIndex& index) { // diese
             continue;
         }
         
-        SearchEngine engine(index, doc_store);
+        std::string query_error;
+        if (!SearchEngine::check_query(query, &query_error)) {
+            std::cout << "Error: " << query_error << "\n";
+            continue;
+        }
+        
+        if (query == "more" || query == "m") {
+            // snippets nur für die neue seite, parallel weil jedes seinen inhalt dekomprimiert
+            size_t first = cursor.returned();
+            print_results(engine.results(cursor.next(page_size), cursor, true), first);
+            continue;
+        }
+        
+        SearchStats stats;
         auto start = std::chrono::high_resolution_clock::now();
-        auto results = engine.search(query, 10); // 10 ist max anzahl an ergebnissen die zurückgegeben werden sollen
+        cursor = engine.execute(query, explain ? &stats : nullptr);
+        auto results = engine.results(cursor.next(page_size, explain ? &stats : nullptr), cursor, true,
+                                      explain ? &stats : nullptr); // erste seite, page_size ergebnisse
         auto end = std::chrono::high_resolution_clock::now();
         
         auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
         
         print_results(results);
+        if (explain) {
+            print_stats(stats);
+        }
         std::cout << "Search completed in " << duration.count() << " ms\n\n";
     }
 }
@@ -99,90 +493,555 @@ int main(int argc, char* argv[]) {
     
     std::string command = argv[1];
     
-    // static .. would be better to save/load but this works for now
-    // das heisst index lebt so lange wie das programm läuft (also im memory)
+    // flags (--explain) und optionen mit wert (--port 7700) von den positionalen argumenten trennen
+    bool explain = false;
+    std::vector<std::string> args;
+    std::map<std::string, std::string> options;
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--explain") {
+            explain = true;
+        } else if (arg.rfind("--", 0) == 0 && i + 1 < argc) {
+            options[arg.substr(2)] = argv[++i];
+        } else {
+            args.push_back(std::move(arg));
+        }
+    }
+    
+    // index lebt so lange wie das programm läuft (also im memory)
+    // "index --out <dir>" speichert ihn, "--index <dir>" lädt ihn wieder statt neu zu scannen
     static DocumentStore doc_store;
     static InvertedIndex index;
     
+    BuildOptions build;
+    if (!parse_build_options(options, build)) {
+        return 1;
+    }
+    
     if (command == "index") {
-        if (argc < 3) { // argc ist die anzahl der argumente die an das programm übergeben werden
+        if (args.empty()) { // args sind die positionalen argumente nach dem command
             std::cerr << "Falsch: Bitte einen Pfad zu einem Verzeichnis eingeben!!.\n";
             return 1; // return 1 ist ein fehlercode
         }
         
-        std::filesystem::path dir_path = argv[2]; // std::filesystem::path ist ein objekt der klasse std::filesystem::path,
-        // argv[2] ist der zweite argument der an das programm übergeben wird
+        std::filesystem::path dir_path = args[0]; // std::filesystem::path ist ein objekt der klasse std::filesystem::path,
+        // args[0] ist das erste argument nach dem command
+        
+        std::filesystem::path out_dir = options["out"];  // leer: nur im speicher indexieren
         
         std::cout << "Scanning directory: " << dir_path << "\n";
         auto start = std::chrono::high_resolution_clock::now(); // startet die zeitmessung durch std::chrono::high_resolution_clock::now(), diese gibt die aktuelle zeit in nanosekunden zurück
         
-        FileScanner scanner; // scanner ist ein objekt der klasse FileScanner
-        auto files = scanner.scan_directory(dir_path); // scanner.scan_directory(dir_path) gibt alle indexierbaren dateien im verzeichnis aus
-        
-        std::cout << "Found " << files.size() << " indexable files.\n"; // gibt die anzahl der indexierbaren dateien aus
-        std::cout << "Indexing...\n";
-        
         doc_store.clear();
         index.clear(); // clear ist technisch eine member function der klasse InvertedIndex, die alle postings (dateien die das wort enthalten) und die term frequency entfernt
         
-        // Jede Datei im Verzeichnis wird verarbeitet
-        for (const auto& file_pair : files) { 
-            // const auto& = Referenz (keine Kopie), file_pair ist ein Paar (Pfad, Inhalt)
-            
-            const auto& file_path = file_pair.first;   // erstes Teil .. Dateipfad
-            const auto& content = file_pair.second;     // zweites Teil .. Dateiinhalt 
-            
-            // weist dem doku eine eindeutige id zu also zb (0, 1, 2...)
-            uint32_t doc_id = doc_store.add_document(file_path, content);
-            
-            // zerlegt text in normalisierte Wörter .. lowercase, min. 2 Zeichen..
-            // zb: "Hallo ich bin Mohammed!" --> ["hello", "ich", "bin", "mohammed"] wie ein array von strings
-            auto tokens = tokenize(content);
+        std::string error;
+        IndexLock out_lock;  // wie ein update: leser warten bis der neue index ganz geschrieben ist
+        if (!out_dir.empty()) {
+            // der komprimierte inhalt landet gleich im index verzeichnis statt in einer temp datei
+            std::error_code ec;
+            std::filesystem::create_directories(out_dir, ec);
+            if (!out_lock.lock(out_dir / lock_file_name, true, &error)) {
+                std::cerr << "Falsch: " << error << "\n";
+                return 1;
+            }
+            std::filesystem::remove(out_dir / update_log_file_name, ec);  // gehört zum alten Snapshot
+            if (!doc_store.create_content(out_dir / content_file_name, &error)) {
+                std::cerr << "Falsch: " << error << "\n";
+                return 1;
+            }
+        }
+        
+        std::cout << "Indexing...\n";
+        
+        // der builder sammelt die postings bis zum speicher budget und lagert sie dann als sortierte runs aus
+        IndexBuilder builder(build.memory_budget);
+        TermCounter terms; // zählt die wörter eines dokuments, wird für jedes dokument wiederverwendet
+        FileScanner scanner(build.scan); // scanner ist ein objekt der klasse FileScanner
+        // scan_directory(dir_path, callback) ruft den callback für jede indexierbare datei auf,
+        // während im hintergrund schon die nächsten dateien gelesen werden
+        scanner.scan_directory(dir_path, [&](const std::filesystem::path& file_path, FileContent& content) {
+            // content ist ein FileContent: view() zeigt direkt auf den gelesenen puffer bzw. das mapping
             
-            // fügt Wörter zum inverted index hinzu (inverted index ist eine datenstruktur die die wörter und die dazugehörigen dateien speichert, mapping also)
-            // Erstellt Mapping... Wort ---->  [Dokumente die dieses Wort enthalten]
-            // zb: "gut" hat die dokumente [doc_id=1, doc_id=3]
-            index.index_document(doc_id, tokens);
+            // weist dem doku eine eindeutige id zu also zb (0, 1, 2...), der inhalt wird komprimiert in den blob geschrieben
+            // dann: wörter zählen, SimHash, wort ----> [dokumente die dieses wort enthalten], trigramme für re: und lit:,
+            // dateiname, verzeichnisse, ext: / dir: filter .. exakte kopien teilen sich den inhalt und kriegen nur den pfad
+            add_file(doc_store, builder, terms, file_path, content.view(), dir_path, content.modified_time());
+        });
+        
+        // runs zusammenführen: in den speicher oder direkt in index.bin
+        // umsortieren braucht den ganzen index im speicher, er wird danach gespeichert
+        bool in_memory = out_dir.empty() || build.order != DocOrder::scan;
+        bool built = in_memory ? builder.finish(index, &error) : builder.write(out_dir / index_file_name, &error);
+        if (built && build.order != DocOrder::scan) {
+            double bits_before = posting_gap_bits(index);
+            auto reorder_start = std::chrono::high_resolution_clock::now();
+            reorder_documents(index, doc_store, build.order);
+            auto reorder_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::high_resolution_clock::now() - reorder_start);
+            std::cout << "Reordered documents by " << options["order"] << ": "
+                      << std::fixed << std::setprecision(2) << bits_before << " -> " << posting_gap_bits(index)
+                      << " bits per posting gap (" << reorder_ms.count() << " ms)\n";
+            if (!out_dir.empty()) {
+                built = index.save(out_dir / index_file_name, &error);
+            }
+        }
+        if (built && !out_dir.empty()) {
+            built = doc_store.save(out_dir / documents_file_name, &error);
+        }
+        if (!built) {
+            std::cerr << "Falsch: Index konnte nicht gebaut werden: " << error << "\n";
+            return 1;
         }
         
+        auto scan_stats = scanner.get_last_scan_stats();
+        std::cout << "Found " << scan_stats.files_indexed << " indexable files ("  // gibt die anzahl der indexierbaren dateien aus
+                  << format_bytes(scan_stats.total_bytes) << ") in " 
+                  << scan_stats.directories_scanned << " directories.\n";
+        std::cout << "Skipped " << scan_stats.directories_ignored << " ignored directories, "
+                  << scan_stats.files_ignored << " ignored files, "
+                  << scan_stats.files_too_large << " too large, "
+                  << scan_stats.files_rejected << " binary/generated/minified.\n";
+
         auto end = std::chrono::high_resolution_clock::now(); // endet die zeitmessung
         auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
         
         std::cout << "\nIndexing complete!\n";
         std::cout << "  Documents indexed: " << doc_store.size() << "\n";
-        std::cout << "  Unique terms: " << index.vocabulary_size() << "\n";
+        std::cout << "  Unique terms: " << builder.stats().terms << "\n";
+        std::cout << "  Runs written: " << builder.stats().runs_written
+                  << " (" << format_bytes(builder.stats().run_bytes) << ", peak block "
+                  << format_bytes(builder.stats().peak_memory_bytes) << ")\n";
+        if (!out_dir.empty()) {
+            std::cout << "  Saved to: " << out_dir << "\n";
+        }
         std::cout << "  Time: " << duration.count() << " ms\n";
         
+    } else if (command == "update") {
+        // update <directory> <pfad>... --index <dir>: directory ist das beim "index" angegebene verzeichnis
+        // geänderte dateien werden neu indexiert, gelöschte entfernt; ein verzeichnis wird neu gescannt,
+        // unveränderte dateien darin (mtime und größe) bleiben stehen, nicht mehr gesehene fliegen raus
+        if (options["index"].empty() || args.size() < 2) {
+            std::cerr << "Falsch: update <directory> <pfad>... --index <dir>\n";
+            return 1;
+        }
+        uint64_t checkpoint_bytes = IndexUpdater::default_checkpoint_bytes;
+        if (!options["checkpoint"].empty()) {
+            const std::string& value = options["checkpoint"];
+            if (value.size() > 7 || value.find_first_not_of("0123456789") != std::string::npos) {
+                std::cerr << "Falsch: --checkpoint erwartet eine Zahl in MB\n";
+                return 1;
+            }
+            checkpoint_bytes = static_cast<uint64_t>(std::stoul(value)) << 20;
+        }
+        
+        std::filesystem::path root = args[0];
+        std::string error;
+        IndexUpdater updater(doc_store, index);
+        updater.set_checkpoint_bytes(checkpoint_bytes);
+        if (!updater.open(options["index"], &error)) {
+            std::cerr << "Falsch: Index konnte nicht geladen werden: " << error << "\n";
+            return 1;
+        }
+        
+        auto start = std::chrono::high_resolution_clock::now();
+        size_t added = 0;
+        size_t replaced = 0;
+        size_t removed = 0;
+        size_t skipped = 0;
+        size_t unchanged = 0;
+        bool failed = false;
+        // jede änderung landet zuerst im update log, dann im index
+        auto add = [&](const std::filesystem::path& file_path, const FileContent& content) {
+            if (updater.unchanged(file_path, content.modified_time(), content.view().size())) {
+                ++unchanged;
+                return;
+            }
+            bool existed = updater.contains(file_path);
+            if (!failed && !updater.add_document(file_path, content.view(), root, content.modified_time(), &error)) {
+                failed = true;
+            }
+            if (!failed) {
+                ++(existed ? replaced : added);
+            }
+        };
+        
+        FileScanner scanner(build.scan);
+        LoadOptions load_options;
+        load_options.max_size = build.scan.max_file_size;
+        load_options.sniff = build.scan.sniff_content;
+        for (size_t i = 1; i < args.size() && !failed; ++i) {
+            std::filesystem::path path = args[i];
+            std::error_code ec;
+            if (std::filesystem::is_directory(path, ec)) {
+                std::unordered_set<std::string> seen;
+                scanner.scan_directory(path, [&](const std::filesystem::path& file_path, FileContent& content) {
+                    seen.insert(IndexUpdater::path_key(file_path));
+                    add(file_path, content);
+                });
+                // was der scan nicht mehr findet ist gelöscht (oder wird jetzt übersprungen)
+                for (const auto& indexed : updater.paths_under(path)) {
+                    if (failed) {
+                        break;
+                    }
+                    if (seen.count(indexed) == 0) {
+                        failed = !updater.remove_document(indexed, &error);
+                        removed += failed ? 0 : 1;
+                    }
+                }
+            } else if (std::filesystem::exists(path, ec)) {
+                FileContent content = load_file(path, load_options);
+                if (content.status() == LoadStatus::ok) {
+                    add(path, content);
+                } else {
+                    std::cerr << "Skipped " << path << " (unreadable, too large or binary)\n";
+                    ++skipped;
+                }
+            } else if (updater.contains(path)) {
+                // datei gibt es nicht mehr: aus dem index nehmen
+                failed = !updater.remove_document(path, &error);
+                removed += failed ? 0 : 1;
+            } else {
+                std::cerr << "Skipped " << path << " (not found and not in the index)\n";
+                ++skipped;
+            }
+        }
+        
+        // ein fsync für alle änderungen, wird der log zu groß gibts einen neuen snapshot
+        bool checkpointed = false;
+        if (!failed) {
+            failed = !updater.commit(&error);
+        }
+        if (!failed && updater.wants_checkpoint()) {
+            failed = !updater.checkpoint(&error);
+            checkpointed = !failed;
+        }
+        if (failed) {
+            std::cerr << "Falsch: Update fehlgeschlagen: " << error << "\n";
+            return 1;
+        }
+        
+        auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::high_resolution_clock::now() - start);
+        std::cout << "Added " << added << ", replaced " << replaced << ", removed " << removed
+                  << ", skipped " << skipped << ", unchanged " << unchanged << " in " << duration.count() << " ms\n";
+        if (checkpointed) {
+            std::cout << "Checkpoint written, update log is empty\n";
+        } else {
+            std::cout << "Update log: " << updater.logged_changes() << " changes ("
+                      << format_bytes(updater.log_bytes()) << ") since the last checkpoint\n";
+        }
+        
     } else if (command == "search") {
-        if (argc < 3) {
+        if (args.empty()) {
             std::cerr << "Falsch: Bitte eine Suchanfrage eingeben!.\n";
             return 1;
         }
         
+        // optionales Verzeichnis: wird vor der Suche indexiert (oder --index <dir> geladen)
+        if (!prepare_index(options, args.size() > 1 ? &args[1] : nullptr, doc_store, index, build)) {
+            return 1;
+        }
+        
         if (doc_store.empty()) {
             std::cerr << "Falsch: Keine Dokumente indexiert. Bitte 'index' kommando zuerst ausführen.\n";
             return 1;
         }
         
-        std::string query = argv[2]; // TODO  i dont understand why argv[2] is the query ?? answer: because the command is "search <query>" ??
+        std::string query = args[0]; // the command is "search <query>", so the query is the first positional argument
+        std::string query_error;
+        if (!SearchEngine::check_query(query, &query_error)) {
+            std::cerr << "Falsch: " << query_error << "\n";
+            return 1;
+        }
+        // --page <n>: die seiten davor werden nur gerankt, ohne snippets
+        size_t page = 1;
+        if (!options["page"].empty()) {
+            const std::string& value = options["page"];
+            if (value.size() > 7 || value.find_first_not_of("0123456789") != std::string::npos ||
+                std::stoul(value) == 0) {
+                std::cerr << "Falsch: --page erwartet eine Zahl ab 1\n";
+                return 1;
+            }
+            page = std::stoul(value);
+        }
+        // --budget <ms>: danach wird abgebrochen und gezeigt was bis dahin gefunden wurde
+        double budget_ms = 0.0;
+        if (!parse_budget(options, budget_ms)) {
+            return 1;
+        }
+        QueryDeadline deadline = budget_ms > 0.0 ? QueryDeadline(budget_ms) : QueryDeadline();
         SearchEngine engine(index, doc_store);
+        SearchStats stats;
+        SearchStats* query_stats = explain ? &stats : nullptr;
         
         auto start = std::chrono::high_resolution_clock::now();
-        auto results = engine.search(query, 10); // 10 is the maximum number of results to return
+        SearchCursor cursor = engine.execute(query, query_stats, nullptr, &deadline);
+        if (page > 1) {
+            cursor.next((page - 1) * page_size);
+        }
+        size_t first = cursor.returned();
+        auto results = engine.results(cursor.next(page_size, query_stats), cursor, true, query_stats);
         auto end = std::chrono::high_resolution_clock::now();
         
         auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
         
-        print_results(results);
+        print_results(results, first);
+        if (explain) {
+            print_stats(stats);
+        }
+        if (!cursor.complete()) {
+            std::cout << "Time budget of " << budget_ms << " ms exceeded, results are partial\n";
+        }
         std::cout << "Search completed in " << duration.count() << " ms\n";
         
     } else if (command == "interactive") {
+        if (!prepare_index(options, args.empty() ? nullptr : &args[0], doc_store, index, build)) {
+            return 1;
+        }
+        
         if (doc_store.empty()) { // doc_store.empty() ist true wenn der document store leer ist
             std::cerr << "Falsch: Keine Dokumente indexiert. Bitte 'index' kommando zuerst ausführen.\n";
             return 1;
         }
         
-        interactive_mode(doc_store, index);
+        CacheWarming warming;
+        if (!warming.start(options, index, doc_store, false)) {
+            return 1;
+        }
+        interactive_mode(doc_store, index, explain, &warming.hot_terms);
+        warming.finish();
+        
+    } else if (command == "stats") {
+        if (args.empty() && options["index"].empty()) {
+            std::cerr << "Falsch: Bitte einen Pfad zu einem Verzeichnis eingeben!!.\n";
+            return 1;
+        }
+        
+        if (!prepare_index(options, args.empty() ? nullptr : &args[0], doc_store, index, build)) {
+            return 1;
+        }
+        print_memory_report(doc_store, index);
+        
+    } else if (command == "serve") {
+        if (args.empty() && options["index"].empty()) {
+            std::cerr << "Falsch: Bitte einen Pfad zu einem Verzeichnis eingeben!!.\n";
+            return 1;
+        }
+        
+        ServerConfig config;
+        config.unix_socket_path = options["socket"];
+        if (!parse_server_options(options, config) || !parse_budget(options, config.query_budget_ms)) {
+            return 1;
+        }
+        
+        // --shard i/n: dieser Prozess ist ein Shard Worker hinter einem Coordinator
+        // (ein gespeicherter Shard kommt aus "index <dir> --shard i/n --out <dir>")
+        std::cout << (options["index"].empty() ? "Indexing " + args[0] : "Loading " + options["index"]);
+        if (build.scan.shard_count > 1) {
+            std::cout << " (shard " << build.scan.shard_index << " of " << build.scan.shard_count << ")";
+        }
+        std::cout << "...\n";
+        if (!prepare_index(options, args.empty() ? nullptr : &args[0], doc_store, index, build)) {
+            return 1;
+        }
+        std::cout << "Indexed " << doc_store.size() << " documents, " 
+                  << index.vocabulary_size() << " unique terms\n";
+        
+        // mit --index: queries zählen, beim start die heißesten vorlesen (läuft neben dem server an)
+        CacheWarming warming;
+        if (!warming.start(options, index, doc_store, true)) {
+            return 1;
+        }
+        config.hot_terms = &warming.hot_terms;
+        QueryServer server(index, doc_store, config);
+        std::string error;
+        if (!server.start(&error)) {
+            std::cerr << "Falsch: Server konnte nicht starten: " << error << "\n";
+            return 1;
+        }
+        
+        // Ctrl+C beendet den Event Loop sauber
+        g_server = &server;
+        std::signal(SIGINT, handle_stop_signal);
+        std::signal(SIGTERM, handle_stop_signal);
+        
+        if (config.unix_socket_path.empty()) {
+            std::cout << "Listening on 127.0.0.1:" << config.tcp_port << "\n";
+        } else {
+            std::cout << "Listening on " << config.unix_socket_path << "\n";
+        }
+        server.run();
+        g_server = nullptr;
+        warming.finish();
+        
+    } else if (command == "coordinate") {
+        // Shards: Ports oder Socket Pfade, kommagetrennt (jeder ein "serve --shard i/n" Prozess)
+        std::vector<ShardAddress> shards;
+        const std::string& list = options["shards"];
+        size_t start = 0;
+        while (start < list.size()) {
+            size_t comma = list.find(',', start);
+            if (comma == std::string::npos) {
+                comma = list.size();
+            }
+            ShardAddress address;
+            if (!ShardAddress::parse(list.substr(start, comma - start), address)) {
+                std::cerr << "Falsch: Ungültige Shard Adresse '" << list.substr(start, comma - start) << "'\n";
+                return 1;
+            }
+            shards.push_back(std::move(address));
+            start = comma + 1;
+        }
+        if (shards.empty()) {
+            std::cerr << "Falsch: Bitte die Shards mit --shards <port,port,...> angeben!!.\n";
+            return 1;
+        }
+        
+        ServerConfig config;
+        config.unix_socket_path = options["socket"];
+        if (!parse_server_options(options, config) || !parse_budget(options, config.query_budget_ms)) {
+            return 1;
+        }
+        
+        // jeder Worker Thread hat eigene Verbindungen zu allen Shards
+        double budget_ms = config.query_budget_ms;
+        QueryServer server([shards, budget_ms]() -> RequestHandler {
+            auto coordinator = std::make_shared<ShardCoordinator>(shards);
+            return [coordinator, budget_ms](std::string_view request) {
+                return coordinator->handle_request(request, budget_ms);
+            };
+        }, config);
+        std::string error;
+        if (!server.start(&error)) {
+            std::cerr << "Falsch: Server konnte nicht starten: " << error << "\n";
+            return 1;
+        }
+        
+        g_server = &server;
+        std::signal(SIGINT, handle_stop_signal);
+        std::signal(SIGTERM, handle_stop_signal);
+        
+        std::cout << "Coordinating " << shards.size() << " shard(s), listening on "
+                  << (config.unix_socket_path.empty() ? "127.0.0.1:" + std::to_string(config.tcp_port)
+                                                      : config.unix_socket_path) << "\n";
+        server.run();
+        g_server = nullptr;
+        
+    } else if (command == "loadtest") {
+        // ziel: in-process (eigener index) oder ein laufender server / coordinator
+        ShardAddress server_address;
+        bool remote = !options["server"].empty();
+        if (remote && !ShardAddress::parse(options["server"], server_address)) {
+            std::cerr << "Falsch: Ungültige Server Adresse '" << options["server"] << "'\n";
+            return 1;
+        }
+        
+        std::vector<size_t> levels;
+        std::string list = options["concurrency"].empty() ? "1,2,4,8" : options["concurrency"];
+        for (size_t start = 0; start < list.size();) {
+            size_t comma = std::min(list.find(',', start), list.size());
+            std::string level = list.substr(start, comma - start);
+            if (level.empty() || level.size() > 4 || level.find_first_not_of("0123456789") != std::string::npos ||
+                std::stoul(level) == 0) {
+                std::cerr << "Falsch: --concurrency erwartet Zahlen wie 1,2,4,8\n";
+                return 1;
+            }
+            levels.push_back(std::stoul(level));
+            start = comma + 1;
+        }
+        
+        LoadTestConfig config;
+        auto parse_seconds = [&options](const char* name, double& value) {
+            if (options[name].empty()) {
+                return true;
+            }
+            char* end = nullptr;
+            value = std::strtod(options[name].c_str(), &end);
+            return *end == '\0' && value > 0.0;
+        };
+        if (!parse_seconds("duration", config.duration_s) || !parse_seconds("rate", config.arrival_rate)) {
+            std::cerr << "Falsch: --duration und --rate erwarten positive Zahlen\n";
+            return 1;
+        }
+        if (!options["k"].empty()) {
+            const std::string& value = options["k"];
+            if (value.size() > 7 || value.find_first_not_of("0123456789") != std::string::npos ||
+                std::stoul(value) == 0) {
+                std::cerr << "Falsch: --k erwartet eine Zahl ab 1\n";
+                return 1;
+            }
+            config.max_results = std::stoul(value);
+        }
+        if (!parse_budget(options, config.budget_ms)) {
+            return 1;
+        }
+        
+        // eigener index: für in-process und für synthetische queries (vokabular)
+        bool local = !args.empty() || !options["index"].empty();
+        if (!remote && !local) {
+            std::cerr << "Falsch: Bitte ein Verzeichnis, --index <dir> oder --server <addr> angeben!!.\n";
+            return 1;
+        }
+        if (local && !prepare_index(options, args.empty() ? nullptr : &args[0], doc_store, index, build)) {
+            return 1;
+        }
+        
+        std::vector<std::string> queries;
+        std::string source;
+        if (!options["queries"].empty()) {
+            std::string error;
+            if (!load_query_log(options["queries"], queries, &error)) {
+                std::cerr << "Falsch: " << error << "\n";
+                return 1;
+            }
+            source = options["queries"];
+        } else if (local) {
+            queries = zipf_queries(index, 10000);
+            source = "synthetic, Zipfian";
+        } else {
+            std::cerr << "Falsch: Ohne eigenen Index bitte --queries <datei> angeben!!.\n";
+            return 1;
+        }
+        if (queries.empty()) {
+            std::cerr << "Falsch: Keine Queries.\n";
+            return 1;
+        }
+        
+        SearchEngine engine(index, doc_store);
+        std::function<LoadClient()> make_client = [&engine]() { return engine_load_client(engine); };
+        if (remote) {
+            make_client = [server_address]() { return server_load_client(server_address); };
+        }
+        
+        std::cout << "Load test: " << queries.size() << " queries (" << source << "), "
+                  << (remote ? "server " + server_address.to_string() : std::string("in-process")) << ", ";
+        if (config.arrival_rate > 0.0) {
+            std::cout << config.arrival_rate << " queries/s";
+        } else {
+            std::cout << "closed loop";
+        }
+        std::cout << ", " << config.duration_s << " s per level\n\n";
+        
+        // latenz in ms, "p99 x" = p99 relativ zur ersten stufe (wie stark die latenz mit der last wächst)
+        std::cout << std::fixed << std::setprecision(2);
+        std::cout << std::setw(8) << "clients" << std::setw(10) << "qps" << std::setw(9) << "mean"
+                  << std::setw(9) << "p50" << std::setw(9) << "p95" << std::setw(9) << "p99"
+                  << std::setw(9) << "p99.9" << std::setw(9) << "max" << std::setw(8) << "p99 x"
+                  << std::setw(8) << "errors" << std::setw(9) << "partial" << "\n";
+        double base_p99 = 0.0;
+        for (size_t level : levels) {
+            LoadTestResult result = run_load_test(queries, make_client, level, config);
+            if (base_p99 == 0.0) {
+                base_p99 = result.p99_ms;
+            }
+            std::cout << std::setw(8) << result.concurrency << std::setw(10) << result.qps
+                      << std::setw(9) << result.mean_ms << std::setw(9) << result.p50_ms
+                      << std::setw(9) << result.p95_ms << std::setw(9) << result.p99_ms
+                      << std::setw(9) << result.p999_ms << std::setw(9) << result.max_ms
+                      << std::setw(8) << (base_p99 > 0.0 ? result.p99_ms / base_p99 : 0.0)
+                      << std::setw(8) << result.errors << std::setw(9) << result.incomplete << "\n";
+        }
         
     } else {
         std::cerr << "Falsch: Unbekanntes kommando '" << command << "'\n\n";
@@ -10,10 +10,12 @@
 #include <sstream>
 #include <iomanip>
 #include <chrono>
+#include <iterator>
 #include <filesystem>
 #include "tokenizer.hpp"
 #include "file_scanner.hpp"
 #include "document_store.hpp"
+#include "file_indexer.hpp"
 #include "index.hpp"
 #include "search.hpp"
 
@@ -22,7 +24,11 @@ using namespace notesearch;
 // global state - TODO: maybe save/load index to file later?
 static DocumentStore g_doc_store;
 static InvertedIndex g_index;
+static SearchEngine g_engine(g_index, g_doc_store);
+static SearchSession g_session(g_engine);  // live search, reuses the work of the previous keystroke
 static std::vector<SearchResult> g_current_results;
+static SearchCursor g_search_cursor;
+static SearchCursor* g_cursor = nullptr;  // ranking behind g_current_results, "More" continues it
 
 // control IDs
 #define ID_SEARCH_EDIT       1001
@@ -31,6 +37,11 @@ static std::vector<SearchResult> g_current_results;
 #define ID_RESULTS_LIST       1004  // not used yet, might add listbox later
 #define ID_STATUS_TEXT        1005
 #define ID_RESULTS_EDIT       1006
+#define ID_MORE_BUTTON        1007
+
+constexpr size_t page_size = 20;
+constexpr double live_budget_ms = 50.0;      // per keystroke, the next one starts over anyway
+constexpr double search_budget_ms = 2000.0;  // search button: a slow regex must not freeze the window
 
 LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam);
 std::wstring StringToWString(const std::string& str);
@@ -39,6 +50,8 @@ void UpdateStatus(HWND hwnd, const std::string& message);
 void DisplayResults(HWND hwnd, const std::vector<SearchResult>& results);
 void IndexDirectory(HWND hwnd, const std::filesystem::path& dir_path);
 void PerformSearch(HWND hwnd, const std::string& query);
+void LiveSearch(HWND hwnd, const std::string& query);
+void ShowMoreResults(HWND hwnd);
 
 int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine, int nCmdShow) {
     // need COM for folder picker dialog
@@ -125,6 +138,12 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
                 10, 100, 100, 20,
                 hwnd, NULL, NULL, NULL);
             
+            // next page of the current results, no new search
+            CreateWindow(L"BUTTON", L"More results",
+                WS_VISIBLE | WS_CHILD | BS_PUSHBUTTON,
+                780, 95, 100, 25,
+                hwnd, (HMENU)ID_MORE_BUTTON, NULL, NULL);
+            
             // results area - edit control works fine, listbox might be better but this is simpler
             HWND hResults = CreateWindow(L"EDIT", L"",
                 WS_VISIBLE | WS_CHILD | WS_BORDER | WS_VSCROLL | WS_HSCROLL | 
@@ -159,6 +178,11 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
                 return 0;
             }
             
+            if (id == ID_MORE_BUTTON) {
+                ShowMoreResults(hwnd);
+                return 0;
+            }
+            
             if (id == ID_INDEX_BUTTON) {
                 // folder picker
                 BROWSEINFO bi = {};
@@ -178,10 +202,13 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
                 return 0;
             }
             
-            // enter key in search box
+            // search as you type
             if (id == ID_SEARCH_EDIT && HIWORD(wParam) == EN_CHANGE) {
-                // could add live search here but not needed
-                // maybe later if I have time
+                HWND hEdit = GetDlgItem(hwnd, ID_SEARCH_EDIT);
+                int length = GetWindowTextLength(hEdit);
+                std::vector<wchar_t> buffer(length + 1);
+                GetWindowText(hEdit, buffer.data(), length + 1);
+                LiveSearch(hwnd, WStringToString(buffer.data()));
             }
             return 0;
         }
@@ -230,6 +257,12 @@ void DisplayResults(HWND hwnd, const std::vector<SearchResult>& results) {
             if (!result.snippet.empty()) {
                 wss << L"    " << StringToWString(result.snippet) << L"\n";
             }
+            for (const auto& copy : result.copies) {
+                wss << L"    also at: " << StringToWString(copy) << L"\n";
+            }
+            if (result.collapsed > 0) {
+                wss << L"    (+" << result.collapsed << L" similar)\n";
+            }
             wss << L"\n";
         }
     }
@@ -244,24 +277,25 @@ void IndexDirectory(HWND hwnd, const std::filesystem::path& dir_path) {
     
     auto start = std::chrono::high_resolution_clock::now();
     
-    FileScanner scanner;
-    auto files = scanner.scan_directory(dir_path);
-    
-    UpdateStatus(hwnd, "Indexing " + std::to_string(files.size()) + " files...");
-    UpdateWindow(hwnd);
-    
     // clear old index
+    g_session.reset();
+    g_search_cursor = SearchCursor{};
+    g_cursor = nullptr;
     g_doc_store.clear();
     g_index.clear();
     
-    // index files
-    for (const auto& file_pair : files) {
-        const auto& file_path = file_pair.first;
-        const auto& content = file_pair.second;
-        uint32_t doc_id = g_doc_store.add_document(file_path, content);
-        auto tokens = tokenize(content);
-        g_index.index_document(doc_id, tokens);
-    }
+    UpdateStatus(hwnd, "Indexing...");
+    UpdateWindow(hwnd);
+    
+    // files are streamed: store and tokenizer read straight from the read buffer / mapping
+    // exact copies are only indexed by path, their content is already in the index
+    // terms counts one document at a time in a single pass and is reused
+    FileScanner scanner;
+    TermCounter terms;
+    scanner.scan_directory(dir_path, [&dir_path, &terms](const std::filesystem::path& file_path, FileContent& content) {
+        add_file(g_doc_store, g_index, terms, file_path, content.view(), dir_path, content.modified_time());
+    });
+    g_index.shrink_to_fit();
     
     auto end = std::chrono::high_resolution_clock::now();
     auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
@@ -292,8 +326,11 @@ void PerformSearch(HWND hwnd, const std::string& query) {
     
     auto start = std::chrono::high_resolution_clock::now();
     
-    SearchEngine engine(g_index, g_doc_store);
-    g_current_results = engine.search(query, 20);  // limit to 20 results
+    // rank once, snippets only for the page that is shown (built in parallel)
+    QueryDeadline deadline(search_budget_ms);
+    g_search_cursor = g_engine.execute(query, nullptr, nullptr, &deadline);
+    g_cursor = &g_search_cursor;
+    g_current_results = g_engine.results(g_cursor->next(page_size), *g_cursor, true);
     
     auto end = std::chrono::high_resolution_clock::now();
     auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
@@ -302,7 +339,51 @@ void PerformSearch(HWND hwnd, const std::string& query) {
     
     std::stringstream ss;
     ss << "Found " << g_current_results.size() << " result(s) in " 
-       << duration.count() << " ms";
+       << duration.count() << " ms" << (g_cursor->complete() ? "" : " (partial, time limit reached)");
+    UpdateStatus(hwnd, ss.str());
+}
+
+void LiveSearch(HWND hwnd, const std::string& query) {
+    if (g_doc_store.empty()) {
+        return;  // no popup while typing, the search button reports it
+    }
+    
+    auto start = std::chrono::high_resolution_clock::now();
+    
+    // the last word is completed as a prefix, e.g. "thread loc" also finds "lock"
+    QueryDeadline deadline(live_budget_ms);
+    g_current_results = g_session.update(query, page_size, nullptr, &deadline);
+    g_cursor = &g_session.cursor();
+    
+    auto end = std::chrono::high_resolution_clock::now();
+    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+    
+    DisplayResults(hwnd, g_current_results);
+    
+    std::stringstream ss;
+    ss << "Found " << g_current_results.size() << " result(s) in " 
+       << duration.count() / 1000.0 << " ms (live" << (g_cursor->complete() ? ")" : ", partial)");
+    UpdateStatus(hwnd, ss.str());
+}
+
+void ShowMoreResults(HWND hwnd) {
+    if (!g_cursor || g_cursor->done()) {
+        UpdateStatus(hwnd, "No more results");
+        return;
+    }
+    
+    auto start = std::chrono::high_resolution_clock::now();
+    auto page = g_engine.results(g_cursor->next(page_size), *g_cursor, true);
+    auto end = std::chrono::high_resolution_clock::now();
+    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+    
+    g_current_results.insert(g_current_results.end(), std::make_move_iterator(page.begin()),
+                             std::make_move_iterator(page.end()));
+    DisplayResults(hwnd, g_current_results);
+    
+    std::stringstream ss;
+    ss << "Showing " << g_current_results.size() << " result(s), next page in "
+       << duration.count() / 1000.0 << " ms";
     UpdateStatus(hwnd, ss.str());
 }
 
@@ -0,0 +1,61 @@
+#include "metadata_columns.hpp"
+#include <memory_resource>
+
+namespace notesearch {
+
+void MetadataColumns::append(int64_t modified, int64_t size) {
+    modified_.push_back(modified);
+    sizes_.push_back(size);
+}
+
+// Spalten Scan: min <= v <= max als ein einziger Vergleich ohne Vorzeichen ((v - min) <= (max - min)),
+// 64 Ergebnisse werden ohne Verzweigung zu einem Wort zusammengeschoben, das vektorisiert der Compiler
+DocIdSet MetadataColumns::match_range(MetadataField field, int64_t min, int64_t max,
+                                      const DocIdSet::allocator_type& allocator) const {
+    DocIdSet result(allocator);
+    if (min > max) {
+        return result;
+    }
+    const std::vector<int64_t>& values = column(field);
+    const uint64_t low = static_cast<uint64_t>(min);
+    const uint64_t span = static_cast<uint64_t>(max) - low;
+
+    std::pmr::vector<uint64_t> words((values.size() + 63) / 64, allocator);
+    size_t full_words = values.size() / 64;
+    for (size_t word = 0; word < full_words; ++word) {
+        const int64_t* block = values.data() + word * 64;
+        uint64_t bits = 0;
+        for (unsigned i = 0; i < 64; ++i) {
+            bits |= static_cast<uint64_t>(static_cast<uint64_t>(block[i]) - low <= span) << i;
+        }
+        words[word] = bits;
+    }
+    for (size_t doc_id = full_words * 64; doc_id < values.size(); ++doc_id) {
+        if (static_cast<uint64_t>(values[doc_id]) - low <= span) {
+            words[doc_id / 64] |= uint64_t{1} << (doc_id % 64);
+        }
+    }
+    result.assign_bits(words.data(), words.size());
+    return result;
+}
+
+void MetadataColumns::remap(const std::vector<uint32_t>& new_ids) {
+    for (auto* values : {&modified_, &sizes_}) {
+        std::vector<int64_t> remapped(values->size());
+        for (size_t old_id = 0; old_id < values->size(); ++old_id) {
+            remapped[new_ids[old_id]] = (*values)[old_id];
+        }
+        values->swap(remapped);
+    }
+}
+
+void MetadataColumns::clear() noexcept {
+    modified_.clear();
+    sizes_.clear();
+}
+
+size_t MetadataColumns::memory_bytes() const noexcept {
+    return (modified_.capacity() + sizes_.capacity()) * sizeof(int64_t);
+}
+
+} // namespace notesearch
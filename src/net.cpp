@@ -0,0 +1,287 @@
+#include "net.hpp"
+#include <cstring>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <afunix.h>   // AF_UNIX, ab Windows 10 1803
+#else
+#include <arpa/inet.h>
+#include <cerrno>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace notesearch {
+
+namespace {
+
+#ifdef _WIN32
+using sockaddr_len_t = int;
+#else
+using sockaddr_len_t = socklen_t;
+#endif
+
+void set_error(std::string* error, const std::string& message) {
+    if (error) {
+        *error = message;
+    }
+}
+
+// Baut eine sockaddr_un, false wenn der Pfad zu lang ist
+bool make_unix_address(const std::string& path, sockaddr_un& address) {
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+        return false;
+    }
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    return true;
+}
+
+sockaddr_in make_loopback_address(uint16_t port) {
+    sockaddr_in address;
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);  // nur localhost, nicht von außen erreichbar
+    return address;
+}
+
+socket_t bind_and_listen(socket_t sock, const sockaddr* address, sockaddr_len_t length, std::string* error) {
+    if (bind(sock, address, length) != 0) {
+        set_error(error, "bind failed");
+        close_socket(sock);
+        return invalid_socket;
+    }
+    if (listen(sock, SOMAXCONN) != 0) {
+        set_error(error, "listen failed");
+        close_socket(sock);
+        return invalid_socket;
+    }
+    return sock;
+}
+
+} // namespace
+
+bool net_init() {
+#ifdef _WIN32
+    static const bool initialized = [] {
+        WSADATA data;
+        return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+    }();
+    return initialized;
+#else
+    return true;
+#endif
+}
+
+void close_socket(socket_t sock) noexcept {
+    if (sock == invalid_socket) {
+        return;
+    }
+#ifdef _WIN32
+    closesocket(static_cast<SOCKET>(sock));
+#else
+    close(sock);
+#endif
+}
+
+bool set_nonblocking(socket_t sock) {
+#ifdef _WIN32
+    u_long mode = 1;
+    return ioctlsocket(static_cast<SOCKET>(sock), FIONBIO, &mode) == 0;
+#else
+    int flags = fcntl(sock, F_GETFL, 0);
+    return flags >= 0 && fcntl(sock, F_SETFL, flags | O_NONBLOCK) == 0;
+#endif
+}
+
+socket_t listen_tcp(uint16_t port, std::string* error) {
+    net_init();
+    socket_t sock = static_cast<socket_t>(socket(AF_INET, SOCK_STREAM, 0));
+    if (sock == invalid_socket) {
+        set_error(error, "socket() failed");
+        return invalid_socket;
+    }
+
+    int reuse = 1;
+    setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuse), sizeof(reuse));
+
+    sockaddr_in address = make_loopback_address(port);
+    return bind_and_listen(sock, reinterpret_cast<const sockaddr*>(&address), sizeof(address), error);
+}
+
+socket_t listen_unix(const std::string& path, std::string* error) {
+    net_init();
+    sockaddr_un address;
+    if (!make_unix_address(path, address)) {
+        set_error(error, "socket path is empty or too long");
+        return invalid_socket;
+    }
+
+    socket_t sock = static_cast<socket_t>(socket(AF_UNIX, SOCK_STREAM, 0));
+    if (sock == invalid_socket) {
+        set_error(error, "socket() failed");
+        return invalid_socket;
+    }
+
+    // alte Socket Datei von einem vorherigen Lauf entfernen, sonst schlägt bind fehl
+#ifdef _WIN32
+    DeleteFileA(path.c_str());
+#else
+    unlink(path.c_str());
+#endif
+    return bind_and_listen(sock, reinterpret_cast<const sockaddr*>(&address), sizeof(address), error);
+}
+
+socket_t accept_connection(socket_t listener) {
+#ifdef _WIN32
+    SOCKET client = accept(static_cast<SOCKET>(listener), nullptr, nullptr);
+    return client == INVALID_SOCKET ? invalid_socket : static_cast<socket_t>(client);
+#else
+    return accept(listener, nullptr, nullptr);
+#endif
+}
+
+socket_t connect_tcp(uint16_t port, std::string* error) {
+    net_init();
+    socket_t sock = static_cast<socket_t>(socket(AF_INET, SOCK_STREAM, 0));
+    if (sock == invalid_socket) {
+        set_error(error, "socket() failed");
+        return invalid_socket;
+    }
+
+    sockaddr_in address = make_loopback_address(port);
+    if (connect(sock, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+        set_error(error, "connect to port " + std::to_string(port) + " failed");
+        close_socket(sock);
+        return invalid_socket;
+    }
+
+    // kleine Request/Response Nachrichten: Nagle würde jede Antwort verzögern
+    int no_delay = 1;
+    setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&no_delay), sizeof(no_delay));
+    return sock;
+}
+
+socket_t connect_unix(const std::string& path, std::string* error) {
+    net_init();
+    sockaddr_un address;
+    if (!make_unix_address(path, address)) {
+        set_error(error, "socket path is empty or too long");
+        return invalid_socket;
+    }
+
+    socket_t sock = static_cast<socket_t>(socket(AF_UNIX, SOCK_STREAM, 0));
+    if (sock == invalid_socket) {
+        set_error(error, "socket() failed");
+        return invalid_socket;
+    }
+    if (connect(sock, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+        set_error(error, "connect to " + path + " failed");
+        close_socket(sock);
+        return invalid_socket;
+    }
+    return sock;
+}
+
+long send_some(socket_t sock, const char* data, size_t size) noexcept {
+#ifdef _WIN32
+    int chunk = size > 0x7fffffff ? 0x7fffffff : static_cast<int>(size);
+    int sent = send(static_cast<SOCKET>(sock), data, chunk, 0);
+    return sent == SOCKET_ERROR ? -1 : sent;
+#else
+    // MSG_NOSIGNAL: kein SIGPIPE wenn der Client die Verbindung schon geschlossen hat
+    ssize_t sent = send(sock, data, size, MSG_NOSIGNAL);
+    return static_cast<long>(sent);
+#endif
+}
+
+long recv_some(socket_t sock, char* buffer, size_t size) noexcept {
+#ifdef _WIN32
+    int chunk = size > 0x7fffffff ? 0x7fffffff : static_cast<int>(size);
+    int received = recv(static_cast<SOCKET>(sock), buffer, chunk, 0);
+    return received == SOCKET_ERROR ? -1 : received;
+#else
+    return static_cast<long>(recv(sock, buffer, size, 0));
+#endif
+}
+
+bool last_error_would_block() noexcept {
+#ifdef _WIN32
+    return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+    return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+#endif
+}
+
+bool make_socket_pair(socket_t pair[2]) {
+    net_init();
+#ifdef _WIN32
+    // Windows hat kein socketpair(): über einen Loopback Listener auf einem freien Port verbinden
+    socket_t listener = listen_tcp(0);
+    if (listener == invalid_socket) {
+        return false;
+    }
+    sockaddr_in address;
+    int length = sizeof(address);
+    if (getsockname(static_cast<SOCKET>(listener), reinterpret_cast<sockaddr*>(&address), &length) != 0) {
+        close_socket(listener);
+        return false;
+    }
+    pair[0] = connect_tcp(ntohs(address.sin_port));
+    pair[1] = pair[0] == invalid_socket ? invalid_socket : accept_connection(listener);
+    close_socket(listener);
+    if (pair[1] == invalid_socket) {
+        close_socket(pair[0]);
+        return false;
+    }
+    return true;
+#else
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+        return false;
+    }
+    pair[0] = fds[0];
+    pair[1] = fds[1];
+    return true;
+#endif
+}
+
+bool send_all(socket_t sock, const std::string& data) {
+    size_t offset = 0;
+    while (offset < data.size()) {
+        long sent = send_some(sock, data.data() + offset, data.size() - offset);
+        if (sent <= 0) {
+            return false;
+        }
+        offset += static_cast<size_t>(sent);
+    }
+    return true;
+}
+
+bool recv_line(socket_t sock, std::string& buffer, std::string& line) {
+    while (true) {
+        size_t newline = buffer.find('\n');
+        if (newline != std::string::npos) {
+            line.assign(buffer, 0, newline);
+            buffer.erase(0, newline + 1);
+            return true;
+        }
+
+        char chunk[4096];
+        long received = recv_some(sock, chunk, sizeof(chunk));
+        if (received <= 0) {
+            return false;
+        }
+        buffer.append(chunk, static_cast<size_t>(received));
+    }
+}
+
+} // namespace notesearch
@@ -0,0 +1,91 @@
+#include "query_arena.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <new>
+
+namespace notesearch {
+
+QueryArena::~QueryArena() {
+    release_blocks();
+}
+
+QueryArena& QueryArena::for_this_thread() {
+    thread_local QueryArena arena;
+    return arena;
+}
+
+QueryArena::Scope::Scope()
+    : arena_(QueryArena::for_this_thread()) {
+    ++arena_.depth_;
+}
+
+QueryArena::Scope::~Scope() {
+    if (--arena_.depth_ == 0) {
+        arena_.reset();
+    }
+}
+
+void* QueryArena::do_allocate(size_t bytes, size_t alignment) {
+    while (true) {
+        if (current_ < blocks_.size()) {
+            Block& block = blocks_[current_];
+            auto address = reinterpret_cast<uintptr_t>(block.data + offset_);
+            size_t padding = static_cast<size_t>(-address & (alignment - 1));
+            if (offset_ + padding + bytes <= block.size) {
+                std::byte* result = block.data + offset_ + padding;
+                offset_ += padding + bytes;
+                used_bytes_ += bytes;
+                return result;
+            }
+            if (current_ + 1 < blocks_.size()) {
+                ++current_;
+                offset_ = 0;
+                continue;
+            }
+        }
+        add_block(bytes + alignment);
+    }
+}
+
+// Neuer Block, mindestens doppelt so groß wie der letzte
+void QueryArena::add_block(size_t min_bytes) {
+    size_t size = std::max(initial_block_bytes, min_bytes);
+    if (!blocks_.empty()) {
+        size = std::max(size, blocks_.back().size * 2);
+    }
+    blocks_.reserve(8);
+    blocks_.push_back({static_cast<std::byte*>(::operator new(size)), size});
+    ++heap_allocations_;
+    current_ = blocks_.size() - 1;
+    offset_ = 0;
+}
+
+void QueryArena::reset() noexcept {
+    // mehrere Blöcke zu einem zusammenfassen: die nächste ähnliche Query kommt ohne Heap aus
+    // Nothrow, Scope ruft reset() im Destruktor auf; klappt es nicht, fängt die nächste Query leer an
+    if (blocks_.size() > 1 || (!blocks_.empty() && blocks_[0].size > max_retained_bytes)) {
+        size_t total = 0;
+        for (const auto& block : blocks_) {
+            total += block.size;
+        }
+        release_blocks();
+        if (total <= max_retained_bytes) {
+            if (void* data = ::operator new(total, std::nothrow)) {
+                blocks_.push_back({static_cast<std::byte*>(data), total});  // Kapazität ist noch da
+                ++heap_allocations_;
+            }
+        }
+    }
+    current_ = 0;
+    offset_ = 0;
+    used_bytes_ = 0;
+}
+
+void QueryArena::release_blocks() noexcept {
+    for (const auto& block : blocks_) {
+        ::operator delete(block.data);
+    }
+    blocks_.clear();
+}
+
+} // namespace notesearch
@@ -1,148 +1,1152 @@
 #include "search.hpp"
+#include "cache_warmer.hpp"
+#include "query_arena.hpp"
 #include "tokenizer.hpp"
 #include "util.hpp"
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <cctype>
+#include <chrono>
 #include <cmath>
+#include <cstring>
+#include <ctime>
+#include <thread>
 #include <unordered_map>
-#include <unordered_set>
 
 namespace notesearch {
 
+namespace {
+
+// Misst die Zeit einer Phase und addiert sie auf ein Feld in SearchStats
+// Ohne stats (nullptr) wird gar nicht gemessen
+class PhaseTimer {
+public:
+    explicit PhaseTimer(double* target_ms)
+        : target_ms_(target_ms) {
+        if (target_ms_) {
+            start_ = std::chrono::steady_clock::now();
+        }
+    }
+    
+    ~PhaseTimer() { stop(); }
+    
+    PhaseTimer(const PhaseTimer&) = delete;
+    PhaseTimer& operator=(const PhaseTimer&) = delete;
+    
+    void stop() {
+        if (target_ms_) {
+            auto elapsed = std::chrono::steady_clock::now() - start_;
+            *target_ms_ += std::chrono::duration<double, std::milli>(elapsed).count();
+            target_ms_ = nullptr;  // nur einmal zählen
+        }
+    }
+
+private:
+    double* target_ms_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+// Trägt beim Verlassen von execute() den Arena Verbrauch der Query in SearchStats ein
+class ArenaUsage {
+public:
+    ArenaUsage(const QueryArena& arena, SearchStats* stats)
+        : arena_(arena), stats_(stats), blocks_before_(arena.heap_allocations()) {}
+    
+    ~ArenaUsage() {
+        if (stats_) {
+            stats_->arena_bytes = arena_.used_bytes();
+            stats_->arena_blocks = arena_.heap_allocations() - blocks_before_;
+        }
+    }
+    
+    ArenaUsage(const ArenaUsage&) = delete;
+    ArenaUsage& operator=(const ArenaUsage&) = delete;
+
+private:
+    const QueryArena& arena_;
+    SearchStats* stats_;
+    size_t blocks_before_;
+};
+
+constexpr size_t snippet_context = 80;             // Zeichen links und rechts vom Treffer
+constexpr size_t snippet_prefix_bytes = 16 * 1024; // so viel wird für ein Snippet zuerst dekomprimiert
+
+std::string lowercase(std::string value) {
+    for (char& c : value) {
+        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+    return value;
+}
+
+// Länge von "re:" / "lit:" am Anfang eines Query Worts, 0 wenn keins
+size_t pattern_marker(const std::string& word) {
+    std::string prefix = lowercase(word.substr(0, 4));
+    if (prefix.compare(0, 3, "re:") == 0 && word.size() > 3) {
+        return 3;
+    }
+    if (prefix == "lit:" && word.size() > 4) {
+        return 4;
+    }
+    return 0;
+}
+
+// Länge von "mtime:" / "size:" / "recent:" am Anfang eines Query Worts, 0 wenn keins (oder ohne Wert)
+size_t metadata_marker(const std::string& word) {
+    std::string prefix = lowercase(word.substr(0, 7));
+    for (const char* marker : {"mtime:", "size:", "recent:"}) {
+        size_t length = std::strlen(marker);
+        if (prefix.compare(0, length, marker) == 0 && word.size() > length) {
+            return length;
+        }
+    }
+    return 0;
+}
+
+// Zahl mit Einheit dahinter: "100k" -> 100 und "k"
+// höchstens 9 Ziffern, dann läuft auch Zahl mal Einheit nicht über
+bool split_number(const std::string& text, int64_t& number, std::string& unit) {
+    size_t digits = 0;
+    while (digits < text.size() && std::isdigit(static_cast<unsigned char>(text[digits]))) {
+        ++digits;
+    }
+    if (digits == 0 || digits > 9) {
+        return false;
+    }
+    number = std::stoll(text.substr(0, digits));
+    unit = lowercase(text.substr(digits));
+    return true;
+}
+
+bool parse_with_units(const std::string& text, std::initializer_list<std::pair<const char*, int64_t>> units,
+                      int64_t& value) {
+    int64_t number = 0;
+    std::string unit;
+    if (!split_number(text, number, unit)) {
+        return false;
+    }
+    for (const auto& [name, factor] : units) {
+        if (unit == name) {
+            value = number * factor;
+            return true;
+        }
+    }
+    return false;
+}
+
+// "512", "100k", "2mb" -> Bytes (k = 1024)
+bool parse_size(const std::string& text, int64_t& bytes) {
+    return parse_with_units(text, {{"", 1}, {"b", 1}, {"k", 1 << 10}, {"kb", 1 << 10}, {"m", 1 << 20},
+                                   {"mb", 1 << 20}, {"g", 1 << 30}, {"gb", 1 << 30}}, bytes);
+}
+
+// "30m", "12h", "7d", "2w", "1y" -> Sekunden, ohne Einheit Tage
+bool parse_duration(const std::string& text, int64_t& seconds) {
+    return parse_with_units(text, {{"", 86400}, {"m", 60}, {"h", 3600}, {"d", 86400}, {"w", 7 * 86400},
+                                   {"y", 365 * 86400}}, seconds);
+}
+
+// "2024-03-01" -> erste und letzte Sekunde dieses Tags in Ortszeit
+bool parse_day(const std::string& text, int64_t& first, int64_t& last) {
+    if (text.size() != 10 || text[4] != '-' || text[7] != '-') {
+        return false;
+    }
+    for (size_t i : {0, 1, 2, 3, 5, 6, 8, 9}) {
+        if (!std::isdigit(static_cast<unsigned char>(text[i]))) {
+            return false;
+        }
+    }
+    std::tm day{};
+    day.tm_year = std::stoi(text.substr(0, 4)) - 1900;
+    day.tm_mon = std::stoi(text.substr(5, 2)) - 1;
+    day.tm_mday = std::stoi(text.substr(8, 2));
+    day.tm_isdst = -1;  // Sommerzeit weiß mktime selbst
+    if (day.tm_mon < 0 || day.tm_mon > 11 || day.tm_mday < 1 || day.tm_mday > 31) {
+        return false;
+    }
+    std::tm next_day = day;
+    next_day.tm_mday += 1;  // mktime normalisiert den Monatsüberlauf
+    std::time_t start = std::mktime(&day);
+    std::time_t end = std::mktime(&next_day);
+    if (start == static_cast<std::time_t>(-1) || end == static_cast<std::time_t>(-1)) {
+        return false;
+    }
+    first = static_cast<int64_t>(start);
+    last = static_cast<int64_t>(end) - 1;
+    return true;
+}
+
+// "mtime:>7d", "mtime:<=2024-03-01", "size:<100k" -> RangeFilter, false bei ungültigem Wert
+// Der Wert ist ein Intervall [first, last]: ein Tag, oder ein Zeitpunkt (jetzt - Alter) bzw. eine Größe
+bool parse_range(const std::string& word, size_t marker, RangeFilter& range) {
+    range.field = marker == 5 ? MetadataField::size : MetadataField::modified;
+    std::string value = word.substr(marker);
+    size_t op_length = 0;
+    // einzeln verglichen, strchr fände auch das abschließende '\0' (ein NUL Byte der Query)
+    while (op_length < value.size() && op_length < 2 &&
+           (value[op_length] == '<' || value[op_length] == '>' || value[op_length] == '=')) {
+        ++op_length;
+    }
+    std::string op = value.substr(0, op_length);
+    value.erase(0, op_length);
+    
+    int64_t first = 0;
+    int64_t last = 0;
+    if (range.field == MetadataField::size) {
+        if (!parse_size(value, first)) {
+            return false;
+        }
+        last = first;
+    } else if (!parse_day(value, first, last)) {
+        int64_t age = 0;
+        if (op.empty() || op == "=" || !parse_duration(value, age)) {
+            return false;  // ein Alter ist ein Zeitpunkt, ohne Vergleich trifft es nichts
+        }
+        first = last = static_cast<int64_t>(std::time(nullptr)) - age;
+    }
+    
+    if (op.empty() || op == "=") {
+        range.min = first;
+        range.max = last;
+    } else if (op == ">") {
+        range.min = last + 1;
+    } else if (op == ">=") {
+        range.min = first;
+    } else if (op == "<") {
+        range.max = first - 1;
+    } else if (op == "<=") {
+        range.max = last;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// Zählt die Zeilen in denen das Muster vorkommt, first_position = erster Treffer (npos wenn keiner)
+// Zeilenweise wie grep: ^ und $ passen an jeder Zeile, ein Treffer geht nie über ein '\n'
+size_t count_matching_lines(const QueryPattern& pattern, const std::string& content, size_t& first_position,
+                            std::pmr::memory_resource* memory) {
+    size_t count = 0;
+    first_position = std::string::npos;
+    if (pattern.literal) {
+        size_t pos = content.find(pattern.source);
+        while (pos != std::string::npos) {
+            ++count;
+            if (first_position == std::string::npos) {
+                first_position = pos;
+            }
+            size_t line_end = content.find('\n', pos);
+            if (line_end == std::string::npos) {
+                break;
+            }
+            pos = content.find(pattern.source, line_end + 1);
+        }
+        return count;
+    }
+    
+    using Iterator = std::string::const_iterator;
+    std::match_results<Iterator, std::pmr::polymorphic_allocator<std::sub_match<Iterator>>> match(memory);
+    size_t line_start = 0;
+    while (line_start <= content.size()) {
+        size_t line_end = content.find('\n', line_start);
+        if (line_end == std::string::npos) {
+            line_end = content.size();
+        }
+        if (std::regex_search(content.begin() + static_cast<std::ptrdiff_t>(line_start),
+                              content.begin() + static_cast<std::ptrdiff_t>(line_end), match, *pattern.regex)) {
+            ++count;
+            if (first_position == std::string::npos) {
+                first_position = line_start + static_cast<size_t>(match.position(0));
+            }
+        }
+        line_start = line_end + 1;
+    }
+    return count;
+}
+
+} // namespace
+
+// Zerlegt die Query in Suchwörter, Filter und Muster
+// "ext:md" / "ext:.MD" -> Endung "md", "dir:notes/2024" -> Verzeichnisse {notes, 2024}
+// "mtime:>7d" / "size:<100k" -> Bereiche auf den Metadaten Spalten, "recent:7d" -> Halbwertszeit
+// "re:..." / "lit:..." -> Muster, der Wert bleibt wie er ist (kein Analyzer)
+// alles andere geht durch tokenize(), also denselben Analyzer wie beim Indexieren
+ParsedQuery parse_query(const std::string& query) {
+    ParsedQuery parsed;
+    std::string text;
+    
+    size_t pos = 0;
+    while (pos < query.size()) {
+        size_t end = query.find_first_of(" \t\r\n", pos);
+        if (end == std::string::npos) {
+            end = query.size();
+        }
+        std::string word = query.substr(pos, end - pos);
+        pos = end + 1;
+        
+        std::string prefix = lowercase(word.substr(0, 4));
+        if (size_t marker = pattern_marker(word)) {
+            QueryPattern pattern;
+            pattern.literal = marker == 4;
+            pattern.source = word.substr(marker);
+            if (pattern.literal) {
+                pattern.trigrams = literal_trigram_query(pattern.source);
+            } else {
+                if (pattern.source.compare(0, 4, "(?i)") == 0) {
+                    pattern.ignore_case = true;  // std::regex kennt keine Inline Flags
+                    pattern.source.erase(0, 4);
+                }
+                auto flags = std::regex::ECMAScript;
+                if (pattern.ignore_case) {
+                    flags |= std::regex::icase;
+                }
+                try {
+                    pattern.regex = std::make_shared<const std::regex>(pattern.source, flags);
+                } catch (const std::regex_error& e) {
+                    if (parsed.error.empty()) {
+                        parsed.error = "invalid pattern '" + pattern.source + "': " + e.what();
+                    }
+                    continue;
+                }
+                pattern.trigrams = regex_trigram_query(pattern.source);
+            }
+            parsed.patterns.push_back(std::move(pattern));
+        } else if (size_t metadata = metadata_marker(word)) {
+            RangeFilter range;
+            if (metadata == 7) {
+                int64_t half_life = 0;
+                if (parse_duration(word.substr(metadata), half_life) && half_life > 0) {
+                    parsed.recency_half_life = half_life;
+                } else if (parsed.error.empty()) {
+                    parsed.error = "invalid half-life '" + word + "' (e.g. recent:7d)";
+                }
+            } else if (parse_range(word, metadata, range)) {
+                parsed.ranges.push_back(range);
+            } else if (parsed.error.empty()) {
+                parsed.error = "invalid filter '" + word + "' (e.g. mtime:>7d, mtime:<2024-03-01, size:<100k)";
+            }
+        } else if (prefix == "ext:" && word.size() > 4) {
+            std::string extension = lowercase(word.substr(4));
+            if (extension[0] == '.') {
+                extension.erase(0, 1);
+            }
+            if (!extension.empty()) {
+                parsed.extensions.push_back(std::move(extension));
+            }
+        } else if (prefix == "dir:" && word.size() > 4) {
+            std::vector<std::string> names;
+            std::string value = lowercase(word.substr(4));
+            size_t start = 0;
+            while (start <= value.size()) {
+                size_t slash = value.find_first_of("/\\", start);
+                if (slash == std::string::npos) {
+                    slash = value.size();
+                }
+                if (slash > start) {
+                    names.push_back(value.substr(start, slash - start));
+                }
+                start = slash + 1;
+            }
+            if (!names.empty()) {
+                parsed.directories.push_back(std::move(names));
+            }
+        } else {
+            text += word;
+            text += ' ';
+        }
+    }
+    
+    parsed.terms = tokenize(text);
+    return parsed;
+}
+
 // Konstruktor: Speichert Referenzen auf Index und DocumentStore
-SearchEngine::SearchEngine(const InvertedIndex& index, const DocumentStore& doc_store)
-    : index_(index), doc_store_(doc_store) {}
+SearchEngine::SearchEngine(const InvertedIndex& index, const DocumentStore& doc_store, FieldBoosts boosts)
+    : index_(index), doc_store_(doc_store), boosts_(boosts) {}
+
+bool SearchEngine::check_query(const std::string& query, std::string* error) {
+    ParsedQuery parsed = parse_query(query);
+    if (parsed.error.empty()) {
+        return true;
+    }
+    if (error) {
+        *error = parsed.error;
+    }
+    return false;
+}
+
+// budget_ms <= 0: keine Zeitgrenze, nur der Token (falls einer da ist)
+QueryDeadline::QueryDeadline(double budget_ms, std::optional<CancellationToken> cancel)
+    : cancel_(std::move(cancel)) {
+    if (budget_ms > 0.0) {
+        end_ = std::chrono::steady_clock::now() +
+               std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                   std::chrono::duration<double, std::milli>(budget_ms));
+    }
+}
+
+bool QueryDeadline::expired() noexcept {
+    if (!expired_) {
+        expired_ = (cancel_ && cancel_->cancelled()) || (end_ && std::chrono::steady_clock::now() >= *end_);
+    }
+    return expired_;
+}
+
+// Dokumente die eine Trigram Query erfüllen (ohne Tombstones zu beachten)
+// Rückgabe false = Query schränkt nicht ein (all), docs bleibt dann unverändert
+bool SearchEngine::match_trigrams(const TrigramQuery& query, DocIdSet& docs) const {
+    switch (query.op) {
+        case TrigramQuery::Op::all:
+            return false;
+        case TrigramQuery::Op::none:
+            docs.clear();
+            return true;
+        case TrigramQuery::Op::and_: {
+            // seltenste Trigramme zuerst, ein fehlendes Trigramm = kein Dokument
+            std::pmr::vector<const DocIdSet*> sets(docs.get_allocator());
+            for (uint32_t trigram : query.trigrams) {
+                const DocIdSet* set = index_.get_trigram(trigram);
+                if (!set) {
+                    docs.clear();
+                    return true;
+                }
+                sets.push_back(set);
+            }
+            std::sort(sets.begin(), sets.end(),
+                      [](const DocIdSet* a, const DocIdSet* b) { return a->size() < b->size(); });
+            bool restricted = !sets.empty();
+            if (restricted) {
+                docs = *sets[0];
+                for (size_t i = 1; i < sets.size() && !docs.empty(); ++i) {
+                    docs.and_with(*sets[i]);
+                }
+            }
+            for (const auto& child : query.children) {
+                if (restricted && docs.empty()) {
+                    break;
+                }
+                DocIdSet child_docs(docs.get_allocator());
+                if (!match_trigrams(child, child_docs)) {
+                    continue;
+                }
+                if (restricted) {
+                    docs.and_with(child_docs);
+                } else {
+                    docs = std::move(child_docs);
+                    restricted = true;
+                }
+            }
+            return restricted;
+        }
+        case TrigramQuery::Op::or_: {
+            DocIdSet result(docs.get_allocator());
+            for (uint32_t trigram : query.trigrams) {
+                if (const DocIdSet* set = index_.get_trigram(trigram)) {
+                    result.or_with(*set);
+                }
+            }
+            for (const auto& child : query.children) {
+                DocIdSet child_docs(docs.get_allocator());
+                if (!match_trigrams(child, child_docs)) {
+                    return false;  // eine Alternative ohne Einschränkung: alles kann passen
+                }
+                result.or_with(child_docs);
+            }
+            docs = std::move(result);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Baut aus den ext: / dir: / mtime: / size: Filtern die Menge der erlaubten Dokumente
+// ext: und dir: sind vorberechnete DocIdSets: mehrere ext: Werte ODER, mehrere dir: Werte ODER, ext und dir UND
+// mtime: und size: sind Scans über eine Metadaten Spalte, mehrere UND (mtime:>2024-01-01 mtime:<2024-02-01)
+// Zwischenmengen kommen aus derselben Ressource wie filter
+// Rückgabe false = kein Dokument passt
+bool SearchEngine::build_filter(const ParsedQuery& query, DocIdSet& filter) const {
+    bool first = true;
+    auto restrict_to = [&filter, &first](const DocIdSet& allowed) {
+        if (first) {
+            filter = allowed;
+            first = false;
+        } else {
+            filter.and_with(allowed);
+        }
+    };
+    
+    if (!query.extensions.empty()) {
+        DocIdSet extensions(filter.get_allocator());
+        for (const auto& extension : query.extensions) {
+            if (const DocIdSet* docs = index_.get_filter(FilterKind::extension, extension)) {
+                extensions.or_with(*docs);
+            }
+        }
+        restrict_to(extensions);
+    }
+    
+    if (!query.directories.empty()) {
+        DocIdSet directories(filter.get_allocator());
+        for (const auto& names : query.directories) {
+            // dir:a/b = Dokumente unter a UND unter b ...
+            DocIdSet docs(filter.get_allocator());
+            bool found = true;
+            for (size_t i = 0; i < names.size() && found; ++i) {
+                const DocIdSet* named = index_.get_filter(FilterKind::directory, names[i]);
+                found = named != nullptr;
+                if (!found) {
+                    break;
+                }
+                if (i == 0) {
+                    docs = *named;
+                } else {
+                    docs.and_with(*named);
+                }
+            }
+            if (!found) {
+                continue;
+            }
+            
+            // ... und zusätzlich direkt hintereinander im Pfad (nur die wenigen Treffer prüfen)
+            if (names.size() > 1) {
+                std::string sequence = "/";
+                for (const auto& name : names) {
+                    sequence += name + "/";
+                }
+                DocIdSet verified(filter.get_allocator());
+                docs.for_each([&](uint32_t doc_id) {
+                    const Document* doc = doc_store_.get_document(doc_id);
+                    if (!doc) {
+                        return;
+                    }
+                    std::string path = std::filesystem::path(doc->path).generic_string();
+                    std::transform(path.begin(), path.end(), path.begin(),
+                                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+                    if (path.find(sequence) != std::string::npos) {
+                        verified.add(doc_id);
+                    }
+                });
+                docs = std::move(verified);
+            }
+            directories.or_with(docs);
+        }
+        restrict_to(directories);
+    }
+    
+    for (const auto& range : query.ranges) {
+        if (!first && filter.empty()) {
+            break;
+        }
+        restrict_to(doc_store_.metadata().match_range(range.field, range.min, range.max, filter.get_allocator()));
+    }
+    
+    return !filter.empty();
+}
+
+// recent: Faktor 1 + 2^(-Alter / Halbwertszeit): eine gerade geänderte Datei zählt doppelt, eine eine
+// Halbwertszeit alte 1.5 mal, alte Dateien behalten ihren Score (die Relevanz bleibt das Wichtigste)
+void SearchEngine::apply_recency(int64_t half_life, std::vector<std::pair<uint32_t, double>>& doc_scores) const {
+    const MetadataColumns& metadata = doc_store_.metadata();
+    int64_t now = static_cast<int64_t>(std::time(nullptr));
+    double per_second = 1.0 / static_cast<double>(half_life);
+    for (auto& [doc_id, score] : doc_scores) {
+        int64_t age = std::max<int64_t>(0, now - metadata.get(MetadataField::modified, doc_id));
+        score *= 1.0 + std::exp2(-static_cast<double>(age) * per_second);
+    }
+}
 
 // Hauptsuchfunktion: Sucht nach Query und gibt sortierte Ergebnisse zurück
-// query = Suchbegriff (kann mehrere Wörter enthalten)
 // max_results = maximale Anzahl Ergebnisse (0 = alle)
-std::vector<SearchResult> SearchEngine::search(const std::string& query, size_t max_results) const {
-    // Schritt 1: Zerlege Query in einzelne Wörter
-    std::vector<std::string> query_terms = tokenize(query);
-    if (query_terms.empty()) {
-        return {};  // Leere Query = keine Ergebnisse
+std::vector<SearchResult> SearchEngine::search(const std::string& query, size_t max_results,
+                                               SearchStats* stats, const CollectionStats* collection,
+                                               QueryDeadline* deadline) const {
+    SearchCursor cursor = execute(query, stats, collection, deadline);
+    return results(cursor.next(max_results, stats), cursor, false, stats);
+}
+
+// Führt die Query bis zum Scoring aus, sortiert und Snippets gebaut wird erst seitenweise (SearchCursor)
+// query = Suchbegriff (kann mehrere Wörter, ext: / dir: Filter und re: / lit: Muster enthalten)
+// stats = optional, wird mit Statistiken für --explain gefüllt
+// deadline = optional, läuft sie ab hört die Query auf und rankt was fertig gescort ist
+SearchCursor SearchEngine::execute(const std::string& query, SearchStats* stats,
+                                   const CollectionStats* collection, QueryDeadline* deadline) const {
+    if (stats) {
+        *stats = SearchStats{};
+    }
+    // Zeit abgelaufen bevor die Kandidaten feststehen: leeres, unvollständiges Ergebnis
+    auto out_of_time = [deadline]() { return deadline && deadline->expired(); };
+    auto incomplete = [stats]() {
+        SearchCursor cursor;
+        cursor.complete_ = false;
+        if (stats) {
+            stats->incomplete = true;
+        }
+        return cursor;
+    };
+    
+    // Zwischenergebnisse (DocIdSets, Wort Reihenfolge, Postings) liegen in der Arena des Threads und
+    // werden am Ende auf einmal verworfen; vom Heap kommt nur noch was der Cursor behält
+    QueryArena::Scope arena_scope;
+    QueryArena& arena = arena_scope.arena();
+    ArenaUsage arena_usage(arena, stats);
+    
+    // Schritt 1: Zerlege Query in einzelne Wörter und Filter
+    PhaseTimer tokenize_timer(stats ? &stats->tokenize_ms : nullptr);
+    ParsedQuery parsed = parse_query(query);
+    std::vector<std::string>& query_terms = parsed.terms;
+    if (!parsed.error.empty() || (query_terms.empty() && !parsed.has_filters() && !parsed.has_patterns())) {
+        return {};  // Leere Query (oder ungültiges Muster) = keine Ergebnisse
+    }
+    
+    // Schritt 2: Entferne doppelte Wörter (an Ort und Stelle, Reihenfolge der Query bleibt)
+    auto unique_end = query_terms.begin();
+    for (auto it = query_terms.begin(); it != query_terms.end(); ++it) {
+        if (std::find(query_terms.begin(), unique_end, *it) == unique_end) {
+            if (unique_end != it) {
+                *unique_end = std::move(*it);
+            }
+            ++unique_end;
+        }
+    }
+    query_terms.erase(unique_end, query_terms.end());
+    if (hot_terms_ && !query_terms.empty()) {
+        hot_terms_->record(query_terms);
+    }
+    tokenize_timer.stop();
+    if (out_of_time()) {
+        return incomplete();
     }
     
-    // Schritt 2: Entferne doppelte Wörter
-    std::unordered_set<std::string> unique_terms(query_terms.begin(), query_terms.end());
-    query_terms.assign(unique_terms.begin(), unique_terms.end());
+    // Schritt 3: AND-Query - finde Dokumente die ALLE Wörter enthalten (in irgendeinem Feld)
+    // Alles mit DocIdSets: ODER über die Felder, UND über die Wörter, UND Filter, OHNE Tombstones
+    PhaseTimer intersect_timer(stats ? &stats->intersect_ms : nullptr);
+    size_t total_docs = collection ? collection->total_docs : doc_store_.live_count();
     
-    // Schritt 3: AND-Query - finde Dokumente die ALLE Wörter enthalten
-    std::unordered_map<uint32_t, double> doc_scores;  // Speichert Score für jedes Dokument
-    size_t total_docs = doc_store_.size();
+    // Filter zuerst: vorberechnete Mengen, schränken die Kandidaten vor dem Scoring ein
+    DocIdSet filter(&arena);
+    if (parsed.has_filters()) {
+        bool any = build_filter(parsed, filter);
+        if (stats) {
+            stats->filtered = true;
+            stats->filter_matches = any ? filter.size() : 0;
+        }
+        if (!any) {
+            return {};
+        }
+        if (out_of_time()) {
+            return incomplete();
+        }
+    }
     
-    // Starte mit dem ersten Wort
-    const auto* first_postings = index_.get_postings(query_terms[0]);
-    if (!first_postings) {
-        return {};  // Erstes Wort nicht gefunden = keine Ergebnisse
+    // Muster: der Trigram Index liefert die Dokumente die überhaupt passen können (UND über die Muster)
+    // Geprüft wird der Inhalt erst nach dem Schneiden mit Wörtern und Filtern
+    DocIdSet pattern_docs(&arena);
+    bool patterns_restrict = false;
+    for (const auto& pattern : parsed.patterns) {
+        DocIdSet docs(&arena);
+        bool restricts = match_trigrams(pattern.trigrams, docs);
+        if (stats) {
+            stats->patterns.push_back({pattern.source, pattern.trigrams.to_string(),
+                                       restricts ? docs.size() : doc_store_.size()});
+        }
+        if (!restricts) {
+            continue;
+        }
+        if (patterns_restrict) {
+            pattern_docs.and_with(docs);
+        } else {
+            pattern_docs = std::move(docs);
+            patterns_restrict = true;
+        }
+        if (pattern_docs.empty()) {
+            return {};
+        }
+        if (out_of_time()) {
+            return incomplete();
+        }
     }
     
-    // Sammle alle Dokumente die das erste Wort enthalten
-    std::unordered_set<uint32_t> candidate_docs;
-    for (const auto& posting : *first_postings) {
-        candidate_docs.insert(posting.doc_id);
+    // Schlage zuerst alle Wörter in allen Feldern nach, damit --explain alle Document Frequencies zeigt
+    std::pmr::vector<FieldPostings> term_postings(&arena);
+    std::pmr::vector<DocIdSet> term_docs(&arena);    // Dokumente mit dem Wort in irgendeinem Feld
+    term_postings.reserve(query_terms.size());
+    term_docs.reserve(query_terms.size());
+    bool all_found = true;
+    for (const auto& term : query_terms) {
+        DocIdSet docs(&arena);
+        term_postings.push_back(lookup_term(term, &docs, stats));
+        all_found = all_found && !docs.empty();
+        term_docs.push_back(std::move(docs));
+        if (out_of_time()) {
+            return incomplete();
+        }
+    }
+    if (!all_found) {
+        return {};  // Ein Wort nicht gefunden = keine Dokumente enthalten alle Wörter
+    }
+    
+    // Seltenstes Wort zuerst: die Kandidaten Menge bleibt von Anfang an klein
+    std::pmr::vector<size_t> order(query_terms.size(), &arena);
+    for (size_t i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(),
+              [&term_docs](size_t a, size_t b) { return term_docs[a].size() < term_docs[b].size(); });
+    
+    DocIdSet candidate_docs(&arena);
+    if (!query_terms.empty()) {
+        candidate_docs = std::move(term_docs[order[0]]);
+        if (parsed.has_filters()) {
+            candidate_docs.and_with(filter);
+        }
+        if (patterns_restrict) {
+            candidate_docs.and_with(pattern_docs);
+        }
+    } else if (parsed.has_filters()) {
+        candidate_docs = std::move(filter);  // keine Wörter: alle Dokumente die durchkommen
+        if (patterns_restrict) {
+            candidate_docs.and_with(pattern_docs);
+        }
+    } else if (patterns_restrict) {
+        candidate_docs = std::move(pattern_docs);
+    } else {
+        // nur Muster ohne brauchbares Trigramm (z.B. re:\d+): jedes Dokument muss geprüft werden
+        // (exakte Kopien nicht, sie erscheinen beim Original wie bei Wörtern und Trigrammen)
+        for (uint32_t doc_id = 0; doc_id < doc_store_.size(); ++doc_id) {
+            if (!doc_store_.is_duplicate(doc_id)) {
+                candidate_docs.add(doc_id);
+            }
+        }
+    }
+    candidate_docs.and_not(doc_store_.deleted_documents());
+    if (stats) {
+        stats->candidate_sizes.push_back(candidate_docs.size());
     }
     
     // Schritt 4: Schneide mit anderen Wörtern (Intersection)
     // Nur Dokumente die ALLE Wörter enthalten bleiben übrig
-    for (size_t i = 1; i < query_terms.size(); ++i) {
-        const auto* postings = index_.get_postings(query_terms[i]);
-        if (!postings) {
-            return {}; // Wort nicht gefunden = keine Dokumente enthalten alle Wörter
+    for (size_t i = 1; i < order.size() && !candidate_docs.empty(); ++i) {
+        candidate_docs.and_with(term_docs[order[i]]);
+        if (stats) {
+            stats->candidate_sizes.push_back(candidate_docs.size());
         }
-        
-        // Sammle Dokumente die dieses Wort enthalten
-        std::unordered_set<uint32_t> term_docs;
-        for (const auto& posting : *postings) {
-            term_docs.insert(posting.doc_id);
+        if (out_of_time()) {
+            return incomplete();
         }
-        
-        // Intersection: Behalte nur Dokumente die in BEIDEN Sets sind
-        std::unordered_set<uint32_t> intersection;
-        for (uint32_t doc_id : candidate_docs) {
-            if (term_docs.find(doc_id) != term_docs.end()) {
-                intersection.insert(doc_id);
+    }
+    if (candidate_docs.empty()) {
+        return {};  // Keine Dokumente enthalten alle Wörter
+    }
+    intersect_timer.stop();
+    
+    // Kandidaten aufsteigend: (doc_id, score), Postings sind ebenfalls aufsteigend sortiert
+    std::vector<std::pair<uint32_t, double>> doc_scores;
+    doc_scores.reserve(candidate_docs.size());
+    
+    // Schritt 5: Muster im Inhalt prüfen, die Trigramme sind nur notwendig, nicht hinreichend
+    // Score pro Muster = 1 + log(Zeilen mit Treffer), das Snippet zeigt den ersten Treffer
+    // Läuft die Zeit dabei ab, werden die bis dahin geprüften Dokumente noch gescort
+    std::unordered_map<uint32_t, size_t> match_positions;
+    bool complete = true;
+    if (parsed.has_patterns()) {
+        PhaseTimer verify_timer(stats ? &stats->verify_ms : nullptr);
+        // std::regex gibt seine Match Puffer pro Zeile frei: ein Pool darüber verwendet sie wieder,
+        // sonst wüchse die Arena mit der Zeilenzahl
+        std::pmr::unsynchronized_pool_resource match_memory(&arena);
+        size_t verified = 0;
+        complete = candidate_docs.for_each_while([&](uint32_t doc_id) {
+            if (out_of_time()) {
+                return false;  // ein Dokument kann teuer sein (langer Inhalt, Regex), also vor jedem prüfen
+            }
+            ++verified;
+            std::string content = doc_store_.get_content(doc_id);
+            double score = 0.0;
+            size_t first_position = std::string::npos;
+            for (const auto& pattern : parsed.patterns) {
+                size_t position;
+                size_t lines = count_matching_lines(pattern, content, position, &match_memory);
+                if (lines == 0) {
+                    return true;
+                }
+                score += 1.0 + std::log(static_cast<double>(lines));
+                if (first_position == std::string::npos) {
+                    first_position = position;
+                }
             }
+            doc_scores.emplace_back(doc_id, score);
+            match_positions.emplace(doc_id, first_position);
+            return true;
+        });
+        if (stats) {
+            stats->docs_verified = verified;
         }
-        candidate_docs = std::move(intersection);
-        
-        if (candidate_docs.empty()) {
-            return {};  // Keine Dokumente enthalten alle Wörter
+        if (doc_scores.empty()) {
+            return complete ? SearchCursor{} : incomplete();
         }
+    } else {
+        // nur Filter und recent: alle gleich relevant, die Reihenfolge macht dann die Aktualität
+        double base = query_terms.empty() && parsed.recency_half_life > 0 ? 1.0 : 0.0;
+        candidate_docs.for_each([&doc_scores, base](uint32_t doc_id) { doc_scores.emplace_back(doc_id, base); });
     }
     
-    // Schritt 5: Berechne TF-IDF Score für jedes Dokument
-    for (uint32_t doc_id : candidate_docs) {
-        double score = 0.0;
-        for (const auto& term : query_terms) {
-            score += calculate_tf_idf(term, doc_id, total_docs);  // Summiere Scores aller Wörter
+    // Schritt 6: Berechne TF-IDF Score für jedes Dokument
+    // Score = Summe über Wörter und Felder von boost(Feld) * tf * idf(Feld)
+    // Läuft die Zeit ab, bleiben nur die Dokumente vorne, die das aktuelle Wort noch ganz bekommen haben;
+    // die restlichen Wörter werden für sie ohne Zeitgrenze gescort (höchstens so viel Arbeit wie schon getan)
+    PhaseTimer score_timer(stats ? &stats->score_ms : nullptr);
+    QueryDeadline* score_deadline = complete ? deadline : nullptr;
+    for (size_t i = 0; i < query_terms.size(); ++i) {
+        size_t scored = score_term(query_terms[i], term_postings[i], total_docs, collection, doc_scores,
+                                   score_deadline);
+        if (scored < doc_scores.size()) {
+            doc_scores.resize(scored);
+            complete = false;
+            score_deadline = nullptr;
         }
-        doc_scores[doc_id] = score;
     }
+    if (parsed.recency_half_life > 0) {
+        apply_recency(parsed.recency_half_life, doc_scores);
+    }
+    if (stats) {
+        stats->docs_scored = doc_scores.size();
+        stats->incomplete = !complete;
+    }
+    score_timer.stop();
     
-    // Schritt 6: Sortiere nach Score (höchster zuerst)
-    std::vector<std::pair<uint32_t, double>> sorted_results;
-    sorted_results.reserve(doc_scores.size());
-    for (const auto& pair : doc_scores) {
-        sorted_results.emplace_back(pair.first, pair.second);
+    SearchCursor cursor = make_cursor(std::move(doc_scores), std::move(query_terms), std::move(match_positions));
+    cursor.complete_ = complete;
+    return cursor;
+}
+
+// Dokumentanzahl und Document Frequencies der Query Wörter in diesem Index (ein Shard)
+// Der Coordinator summiert sie über alle Shards, Filter spielen für die IDF keine Rolle
+CollectionStats SearchEngine::collection_stats(const std::string& query) const {
+    CollectionStats collection;
+    collection.total_docs = doc_store_.live_count();
+    for (const auto& term : parse_query(query).terms) {
+        auto& frequencies = collection.document_frequencies[term];
+        for (size_t f = 0; f < field_count; ++f) {
+            frequencies[f] = index_.get_document_frequency(term, static_cast<Field>(f));
+        }
+    }
+    return collection;
+}
+
+void CollectionStats::merge(const CollectionStats& other) {
+    total_docs += other.total_docs;
+    for (const auto& [term, frequencies] : other.document_frequencies) {
+        auto& sum = document_frequencies[term];  // neu angelegt: alles 0
+        for (size_t f = 0; f < field_count; ++f) {
+            sum[f] += frequencies[f];
+        }
+    }
+}
+
+// Schlägt ein Wort in allen Feldern nach, docs = Dokumente mit dem Wort in irgendeinem Feld
+// docs ist optional: die Vereinigung kostet, SearchSession braucht sie oft nicht
+SearchEngine::FieldPostings SearchEngine::lookup_term(const std::string& term, DocIdSet* docs,
+                                                      SearchStats* stats) const {
+    DocIdSet explain_docs;
+    if (!docs && stats) {
+        docs = &explain_docs;  // --explain zeigt die Document Frequency über alle Felder
+    }
+    FieldPostings postings{};
+    for (size_t f = 0; f < field_count; ++f) {
+        postings[f] = index_.get_postings(term, static_cast<Field>(f));
+        if (postings[f]) {
+            if (docs) {
+                docs->or_with(postings[f]->docs());
+            }
+            if (stats) {
+                stats->postings_scanned += postings[f]->size();
+            }
+        }
+    }
+    if (stats) {
+        stats->terms.push_back({term, docs->size()});
+    }
+    return postings;
+}
+
+// Addiert den Score eines Worts auf die Kandidaten (doc_scores aufsteigend nach doc_id)
+// Score = Summe über Felder von boost(Feld) * tf * idf(Feld)
+// collection = globale Statistiken (Sharding), sonst zählt dieser Index
+// deadline: läuft sie in einem Feld ab, bekommen die restlichen Felder nur noch die Kandidaten davor,
+// Rückgabe = so viele Kandidaten von vorne haben das Wort komplett
+size_t SearchEngine::score_term(const std::string& term, const FieldPostings& postings, size_t total_docs,
+                                const CollectionStats* collection,
+                                std::vector<std::pair<uint32_t, double>>& doc_scores,
+                                QueryDeadline* deadline) const {
+    const std::array<size_t, field_count>* global_df = nullptr;
+    if (collection) {
+        auto it = collection->document_frequencies.find(term);
+        if (it != collection->document_frequencies.end()) {
+            global_df = &it->second;
+        }
     }
-    std::sort(sorted_results.begin(), sorted_results.end(),
-        [](const auto& a, const auto& b) { return a.second > b.second; });  // Absteigend sortieren
     
-    // Schritt 7: Baue Ergebnis-Liste mit Snippets
-    std::vector<SearchResult> results;
-    size_t result_count = (max_results == 0) ? sorted_results.size() : 
-                          std::min(max_results, sorted_results.size());
-    results.reserve(result_count);
+    size_t end = doc_scores.size();  // Kandidaten [0, end) bekommen das Wort
+    for (size_t f = 0; f < field_count; ++f) {
+        const PostingList* list = postings[f];
+        if (!list) {
+            continue;
+        }
+        Field field = static_cast<Field>(f);
+        double idf = calculate_idf(term, total_docs, field);
+        if (global_df && (*global_df)[f] > 0 && total_docs > 0) {
+            idf = std::log(static_cast<double>(total_docs) / static_cast<double>((*global_df)[f]));
+        }
+        double weight = boosts_[field] * idf;
+        auto tf = [](uint32_t term_freq) { return 1.0 + std::log(static_cast<double>(term_freq)); };
+        // nach einem Abbruch werden die Kandidaten davor ohne weitere Prüfung fertig gescort
+        QueryDeadline* check = (end == doc_scores.size()) ? deadline : nullptr;
+        
+        if (end * 32 < list->size()) {
+            // wenige Kandidaten, lange Liste: gezielt nachschlagen statt alles zu lesen
+            // (frequency() braucht rank(), in Bitmap Containern bis zu 4096 popcounts)
+            for (size_t i = 0; i < end; ++i) {
+                if (check && check->poll()) {
+                    end = i;
+                    break;
+                }
+                if (uint32_t term_freq = list->frequency(doc_scores[i].first)) {
+                    doc_scores[i].second += weight * tf(term_freq);
+                }
+            }
+        } else {
+            // Merge: beide Seiten aufsteigend, kein Hashing
+            // Abbruch bei Posting doc_id: alle Kandidaten davor haben ihre Postings schon bekommen
+            size_t next = 0;
+            bool stopped = false;
+            list->for_each_while([&](uint32_t doc_id, uint32_t term_freq) {
+                while (next < end && doc_scores[next].first < doc_id) {
+                    ++next;
+                }
+                if (next == end) {
+                    return false;  // Rest der Liste liegt hinter den Kandidaten
+                }
+                if (check && check->poll()) {
+                    stopped = true;
+                    return false;
+                }
+                if (doc_scores[next].first == doc_id) {
+                    doc_scores[next].second += weight * tf(term_freq);
+                }
+                return true;
+            });
+            if (stopped) {
+                end = next;
+            }
+        }
+    }
+    return end;
+}
+
+// Cursor über die gescorten Kandidaten
+// Near-Duplicates: pro Cluster wird nur das beste Dokument ein Treffer, die anderen zählen mit.
+// Einmal über alle Kandidaten (unsortiert reicht), so stimmt collapsed auch wenn Mitglieder
+// erst auf späteren Seiten kämen. Nur Dokumente die ihren Cluster mit anderen teilen kommen in die Tabelle,
+// ein nach Cluster sortierter Vektor (eine Allokation statt einem Knoten pro Cluster)
+SearchCursor SearchEngine::make_cursor(std::vector<std::pair<uint32_t, double>> doc_scores,
+                                       std::vector<std::string> snippet_terms,
+                                       std::unordered_map<uint32_t, size_t> match_positions) const {
+    SearchCursor cursor;
+    cursor.doc_store_ = &doc_store_;
+    const DocIdSet& clustered = doc_store_.clustered_documents();
+    if (!clustered.empty()) {
+        auto& clusters = cursor.clusters_;
+        clusters.reserve(static_cast<size_t>(std::count_if(
+            doc_scores.begin(), doc_scores.end(), [&clustered](const auto& entry) { return clustered.contains(entry.first); })));
+        for (const auto& [doc_id, score] : doc_scores) {
+            if (clustered.contains(doc_id)) {
+                clusters.push_back({doc_store_.cluster_of(doc_id), SearchCursor::Cluster{doc_id, score, 1}});
+            }
+        }
+        // pro Cluster das beste Mitglied nach vorne (höchster Score, dann kleinste ID), dann zusammenfassen
+        std::sort(clusters.begin(), clusters.end(), [](const auto& a, const auto& b) {
+            if (a.first != b.first) {
+                return a.first < b.first;
+            }
+            return a.second.score != b.second.score ? a.second.score > b.second.score : a.second.best < b.second.best;
+        });
+        size_t out = 0;
+        for (size_t i = 0; i < clusters.size(); ++i) {
+            if (out > 0 && clusters[out - 1].first == clusters[i].first) {
+                ++clusters[out - 1].second.members;
+            } else {
+                clusters[out++] = clusters[i];
+            }
+        }
+        clusters.resize(out);
+    }
+    cursor.doc_scores_ = std::move(doc_scores);
+    cursor.snippet_terms_ = std::move(snippet_terms);
+    cursor.match_positions_ = std::move(match_positions);
+    return cursor;
+}
+
+// Nächste Seite: nach Score sortieren (höchster zuerst), aber nur so weit wie nötig
+// Für jede Seite werden die nächsten Kandidaten nach vorne geholt (nth_element) und nur die sortiert,
+// mit Puffer für Near-Duplicates die wegfallen; reicht er nicht, kommt der nächste Abschnitt dran
+std::vector<SearchHit> SearchCursor::next(size_t count, SearchStats* stats) {
+    PhaseTimer sort_timer(stats ? &stats->sort_ms : nullptr);
+    auto better = [](const auto& a, const auto& b) {
+        // Absteigend sortieren, bei gleichem Score nach Dokument ID (stabile Reihenfolge)
+        return a.second != b.second ? a.second > b.second : a.first < b.first;
+    };
+    size_t limit = (count == 0) ? doc_scores_.size() : count;
+    std::vector<SearchHit> hits;
+    hits.reserve(std::min(limit, doc_scores_.size() - next_));
     
-    for (size_t i = 0; i < result_count; ++i) {
-        uint32_t doc_id = sorted_results[i].first;
-        double score = sorted_results[i].second;
+    while (hits.size() < limit && next_ < doc_scores_.size()) {
+        if (next_ == sorted_) {
+            size_t end = doc_scores_.size();
+            if (count > 0 && (end - sorted_) / 4 > limit - hits.size()) {
+                end = sorted_ + (limit - hits.size()) * 4;
+                std::nth_element(doc_scores_.begin() + sorted_, doc_scores_.begin() + end, doc_scores_.end(), better);
+            }
+            std::sort(doc_scores_.begin() + sorted_, doc_scores_.begin() + end, better);
+            sorted_ = end;
+        }
         
-        const Document* doc = doc_store_.get_document(doc_id);
-        if (doc) {
-            std::string snippet = extract_snippet(doc->content, query_terms);  // Extrahiere Textausschnitt
-            results.emplace_back(doc->path, score, std::move(snippet));
+        auto [doc_id, score] = doc_scores_[next_++];
+        size_t collapsed = 0;
+        if (!clusters_.empty() && doc_store_->clustered_documents().contains(doc_id)) {
+            uint32_t cluster_id = doc_store_->cluster_of(doc_id);
+            const Cluster& cluster = std::lower_bound(clusters_.begin(), clusters_.end(), cluster_id,
+                                                      [](const auto& entry, uint32_t id) { return entry.first < id; })
+                                         ->second;
+            if (cluster.best != doc_id) {
+                continue;  // steckt im besten Dokument des Clusters
+            }
+            collapsed = cluster.members - 1;
+        }
+        if (!doc_store_->get_document(doc_id)) {
+            continue;
+        }
+        hits.push_back({doc_id, score, collapsed});
+        if (stats) {
+            stats->collapsed += collapsed;
+        }
+    }
+    returned_ += hits.size();
+    return hits;
+}
+
+// Baut die Ergebnisse einer Seite, parallel auf Wunsch: jedes Snippet dekomprimiert seinen Inhalt
+std::vector<SearchResult> SearchEngine::results(const std::vector<SearchHit>& hits, const SearchCursor& cursor,
+                                                bool parallel, SearchStats* stats) const {
+    PhaseTimer snippet_timer(stats ? &stats->snippet_ms : nullptr);
+    std::vector<SearchResult> results;
+    size_t thread_count = parallel ? std::min<size_t>(hits.size(), std::thread::hardware_concurrency()) : 1;
+    if (thread_count <= 1) {
+        results.reserve(hits.size());
+        for (const auto& hit : hits) {
+            results.push_back(result(hit, cursor));
         }
+        return results;
     }
     
+    results.assign(hits.size(), SearchResult(std::string(), 0.0, std::string()));
+    std::atomic<size_t> next{0};
+    std::vector<std::thread> threads;
+    threads.reserve(thread_count);
+    for (size_t t = 0; t < thread_count; ++t) {
+        threads.emplace_back([&]() {
+            for (size_t i = next++; i < hits.size(); i = next++) {
+                results[i] = result(hits[i], cursor);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
     return results;
 }
 
+// Pfad, Snippet und Kopien eines Treffers
+SearchResult SearchEngine::result(const SearchHit& hit, const SearchCursor& cursor) const {
+    uint32_t doc_id = hit.doc_id;
+    const Document* doc = doc_store_.get_document(doc_id);
+    if (!doc) {
+        return SearchResult(std::string(), hit.score, std::string());  // Cursor älter als der Store
+    }
+    SearchResult result(doc->path, hit.score, std::string());
+    result.collapsed = hit.collapsed;
+    
+    // Inhalt wird nur für die gezeigten Treffer aus dem Blob dekomprimiert, und zuerst nur der Anfang:
+    // meist steht ein Treffer weit vorne. Sonst (oder zu nah am Ende des Anfangs) das ganze Dokument
+    // Mit Muster ist die Position schon bekannt, gelesen wird bis kurz dahinter
+    std::string content;
+    size_t position = std::string::npos;
+    auto matched = cursor.match_positions_.find(doc_id);
+    if (matched != cursor.match_positions_.end()) {
+        position = matched->second;
+        content = doc_store_.get_content(doc_id, std::max(snippet_prefix_bytes, position + 2 * snippet_context));
+    } else {
+        content = doc_store_.get_content(doc_id, snippet_prefix_bytes);
+        position = first_match(content, cursor.snippet_terms_);
+        bool truncated = content.size() < doc->content_ref.raw_size;
+        if (truncated && (position == std::string::npos || position + snippet_context >= content.size())) {
+            content = doc_store_.get_content(doc_id);
+            position = first_match(content, cursor.snippet_terms_);
+        }
+    }
+    if (position == std::string::npos) {
+        position = 0;  // Kein Match gefunden (oder nur Filter), zeige Anfang
+    }
+    result.snippet = notesearch::extract_snippet(content, position, snippet_context);  // Extrahiere Textausschnitt
+    
+    // exakte Kopien: das Original und alle Kopien, außer dem Ergebnis selbst
+    uint32_t original = doc_store_.duplicate_of(doc_id);
+    const auto& copies = doc_store_.copies_of(original);
+    if (!copies.empty()) {
+        for (uint32_t copy : copies) {
+            if (copy != doc_id && !doc_store_.is_deleted(copy)) {
+                result.copies.push_back(doc_store_.get_document(copy)->path);
+            }
+        }
+        if (original != doc_id && !doc_store_.is_deleted(original)) {
+            result.copies.insert(result.copies.begin(), doc_store_.get_document(original)->path);
+        }
+    }
+    return result;
+}
+
 // Berechnet TF-IDF Score für ein Wort in einem Dokument
 // TF-IDF = Term Frequency * Inverse Document Frequency
 // Höherer Score = Wort ist wichtiger für dieses Dokument
-double SearchEngine::calculate_tf_idf(const std::string& term, uint32_t doc_id, size_t total_docs) const {
-    double tf = calculate_tf(term, doc_id);      // Wie oft kommt Wort im Dokument vor?
-    double idf = calculate_idf(term, total_docs); // Wie selten ist das Wort insgesamt?
+double SearchEngine::calculate_tf_idf(const std::string& term, uint32_t doc_id, size_t total_docs,
+                                      Field field) const {
+    double tf = calculate_tf(term, doc_id, field);      // Wie oft kommt Wort im Dokument vor?
+    double idf = calculate_idf(term, total_docs, field); // Wie selten ist das Wort insgesamt?
     return tf * idf;  // Kombiniert beide Werte
 }
 
 // Term Frequency: Wie oft kommt das Wort im Dokument vor?
 // Verwendet log-Normalisierung: 1 + log(Häufigkeit)
 // Warum log? Häufige Wörter sollen nicht zu dominant werden
-double SearchEngine::calculate_tf(const std::string& term, uint32_t doc_id) const {
-    const auto* postings = index_.get_postings(term);
+double SearchEngine::calculate_tf(const std::string& term, uint32_t doc_id, Field field) const {
+    const auto* postings = index_.get_postings(term, field);
     if (!postings) {
         return 0.0;  // Wort nicht gefunden
     }
     
-    // Suche das Posting für dieses Dokument
-    for (const auto& posting : *postings) {
-        if (posting.doc_id == doc_id) {
-            // Log-Normalisierung: 1 + log(Häufigkeit)
-            // Beispiel: 10x vorkommen → 1 + log(10) ≈ 3.3
-            return 1.0 + std::log(static_cast<double>(posting.term_freq));
-        }
+    uint32_t term_freq = postings->frequency(doc_id);
+    if (term_freq == 0) {
+        return 0.0;  // Dokument enthält Wort nicht
     }
     
-    return 0.0;  // Dokument enthält Wort nicht
+    // Log-Normalisierung: 1 + log(Häufigkeit)
+    // Beispiel: 10x vorkommen → 1 + log(10) ≈ 3.3
+    return 1.0 + std::log(static_cast<double>(term_freq));
 }
 
 // Inverse Document Frequency: Wie selten ist das Wort?
 // Seltene Wörter = höherer IDF = wichtiger für Suche
 // Formel: log(Gesamtanzahl Dokumente / Anzahl Dokumente mit diesem Wort)
-double SearchEngine::calculate_idf(const std::string& term, size_t total_docs) const {
-    size_t df = index_.get_document_frequency(term);  // In wie vielen Dokumenten kommt Wort vor?
+double SearchEngine::calculate_idf(const std::string& term, size_t total_docs, Field field) const {
+    size_t df = index_.get_document_frequency(term, field);  // In wie vielen Dokumenten kommt Wort vor?
     if (df == 0 || total_docs == 0) {
         return 0.0;
     }
@@ -153,36 +1157,373 @@ double SearchEngine::calculate_idf(const std::string& term, size_t total_docs) c
     return std::log(static_cast<double>(total_docs) / static_cast<double>(df));
 }
 
-// Extrahiert einen Textausschnitt (Snippet) aus dem Dokument
-// Zeigt den Bereich um das erste Vorkommen der Suchwörter
-std::string SearchEngine::extract_snippet(const std::string& content, 
-                                          const std::vector<std::string>& query_terms) const {
-    if (content.empty() || query_terms.empty()) {
-        return "";
-    }
-    
-    // Finde erste Position wo eines der Suchwörter vorkommt
+// Position des ersten Vorkommens eines der Suchwörter (npos wenn keins vorkommt)
+// Case-insensitive Suche direkt im Inhalt (keine klein geschriebene Kopie), jedes weitere Wort
+// wird nur noch vor dem bisher frühesten Treffer gesucht
+size_t SearchEngine::first_match(const std::string& content, const std::vector<std::string>& query_terms) {
+    auto same_letter = [](char text_char, char term_char) {
+        return std::tolower(static_cast<unsigned char>(text_char)) == term_char;
+    };
     size_t first_pos = std::string::npos;
     for (const auto& term : query_terms) {
-        // Case-insensitive Suche
-        std::string lower_content = content;
-        std::transform(lower_content.begin(), lower_content.end(), lower_content.begin(), ::tolower);
-        
         std::string lower_term = term;
         std::transform(lower_term.begin(), lower_term.end(), lower_term.begin(), ::tolower);
         
-        size_t pos = lower_content.find(lower_term);
-        if (pos != std::string::npos && (first_pos == std::string::npos || pos < first_pos)) {
-            first_pos = pos;  // Merke früheste Position
+        size_t limit = (first_pos == std::string::npos) ? content.size()
+                                                        : std::min(content.size(), first_pos + lower_term.size());
+        auto found = std::search(content.begin(), content.begin() + limit,
+                                 lower_term.begin(), lower_term.end(), same_letter);
+        if (found != content.begin() + limit) {
+            first_pos = static_cast<size_t>(found - content.begin());  // Merke früheste Position
+        }
+    }
+    return first_pos;
+}
+
+// ---------------------------------------------------------------------------
+// SearchSession: Search-as-you-type
+// Pro Tastendruck ändert sich die Query meist nur am Ende: ein Wort mehr oder ein längeres letztes Wort.
+// Dann wird die Kandidaten Menge der vorigen Query weiter eingeschränkt statt neu geschnitten.
+
+SearchSession::SearchSession(const SearchEngine& engine)
+    : engine_(engine) {}
+
+void SearchSession::reset() noexcept {
+    valid_ = false;
+    extensions_.clear();
+    directories_.clear();
+    ranges_.clear();
+    document_count_ = 0;
+    deleted_count_ = 0;
+    filter_matches_ = 0;
+    terms_.clear();
+    term_postings_.clear();
+    unrestricted_ = true;
+    base_.clear();
+    prefix_.clear();
+    completions_.clear();
+    completion_postings_.clear();
+    prefix_docs_.clear();
+    cursor_ = SearchCursor{};
+}
+
+// candidates = candidates UND (Dokument hat eines der Wörter in irgendeinem Feld)
+// Kleine Kandidaten Menge: jedes Dokument in den Listen nachschlagen (contains ist O(log n) bzw. O(1))
+// Sonst: Listen vereinigen und schneiden
+void SearchSession::narrow(DocIdSet& candidates, const std::vector<const FieldPostings*>& any_of) const {
+    size_t list_count = 0;
+    size_t list_postings = 0;
+    for (const FieldPostings* postings : any_of) {
+        for (const PostingList* list : *postings) {
+            if (list) {
+                ++list_count;
+                list_postings += list->size();
+            }
+        }
+    }
+    
+    if (candidates.size() * list_count < list_postings) {
+        DocIdSet kept;
+        candidates.for_each([&](uint32_t doc_id) {
+            for (const FieldPostings* postings : any_of) {
+                for (const PostingList* list : *postings) {
+                    if (list && list->docs().contains(doc_id)) {
+                        kept.add(doc_id);
+                        return;
+                    }
+                }
+            }
+        });
+        candidates = std::move(kept);
+        return;
+    }
+    
+    DocIdSet matching;
+    for (const FieldPostings* postings : any_of) {
+        for (const PostingList* list : *postings) {
+            if (list) {
+                matching.or_with(list->docs());
+            }
+        }
+    }
+    candidates.and_with(matching);
+}
+
+// Vervollständigungen des letzten Worts: die max_completions häufigsten Wörter mit dem Präfix
+// (Document Frequency im Feld wo sie am häufigsten sind)
+// Dazu die analysierte Form des Präfix ("indexes" -> "index"), die fängt nicht unbedingt mit ihm an
+void SearchSession::find_completions(const std::string& prefix, SearchStats* stats) {
+    const InvertedIndex& index = engine_.index_;
+    using Candidate = std::pair<std::string_view, size_t>;  // (Wort, df)
+    auto more_frequent = [](const Candidate& a, const Candidate& b) {
+        return a.second != b.second ? a.second > b.second : a.first < b.first;
+    };
+    
+    // pro Feld nur die häufigsten behalten: was insgesamt unter den ersten ist, ist es auch in
+    // dem Feld in dem es am häufigsten vorkommt, so bleibt die Auswahl bei langen Bereichen linear
+    std::vector<Candidate> candidates;
+    for (size_t f = 0; f < field_count; ++f) {
+        std::vector<LexiconEntry> entries = index.terms_with_prefix(prefix, static_cast<Field>(f));
+        std::vector<Candidate> field_candidates;
+        field_candidates.reserve(entries.size());
+        for (const auto& entry : entries) {
+            field_candidates.emplace_back(*entry.term, entry.postings->size());
+        }
+        if (field_candidates.size() > max_completions) {
+            std::nth_element(field_candidates.begin(), field_candidates.begin() + max_completions,
+                             field_candidates.end(), more_frequent);
+            field_candidates.resize(max_completions);
+        }
+        candidates.insert(candidates.end(), field_candidates.begin(), field_candidates.end());
+    }
+    std::vector<std::string> analyzed = tokenize(prefix);
+    if (analyzed.size() == 1 && analyzed[0] != prefix) {
+        for (size_t f = 0; f < field_count; ++f) {
+            if (const PostingList* list = index.get_postings(analyzed[0], static_cast<Field>(f))) {
+                candidates.emplace_back(analyzed[0], list->size());
+            }
+        }
+    }
+    
+    // gleiche Wörter aus mehreren Feldern zusammenfassen (größte df), dann die häufigsten
+    std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) {
+        return a.first != b.first ? a.first < b.first : a.second > b.second;
+    });
+    candidates.erase(std::unique(candidates.begin(), candidates.end(),
+                                 [](const Candidate& a, const Candidate& b) { return a.first == b.first; }),
+                     candidates.end());
+    std::sort(candidates.begin(), candidates.end(), more_frequent);
+    if (candidates.size() > max_completions) {
+        candidates.resize(max_completions);
+    }
+    
+    completions_.clear();
+    completion_postings_.clear();
+    for (const auto& candidate : candidates) {
+        completions_.emplace_back(candidate.first);
+        completion_postings_.push_back(engine_.lookup_term(completions_.back(), nullptr, stats));
+    }
+}
+
+std::vector<SearchResult> SearchSession::update(const std::string& query, size_t max_results,
+                                                SearchStats* stats, QueryDeadline* deadline) {
+    if (stats) {
+        *stats = SearchStats{};
+    }
+    cursor_ = SearchCursor{};
+    // Zeit abgelaufen während die Kandidaten eingeschränkt werden: der Cache ist dann halb fertig
+    auto out_of_time = [this, deadline, stats]() {
+        if (!deadline || !deadline->expired()) {
+            return false;
+        }
+        reset();
+        cursor_.complete_ = false;
+        if (stats) {
+            stats->incomplete = true;
+        }
+        return true;
+    };
+    const DocumentStore& doc_store = engine_.doc_store_;
+    
+    // Schritt 1: fertigen Teil der Query und das angefangene letzte Wort trennen
+    // Endet die Query mit Leerzeichen (oder Satzzeichen) ist das letzte Wort fertig
+    // Muster brauchen den ganzen Inhalt jedes Kandidaten, da lohnt kein Cache: normal suchen
+    for (size_t pos = 0; pos < query.size();) {
+        size_t end = std::min(query.find_first_of(" \t\r\n", pos), query.size());
+        if (pattern_marker(query.substr(pos, end - pos))) {
+            reset();
+            cursor_ = engine_.execute(query, stats, nullptr, deadline);
+            return engine_.results(cursor_.next(max_results, stats), cursor_, false, stats);
+        }
+        pos = end + 1;
+    }
+    
+    PhaseTimer tokenize_timer(stats ? &stats->tokenize_ms : nullptr);
+    size_t word_start = query.size();
+    while (word_start > 0 && std::isalnum(static_cast<unsigned char>(query[word_start - 1]))) {
+        --word_start;
+    }
+    std::string head = query;
+    std::string prefix;
+    if (word_start < query.size()) {
+        size_t token_start = query.find_last_of(" \t\r\n", word_start);
+        token_start = (token_start == std::string::npos) ? 0 : token_start + 1;
+        std::string token = query.substr(token_start);
+        std::string marker = lowercase(token.substr(0, 4));
+        if (marker != "ext:" && marker != "dir:" && !metadata_marker(token)) {  // Filter Werte sind keine Präfixe
+            prefix = lowercase(query.substr(word_start));
+            head = query.substr(0, word_start);
+        }
+        if (prefix.size() < SearchSession::min_prefix_length) {
+            prefix.clear();  // ein Buchstabe passt auf einen großen Teil des Vokabulars
+        }
+    }
+    ParsedQuery parsed = parse_query(head);
+    
+    // doppelte Wörter raus, die Reihenfolge bleibt (sonst wird eine Erweiterung nicht erkannt)
+    std::vector<std::string> terms;
+    for (auto& term : parsed.terms) {
+        if (std::find(terms.begin(), terms.end(), term) == terms.end()) {
+            terms.push_back(std::move(term));
+        }
+    }
+    tokenize_timer.stop();
+    if (!parsed.error.empty() || (terms.empty() && prefix.empty() && !parsed.has_filters())) {
+        reset();
+        return {};
+    }
+    
+    // Schritt 2: Basis Kandidaten (Filter UND fertige Wörter)
+    // Gleicher Kontext und die alten Wörter sind ein Anfang der neuen: nur die neuen Wörter einschränken
+    PhaseTimer intersect_timer(stats ? &stats->intersect_ms : nullptr);
+    const DocIdSet& deleted = doc_store.deleted_documents();
+    bool extends = valid_ && parsed.extensions == extensions_ && parsed.directories == directories_ &&
+                   parsed.ranges == ranges_ &&
+                   doc_store.size() == document_count_ && deleted.size() == deleted_count_ &&
+                   terms_.size() <= terms.size() && std::equal(terms_.begin(), terms_.end(), terms.begin());
+    bool base_changed = !extends || terms.size() != terms_.size();
+    
+    if (!extends) {
+        reset();
+        extensions_ = parsed.extensions;
+        directories_ = parsed.directories;
+        ranges_ = parsed.ranges;  // "mtime:>7d" hängt an der Uhr: jede Sekunde ein neuer Filter
+        document_count_ = doc_store.size();
+        deleted_count_ = deleted.size();
+        if (parsed.has_filters()) {
+            if (engine_.build_filter(parsed, base_)) {
+                filter_matches_ = base_.size();
+                base_.and_not(deleted);
+            } else {
+                base_.clear();
+            }
+            unrestricted_ = false;
+        }
+        valid_ = true;
+    }
+    if (stats) {
+        stats->incremental = extends;
+        stats->filtered = parsed.has_filters();
+        stats->filter_matches = filter_matches_;
+    }
+    
+    for (size_t i = 0; i < terms.size(); ++i) {
+        if (i < terms_.size()) {
+            if (stats) {
+                engine_.lookup_term(terms_[i], nullptr, stats);  // nur für --explain
+            }
+            continue;
+        }
+        DocIdSet docs;
+        FieldPostings postings = engine_.lookup_term(terms[i], unrestricted_ ? &docs : nullptr, stats);
+        if (unrestricted_) {
+            base_ = std::move(docs);
+            base_.and_not(deleted);
+            unrestricted_ = false;
+        } else {
+            narrow(base_, {&postings});
+        }
+        terms_.push_back(terms[i]);
+        term_postings_.push_back(postings);
+        if (out_of_time()) {
+            return {};
+        }
+    }
+    if (stats && !unrestricted_) {
+        stats->candidate_sizes.push_back(base_.size());
+    }
+    
+    // Schritt 3: letztes Wort als Präfix
+    // Waren alle neuen Vervollständigungen schon unter den alten, enthält prefix_docs_ alle Treffer
+    // und wird nur weiter eingeschränkt
+    if (prefix.empty()) {
+        prefix_.clear();
+        completions_.clear();
+        completion_postings_.clear();
+        prefix_docs_.clear();
+    } else {
+        bool prefix_extends = !base_changed && !prefix_.empty() && prefix.compare(0, prefix_.size(), prefix_) == 0;
+        std::vector<std::string> previous = std::move(completions_);
+        find_completions(prefix, stats);
+        bool subset = prefix_extends;
+        for (size_t i = 0; i < completions_.size() && subset; ++i) {
+            subset = std::find(previous.begin(), previous.end(), completions_[i]) != previous.end();
+        }
+        
+        std::vector<const FieldPostings*> lists;
+        for (const auto& postings : completion_postings_) {
+            lists.push_back(&postings);
         }
+        if (subset) {
+            narrow(prefix_docs_, lists);
+        } else if (unrestricted_) {
+            prefix_docs_.clear();
+            for (const FieldPostings* postings : lists) {
+                for (const PostingList* list : *postings) {
+                    if (list) {
+                        prefix_docs_.or_with(list->docs());
+                    }
+                }
+            }
+            prefix_docs_.and_not(deleted);
+        } else {
+            prefix_docs_ = base_;
+            narrow(prefix_docs_, lists);
+        }
+        prefix_ = prefix;
+        if (stats) {
+            stats->incremental = stats->incremental && subset;
+            stats->candidate_sizes.push_back(prefix_docs_.size());
+        }
+    }
+    if (out_of_time()) {
+        return {};
+    }
+    const DocIdSet& candidates = prefix.empty() ? base_ : prefix_docs_;
+    intersect_timer.stop();
+    if (candidates.empty()) {
+        return {};
     }
     
-    if (first_pos == std::string::npos) {
-        first_pos = 0;  // Kein Match gefunden, zeige Anfang
+    // Schritt 4: Scoring wie search(), jede Vervollständigung zählt wie ein eigenes Wort
+    PhaseTimer score_timer(stats ? &stats->score_ms : nullptr);
+    size_t total_docs = doc_store.live_count();
+    std::vector<std::pair<uint32_t, double>> doc_scores;
+    doc_scores.reserve(candidates.size());
+    double base = terms_.empty() && completions_.empty() && parsed.recency_half_life > 0 ? 1.0 : 0.0;
+    candidates.for_each([&doc_scores, base](uint32_t doc_id) { doc_scores.emplace_back(doc_id, base); });
+    bool complete = true;
+    auto score = [&](const std::string& term, const FieldPostings& postings) {
+        size_t scored = engine_.score_term(term, postings, total_docs, nullptr, doc_scores,
+                                           complete ? deadline : nullptr);
+        if (scored < doc_scores.size()) {
+            doc_scores.resize(scored);  // wie in execute(): nur die vorderen, dafür fertig gescort
+            complete = false;
+        }
+    };
+    for (size_t i = 0; i < terms_.size(); ++i) {
+        score(terms_[i], term_postings_[i]);
     }
+    for (size_t i = 0; i < completions_.size(); ++i) {
+        score(completions_[i], completion_postings_[i]);
+    }
+    if (parsed.recency_half_life > 0) {
+        engine_.apply_recency(parsed.recency_half_life, doc_scores);
+    }
+    if (stats) {
+        stats->docs_scored = doc_scores.size();
+        stats->incomplete = !complete;
+    }
+    score_timer.stop();
     
-    // Nutze Utility-Funktion um Snippet zu extrahieren (80 Zeichen um Position)
-    return notesearch::extract_snippet(content, first_pos, 80);
+    // Snippet beim ersten Vorkommen eines Worts oder des Präfix
+    std::vector<std::string> snippet_terms = terms_;
+    if (!prefix.empty()) {
+        snippet_terms.push_back(prefix);
+    }
+    cursor_ = engine_.make_cursor(std::move(doc_scores), std::move(snippet_terms));
+    cursor_.complete_ = complete;
+    return engine_.results(cursor_.next(max_results, stats), cursor_, false, stats);
 }
 
 } 
\ No newline at end of file
@@ -0,0 +1,698 @@
+#include "server.hpp"
+#include "json.hpp"
+#include "net.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__linux__)
+#include <sys/epoll.h>
+#include <unistd.h>
+#elif defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <winsock2.h>
+#else
+#include <poll.h>
+#endif
+
+namespace notesearch {
+
+namespace {
+
+constexpr int poll_timeout_ms = 200;  // so oft wird stop_requested_ geprüft
+
+// Poller: wartet auf lesbare / schreibbare Sockets
+// Linux: epoll (O(1) pro Event), sonst poll() bzw. WSAPoll() über eine pollfd Liste
+class Poller {
+public:
+    struct Event {
+        socket_t sock;
+        bool readable;
+        bool writable;
+        bool error;
+    };
+
+#if defined(__linux__)
+    Poller() : epoll_fd_(epoll_create1(EPOLL_CLOEXEC)) {}
+    ~Poller() {
+        if (epoll_fd_ >= 0) {
+            close(epoll_fd_);
+        }
+    }
+
+    bool ok() const noexcept { return epoll_fd_ >= 0; }
+
+    void add(socket_t sock, bool want_read, bool want_write) {
+        epoll_event event = make_event(sock, want_read, want_write);
+        epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, sock, &event);
+    }
+
+    void modify(socket_t sock, bool want_read, bool want_write) {
+        epoll_event event = make_event(sock, want_read, want_write);
+        epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, sock, &event);
+    }
+
+    void remove(socket_t sock) {
+        epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, sock, nullptr);
+    }
+
+    void wait(std::vector<Event>& events, int timeout_ms) {
+        epoll_event raw[128];
+        int count = epoll_wait(epoll_fd_, raw, 128, timeout_ms);
+        events.clear();
+        for (int i = 0; i < count; ++i) {
+            events.push_back({raw[i].data.fd,
+                              (raw[i].events & (EPOLLIN | EPOLLRDHUP)) != 0,
+                              (raw[i].events & EPOLLOUT) != 0,
+                              (raw[i].events & (EPOLLERR | EPOLLHUP)) != 0});
+        }
+    }
+
+private:
+    int epoll_fd_;
+
+    static epoll_event make_event(socket_t sock, bool want_read, bool want_write) {
+        epoll_event event{};
+        event.events = (want_read ? EPOLLIN | EPOLLRDHUP : 0u) | (want_write ? EPOLLOUT : 0u);
+        event.data.fd = sock;
+        return event;
+    }
+#else
+#ifdef _WIN32
+    using pollfd_t = WSAPOLLFD;
+#else
+    using pollfd_t = pollfd;
+#endif
+
+    bool ok() const noexcept { return true; }
+
+    void add(socket_t sock, bool want_read, bool want_write) {
+        positions_[sock] = fds_.size();
+        pollfd_t entry{};
+        entry.fd = sock;
+        entry.events = make_events(want_read, want_write);
+        fds_.push_back(entry);
+    }
+
+    void modify(socket_t sock, bool want_read, bool want_write) {
+        auto it = positions_.find(sock);
+        if (it != positions_.end()) {
+            fds_[it->second].events = make_events(want_read, want_write);
+        }
+    }
+
+    void remove(socket_t sock) {
+        auto it = positions_.find(sock);
+        if (it == positions_.end()) {
+            return;
+        }
+        // mit dem letzten Eintrag tauschen, damit das Entfernen O(1) bleibt
+        size_t position = it->second;
+        positions_.erase(it);
+        if (position + 1 != fds_.size()) {
+            fds_[position] = fds_.back();
+            positions_[static_cast<socket_t>(fds_[position].fd)] = position;
+        }
+        fds_.pop_back();
+    }
+
+    void wait(std::vector<Event>& events, int timeout_ms) {
+        events.clear();
+#ifdef _WIN32
+        int count = WSAPoll(fds_.data(), static_cast<ULONG>(fds_.size()), timeout_ms);
+#else
+        int count = poll(fds_.data(), static_cast<nfds_t>(fds_.size()), timeout_ms);
+#endif
+        if (count <= 0) {
+            return;
+        }
+        for (const auto& entry : fds_) {
+            if (entry.revents != 0) {
+                events.push_back({static_cast<socket_t>(entry.fd),
+                                  (entry.revents & POLLIN) != 0,
+                                  (entry.revents & POLLOUT) != 0,
+                                  (entry.revents & (POLLERR | POLLHUP | POLLNVAL)) != 0});
+            }
+        }
+    }
+
+private:
+    std::vector<pollfd_t> fds_;
+    std::unordered_map<socket_t, size_t> positions_;
+
+    static short make_events(bool want_read, bool want_write) {
+        return static_cast<short>((want_read ? POLLIN : 0) | (want_write ? POLLOUT : 0));
+    }
+#endif
+};
+
+// Eine Client Verbindung, gehört dem Event Loop Thread
+struct Connection {
+    socket_t sock = invalid_socket;
+    uint64_t id = 0;               // unterscheidet wiederverwendete Socket Nummern
+    std::string in_buffer;         // empfangene, noch nicht verarbeitete Bytes
+    std::string out_buffer;        // fertige Antworten, noch nicht gesendet
+    uint64_t next_seq = 0;         // Sequenznummer für den nächsten Request
+    uint64_t next_write_seq = 0;   // nächste Antwort die gesendet werden darf
+    std::map<uint64_t, std::string> finished;  // Antworten die auf ihre Vorgänger warten
+    bool read_closed = false;      // Client hat seine Seite geschlossen
+    bool reading = true;           // false wenn zu viele Requests offen sind
+    bool writing = false;          // Poller wartet auf POLLOUT
+};
+
+struct Job {
+    socket_t sock;
+    uint64_t connection_id;
+    uint64_t seq;
+    std::string request;
+};
+
+struct Completion {
+    socket_t sock;
+    uint64_t connection_id;
+    uint64_t seq;
+    std::string response;
+};
+
+void append_explain(std::string& out, const SearchStats& stats) {
+    out += ",\"stats\":{\"terms\":[";
+    for (size_t i = 0; i < stats.terms.size(); ++i) {
+        if (i > 0) out += ',';
+        out += "{\"term\":";
+        json_append_string(out, stats.terms[i].term);
+        out += ",\"df\":" + std::to_string(stats.terms[i].document_frequency) + "}";
+    }
+    out += ']';
+    if (stats.filtered) {
+        out += ",\"filter_matches\":" + std::to_string(stats.filter_matches);
+    }
+    if (!stats.patterns.empty()) {
+        out += ",\"patterns\":[";
+        for (size_t i = 0; i < stats.patterns.size(); ++i) {
+            if (i > 0) out += ',';
+            out += "{\"pattern\":";
+            json_append_string(out, stats.patterns[i].pattern);
+            out += ",\"trigrams\":";
+            json_append_string(out, stats.patterns[i].trigram_query);
+            out += ",\"matches\":" + std::to_string(stats.patterns[i].trigram_matches) + "}";
+        }
+        out += "],\"docs_verified\":" + std::to_string(stats.docs_verified);
+    }
+    out += ",\"postings_scanned\":" + std::to_string(stats.postings_scanned);
+    out += ",\"candidates\":[";
+    for (size_t i = 0; i < stats.candidate_sizes.size(); ++i) {
+        if (i > 0) out += ',';
+        out += std::to_string(stats.candidate_sizes[i]);
+    }
+    out += "],\"docs_scored\":" + std::to_string(stats.docs_scored);
+    out += ",\"collapsed\":" + std::to_string(stats.collapsed);
+    out += std::string(",\"incomplete\":") + (stats.incomplete ? "true" : "false");
+    out += ",\"arena_bytes\":" + std::to_string(stats.arena_bytes);
+    out += ",\"arena_blocks\":" + std::to_string(stats.arena_blocks);
+    out += ",\"tokenize_ms\":" + JsonValue(stats.tokenize_ms).dump();
+    out += ",\"intersect_ms\":" + JsonValue(stats.intersect_ms).dump();
+    out += ",\"verify_ms\":" + JsonValue(stats.verify_ms).dump();
+    out += ",\"score_ms\":" + JsonValue(stats.score_ms).dump();
+    out += ",\"sort_ms\":" + JsonValue(stats.sort_ms).dump();
+    out += ",\"snippet_ms\":" + JsonValue(stats.snippet_ms).dump();
+    out += '}';
+}
+
+// eine Anzahl vom Client: endlich, nicht negativ und auf max gekappt bevor sie zu size_t wird
+// (1e300, inf oder NaN wären beim Cast undefiniert)
+bool parse_count(const JsonValue& value, size_t max, size_t& count) {
+    if (!value.is_number() || !std::isfinite(value.as_number()) || value.as_number() < 0) {
+        return false;
+    }
+    double number = value.as_number();
+    count = number >= static_cast<double>(max) ? max : static_cast<size_t>(number);
+    return true;
+}
+
+std::string error_response(const std::string& id_json, const std::string& message) {
+    std::string out = "{\"id\":" + id_json + ",\"error\":";
+    json_append_string(out, message);
+    out += '}';
+    return out;
+}
+
+} // namespace
+
+bool parse_query_budget(const JsonValue& request, double& budget_ms) {
+    if (const JsonValue* budget = request.find("budget_ms")) {
+        if (!budget->is_number() || budget->as_number() < 0) {
+            return false;
+        }
+        budget_ms = budget->as_number();
+    }
+    return true;
+}
+
+bool parse_result_count(const JsonValue& request, size_t& max_results) {
+    const JsonValue* k = request.find("k");
+    return !k || parse_count(*k, UINT32_MAX, max_results);
+}
+
+std::string handle_query_request(const SearchEngine& engine, std::string_view request_line,
+                                 double default_budget_ms) {
+    auto request = JsonValue::parse(request_line);
+    if (!request || !request->is_object()) {
+        return error_response("null", "request must be a JSON object");
+    }
+
+    // id wird unverändert zurückgegeben, damit der Client Antworten zuordnen kann
+    const JsonValue* id = request->find("id");
+    std::string id_json = id ? id->dump() : "null";
+
+    const JsonValue* query = request->find("q");
+    if (!query || !query->is_string()) {
+        return error_response(id_json, "missing string field 'q'");
+    }
+    std::string query_error;
+    if (!SearchEngine::check_query(query->as_string(), &query_error)) {
+        return error_response(id_json, query_error);
+    }
+
+    size_t max_results = 10;
+    if (!parse_result_count(*request, max_results)) {
+        return error_response(id_json, "'k' must be a non-negative number");
+    }
+
+    // Sharding, Runde 1: nur die lokalen Statistiken für die globale IDF
+    const JsonValue* df = request->find("df");
+    if (df && df->is_bool() && df->as_bool()) {
+        std::string out = "{\"id\":" + id_json + ",";
+        append_collection_stats(out, engine.collection_stats(query->as_string()));
+        out += '}';
+        return out;
+    }
+
+    // Sharding, Runde 2: mit den summierten Statistiken aller Shards scoren
+    CollectionStats collection;
+    const JsonValue* global = request->find("global");
+    if (global && !parse_collection_stats(*global, collection)) {
+        return error_response(id_json, "malformed 'global' statistics");
+    }
+
+    const JsonValue* explain = request->find("explain");
+    bool want_stats = explain && explain->is_bool() && explain->as_bool();
+
+    // Zeitbudget ab hier, die Wartezeit in der Job Queue zählt nicht mit
+    double budget_ms = default_budget_ms;
+    if (!parse_query_budget(*request, budget_ms)) {
+        return error_response(id_json, "'budget_ms' must be a non-negative number");
+    }
+    QueryDeadline deadline(budget_ms);
+
+    SearchStats stats;
+    SearchStats* query_stats = want_stats ? &stats : nullptr;
+    auto start = std::chrono::steady_clock::now();
+    SearchCursor cursor = engine.execute(query->as_string(), query_stats, global ? &collection : nullptr,
+                                         budget_ms > 0.0 ? &deadline : nullptr);
+    auto results = engine.results(cursor.next(max_results, query_stats), cursor, false, query_stats);
+    double took_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    std::string out = "{\"id\":" + id_json + ",\"results\":[";
+    for (size_t i = 0; i < results.size(); ++i) {
+        if (i > 0) out += ',';
+        out += "{\"path\":";
+        json_append_string(out, results[i].path);
+        out += ",\"score\":" + JsonValue(results[i].score).dump();
+        out += ",\"snippet\":";
+        json_append_string(out, results[i].snippet);
+        if (!results[i].copies.empty()) {
+            out += ",\"copies\":[";
+            for (size_t j = 0; j < results[i].copies.size(); ++j) {
+                if (j > 0) out += ',';
+                json_append_string(out, results[i].copies[j]);
+            }
+            out += ']';
+        }
+        if (results[i].collapsed > 0) {
+            out += ",\"collapsed\":" + std::to_string(results[i].collapsed);
+        }
+        out += '}';
+    }
+    out += "],\"took_ms\":" + JsonValue(took_ms).dump();
+    if (!cursor.complete()) {
+        out += ",\"incomplete\":true";
+    }
+    if (want_stats) {
+        append_explain(out, stats);
+    }
+    out += '}';
+    return out;
+}
+
+void append_collection_stats(std::string& out, const CollectionStats& collection) {
+    out += "\"docs\":" + std::to_string(collection.total_docs) + ",\"df\":{";
+    bool first = true;
+    for (const auto& [term, frequencies] : collection.document_frequencies) {
+        if (!first) out += ',';
+        first = false;
+        json_append_string(out, term);
+        out += ":[";
+        for (size_t f = 0; f < field_count; ++f) {
+            if (f > 0) out += ',';
+            out += std::to_string(frequencies[f]);
+        }
+        out += ']';
+    }
+    out += '}';
+}
+
+bool parse_collection_stats(const JsonValue& value, CollectionStats& collection) {
+    const JsonValue* docs = value.find("docs");
+    const JsonValue* df = value.find("df");
+    if (!docs || !parse_count(*docs, SIZE_MAX, collection.total_docs) || !df || !df->is_object()) {
+        return false;
+    }
+    for (const auto& [term, frequencies] : df->as_object()) {
+        if (!frequencies.is_array() || frequencies.as_array().size() != field_count) {
+            return false;
+        }
+        auto& target = collection.document_frequencies[term];
+        for (size_t f = 0; f < field_count; ++f) {
+            if (!parse_count(frequencies.as_array()[f], SIZE_MAX, target[f])) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Alles was vom Betriebssystem abhängt bleibt hier, damit server.hpp keine Socket Header braucht
+struct QueryServer::Impl {
+    socket_t listener = invalid_socket;
+    socket_t wake[2] = {invalid_socket, invalid_socket};  // Worker wecken den Event Loop über wake[1]
+    Poller poller;
+
+    std::unordered_map<socket_t, Connection> connections;
+    uint64_t next_connection_id = 1;
+
+    // Job Queue für die Worker
+    std::mutex job_mutex;
+    std::condition_variable job_ready;
+    std::deque<Job> jobs;
+    bool shutting_down = false;
+    std::vector<std::thread> workers;
+
+    // fertige Antworten zurück an den Event Loop
+    std::mutex completion_mutex;
+    std::vector<Completion> completions;
+
+    ~Impl() {
+        for (auto& pair : connections) {
+            close_socket(pair.first);
+        }
+        close_socket(listener);
+        close_socket(wake[0]);
+        close_socket(wake[1]);
+    }
+};
+
+QueryServer::QueryServer(const InvertedIndex& index, const DocumentStore& doc_store, ServerConfig config)
+    : QueryServer([&index, &doc_store, budget_ms = config.query_budget_ms, hot_terms = config.hot_terms]() -> RequestHandler {
+          // jeder Worker hat seine eigene SearchEngine auf dem gemeinsamen Index (und den gemeinsamen HotTerms)
+          auto engine = std::make_shared<SearchEngine>(index, doc_store);
+          engine->set_hot_terms(hot_terms);
+          return [engine, budget_ms](std::string_view request) {
+              return handle_query_request(*engine, request, budget_ms);
+          };
+      }, std::move(config)) {}
+
+QueryServer::QueryServer(std::function<RequestHandler()> make_handler, ServerConfig config)
+    : make_handler_(std::move(make_handler)), config_(std::move(config)), impl_(std::make_unique<Impl>()) {}
+
+QueryServer::~QueryServer() {
+    {
+        std::lock_guard<std::mutex> lock(impl_->job_mutex);
+        impl_->shutting_down = true;
+    }
+    impl_->job_ready.notify_all();
+    for (auto& worker : impl_->workers) {
+        worker.join();
+    }
+}
+
+bool QueryServer::start(std::string* error) {
+    if (!net_init() || !impl_->poller.ok()) {
+        if (error) *error = "could not initialize the socket layer";
+        return false;
+    }
+
+    impl_->listener = config_.unix_socket_path.empty()
+        ? listen_tcp(config_.tcp_port, error)
+        : listen_unix(config_.unix_socket_path, error);
+    if (impl_->listener == invalid_socket) {
+        return false;
+    }
+
+    if (!make_socket_pair(impl_->wake)) {
+        if (error) *error = "could not create wakeup socket pair";
+        return false;
+    }
+    set_nonblocking(impl_->listener);
+    set_nonblocking(impl_->wake[0]);
+    set_nonblocking(impl_->wake[1]);
+
+    // Worker Pool: jeder Worker bekommt seinen eigenen Handler (SearchEngine bzw. Shard Verbindungen)
+    size_t thread_count = config_.worker_threads;
+    if (thread_count == 0) {
+        thread_count = std::max(1u, std::thread::hardware_concurrency());
+    }
+    Impl* impl = impl_.get();
+    for (size_t i = 0; i < thread_count; ++i) {
+        impl->workers.emplace_back([impl, handler = make_handler_()] {
+            while (true) {
+                Job job;
+                {
+                    std::unique_lock<std::mutex> lock(impl->job_mutex);
+                    impl->job_ready.wait(lock, [impl] { return impl->shutting_down || !impl->jobs.empty(); });
+                    if (impl->shutting_down) {
+                        return;
+                    }
+                    job = std::move(impl->jobs.front());
+                    impl->jobs.pop_front();
+                }
+
+                std::string response = handler(job.request);
+                response += '\n';
+
+                bool was_empty;
+                {
+                    std::lock_guard<std::mutex> lock(impl->completion_mutex);
+                    was_empty = impl->completions.empty();
+                    impl->completions.push_back({job.sock, job.connection_id, job.seq, std::move(response)});
+                }
+                if (was_empty) {
+                    // nur beim ersten Eintrag wecken, der Event Loop holt alle auf einmal ab
+                    char byte = 1;
+                    send_some(impl->wake[1], &byte, 1);
+                }
+            }
+        });
+    }
+    return true;
+}
+
+void QueryServer::run() {
+    Impl& impl = *impl_;
+    impl.poller.add(impl.listener, true, false);
+    impl.poller.add(impl.wake[0], true, false);
+
+    auto update_interest = [&impl](Connection& conn) {
+        impl.poller.modify(conn.sock, conn.reading && !conn.read_closed, conn.writing);
+    };
+
+    auto close_connection = [&impl](socket_t sock) {
+        impl.poller.remove(sock);
+        close_socket(sock);
+        impl.connections.erase(sock);  // spätere Completions für diese Verbindung werden verworfen
+    };
+
+    // Sendet so viel wie möglich, true wenn die Verbindung offen bleibt
+    auto flush = [&](Connection& conn) {
+        while (!conn.out_buffer.empty()) {
+            long sent = send_some(conn.sock, conn.out_buffer.data(), conn.out_buffer.size());
+            if (sent < 0) {
+                if (last_error_would_block()) {
+                    break;
+                }
+                return false;
+            }
+            conn.out_buffer.erase(0, static_cast<size_t>(sent));
+        }
+
+        bool want_write = !conn.out_buffer.empty();
+        bool all_answered = conn.next_write_seq == conn.next_seq;
+        if (conn.read_closed && all_answered && !want_write) {
+            return false;  // Client ist fertig und hat alle Antworten bekommen
+        }
+        if (want_write != conn.writing) {
+            conn.writing = want_write;
+            update_interest(conn);
+        }
+        return true;
+    };
+
+    // Zerlegt in_buffer in Zeilen und gibt sie an die Worker, true wenn die Verbindung offen bleibt
+    auto dispatch_lines = [&](Connection& conn) {
+        size_t start = 0;
+        std::vector<Job> new_jobs;
+        while (conn.next_seq - conn.next_write_seq < config_.max_inflight_per_connection) {
+            size_t newline = conn.in_buffer.find('\n', start);
+            if (newline == std::string::npos) {
+                break;
+            }
+            std::string line = conn.in_buffer.substr(start, newline - start);
+            start = newline + 1;
+            if (!line.empty() && line.back() == '\r') {
+                line.pop_back();
+            }
+            if (line.empty()) {
+                continue;
+            }
+            new_jobs.push_back({conn.sock, conn.id, conn.next_seq++, std::move(line)});
+        }
+        conn.in_buffer.erase(0, start);
+
+        if (!new_jobs.empty()) {
+            {
+                std::lock_guard<std::mutex> lock(impl.job_mutex);
+                for (auto& job : new_jobs) {
+                    impl.jobs.push_back(std::move(job));
+                }
+            }
+            impl.job_ready.notify_all();
+        }
+
+        // Backpressure: zu viele offene Requests, erst weiterlesen wenn Antworten raus sind
+        bool can_read = conn.next_seq - conn.next_write_seq < config_.max_inflight_per_connection;
+        if (can_read && conn.in_buffer.size() > config_.max_line_bytes) {
+            return false;  // Zeile ohne '\n' ist zu lang
+        }
+        if (can_read != conn.reading) {
+            conn.reading = can_read;
+            update_interest(conn);
+        }
+        return true;
+    };
+
+    auto handle_readable = [&](Connection& conn) {
+        char chunk[16384];
+        while (true) {
+            long received = recv_some(conn.sock, chunk, sizeof(chunk));
+            if (received > 0) {
+                conn.in_buffer.append(chunk, static_cast<size_t>(received));
+                if (conn.in_buffer.size() > config_.max_line_bytes + sizeof(chunk)) {
+                    break;  // erst verarbeiten, dispatch_lines prüft die Zeilenlänge
+                }
+                continue;
+            }
+            if (received < 0 && last_error_would_block()) {
+                break;
+            }
+            // 0 = Client hat geschrieben und seine Seite geschlossen, Antworten noch senden
+            conn.read_closed = true;
+            update_interest(conn);
+            break;
+        }
+        return dispatch_lines(conn) && flush(conn);
+    };
+
+    auto handle_completions = [&]() {
+        char drain[256];
+        while (recv_some(impl.wake[0], drain, sizeof(drain)) > 0) {
+        }
+
+        std::vector<Completion> ready;
+        {
+            std::lock_guard<std::mutex> lock(impl.completion_mutex);
+            ready.swap(impl.completions);
+        }
+
+        for (auto& completion : ready) {
+            auto it = impl.connections.find(completion.sock);
+            if (it == impl.connections.end() || it->second.id != completion.connection_id) {
+                continue;  // Verbindung wurde inzwischen geschlossen
+            }
+            Connection& conn = it->second;
+            conn.finished.emplace(completion.seq, std::move(completion.response));
+
+            // Antworten in Request Reihenfolge anhängen (Pipelining)
+            auto next = conn.finished.find(conn.next_write_seq);
+            while (next != conn.finished.end()) {
+                conn.out_buffer += next->second;
+                conn.finished.erase(next);
+                ++conn.next_write_seq;
+                next = conn.finished.find(conn.next_write_seq);
+            }
+
+            // evtl. gepufferte Zeilen nachschieben, falls das Lesen pausiert war
+            if (!dispatch_lines(conn) || !flush(conn)) {
+                close_connection(conn.sock);
+            }
+        }
+    };
+
+    std::vector<Poller::Event> events;
+    while (!stop_requested_.load()) {
+        impl.poller.wait(events, poll_timeout_ms);
+
+        for (const auto& event : events) {
+            if (event.sock == impl.listener) {
+                while (true) {
+                    socket_t client = accept_connection(impl.listener);
+                    if (client == invalid_socket) {
+                        break;
+                    }
+                    set_nonblocking(client);
+                    Connection conn;
+                    conn.sock = client;
+                    conn.id = impl.next_connection_id++;
+                    impl.connections[client] = std::move(conn);
+                    impl.poller.add(client, true, false);
+                }
+                continue;
+            }
+
+            if (event.sock == impl.wake[0]) {
+                handle_completions();
+                continue;
+            }
+
+            auto it = impl.connections.find(event.sock);
+            if (it == impl.connections.end()) {
+                continue;
+            }
+            Connection& conn = it->second;
+
+            // beide Richtungen geschlossen: offene Antworten kann niemand mehr lesen
+            bool keep_open = !(event.error && conn.read_closed);
+            if (keep_open && (event.readable || event.error)) {
+                keep_open = handle_readable(conn);
+            }
+            if (keep_open && event.writable) {
+                keep_open = flush(conn);
+            }
+            if (!keep_open) {
+                close_connection(event.sock);
+            }
+        }
+    }
+
+    if (!config_.unix_socket_path.empty()) {
+        std::remove(config_.unix_socket_path.c_str());
+    }
+}
+
+} // namespace notesearch
@@ -0,0 +1,258 @@
+#include "shard.hpp"
+#include "dedup.hpp"
+#include "server.hpp"
+#include <algorithm>
+#include <chrono>
+
+namespace notesearch {
+
+namespace {
+
+std::string error_response(const std::string& id_json, const std::string& message) {
+    std::string out = "{\"id\":" + id_json + ",\"error\":";
+    json_append_string(out, message);
+    out += '}';
+    return out;
+}
+
+double elapsed_ms(std::chrono::steady_clock::time_point since) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - since).count();
+}
+
+} // namespace
+
+size_t shard_of(const std::filesystem::path& relative_path, size_t shard_count) {
+    if (shard_count <= 1) {
+        return 0;
+    }
+    // generic_string: gleiche Zuordnung mit / und \ als Trenner
+    return static_cast<size_t>(hash_bytes(relative_path.generic_string()) % shard_count);
+}
+
+bool ShardAddress::parse(const std::string& text, ShardAddress& address) {
+    if (text.empty()) {
+        return false;
+    }
+    address = ShardAddress{};
+    if (text.find_first_not_of("0123456789") != std::string::npos) {
+        address.unix_socket_path = text;
+        return true;
+    }
+    unsigned long port = text.size() <= 5 ? std::stoul(text) : 0;
+    if (port == 0 || port > 65535) {
+        return false;
+    }
+    address.tcp_port = static_cast<uint16_t>(port);
+    return true;
+}
+
+std::string ShardAddress::to_string() const {
+    return unix_socket_path.empty() ? "127.0.0.1:" + std::to_string(tcp_port) : unix_socket_path;
+}
+
+ShardCoordinator::ShardCoordinator(std::vector<ShardAddress> shards) {
+    shards_.reserve(shards.size());
+    for (auto& address : shards) {
+        shards_.push_back({std::move(address), invalid_socket, std::string()});
+    }
+}
+
+ShardCoordinator::~ShardCoordinator() {
+    for (auto& shard : shards_) {
+        disconnect(shard);
+    }
+}
+
+bool ShardCoordinator::connect(Shard& shard) {
+    if (shard.sock != invalid_socket) {
+        return true;
+    }
+    shard.sock = shard.address.unix_socket_path.empty()
+        ? connect_tcp(shard.address.tcp_port)
+        : connect_unix(shard.address.unix_socket_path);
+    return shard.sock != invalid_socket;
+}
+
+void ShardCoordinator::disconnect(Shard& shard) noexcept {
+    close_socket(shard.sock);
+    shard.sock = invalid_socket;
+    shard.buffer.clear();  // Rest einer alten Antwort gehört nicht zur neuen Verbindung
+}
+
+bool ShardCoordinator::exchange(const std::vector<std::string>& requests, std::vector<JsonValue>& responses,
+                                std::string& error) {
+    // Scatter: erst an alle senden, die Shards suchen dann parallel
+    std::vector<bool> sent(shards_.size());
+    for (size_t i = 0; i < shards_.size(); ++i) {
+        sent[i] = connect(shards_[i]) && send_all(shards_[i].sock, requests[i] + "\n");
+    }
+
+    // Gather: Antworten in Shard Reihenfolge einsammeln
+    // Auch nach einem Fehler weiterlesen, sonst hängen alte Antworten in den anderen Verbindungen
+    responses.assign(shards_.size(), JsonValue());
+    error.clear();
+    for (size_t i = 0; i < shards_.size(); ++i) {
+        Shard& shard = shards_[i];
+        std::string line;
+        bool received = sent[i] && recv_line(shard.sock, shard.buffer, line);
+        if (!received) {
+            // Verbindung verloren (Shard neu gestartet?): einmal neu verbinden und wiederholen
+            disconnect(shard);
+            received = connect(shard) && send_all(shard.sock, requests[i] + "\n") &&
+                       recv_line(shard.sock, shard.buffer, line);
+        }
+        if (!received) {
+            disconnect(shard);
+            if (error.empty()) {
+                error = "shard " + shard.address.to_string() + " is unavailable";
+            }
+            continue;
+        }
+
+        auto response = JsonValue::parse(line);
+        if (!response || !response->is_object()) {
+            if (error.empty()) {
+                error = "shard " + shard.address.to_string() + " sent a malformed response";
+            }
+            continue;
+        }
+        if (const JsonValue* message = response->find("error")) {
+            if (error.empty()) {
+                error = "shard " + shard.address.to_string() + ": " +
+                        (message->is_string() ? message->as_string() : message->dump());
+            }
+            continue;
+        }
+        responses[i] = std::move(*response);
+    }
+    return error.empty();
+}
+
+std::string ShardCoordinator::handle_request(std::string_view request_line, double default_budget_ms) {
+    auto request = JsonValue::parse(request_line);
+    if (!request || !request->is_object()) {
+        return error_response("null", "request must be a JSON object");
+    }
+
+    const JsonValue* id = request->find("id");
+    std::string id_json = id ? id->dump() : "null";
+
+    const JsonValue* query = request->find("q");
+    if (!query || !query->is_string()) {
+        return error_response(id_json, "missing string field 'q'");
+    }
+    std::string query_error;
+    if (!SearchEngine::check_query(query->as_string(), &query_error)) {
+        return error_response(id_json, query_error);  // die Shards würden dasselbe melden
+    }
+
+    size_t max_results = 10;
+    if (!parse_result_count(*request, max_results)) {
+        return error_response(id_json, "'k' must be a non-negative number");
+    }
+
+    const JsonValue* explain = request->find("explain");
+    bool want_stats = explain && explain->is_bool() && explain->as_bool();
+    double budget_ms = default_budget_ms;
+    if (!parse_query_budget(*request, budget_ms)) {
+        return error_response(id_json, "'budget_ms' must be a non-negative number");
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::string query_json;
+    json_append_string(query_json, query->as_string());
+
+    // Runde 1: Document Frequencies aller Shards summieren (globale IDF)
+    std::vector<JsonValue> responses;
+    std::string error;
+    std::vector<std::string> requests(shards_.size(), "{\"id\":0,\"q\":" + query_json + ",\"df\":true}");
+    if (!exchange(requests, responses, error)) {
+        return error_response(id_json, error);
+    }
+    CollectionStats collection;
+    for (const auto& response : responses) {
+        CollectionStats shard_stats;
+        if (!parse_collection_stats(response, shard_stats)) {
+            return error_response(id_json, "shard sent malformed statistics");
+        }
+        collection.merge(shard_stats);
+    }
+    double df_ms = elapsed_ms(start);
+
+    // Runde 2: jeder Shard sucht mit den globalen Statistiken und liefert seine Top-k
+    auto search_start = std::chrono::steady_clock::now();
+    std::string search_request = "{\"id\":0,\"q\":" + query_json + ",\"k\":" + std::to_string(max_results) +
+                                 ",\"explain\":" + (want_stats ? "true" : "false");
+    if (budget_ms > 0.0) {
+        // was Runde 1 übrig gelassen hat, mindestens ein Hauch (sonst hieße 0 "ohne Grenze")
+        search_request += ",\"budget_ms\":" + JsonValue(std::max(budget_ms - df_ms, 0.001)).dump();
+    }
+    search_request += ",\"global\":{";
+    append_collection_stats(search_request, collection);
+    search_request += "}}";
+    requests.assign(shards_.size(), search_request);
+    if (!exchange(requests, responses, error)) {
+        return error_response(id_json, error);
+    }
+    double search_ms = elapsed_ms(search_start);
+
+    // Merge: alle Scores sind global vergleichbar, bei Gleichstand Shard und Rang (stabile Reihenfolge)
+    auto merge_start = std::chrono::steady_clock::now();
+    struct Hit {
+        double score;
+        size_t shard;
+        size_t rank;
+        const JsonValue* result;
+    };
+    std::vector<Hit> hits;
+    bool incomplete = false;
+    for (size_t i = 0; i < responses.size(); ++i) {
+        const JsonValue* shard_incomplete = responses[i].find("incomplete");
+        incomplete = incomplete || (shard_incomplete && shard_incomplete->is_bool() && shard_incomplete->as_bool());
+        const JsonValue* results = responses[i].find("results");
+        if (!results || !results->is_array()) {
+            return error_response(id_json, "shard " + shards_[i].address.to_string() + " sent no results");
+        }
+        const auto& list = results->as_array();
+        for (size_t rank = 0; rank < list.size(); ++rank) {
+            const JsonValue* score = list[rank].find("score");
+            hits.push_back({score && score->is_number() ? score->as_number() : 0.0, i, rank, &list[rank]});
+        }
+    }
+    std::sort(hits.begin(), hits.end(), [](const Hit& a, const Hit& b) {
+        if (a.score != b.score) return a.score > b.score;
+        return a.shard != b.shard ? a.shard < b.shard : a.rank < b.rank;
+    });
+    if (max_results > 0 && hits.size() > max_results) {
+        hits.resize(max_results);
+    }
+
+    std::string out = "{\"id\":" + id_json + ",\"results\":[";
+    for (size_t i = 0; i < hits.size(); ++i) {
+        if (i > 0) out += ',';
+        out += hits[i].result->dump();
+    }
+    double merge_ms = elapsed_ms(merge_start);
+    out += "],\"took_ms\":" + JsonValue(elapsed_ms(start)).dump();
+    if (incomplete) {
+        out += ",\"incomplete\":true";  // mindestens ein Shard hat nur Teilergebnisse
+    }
+    if (want_stats) {
+        out += ",\"stats\":{\"shards\":" + std::to_string(shards_.size());
+        out += ",\"docs\":" + std::to_string(collection.total_docs);
+        out += ",\"df_ms\":" + JsonValue(df_ms).dump();
+        out += ",\"search_ms\":" + JsonValue(search_ms).dump();
+        out += ",\"merge_ms\":" + JsonValue(merge_ms).dump();
+        out += ",\"shard_stats\":[";
+        for (size_t i = 0; i < responses.size(); ++i) {
+            if (i > 0) out += ',';
+            const JsonValue* shard_stats = responses[i].find("stats");
+            out += shard_stats ? shard_stats->dump() : "null";
+        }
+        out += "]}";
+    }
+    out += '}';
+    return out;
+}
+
+} // namespace notesearch
@@ -1,13 +1,15 @@
 #include "tokenizer.hpp"
-#include <cctype>
+#include "analyzer.hpp"
+#include "dedup.hpp"
 
 namespace notesearch { 
     // mamespace ist container für Funktionen, Variablen also keine Klasse
     // ziel ist verhinderung Namenskonflikte mit anderen Libraries
 
-    std::vector<std::string> tokenize(const std::string &text) {
-        // Parameter  .... const std::string &text
-        // &  ..... Referenz (keine Kopie, spart Memory)
+    std::vector<std::string> tokenize(std::string_view text) {
+        // Parameter  .... std::string_view text
+        // string_view ..... nur Pointer + Länge (keine Kopie, spart Memory), 
+        // funktioniert für std::string und für gemappte Dateien
         
         std::vector<std::string> tokens; 
         // Vector ist ein dynamisches Array von Strings
@@ -18,53 +20,78 @@ namespace notesearch {
         // - Reserviert Memory im vorhinen .. das vermeidet Reallokationen 
         // - Reallokation ist teuer (kopiert alle Elemente)
         
-        std::string current_token;
+        // Regeln stecken im Analyzer: Filter Kette wird zur Compile Zeit zusammengesetzt,
+        // pro Token also nur inline Aufrufe, keine virtuellen Funktionen
+        const DefaultAnalyzer analyzer;
+        analyzer.analyze(text, [&tokens](std::string&& token) {
+            tokens.emplace_back(std::move(token));
+            // - emplace_back() = konstruiert direkt im Container (schneller als push_back)
+            // - std::move() = übergibt Besitz statt Kopie (spart Zeit bei großen Strings)
+        });
         
-        current_token.reserve(16); 
-        // Performance Optimierung wieder
-        // - reserviert 16 Zeichen (16 ist eine typische Wortlänge)
-        // - vrermeidet Reallokationen auch..
-        
-        for (char c : text) { 
-            // Range based for loop.. iteriert über jeden Charakter
-            
-            if (std::isalnum(c)) { 
-                // Prüft ob Charakter alphanumerisch ist (a to z, A to Z, 0 to9 )
-                
-                current_token += std::tolower(static_cast<unsigned char>(c)); 
-                // - tolower() konvertiert zu lowercase
-                // - static_cast<unsigned char> = Cast wegen signed/unsigned char Problem
-                //   wichtig weil(verhindert Undefined Behavior bei negativen Werten)
-                // - += fügt Charakter zum Token hinzu
-                
-            } else { 
-                // delimiter gefunden (Leerzeichen, Sonderzeichen)
-                
-                if (current_token.length() >= 2) {
-                    // tokem muss lang genug sein(min 2 chars)
-                    
-                    tokens.emplace_back(std::move(current_token)); 
-                    // - emplace_back() = konstruiert direkt im Container (schneller als push_back), das heißt es wird keine neue stelle im memory reserviert und keine elemente kopiert, sondern direkt an die stelle im memory geschrieben.
-                    // - std::move() = übergibt Besitz statt Kopie (spart Zeit bei großen Strings)
-                    // - current_token ist danach leer 
+        return tokens; 
+    }
+    // TermCounter: Tokenisieren und Zählen in einem Durchgang, ohne einen String pro Token
+
+    void TermCounter::count(std::string_view text) {
+        clear();
+        const DefaultAnalyzer analyzer;
+        analyzer.analyze(text, [this](std::string&& token) {
+            add(token);
+            // token wird nicht verschoben: der Analyzer benutzt seinen Puffer für das nächste Token weiter
+        });
+    }
+
+    void TermCounter::count(const std::vector<std::string>& tokens) {
+        clear();
+        for (const auto& token : tokens) {
+            add(token);
+        }
+    }
+
+    void TermCounter::clear() noexcept {
+        // nur die belegten Slots leeren, die Tabelle kann von einem großen Dokument viel größer sein
+        for (const auto& entry : terms_) {
+            slots_[entry.slot] = 0;
+        }
+        terms_.clear();
+        pool_.clear();
+        token_count_ = 0;
+    }
 
-                    // wenn mann emplace_back() verwendet, wird der Konstruktor des Objekts 
-                    // direkt auf dem Platz aufgerufen, der für das neue Element reserviert ist. 
-                    // So wird das Objekt in place im Container konstruiert.
-                    current_token.clear();
-                } else {
-                    // Token zu kurz 
-                    current_token.clear();
-                }
+    void TermCounter::add(std::string_view token) {
+        ++token_count_;
+        uint64_t hash = hash_bytes(token);  // der einzige Hash pro Token
+        if ((terms_.size() + 1) * 2 > slots_.size()) {
+            grow();  // höchstens halb voll
+        }
+        size_t mask = slots_.size() - 1;
+        size_t slot = static_cast<size_t>(hash ^ (hash >> 32)) & mask;
+        while (uint32_t id = slots_[slot]) {
+            Entry& entry = terms_[id - 1];
+            if (entry.hash == hash && std::string_view(pool_).substr(entry.offset, entry.length) == token) {
+                ++entry.frequency;
+                return;
             }
+            slot = (slot + 1) & mask;
         }
-        
-        // Handle last token
-        // falls Text nicht mit Delimiter endet, ist letztes Token noch in current_token
-        if (current_token.length() >= 2) {
-            tokens.emplace_back(std::move(current_token));
+        slots_[slot] = static_cast<uint32_t>(terms_.size() + 1);
+        terms_.push_back({hash, static_cast<uint32_t>(pool_.size()), static_cast<uint32_t>(token.size()), 1,
+                          static_cast<uint32_t>(slot)});
+        pool_.append(token);
+    }
+
+    void TermCounter::grow() {
+        slots_.assign(slots_.empty() ? 1024 : slots_.size() * 2, 0);
+        size_t mask = slots_.size() - 1;
+        for (size_t id = 0; id < terms_.size(); ++id) {
+            Entry& entry = terms_[id];
+            size_t slot = static_cast<size_t>(entry.hash ^ (entry.hash >> 32)) & mask;
+            while (slots_[slot] != 0) {
+                slot = (slot + 1) & mask;
+            }
+            slots_[slot] = static_cast<uint32_t>(id + 1);
+            entry.slot = static_cast<uint32_t>(slot);
         }
-        
-        return tokens; 
     }
 }
\ No newline at end of file
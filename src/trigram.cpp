@@ -0,0 +1,535 @@
+#include "trigram.hpp"
+#include <algorithm>
+#include <cctype>
+#include <set>
+
+namespace notesearch {
+
+namespace {
+
+constexpr size_t max_exact = 16;   // mehr exakte Strings werden zu Präfix / Suffix + Trigrammen
+constexpr size_t max_set = 64;     // größere Kreuzprodukte an Übergängen werden übersprungen
+constexpr size_t max_class = 8;    // größere Zeichenklassen zählen als beliebiges Zeichen
+constexpr size_t max_copies = 4;   // x{m,n}: höchstens so viele Kopien von x werden ausgewertet
+constexpr int max_nesting = 200;   // tiefer geschachtelte Gruppen: keine Einschränkung
+
+using StringSet = std::set<std::string>;
+
+char fold(char c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c + ('a' - 'A')) : c;
+}
+
+// Was über die Treffer eines Teilausdrucks bekannt ist
+// exact_known: jeder Treffer ist einer der Strings in exact (klein geschrieben)
+// sonst: jeder Treffer beginnt mit einem String aus prefix, endet mit einem aus suffix (je höchstens
+// 2 Bytes, die Trigramme der ganzen Strings stehen schon in match) und erfüllt match
+struct Info {
+    bool exact_known = true;
+    StringSet exact{""};
+    StringSet prefix;
+    StringSet suffix;
+    TrigramQuery match;
+    bool can_empty = true;
+};
+
+Info exact_info(StringSet strings) {
+    Info info;
+    info.can_empty = strings.count("") > 0;
+    info.exact = std::move(strings);
+    return info;
+}
+
+// ein beliebiges Zeichen (., \w, große Klassen) bzw. ein beliebiger String (x*, Rückverweise)
+Info any_info(bool can_empty) {
+    Info info;
+    info.exact_known = false;
+    info.exact.clear();
+    info.prefix = {""};
+    info.suffix = {""};
+    info.can_empty = can_empty;
+    return info;
+}
+
+// ODER über die Strings, je UND ihrer Trigramme; ein String unter 3 Bytes schränkt nichts ein
+TrigramQuery string_query(const StringSet& strings) {
+    TrigramQuery result;
+    result.op = TrigramQuery::Op::none;
+    for (const auto& s : strings) {
+        if (s.size() < 3) {
+            return TrigramQuery::all();
+        }
+        TrigramQuery query;
+        query.op = TrigramQuery::Op::and_;
+        for (size_t i = 0; i + 3 <= s.size(); ++i) {
+            query.trigrams.push_back(trigram_key(s[i], s[i + 1], s[i + 2]));
+        }
+        std::sort(query.trigrams.begin(), query.trigrams.end());
+        query.trigrams.erase(std::unique(query.trigrams.begin(), query.trigrams.end()), query.trigrams.end());
+        result = TrigramQuery::or_of(std::move(result), std::move(query));
+    }
+    return result;
+}
+
+StringSet cross(const StringSet& a, const StringSet& b) {
+    StringSet result;
+    for (const auto& x : a) {
+        for (const auto& y : b) {
+            result.insert(x + y);
+        }
+    }
+    return result;
+}
+
+// exakte Menge in Trigramme + Präfix / Suffix umwandeln
+void make_inexact(Info& info) {
+    if (!info.exact_known) {
+        return;
+    }
+    info.match = TrigramQuery::and_of(std::move(info.match), string_query(info.exact));
+    info.prefix.clear();
+    info.suffix.clear();
+    for (const auto& s : info.exact) {
+        info.prefix.insert(s.substr(0, 2));
+        info.suffix.insert(s.size() > 2 ? s.substr(s.size() - 2) : s);
+    }
+    info.exact.clear();
+    info.exact_known = false;
+}
+
+// zu große Präfix / Suffix Mengen sagen nichts mehr
+void limit(StringSet& strings) {
+    if (strings.size() > max_set) {
+        strings = {""};
+    }
+}
+
+// lange Präfixe / Suffixe: ihre Trigramme kommen nach match, am Rand bleiben nur 2 Bytes
+void trim(Info& info) {
+    info.match = TrigramQuery::and_of(std::move(info.match), string_query(info.prefix));
+    info.match = TrigramQuery::and_of(std::move(info.match), string_query(info.suffix));
+    StringSet prefix;
+    for (const auto& s : info.prefix) {
+        prefix.insert(s.substr(0, 2));
+    }
+    StringSet suffix;
+    for (const auto& s : info.suffix) {
+        suffix.insert(s.size() > 2 ? s.substr(s.size() - 2) : s);
+    }
+    info.prefix = std::move(prefix);
+    info.suffix = std::move(suffix);
+}
+
+Info concat(Info x, Info y) {
+    if (x.exact_known && y.exact_known && x.exact.size() * y.exact.size() <= max_exact) {
+        return exact_info(cross(x.exact, y.exact));
+    }
+    // ein exakter Teil neben einem unbekannten verlängert dessen Präfix bzw. Suffix
+    if (x.exact_known && !y.exact_known && x.exact.size() * y.prefix.size() <= max_set) {
+        y.prefix = cross(x.exact, y.prefix);
+        y.can_empty = y.can_empty && x.can_empty;
+        trim(y);
+        return y;
+    }
+    if (!x.exact_known && y.exact_known && x.suffix.size() * y.exact.size() <= max_set) {
+        x.suffix = cross(x.suffix, y.exact);
+        x.can_empty = x.can_empty && y.can_empty;
+        trim(x);
+        return x;
+    }
+    make_inexact(x);
+    make_inexact(y);
+    Info result = any_info(x.can_empty && y.can_empty);
+    result.match = TrigramQuery::and_of(std::move(x.match), std::move(y.match));
+    if (x.suffix.size() * y.prefix.size() <= max_set) {
+        // Trigramme über die Grenze: Ende von x direkt gefolgt vom Anfang von y
+        result.match = TrigramQuery::and_of(std::move(result.match), string_query(cross(x.suffix, y.prefix)));
+    }
+    // kann x leer sein, enthält sein prefix "" (ebenso suffix für y), das bleibt so richtig
+    result.prefix = std::move(x.prefix);
+    result.suffix = std::move(y.suffix);
+    return result;
+}
+
+Info alternate(Info x, Info y) {
+    bool can_empty = x.can_empty || y.can_empty;
+    if (x.exact_known && y.exact_known && x.exact.size() + y.exact.size() <= max_exact) {
+        x.exact.insert(y.exact.begin(), y.exact.end());
+        return exact_info(std::move(x.exact));
+    }
+    make_inexact(x);
+    make_inexact(y);
+    Info result = any_info(can_empty);
+    result.match = TrigramQuery::or_of(std::move(x.match), std::move(y.match));
+    result.prefix = std::move(x.prefix);
+    result.prefix.insert(y.prefix.begin(), y.prefix.end());
+    result.suffix = std::move(x.suffix);
+    result.suffix.insert(y.suffix.begin(), y.suffix.end());
+    limit(result.prefix);
+    limit(result.suffix);
+    return result;
+}
+
+// x+ beginnt und endet wie x und enthält x
+Info one_or_more(Info x) {
+    make_inexact(x);
+    return x;
+}
+
+// Rekursiver Abstieg über die ECMAScript Syntax (std::regex)
+// Alles was nicht sicher verstanden wird ergibt any_info(), schränkt also nur weniger ein
+class RegexAnalyzer {
+public:
+    explicit RegexAnalyzer(std::string_view pattern) : pattern_(pattern) {}
+
+    Info analyze() {
+        Info info = alternation();
+        if (pos_ != pattern_.size()) {
+            return any_info(true);  // z.B. ein ')' zu viel, std::regex meldet den Fehler
+        }
+        return info;
+    }
+
+private:
+    std::string_view pattern_;
+    size_t pos_ = 0;
+    int depth_ = 0;
+
+    bool at(char c) const noexcept { return pos_ < pattern_.size() && pattern_[pos_] == c; }
+
+    Info alternation() {
+        Info result = concatenation();
+        while (at('|')) {
+            ++pos_;
+            result = alternate(std::move(result), concatenation());
+        }
+        return result;
+    }
+
+    Info concatenation() {
+        Info result;
+        while (pos_ < pattern_.size() && !at('|') && !at(')')) {
+            result = concat(std::move(result), repetition());
+        }
+        return result;
+    }
+
+    Info repetition() {
+        Info result = atom();
+        while (pos_ < pattern_.size()) {
+            char c = pattern_[pos_];
+            size_t min = 0;
+            size_t max = 0;
+            if (c == '*') {
+                ++pos_;
+                result = any_info(true);
+            } else if (c == '+') {
+                ++pos_;
+                result = one_or_more(std::move(result));
+            } else if (c == '?') {
+                ++pos_;
+                result = alternate(std::move(result), Info{});
+            } else if (c == '{' && braces(min, max)) {
+                result = repeat(std::move(result), min, max);
+            } else {
+                break;
+            }
+            if (at('?')) {
+                ++pos_;  // nicht gierig, gleiche Treffermenge
+            }
+        }
+        return result;
+    }
+
+    // {m}, {m,}, {m,n}; max == SIZE_MAX für unbegrenzt
+    bool braces(size_t& min, size_t& max) {
+        size_t end = pattern_.find('}', pos_);
+        if (end == std::string_view::npos) {
+            return false;
+        }
+        std::string_view body = pattern_.substr(pos_ + 1, end - pos_ - 1);
+        size_t comma = body.find(',');
+        std::string_view low = body.substr(0, comma);
+        std::string_view high = comma == std::string_view::npos ? low : body.substr(comma + 1);
+        auto number = [](std::string_view digits, size_t& value) {
+            if (digits.empty() || digits.size() > 6 ||
+                !std::all_of(digits.begin(), digits.end(), [](char d) { return d >= '0' && d <= '9'; })) {
+                return false;
+            }
+            value = std::stoul(std::string(digits));
+            return true;
+        };
+        if (!number(low, min)) {
+            return false;
+        }
+        if (high.empty()) {
+            max = SIZE_MAX;
+        } else if (!number(high, max)) {
+            return false;
+        }
+        pos_ = end + 1;
+        return true;
+    }
+
+    Info repeat(Info x, size_t min, size_t max) {
+        if (max == 0) {
+            return Info{};
+        }
+        if (min == 0) {
+            return alternate(one_or_more(std::move(x)), Info{});
+        }
+        Info result = x;
+        for (size_t i = 1; i < std::min(min, max_copies); ++i) {
+            result = concat(std::move(result), x);
+        }
+        if (max > min || min > max_copies) {
+            result = concat(std::move(result), any_info(true));  // weitere Kopien: irgendein String
+        }
+        return result;
+    }
+
+    Info atom() {
+        char c = pattern_[pos_++];
+        switch (c) {
+            case '(':
+                return group();
+            case '.':
+                return any_info(false);
+            case '^':
+            case '$':
+                return Info{};
+            case '[':
+                return char_class();
+            case '\\':
+                return escape();
+            case '*':
+            case '+':
+            case '?':
+                return any_info(true);  // nichts zu wiederholen, std::regex meldet den Fehler
+            default:
+                return exact_info({std::string(1, fold(c))});
+        }
+    }
+
+    Info group() {
+        bool lookahead = false;
+        if (at('?')) {
+            if (pos_ + 1 < pattern_.size() && (pattern_[pos_ + 1] == '=' || pattern_[pos_ + 1] == '!')) {
+                lookahead = true;
+            }
+            pos_ += 2;  // (?: (?= (?!
+        }
+        if (++depth_ > max_nesting) {
+            pos_ = pattern_.size();
+            return any_info(true);
+        }
+        Info inner = alternation();
+        --depth_;
+        if (at(')')) {
+            ++pos_;
+        }
+        // Lookaheads verbrauchen nichts, ihr Inhalt steht nicht sicher an dieser Stelle
+        return lookahead ? Info{} : inner;
+    }
+
+    // ein Zeichen einer Escape Sequenz, false für Klassen (\d, \w, ...) und Unbekanntes
+    bool escaped_char(char& out) {
+        if (pos_ >= pattern_.size()) {
+            return false;
+        }
+        char c = pattern_[pos_++];
+        switch (c) {
+            case 'n': out = '\n'; return true;
+            case 't': out = '\t'; return true;
+            case 'r': out = '\r'; return true;
+            case 'f': out = '\f'; return true;
+            case 'v': out = '\v'; return true;
+            case '0': out = '\0'; return true;
+            case 'x': {
+                if (pos_ + 2 > pattern_.size()) return false;
+                std::string hex(pattern_.substr(pos_, 2));
+                if (!std::all_of(hex.begin(), hex.end(), [](char h) { return std::isxdigit(static_cast<unsigned char>(h)); })) {
+                    return false;
+                }
+                pos_ += 2;
+                out = static_cast<char>(std::stoul(hex, nullptr, 16));
+                return true;
+            }
+            case 'd': case 'D': case 'w': case 'W': case 's': case 'S':
+            case 'b': case 'B': case 'c': case 'u':
+                return false;
+            default:
+                if (c >= '1' && c <= '9') {
+                    return false;  // Rückverweis
+                }
+                out = c;  // \. \( \\ ...
+                return true;
+        }
+    }
+
+    Info escape() {
+        if (pos_ < pattern_.size() && (pattern_[pos_] == 'b' || pattern_[pos_] == 'B')) {
+            ++pos_;
+            return Info{};  // Wortgrenze, verbraucht nichts
+        }
+        bool backreference = pos_ < pattern_.size() && pattern_[pos_] >= '1' && pattern_[pos_] <= '9';
+        char c = 0;
+        if (escaped_char(c)) {
+            return exact_info({std::string(1, fold(c))});
+        }
+        if (backreference) {
+            while (pos_ < pattern_.size() && pattern_[pos_] >= '0' && pattern_[pos_] <= '9') ++pos_;
+            return any_info(true);
+        }
+        if (pattern_[pos_ - 1] == 'c' && pos_ < pattern_.size()) ++pos_;                   // \cX
+        if (pattern_[pos_ - 1] == 'u') pos_ = std::min(pattern_.size(), pos_ + 4);        // \uXXXX
+        return any_info(false);
+    }
+
+    Info char_class() {
+        bool negated = at('^');
+        if (negated) ++pos_;
+        StringSet chars;
+        bool large = negated;
+        while (pos_ < pattern_.size() && !at(']')) {  // ECMAScript: ']' schließt immer, "[]" ist leer
+            char low = pattern_[pos_++];
+            if (low == '\\') {
+                if (!escaped_char(low)) {
+                    large = true;
+                    continue;
+                }
+            }
+            char high = low;
+            if (at('-') && pos_ + 1 < pattern_.size() && pattern_[pos_ + 1] != ']') {
+                ++pos_;
+                high = pattern_[pos_++];
+                if (high == '\\' && !escaped_char(high)) {
+                    large = true;
+                    continue;
+                }
+            }
+            int span = static_cast<unsigned char>(high) - static_cast<unsigned char>(low);
+            if (span < 0 || static_cast<size_t>(span) >= max_class) {
+                large = true;
+                continue;
+            }
+            for (int ch = static_cast<unsigned char>(low); ch <= static_cast<unsigned char>(high); ++ch) {
+                chars.insert(std::string(1, fold(static_cast<char>(ch))));
+            }
+        }
+        if (at(']')) ++pos_;
+        if (large || chars.empty() || chars.size() > max_class) {
+            return any_info(false);
+        }
+        return exact_info(std::move(chars));
+    }
+};
+
+void flatten_into(TrigramQuery& target, TrigramQuery&& source) {
+    if (source.op == target.op) {
+        target.trigrams.insert(target.trigrams.end(), source.trigrams.begin(), source.trigrams.end());
+        for (auto& child : source.children) {
+            target.children.push_back(std::move(child));
+        }
+    } else if (source.trigrams.size() == 1 && source.children.empty()) {
+        target.trigrams.push_back(source.trigrams[0]);  // ein einzelnes Trigramm ist UND wie ODER
+    } else {
+        target.children.push_back(std::move(source));
+    }
+}
+
+TrigramQuery combine(TrigramQuery::Op op, TrigramQuery a, TrigramQuery b) {
+    TrigramQuery result;
+    result.op = op;
+    flatten_into(result, std::move(a));
+    flatten_into(result, std::move(b));
+    std::sort(result.trigrams.begin(), result.trigrams.end());
+    result.trigrams.erase(std::unique(result.trigrams.begin(), result.trigrams.end()), result.trigrams.end());
+    return result;
+}
+
+} // namespace
+
+std::string trigram_string(uint32_t trigram) {
+    return {static_cast<char>(trigram >> 16), static_cast<char>(trigram >> 8), static_cast<char>(trigram)};
+}
+
+// Doppelte über ein Bitset aller 2^24 Trigramme erkennen (2 MB, pro Thread einmal),
+// danach werden nur die gesetzten Bits wieder gelöscht
+void document_trigrams(std::string_view content, std::vector<uint32_t>& trigrams) {
+    thread_local std::vector<uint64_t> seen(size_t{1} << 18);
+    trigrams.clear();
+    for (size_t i = 0; i + 3 <= content.size(); ++i) {
+        uint32_t key = trigram_key(content[i], content[i + 1], content[i + 2]);
+        uint64_t bit = uint64_t{1} << (key & 63);
+        if (!(seen[key >> 6] & bit)) {
+            seen[key >> 6] |= bit;
+            trigrams.push_back(key);
+        }
+    }
+    for (uint32_t key : trigrams) {
+        seen[key >> 6] = 0;
+    }
+}
+
+TrigramQuery TrigramQuery::and_of(TrigramQuery a, TrigramQuery b) {
+    if (a.op == Op::none || b.op == Op::none) {
+        TrigramQuery none;
+        none.op = Op::none;
+        return none;
+    }
+    if (a.op == Op::all) return b;
+    if (b.op == Op::all) return a;
+    return combine(Op::and_, std::move(a), std::move(b));
+}
+
+TrigramQuery TrigramQuery::or_of(TrigramQuery a, TrigramQuery b) {
+    if (a.op == Op::all || b.op == Op::all) return all();
+    if (a.op == Op::none) return b;
+    if (b.op == Op::none) return a;
+    return combine(Op::or_, std::move(a), std::move(b));
+}
+
+std::string TrigramQuery::to_string() const {
+    switch (op) {
+        case Op::all: return "*";
+        case Op::none: return "-";
+        default: break;
+    }
+    std::string out;
+    const char* separator = op == Op::and_ ? " " : " | ";
+    auto append = [&out, separator](const std::string& part) {
+        if (!out.empty()) out += separator;
+        out += part;
+    };
+    for (uint32_t trigram : trigrams) {
+        std::string quoted = "\"";
+        for (char c : trigram_string(trigram)) {
+            unsigned char byte = static_cast<unsigned char>(c);
+            if (byte < 0x20 || byte == 0x7f) {
+                const char* hex = "0123456789abcdef";
+                quoted += "\\x";
+                quoted += hex[byte >> 4];
+                quoted += hex[byte & 15];
+            } else {
+                quoted += c;
+            }
+        }
+        append(quoted + "\"");
+    }
+    for (const auto& child : children) {
+        append("(" + child.to_string() + ")");
+    }
+    return out;
+}
+
+TrigramQuery regex_trigram_query(std::string_view pattern) {
+    Info info = RegexAnalyzer(pattern).analyze();
+    make_inexact(info);
+    return info.match;
+}
+
+TrigramQuery literal_trigram_query(std::string_view text) {
+    return string_query({std::string(text)});
+}
+
+} // namespace notesearch
@@ -0,0 +1,373 @@
+#include "update_log.hpp"
+#include "binary_io.hpp"
+#include <fstream>
+#include <iterator>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <io.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+#endif
+
+namespace notesearch {
+
+namespace {
+
+constexpr uint32_t update_log_magic = 0x4c57534e;   // "NSWL"
+constexpr uint64_t update_log_version = 2;  // 2: modified time in add records
+
+void append_string(std::string& out, std::string_view text) {
+    append_varint(out, text.size());
+    out += text;
+}
+
+bool read_string(std::string_view bytes, size_t& pos, std::string& out) {
+    uint64_t size = 0;
+    if (!read_varint(bytes, pos, size) || size > bytes.size() - pos) {
+        return false;
+    }
+    out.assign(bytes.substr(pos, static_cast<size_t>(size)));
+    pos += static_cast<size_t>(size);
+    return true;
+}
+
+void append_u32(std::string& out, uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        out += static_cast<char>((value >> (8 * i)) & 0xff);
+    }
+}
+
+uint32_t read_u32(const char* bytes) {
+    uint32_t value = 0;
+    for (int i = 0; i < 4; ++i) {
+        value |= static_cast<uint32_t>(static_cast<uint8_t>(bytes[i])) << (8 * i);
+    }
+    return value;
+}
+
+bool read_modified_time(std::string_view bytes, size_t& pos, LogRecord& record) {
+    uint64_t value = 0;
+    if (!read_varint(bytes, pos, value)) {
+        return false;
+    }
+    record.modified_time = static_cast<int64_t>(value);
+    return true;
+}
+
+// Record mit Länge und Prüfsumme davor
+std::string encode_record(const LogRecord& record) {
+    std::string payload;
+    payload += static_cast<char>(record.type);
+    switch (record.type) {
+    case LogRecord::Type::start:
+        append_varint(payload, update_log_magic);
+        append_varint(payload, update_log_version);
+        append_varint(payload, record.blob_offset);
+        break;
+    case LogRecord::Type::add:
+        append_string(payload, record.root);
+        append_string(payload, record.path);
+        append_varint(payload, record.blob_offset);
+        append_varint(payload, static_cast<uint64_t>(record.modified_time));
+        append_string(payload, record.content);
+        break;
+    case LogRecord::Type::remove:
+        append_string(payload, record.path);
+        break;
+    case LogRecord::Type::checkpoint:
+        append_varint(payload, record.blob_offset);
+        break;
+    }
+    std::string frame;
+    frame.reserve(8 + payload.size());
+    append_u32(frame, static_cast<uint32_t>(payload.size()));
+    append_u32(frame, crc32(payload));
+    frame += payload;
+    return frame;
+}
+
+bool decode_record(std::string_view payload, LogRecord& record) {
+    if (payload.empty()) {
+        return false;
+    }
+    size_t pos = 1;
+    uint64_t magic = 0;
+    uint64_t version = 0;
+    record = LogRecord{};
+    record.type = static_cast<LogRecord::Type>(payload[0]);
+    switch (record.type) {
+    case LogRecord::Type::start:
+        return read_varint(payload, pos, magic) && magic == update_log_magic &&
+               read_varint(payload, pos, version) && version == update_log_version &&
+               read_varint(payload, pos, record.blob_offset);
+    case LogRecord::Type::add:
+        return read_string(payload, pos, record.root) && read_string(payload, pos, record.path) &&
+               read_varint(payload, pos, record.blob_offset) && read_modified_time(payload, pos, record) &&
+               read_string(payload, pos, record.content);
+    case LogRecord::Type::remove:
+        return read_string(payload, pos, record.path);
+    case LogRecord::Type::checkpoint:
+        return read_varint(payload, pos, record.blob_offset);
+    }
+    return false;
+}
+
+std::FILE* open_for_append(const std::filesystem::path& path) {
+#ifdef _WIN32
+    return _wfopen(path.c_str(), L"ab");
+#else
+    return std::fopen(path.c_str(), "ab");
+#endif
+}
+
+// fflush bringt die Bytes nur zum Betriebssystem, erst das hier auf die Platte
+bool sync_stream(std::FILE* file) {
+    if (std::fflush(file) != 0) {
+        return false;
+    }
+#ifdef _WIN32
+    return _commit(_fileno(file)) == 0;
+#else
+    return fsync(fileno(file)) == 0;
+#endif
+}
+
+} // namespace
+
+UpdateLog::~UpdateLog() {
+    close();
+}
+
+void UpdateLog::close() noexcept {
+    if (file_) {
+        std::fclose(file_);
+        file_ = nullptr;
+    }
+}
+
+bool UpdateLog::open(const std::filesystem::path& log_path, std::vector<LogRecord>& records, std::string* error) {
+    close();
+    path_ = log_path;
+    size_ = 0;
+    damaged_tail_ = false;
+    records.clear();
+
+    std::error_code ec;
+    if (!std::filesystem::exists(log_path, ec)) {
+        return true;
+    }
+    std::ifstream in(log_path, std::ios::binary);
+    if (!in) {
+        if (error) *error = "cannot open " + log_path.string();
+        return false;
+    }
+    std::string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    // bis zum ersten unvollständigen oder kaputten Record: dort ist der Prozess beim Schreiben gestorben
+    size_t pos = 0;
+    while (bytes.size() - pos >= header_bytes) {
+        uint32_t length = read_u32(bytes.data() + pos);
+        uint32_t checksum = read_u32(bytes.data() + pos + 4);
+        if (length > bytes.size() - pos - header_bytes) {
+            break;
+        }
+        std::string_view payload(bytes.data() + pos + header_bytes, length);
+        LogRecord record;
+        if (crc32(payload) != checksum || !decode_record(payload, record)) {
+            // intakte Prüfsumme, aber kein Log dieser Version vorne: nicht überschreiben
+            if (pos == 0 && crc32(payload) == checksum) {
+                if (error) *error = log_path.string() + " is not an update log of this version";
+                return false;
+            }
+            break;
+        }
+        if ((pos == 0) != (record.type == LogRecord::Type::start)) {
+            break;
+        }
+        records.push_back(std::move(record));
+        pos += header_bytes + length;
+    }
+    size_ = pos;
+    damaged_tail_ = pos < bytes.size();
+    return true;
+}
+
+bool UpdateLog::append(const LogRecord& record, std::string* error) {
+    if (!file_) {
+        std::error_code ec;
+        if (damaged_tail_) {
+            std::filesystem::resize_file(path_, size_, ec);
+            if (ec) {
+                if (error) *error = "cannot truncate " + path_.string() + ": " + ec.message();
+                return false;
+            }
+            damaged_tail_ = false;
+        }
+        file_ = open_for_append(path_);
+        if (!file_) {
+            if (error) *error = "cannot open " + path_.string();
+            return false;
+        }
+    }
+    std::string frame = encode_record(record);
+    if (std::fwrite(frame.data(), 1, frame.size(), file_) != frame.size() || std::fflush(file_) != 0) {
+        // halb geschriebener Record: beim nächsten append() abschneiden
+        close();
+        damaged_tail_ = true;
+        if (error) *error = "cannot write " + path_.string();
+        return false;
+    }
+    size_ += frame.size();
+    return true;
+}
+
+bool UpdateLog::sync(std::string* error) {
+    if (file_ && !sync_stream(file_)) {
+        if (error) *error = "cannot sync " + path_.string();
+        return false;
+    }
+    return true;
+}
+
+bool UpdateLog::reset(uint64_t blob_size, std::string* error) {
+    close();
+    LogRecord start;
+    start.type = LogRecord::Type::start;
+    start.blob_offset = blob_size;
+    std::string frame = encode_record(start);
+
+    std::filesystem::path temp_path = path_;
+    temp_path += ".tmp";
+    std::FILE* file = open_for_append(temp_path);
+    std::error_code ec;
+    std::filesystem::resize_file(temp_path, 0, ec);  // Rest eines abgebrochenen reset()
+    bool written = file && !ec && std::fwrite(frame.data(), 1, frame.size(), file) == frame.size() &&
+                   sync_stream(file);
+    if (file) {
+        written = std::fclose(file) == 0 && written;
+    }
+    if (written) {
+        std::filesystem::rename(temp_path, path_, ec);
+    }
+    if (!written || ec || !sync_directory(path_.parent_path())) {
+        if (error) *error = "cannot write " + path_.string();
+        return false;
+    }
+    size_ = frame.size();
+    damaged_tail_ = false;
+    return true;
+}
+
+IndexLock::~IndexLock() {
+    unlock();
+}
+
+bool IndexLock::lock(const std::filesystem::path& lock_path, bool exclusive, std::string* error) {
+    unlock();
+#ifdef _WIN32
+    HANDLE file = CreateFileW(lock_path.c_str(), GENERIC_READ | GENERIC_WRITE,
+                              FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_ALWAYS,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE && !exclusive) {
+        file = CreateFileW(lock_path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                           nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    }
+    if (file == INVALID_HANDLE_VALUE) {
+        std::error_code ec;
+        if (!exclusive && !std::filesystem::exists(lock_path, ec)) {
+            return true;  // schreibgeschütztes Verzeichnis: hier ändert auch niemand etwas
+        }
+        if (error) *error = "cannot open " + lock_path.string();
+        return false;
+    }
+    OVERLAPPED overlapped = {};
+    if (!LockFileEx(file, exclusive ? LOCKFILE_EXCLUSIVE_LOCK : 0, 0, 1, 0, &overlapped)) {
+        CloseHandle(file);
+        if (error) *error = "cannot lock " + lock_path.string();
+        return false;
+    }
+    file_ = file;
+#else
+    int fd = ::open(lock_path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0 && !exclusive) {
+        fd = ::open(lock_path.c_str(), O_RDONLY | O_CLOEXEC);
+    }
+    if (fd < 0) {
+        std::error_code ec;
+        if (!exclusive && !std::filesystem::exists(lock_path, ec)) {
+            return true;  // schreibgeschütztes Verzeichnis: hier ändert auch niemand etwas
+        }
+        if (error) *error = "cannot open " + lock_path.string();
+        return false;
+    }
+    int result = 0;
+    do {
+        result = flock(fd, exclusive ? LOCK_EX : LOCK_SH);
+    } while (result != 0 && errno == EINTR);
+    if (result != 0) {
+        ::close(fd);
+        if (error) *error = "cannot lock " + lock_path.string();
+        return false;
+    }
+    fd_ = fd;
+#endif
+    return true;
+}
+
+// Schließen gibt den Lock frei, die Datei bleibt liegen (sie zu löschen liefe gegen wartende Prozesse)
+void IndexLock::unlock() noexcept {
+#ifdef _WIN32
+    if (file_) {
+        CloseHandle(static_cast<HANDLE>(file_));
+        file_ = nullptr;
+    }
+#else
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+#endif
+}
+
+bool sync_file(const std::filesystem::path& path) {
+#ifdef _WIN32
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                              nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    bool synced = FlushFileBuffers(file) != 0;
+    CloseHandle(file);
+    return synced;
+#else
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    bool synced = fsync(fd) == 0;
+    ::close(fd);
+    return synced;
+#endif
+}
+
+bool sync_directory(const std::filesystem::path& dir) {
+#ifdef _WIN32
+    (void)dir;
+    return true;  // NTFS schreibt Umbenennungen über sein Journal, Verzeichnisse lassen sich nicht flushen
+#else
+    int fd = ::open(dir.empty() ? "." : dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    bool synced = fsync(fd) == 0;
+    ::close(fd);
+    return synced;
+#endif
+}
+
+} // namespace notesearch
@@ -1,7 +1,11 @@
 #include "util.hpp"
-#include <fstream>
+#include "file_reader.hpp"
 #include <sstream>
 #include <algorithm>
+#include <cctype>
+#include <iterator>
+#include <string_view>
+#include <iomanip>
 
 namespace notesearch {
 
@@ -9,34 +13,30 @@ namespace notesearch {
 
 bool should_index_file(const std::filesystem::path& file_path) {
 
-    
-    const std::string ext = file_path.extension().string();
-
-    
-    std::string lower_ext = ext;
-
-    std::transform(lower_ext.begin(), lower_ext.end(), lower_ext.begin(), ::tolower);
-    // std::transform() 
-    // Transformiert jedes Element im Bereich
-    //
-    // Parameter:
-    //  lower_ext.begin() ... Anfang des Strings
-    //  lower_ext.end() ... Ende des Strings
-    //  lower_ext.begin() ... wo Ergebnis gespeichert wird
-
-    //  ::tolower Konvertiert jeden Charakter zu lowercase
-    // hier wird Zeichen für Zeichen transformiert  und sofort überschrieben. Es wird nicht erst ein neuer String erstellt.
-    
     //  Liste der indexierbaren Datei Endungen
-    const std::vector<std::string> indexable_extensions = {
-        ".txt", ".md", ".markdown", ".cpp", ".hpp", ".c", ".h",
-        ".java", ".py", ".js", ".ts", ".rs", ".go", ".rb", ".php",
-        ".json", ".xml", ".yaml", ".yml", ".toml", ".ini", ".cfg"
+    //  static constexpr: wird einmal zur Compile Zeit angelegt (früher: neuer vector bei jedem Aufruf)
+    //  sortiert, damit binary_search funktioniert
+    static constexpr std::string_view indexable_extensions[] = {
+        ".c", ".cfg", ".cpp", ".go", ".h", ".hpp", ".ini", ".java", ".js", ".json",
+        ".markdown", ".md", ".php", ".py", ".rb", ".rs", ".toml", ".ts", ".txt",
+        ".xml", ".yaml", ".yml"
     };
+    constexpr size_t max_extension_length = 9;  // ".markdown"
+
+    const std::string ext = file_path.extension().string();  // kurz, passt in den SSO Puffer
+    if (ext.size() < 2 || ext.size() > max_extension_length) {
+        return false;
+    }
 
-    // std::find() .. sucht Element in einem Container
-    return std::find(indexable_extensions.begin(), indexable_extensions.end(), lower_ext) 
-           != indexable_extensions.end();
+    // lowercase in einen Puffer auf dem Stack, keine Heap Allokation
+    char lower[max_extension_length];
+    for (size_t i = 0; i < ext.size(); ++i) {
+        lower[i] = static_cast<char>(std::tolower(static_cast<unsigned char>(ext[i])));
+    }
+    const std::string_view lower_ext(lower, ext.size());
+
+    // std::binary_search() .. sucht in sortiertem Bereich in O(log n)
+    return std::binary_search(std::begin(indexable_extensions), std::end(indexable_extensions), lower_ext);
 }
 
 
@@ -45,50 +45,12 @@ std::string read_file_content(const std::filesystem::path& file_path) {
     // Parameter .. Dateipfad zum Lesen
     // Return ..  Datei Inhalt als String
     
-
-    std::ifstream file(file_path, std::ios::binary);
-    // std::ifstream .. stream heisst ein Datenstream, der Dateien lesen kann
-    // RAII.. Datei wird automatisch im Destruktor geschlossen
-    // Auch bei Exception wird Datei geschlossen
-    // Der Grund fur die verwendung von RAII (resource acquisition is initialization) ist, dass die Datei automatisch geschlossen wird, wenn das Objekt aus dem Scope heraus geht.
-    // das ist wichtig, um Ressourcen freizugeben und um Fehler zu vermeiden.
-   
-    // Params
-    //    Liest Datei als Binär (keine Text Konvertierung)
-    //    Wichtig für Unicode, spezielle Zeichen, ...
-    //    Ohne binary: also Text Mode
-    
-    if (!file.is_open()) {
-        // Prüft ob Datei erfolgreich geöffnet wurde
-   
-        return "";
-
-    }
-    
-    // std::ostringstream - NEUES KONZEPT!
-    std::ostringstream buffer;
-    // std::ostringstream = Output String Stream
-    // String Buffer zum Schreiben (wie std::cout, aber in String)
-    // Kann mit << Operator beschrieben werden (<< ist der Insertion Operator)
-    // .str() gibt String zurück
-    
-
-    buffer << file.rdbuf();
-    // rdbuf().. ist Read Buffer 
-    // Gibt Pointer auf internen Stream Buffer zurück
-    // << Operator kopiert gesamten Buffer in ostringstream
-    // Liest Datei komplett in einen Zug 
-
-    // Warum rdbuf()?
-    // Schneller (einmaliger Buffer Copy)
-    // Behält Formatierung (inkl Zeilenumbrüche)
-    
-    return buffer.str();
-    // .str() = gibt String-Inhalt zurück
-    // Konvertiert ostringstream zu std::string
-    //  Gibt gesamten Datei-Inhalt zurück
-    //
-    // raii file wird automatisch geschlossen (auch bei Exception)
+    // load_file liest kleine Dateien mit einem einzigen Read direkt in den String
+    // (früher ifstream -> ostringstream -> str(), also zwei volle Kopien)
+    // große Dateien werden gemappt und nur einmal kopiert
+    // RAII: Datei bzw. Mapping wird im Destruktor von FileContent geschlossen
+    FileContent content = load_file(file_path);
+    return content.release_string();
 }
 
 
@@ -146,4 +108,36 @@ std::string extract_snippet(const std::string& text, size_t position, size_t con
 
 }
 
-} 
\ No newline at end of file
+
+// string_heap_bytes: wie viel Heap Speicher ein String belegt
+size_t string_heap_bytes(const std::string& str) noexcept {
+    // Kurze Strings liegen im String Objekt selbst (Small String Optimization)
+    // erst wenn capacity größer als der interne Puffer ist, wird auf dem Heap allokiert
+    static const size_t sso_capacity = std::string().capacity();
+    if (str.capacity() <= sso_capacity) {
+        return 0;
+    }
+    return str.capacity() + 1;  // +1 für das abschließende '\0'
+}
+
+
+// format_bytes: Bytes lesbar formatieren (B, KB, MB, GB)
+std::string format_bytes(size_t bytes) {
+    const char* units[] = {"B", "KB", "MB", "GB", "TB"};
+    double value = static_cast<double>(bytes);
+    size_t unit = 0;
+    while (value >= 1024.0 && unit < 4) {
+        value /= 1024.0;
+        ++unit;
+    }
+    
+    std::ostringstream out;
+    if (unit == 0) {
+        out << bytes << " B";
+    } else {
+        out << std::fixed << std::setprecision(1) << value << " " << units[unit];
+    }
+    return out.str();
+}
+
+}